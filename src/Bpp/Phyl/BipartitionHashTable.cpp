@@ -0,0 +1,333 @@
+//
+// File: BipartitionHashTable.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "BipartitionHashTable.h"
+#include "BipartitionTools.h"
+#include "TreeTemplate.h"
+
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+#include <memory>
+#include <climits> // defines CHAR_BIT
+
+using namespace std;
+
+/******************************************************************************/
+
+BipartitionHashTable::BipartitionHashTable(const vector<string>& elements) throw (Exception) :
+  elements_(elements),
+  elementIndex_(),
+  nbWords_((elements.size() + 63) / 64),
+  lastWordMask_(elements.size() % 64 == 0 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << (elements.size() % 64)) - 1),
+  nbTrees_(0),
+  nbOccurrences_(0),
+  bitsets_(),
+  hashes_(),
+  counts_(),
+  lastOccurrences_(),
+  table_()
+{
+  std::sort(elements_.begin(), elements_.end());
+  for (size_t i = 0; i < elements_.size(); i++)
+  {
+    if (i > 0 && elements_[i] == elements_[i - 1])
+      throw Exception("BipartitionHashTable::BipartitionHashTable. Duplicated element: " + elements_[i] + ".");
+    elementIndex_[elements_[i]] = i;
+  }
+}
+
+/******************************************************************************/
+
+size_t BipartitionHashTable::countBits_(uint64_t word)
+{
+  word = word - ((word >> 1) & 0x5555555555555555ULL);
+  word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+  word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast<size_t>((word * 0x0101010101010101ULL) >> 56);
+}
+
+/******************************************************************************/
+
+uint64_t BipartitionHashTable::hash_(const uint64_t* bitset, size_t nbWords)
+{
+  uint64_t h = 0x9E3779B97F4A7C15ULL;
+  for (size_t k = 0; k < nbWords; k++)
+  {
+    // SplitMix64 finalizer:
+    uint64_t x = h ^ bitset[k];
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    h = x ^ (x >> 31);
+  }
+  return h;
+}
+
+/******************************************************************************/
+
+void BipartitionHashTable::canonicalize_(uint64_t* bitset) const
+{
+  if (nbWords_ == 0) return;
+  bitset[nbWords_ - 1] &= lastWordMask_;
+  if (bitset[0] & 1)
+  {
+    for (size_t k = 0; k < nbWords_; k++)
+      bitset[k] = ~bitset[k];
+    bitset[nbWords_ - 1] &= lastWordMask_;
+  }
+}
+
+/******************************************************************************/
+
+size_t BipartitionHashTable::getPartitionSize(const uint64_t* bitset) const
+{
+  size_t size = 0;
+  for (size_t k = 0; k < nbWords_; k++)
+    size += countBits_(bitset[k]);
+  return min(size, elements_.size() - size);
+}
+
+/******************************************************************************/
+
+size_t BipartitionHashTable::find(const uint64_t* bitset) const
+{
+  if (table_.size() == 0) return counts_.size();
+  uint64_t hash = hash_(bitset, nbWords_);
+  size_t mask = table_.size() - 1;
+  for (size_t slot = static_cast<size_t>(hash) & mask; table_[slot] != 0; slot = (slot + 1) & mask)
+  {
+    size_t i = table_[slot] - 1;
+    if (hashes_[i] == hash && std::equal(bitset, bitset + nbWords_, bitsets_.begin() + static_cast<ptrdiff_t>(i * nbWords_)))
+      return i;
+  }
+  return counts_.size();
+}
+
+/******************************************************************************/
+
+void BipartitionHashTable::rehash_(size_t size)
+{
+  table_.assign(size, 0);
+  size_t mask = size - 1;
+  for (size_t i = 0; i < hashes_.size(); i++)
+  {
+    size_t slot = static_cast<size_t>(hashes_[i]) & mask;
+    while (table_[slot] != 0)
+      slot = (slot + 1) & mask;
+    table_[slot] = i + 1;
+  }
+}
+
+/******************************************************************************/
+
+size_t BipartitionHashTable::add_(const uint64_t* bitset, uint64_t hash)
+{
+  // Keep the load factor under 1/2:
+  if (2 * (counts_.size() + 1) > table_.size())
+    rehash_(max(static_cast<size_t>(64), 2 * table_.size()));
+  size_t mask = table_.size() - 1;
+  size_t slot = static_cast<size_t>(hash) & mask;
+  for ( ; table_[slot] != 0; slot = (slot + 1) & mask)
+  {
+    size_t i = table_[slot] - 1;
+    if (hashes_[i] == hash && std::equal(bitset, bitset + nbWords_, bitsets_.begin() + static_cast<ptrdiff_t>(i * nbWords_)))
+    {
+      counts_[i]++;
+      lastOccurrences_[i] = nbOccurrences_++;
+      return i;
+    }
+  }
+  size_t i = counts_.size();
+  bitsets_.insert(bitsets_.end(), bitset, bitset + nbWords_);
+  hashes_.push_back(hash);
+  counts_.push_back(1);
+  lastOccurrences_.push_back(nbOccurrences_++);
+  table_[slot] = i + 1;
+  return i;
+}
+
+/******************************************************************************/
+
+bool BipartitionHashTable::areCompatible(size_t i, size_t j) const
+{
+  const uint64_t* b1 = getBitBipartition(i);
+  const uint64_t* b2 = getBitBipartition(j);
+  bool uu = false, uz = false, zu = false, zz = false;
+  for (size_t k = 0; k < nbWords_; k++)
+  {
+    uint64_t mask = (k == nbWords_ - 1 ? lastWordMask_ : ~static_cast<uint64_t>(0));
+    uu = uu || (b1[k] & b2[k]) != 0;
+    uz = uz || (b1[k] & ~b2[k] & mask) != 0;
+    zu = zu || (~b1[k] & b2[k] & mask) != 0;
+    zz = zz || (~b1[k] & ~b2[k] & mask) != 0;
+    if (uu && uz && zu && zz)
+      return false;
+  }
+  return true;
+}
+
+/******************************************************************************/
+
+void BipartitionHashTable::computeBipartitions(const Tree& tree, vector<uint64_t>& bitsets, vector<int>& nodeIds, bool includeTrivial) const throw (Exception)
+{
+  bitsets.clear();
+  nodeIds.clear();
+  const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(&tree);
+  unique_ptr< TreeTemplate<Node> > tmp;
+  if (!ttree)
+  {
+    tmp.reset(new TreeTemplate<Node>(tree));
+    ttree = tmp.get();
+  }
+  const Node* root = ttree->getRootNode();
+  // When the root node has two sons, both branches define the same bipartition:
+  const Node* skipped = (root->getNumberOfSons() == 2 ? root->getSon(1) : 0);
+
+  // Iterative post-order traversal. Each level of the stack has its own bitset,
+  // which is merged into the one of the level above when the node is done.
+  vector< pair<const Node*, size_t> > stack;
+  vector<uint64_t> levels;
+  stack.push_back(make_pair(root, 0));
+  levels.assign(nbWords_, 0);
+  while (!stack.empty())
+  {
+    size_t level = stack.size() - 1;
+    const Node* node = stack.back().first;
+    size_t son = stack.back().second;
+    if (son < node->getNumberOfSons())
+    {
+      stack.back().second++;
+      stack.push_back(make_pair(node->getSon(son), 0));
+      levels.resize((level + 2) * nbWords_);
+      std::fill(levels.begin() + static_cast<ptrdiff_t>((level + 1) * nbWords_), levels.end(), 0);
+      continue;
+    }
+    uint64_t* bitset = (nbWords_ > 0 ? &levels[level * nbWords_] : 0);
+    if (node->getNumberOfSons() == 0)
+    {
+      map<string, size_t>::const_iterator it = elementIndex_.find(node->getName());
+      if (it == elementIndex_.end())
+        throw Exception("BipartitionHashTable::computeBipartitions. Unknown leaf name: " + node->getName() + ".");
+      bitset[it->second / 64] |= static_cast<uint64_t>(1) << (it->second % 64);
+    }
+    if (level > 0)
+    {
+      if (node != skipped)
+      {
+        size_t begin = bitsets.size();
+        bitsets.insert(bitsets.end(), bitset, bitset + nbWords_);
+        canonicalize_(&bitsets[begin]);
+        if (includeTrivial || getPartitionSize(&bitsets[begin]) >= 2)
+          nodeIds.push_back(node->getId());
+        else
+          bitsets.resize(begin);
+      }
+      uint64_t* fatherBitset = &levels[(level - 1) * nbWords_];
+      for (size_t k = 0; k < nbWords_; k++)
+        fatherBitset[k] |= bitset[k];
+    }
+    stack.pop_back();
+  }
+}
+
+/******************************************************************************/
+
+void BipartitionHashTable::addTree(const Tree& tree) throw (Exception)
+{
+  vector<uint64_t> bitsets;
+  vector<int> nodeIds;
+  computeBipartitions(tree, bitsets, nodeIds);
+  for (size_t i = 0; i < nodeIds.size(); i++)
+  {
+    const uint64_t* bitset = &bitsets[i * nbWords_];
+    add_(bitset, hash_(bitset, nbWords_));
+  }
+  nbTrees_++;
+}
+
+/******************************************************************************/
+
+BipartitionList* BipartitionHashTable::toBipartitionList(const vector<size_t>& indices, bool addTrivial) const
+{
+  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
+  size_t nbword = (elements_.size() + lword - 1) / lword;
+  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
+
+  vector<int*> bitBipL;
+  for (size_t i = 0; i < indices.size(); i++)
+  {
+    const uint64_t* bitset = getBitBipartition(indices[i]);
+    size_t size = 0;
+    for (size_t k = 0; k < nbWords_; k++)
+      size += countBits_(bitset[k]);
+    // The smallest partition is coded with ones:
+    bool flip = size > elements_.size() / 2;
+    int* bip = new int[nbint];
+    std::fill(bip, bip + nbint, 0);
+    for (size_t e = 0; e < elements_.size(); e++)
+    {
+      bool bit = ((bitset[e / 64] >> (e % 64)) & 1) != 0;
+      if (bit != flip)
+        BipartitionTools::bit1(bip, static_cast<int>(e));
+    }
+    bitBipL.push_back(bip);
+  }
+  if (addTrivial)
+  {
+    for (size_t e = 0; e < elements_.size(); e++)
+    {
+      int* bip = new int[nbint];
+      std::fill(bip, bip + nbint, 0);
+      BipartitionTools::bit1(bip, static_cast<int>(e));
+      bitBipL.push_back(bip);
+    }
+  }
+
+  // The BipartitionList constructor copies the arrays:
+  BipartitionList* bipL = new BipartitionList(elements_, bitBipL);
+  for (size_t i = 0; i < bitBipL.size(); i++)
+    delete[] bitBipL[i];
+  return bipL;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,237 @@
+//
+// File: BipartitionHashTable.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _BIPARTITIONHASHTABLE_H_
+#define _BIPARTITIONHASHTABLE_H_
+
+#include "Tree.h"
+#include "BipartitionList.h"
+
+#include <Bpp/Clonable.h>
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <map>
+#include <stdint.h>
+
+namespace bpp
+{
+
+/**
+ * @brief A hash table of bipartitions, counting the number of occurrences of each of them in a set of trees.
+ *
+ * Bipartitions are stored as bitsets of 64 bits words, one bit per element (leaf names, in alphabetic order),
+ * contiguously in a single vector. Each bipartition is stored in a canonical orientation, where the bit of
+ * the first element is 0, so that two identical bipartitions always have the same bitset.
+ * Distinct bipartitions are indexed by an open addressing hash table, so that adding a tree, or retrieving
+ * the number of occurrences of a bipartition, takes a time linear in the number of elements per branch,
+ * independently of the number of stored bipartitions.
+ *
+ * Only non-trivial bipartitions (both partitions containing at least two elements) are stored.
+ * As for BipartitionList, trees are considered as unrooted: when the root node has two sons,
+ * the two corresponding branches define a single bipartition.
+ *
+ * @see BipartitionList, TreeTools::bipartitionOccurrences, TreeTools::computeBootstrapValues
+ */
+class BipartitionHashTable:
+  public virtual Clonable
+{
+  private:
+    std::vector<std::string> elements_;
+    std::map<std::string, size_t> elementIndex_;
+    size_t nbWords_;
+    uint64_t lastWordMask_;
+    size_t nbTrees_;
+    size_t nbOccurrences_;
+
+    /**
+     * @brief Bitsets of all distinct bipartitions, nbWords_ words each.
+     */
+    std::vector<uint64_t> bitsets_;
+    std::vector<uint64_t> hashes_;
+    std::vector<size_t> counts_;
+    std::vector<size_t> lastOccurrences_;
+
+    /**
+     * @brief The hash table, with 0 for empty slots and the index of a bipartition + 1 otherwise.
+     */
+    std::vector<size_t> table_;
+
+  public:
+    /**
+     * @param elements The element names (typically leaf names), in any order.
+     * @throw Exception If an element name is duplicated.
+     */
+    BipartitionHashTable(const std::vector<std::string>& elements) throw (Exception);
+
+    virtual ~BipartitionHashTable() {}
+
+    BipartitionHashTable* clone() const { return new BipartitionHashTable(*this); }
+
+  public:
+    /**
+     * @return The element names, in alphabetic order.
+     */
+    const std::vector<std::string>& getElementNames() const { return elements_; }
+
+    size_t getNumberOfElements() const { return elements_.size(); }
+
+    /**
+     * @return The number of 64 bits words of each bitset.
+     */
+    size_t getNumberOfWords() const { return nbWords_; }
+
+    /**
+     * @return The number of trees added to the table.
+     */
+    size_t getNumberOfTrees() const { return nbTrees_; }
+
+    /**
+     * @return The number of distinct bipartitions in the table.
+     */
+    size_t getNumberOfBipartitions() const { return counts_.size(); }
+
+    /**
+     * @return The bitset of a bipartition of the table.
+     * @param i The index of the bipartition.
+     */
+    const uint64_t* getBitBipartition(size_t i) const { return &bitsets_[i * nbWords_]; }
+
+    /**
+     * @return The number of occurrences of a bipartition of the table.
+     * @param i The index of the bipartition.
+     */
+    size_t getCount(size_t i) const { return counts_[i]; }
+
+    /**
+     * @return The rank of the last occurrence of a bipartition among all added ones,
+     * which is its position if the non-trivial bipartitions of all trees were concatenated.
+     * @param i The index of the bipartition.
+     */
+    size_t getLastOccurrence(size_t i) const { return lastOccurrences_[i]; }
+
+    /**
+     * @return The size of the smallest partition of a bipartition of the table.
+     * @param i The index of the bipartition.
+     */
+    size_t getPartitionSize(size_t i) const { return getPartitionSize(getBitBipartition(i)); }
+
+    /**
+     * @return The size of the smallest partition of a bipartition.
+     * @param bitset The bitset of the bipartition.
+     */
+    size_t getPartitionSize(const uint64_t* bitset) const;
+
+    /**
+     * @return The index of a bipartition in the table, or getNumberOfBipartitions() if it is not found.
+     * @param bitset A bitset in canonical orientation.
+     */
+    size_t find(const uint64_t* bitset) const;
+
+    /**
+     * @return The number of occurrences of a bipartition, 0 if it is not in the table.
+     * @param bitset A bitset in canonical orientation.
+     */
+    size_t getCount(const uint64_t* bitset) const
+    {
+      size_t i = find(bitset);
+      return i < counts_.size() ? counts_[i] : 0;
+    }
+
+    /**
+     * @brief Tells whether two bipartitions of the table are compatible (see BipartitionList::areCompatible).
+     *
+     * @param i The index of the first bipartition.
+     * @param j The index of the second bipartition.
+     */
+    bool areCompatible(size_t i, size_t j) const;
+
+    /**
+     * @brief Add all bipartitions of a tree.
+     *
+     * @param tree The tree, with leaf names matching the elements of the table.
+     * @throw Exception If a leaf name is not an element of the table.
+     */
+    void addTree(const Tree& tree) throw (Exception);
+
+    /**
+     * @brief Compute the canonical bitsets of the bipartitions of a tree, without adding them.
+     *
+     * Bipartitions are listed in post-order, in the same order as in a BipartitionList built from the same tree.
+     *
+     * @param tree The tree, with leaf names matching the elements of the table.
+     * @param bitsets [out] The bitsets, getNumberOfWords() words each.
+     * @param nodeIds [out] The id of the node under each bipartition.
+     * @param includeTrivial Tell if trivial bipartitions should be listed too.
+     * @throw Exception If a leaf name is not an element of the table.
+     */
+    void computeBipartitions(const Tree& tree, std::vector<uint64_t>& bitsets, std::vector<int>& nodeIds, bool includeTrivial = false) const throw (Exception);
+
+    /**
+     * @brief Build a BipartitionList from some bipartitions of the table.
+     *
+     * In the output list, the smallest partition of each bipartition is coded with ones.
+     *
+     * @param indices The indices of the bipartitions to include, in the order of the output list.
+     * @param addTrivial If true, the trivial bipartitions of all elements are added at the end of the list.
+     * @return A new BipartitionList object, with sorted elements.
+     */
+    BipartitionList* toBipartitionList(const std::vector<size_t>& indices, bool addTrivial = false) const;
+
+  private:
+    static uint64_t hash_(const uint64_t* bitset, size_t nbWords);
+
+    size_t add_(const uint64_t* bitset, uint64_t hash);
+
+    void rehash_(size_t size);
+
+    /**
+     * @brief Put a bitset in canonical orientation.
+     */
+    void canonicalize_(uint64_t* bitset) const;
+
+    static size_t countBits_(uint64_t word);
+};
+
+} //end of namespace bpp.
+
+#endif //_BIPARTITIONHASHTABLE_H_
+
@@ -59,6 +59,22 @@ double BioNJ::computeDistancesFromPair(const vector<size_t>& pair, const vector<
 
 void BioNJ::computeTree() throw (Exception)
 {
+  if (fastSearch_)
+  {
+    size_t n = variance_.size();
+    flatVariance_.resize(n * (n - 1) / 2);
+    for (size_t i = 1; i < n; i++)
+    {
+      for (size_t j = 0; j < i; j++)
+      {
+        flatVariance_[getFlatIndex_(i, j)] = variance_(i, j);
+      }
+    }
+    NeighborJoining::computeTree();
+    vector<double>().swap(flatVariance_);
+    return;
+  }
+
   // Initialization:
   for (size_t i = 0; i < matrix_.size(); i++)
   {
@@ -128,3 +144,40 @@ void BioNJ::computeTree() throw (Exception)
   finalStep(idNextNode);
 }
 
+void BioNJ::computeFlatDistancesFromPair_(size_t a, size_t b, const vector<double>& branchLengths, const vector<size_t>& active, vector<double>& newDist)
+{
+  double vab = flatVariance_[getFlatIndex_(a, b)];
+  // compute lambda
+  lambda_ = 0;
+  if (vab == 0)
+    lambda_ = .5;
+  else
+  {
+    for (size_t k = 0; k < active.size(); k++)
+    {
+      size_t id = active[k];
+      if (id != a && id != b)
+        lambda_ += (flatVariance_[getFlatIndex_(b, id)] - flatVariance_[getFlatIndex_(a, id)]);
+    }
+    double div = 2 * static_cast<double>(active.size() - 2) * vab;
+    lambda_ /= div;
+    lambda_ += .5;
+  }
+  if (lambda_ < 0.)
+    lambda_ = 0.;
+  if (lambda_ > 1.)
+    lambda_ = 1.;
+
+  for (size_t k = 0; k < active.size(); k++)
+  {
+    size_t id = active[k];
+    if (id == a || id == b) continue;
+    size_t ia = getFlatIndex_(a, id);
+    size_t ib = getFlatIndex_(b, id);
+    double d = lambda_ * (flatMatrix_[ia] - branchLengths[0]) + (1 - lambda_) * (flatMatrix_[ib] - branchLengths[1]);
+    newDist[id] = positiveLengths_ ? std::max(d, 0.) : d;
+    // Each variance is only read here, so it can be updated at once:
+    flatVariance_[ia] = lambda_ * flatVariance_[ia] + (1 - lambda_) * flatVariance_[ib] - lambda_ * (1 - lambda_) * vab;
+  }
+}
+
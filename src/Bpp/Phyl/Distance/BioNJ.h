@@ -59,6 +59,13 @@ private:
   DistanceMatrix variance_;
   double lambda_;
 
+  /**
+   * @brief The variances between current nodes, used by the fast search.
+   *
+   * Stored as NeighborJoining::flatMatrix_.
+   */
+  std::vector<double> flatVariance_;
+
 public:
   /**
    * @brief Create a new BioNJ object instance and compute a tree from a distance matrix.
@@ -70,7 +77,8 @@ public:
   BioNJ(bool rooted = false, bool positiveLengths = false, bool verbose = true) :
     NeighborJoining(rooted, positiveLengths, verbose),
     variance_(0),
-    lambda_(0) {}
+    lambda_(0),
+    flatVariance_() {}
 
   /**
    * @brief Create a new BioNJ object instance and compute a tree from a distance matrix.
@@ -84,7 +92,8 @@ public:
     NeighborJoining(rooted, positiveLengths, verbose),
     // Use the default constructor, because the other one call computeTree.
     variance_(matrix),
-    lambda_(0)
+    lambda_(0),
+    flatVariance_()
   {
     setDistanceMatrix(matrix);
     outputPositiveLengths(positiveLengths);
@@ -105,6 +114,9 @@ public:
   }
   void computeTree() throw (Exception);
   double computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos);
+
+protected:
+  void computeFlatDistancesFromPair_(size_t a, size_t b, const std::vector<double>& branchLengths, const std::vector<size_t>& active, std::vector<double>& newDist);
 };
 } // end of namespace bpp.
 
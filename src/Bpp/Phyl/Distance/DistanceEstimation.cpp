@@ -41,7 +41,6 @@
 #include "DistanceEstimation.h"
 #include "../Tree.h"
 #include "../PatternTools.h"
-#include "../SitePatterns.h"
 
 // From bpp-core:
 #include <Bpp/App/ApplicationTools.h>
@@ -51,6 +50,7 @@
 #include <Bpp/Seq/SiteTools.h>
 #include <Bpp/Seq/Sequence.h>
 #include <Bpp/Seq/Container/AlignedSequenceContainer.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
 #include <Bpp/Seq/DistanceMatrix.h>
 
 using namespace bpp;
@@ -60,6 +60,8 @@ using namespace bpp;
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <mutex>
 
 using namespace std;
 
@@ -72,55 +74,65 @@ TwoTreeLikelihood::TwoTreeLikelihood(
     DiscreteDistribution* rDist,
     bool verbose) throw (Exception) :
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(rDist, verbose),
-  shrunkData_(0), seqnames_(2), model_(model), brLenParameters_(), pxy_(), dpxy_(), d2pxy_(),
-  rootPatternLinks_(), rootWeights_(), nbSites_(0), nbClasses_(0), nbStates_(0), nbDistinctSites_(0),
+  seqnames_(2), contents1_(), contents2_(), dataAlphabet_(0), pairData_(),
+  model_(model), brLenParameters_(), pxy_(), dpxy_(), d2pxy_(),
+  rootPatternLinks_(), rootWeights_(), rootStates1_(), rootStates2_(), patternIndex_(),
+  nbSites_(0), nbClasses_(0), nbStates_(0), nbDistinctSites_(0),
   rootLikelihoods_(), rootLikelihoodsS_(), rootLikelihoodsSR_(), dLikelihoods_(), d2Likelihoods_(),
   leafLikelihoods1_(), leafLikelihoods2_(),
   minimumBrLen_(0.000001), brLenConstraint_(0), brLen_(0)
+{
+  if (verbose)
+    ApplicationTools::displayMessage("Double-Recursive Homogeneous Tree Likelihood");
+
+  // Init _likelihoods:
+  if (verbose) ApplicationTools::displayTask("Init likelihoods arrays");
+  setSequences(seq1, seq2, data);
+  brLenConstraint_ = new IntervalConstraint(1, minimumBrLen_, true);
+  if (verbose) ApplicationTools::displayTaskDone();
+
+  if (verbose)
+    ApplicationTools::displayResult("Number of distinct sites", TextTools::toString(nbDistinctSites_));
+}
+
+/******************************************************************************/
+
+void TwoTreeLikelihood::setSequences(const std::string& seq1, const std::string& seq2, const SiteContainer& data) throw (Exception)
 {
   seqnames_[0] = seq1;
   seqnames_[1] = seq2;
-  data_ = PatternTools::getSequenceSubset(data, seqnames_);
-  if (data_->getAlphabet()->getAlphabetType()
+  if (data.getAlphabet()->getAlphabetType()
       != model_->getAlphabet()->getAlphabetType())
     throw AlphabetMismatchException("TwoTreeTreeLikelihood::TwoTreeTreeLikelihood. Data and model must have the same alphabet type.",
-                                    data_->getAlphabet(),
+                                    data.getAlphabet(),
                                     model_->getAlphabet());
 
-  nbSites_   = data_->getNumberOfSites();
+  nbSites_   = data.getNumberOfSites();
   nbClasses_ = rateDistribution_->getNumberOfCategories();
   nbStates_  = model_->getNumberOfStates();
-  if (verbose)
-    ApplicationTools::displayMessage("Double-Recursive Homogeneous Tree Likelihood");
 
-  // Initialize root patterns:
-  SitePatterns pattern(data_);
-  shrunkData_       = pattern.getSites();
-  rootWeights_      = pattern.getWeights();
-  rootPatternLinks_ = pattern.getIndices();
-  nbDistinctSites_  = shrunkData_->getNumberOfSites();
-  if (verbose)
-    ApplicationTools::displayResult("Number of distinct sites", TextTools::toString(nbDistinctSites_));
-
-  // Init _likelihoods:
-  if (verbose) ApplicationTools::displayTask("Init likelihoods arrays recursively");
-  // Clone data for more efficiency on sequences access:
-  const SiteContainer* sequences = new AlignedSequenceContainer(*shrunkData_);
-  initTreeLikelihoods(*sequences);
-  delete sequences;
+  // Sequences are read in place, no copy of the pair is made:
+  const Sequence& sequence1 = data.getSequence(seq1);
+  const Sequence& sequence2 = data.getSequence(seq2);
+  initTreeLikelihoods(sequence1, sequence2);
+  contents1_ = sequence1.getContent();
+  contents2_ = sequence2.getContent();
+  dataAlphabet_ = data.getAlphabet();
+  pairData_.reset();
 
   brLen_ = minimumBrLen_;
-  brLenConstraint_ = new IntervalConstraint(1, minimumBrLen_, true);
-
-  if (verbose) ApplicationTools::displayTaskDone();
+  initialized_ = false;
 }
 
 /******************************************************************************/
 
 TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
   AbstractDiscreteRatesAcrossSitesTreeLikelihood(lik),
-  shrunkData_        (dynamic_cast<SiteContainer*>(lik.shrunkData_->clone())),
   seqnames_          (lik.seqnames_),
+  contents1_         (lik.contents1_),
+  contents2_         (lik.contents2_),
+  dataAlphabet_      (lik.dataAlphabet_),
+  pairData_          (),
   model_             (lik.model_),
   brLenParameters_   (lik.brLenParameters_),
   pxy_               (lik.pxy_),
@@ -128,6 +140,9 @@ TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
   d2pxy_             (lik.d2pxy_),
   rootPatternLinks_  (lik.rootPatternLinks_),
   rootWeights_       (lik.rootWeights_),
+  rootStates1_       (lik.rootStates1_),
+  rootStates2_       (lik.rootStates2_),
+  patternIndex_      (),
   nbSites_           (lik.nbSites_),
   nbClasses_         (lik.nbClasses_),
   nbStates_          (lik.nbStates_),
@@ -149,8 +164,11 @@ TwoTreeLikelihood::TwoTreeLikelihood(const TwoTreeLikelihood& lik) :
 TwoTreeLikelihood& TwoTreeLikelihood::operator=(const TwoTreeLikelihood& lik)
 {
   AbstractDiscreteRatesAcrossSitesTreeLikelihood::operator=(lik);
-  shrunkData_        = dynamic_cast<SiteContainer*>(lik.shrunkData_->clone());
   seqnames_          = lik.seqnames_;
+  contents1_         = lik.contents1_;
+  contents2_         = lik.contents2_;
+  dataAlphabet_      = lik.dataAlphabet_;
+  pairData_.reset();
   model_             = lik.model_;
   brLenParameters_   = lik.brLenParameters_;
   pxy_               = lik.pxy_;
@@ -158,6 +176,8 @@ TwoTreeLikelihood& TwoTreeLikelihood::operator=(const TwoTreeLikelihood& lik)
   d2pxy_             = lik.d2pxy_;
   rootPatternLinks_  = lik.rootPatternLinks_;
   rootWeights_       = lik.rootWeights_;
+  rootStates1_       = lik.rootStates1_;
+  rootStates2_       = lik.rootStates2_;
   nbSites_           = lik.nbSites_;
   nbClasses_         = lik.nbClasses_;
   nbStates_          = lik.nbStates_;
@@ -179,7 +199,6 @@ TwoTreeLikelihood& TwoTreeLikelihood::operator=(const TwoTreeLikelihood& lik)
 
 TwoTreeLikelihood::~TwoTreeLikelihood()
 {
-  delete shrunkData_;
   if (brLenConstraint_) delete brLenConstraint_;
 }
 
@@ -194,6 +213,20 @@ void TwoTreeLikelihood::initialize() throw (Exception)
 
 /******************************************************************************/
 
+const SiteContainer* TwoTreeLikelihood::getData() const
+{
+  if (!pairData_.get())
+  {
+    VectorSiteContainer* sites = new VectorSiteContainer(dataAlphabet_);
+    sites->addSequence(BasicSequence(seqnames_[0], contents1_, dataAlphabet_), false);
+    sites->addSequence(BasicSequence(seqnames_[1], contents2_, dataAlphabet_), false);
+    pairData_.reset(sites);
+  }
+  return pairData_.get();
+}
+
+/******************************************************************************/
+
 ParameterList TwoTreeLikelihood::getBranchLengthsParameters() const
 {
   if (!initialized_) throw Exception("TwoTreeLikelihood::getBranchLengthsParameters(). Object is not initialized.");
@@ -416,20 +449,54 @@ throw (Exception)
 
 /******************************************************************************/
 
-void TwoTreeLikelihood::initTreeLikelihoods(const SequenceContainer& sequences) throw (Exception)
+void TwoTreeLikelihood::initTreeLikelihoods(const Sequence& sequence1, const Sequence& sequence2) throw (Exception)
 {
-  const Sequence* seq1 = &sequences.getSequence(seqnames_[0]);
-  const Sequence* seq2 = &sequences.getSequence(seqnames_[1]);
+  const Sequence* seq1 = &sequence1;
+  const Sequence* seq2 = &sequence2;
+
+  // Compress sites according to the pair of states they show.
+  // Alphabet states are first mapped onto a contiguous range, to index patterns in a flat table:
+  int minState = 0, maxState = 0;
+  for (size_t i = 0; i < nbSites_; i++)
+  {
+    minState = min(minState, min(seq1->getValue(i), seq2->getValue(i)));
+    maxState = max(maxState, max(seq1->getValue(i), seq2->getValue(i)));
+  }
+  size_t nbAlphabetStates = static_cast<size_t>(maxState - minState + 1);
+  patternIndex_.assign(nbAlphabetStates * nbAlphabetStates, nbSites_);
+  rootPatternLinks_.resize(nbSites_);
+  rootWeights_.clear();
+  vector<size_t> firstSites;
+  for (size_t i = 0; i < nbSites_; i++)
+  {
+    size_t* index = &patternIndex_[static_cast<size_t>(seq1->getValue(i) - minState) * nbAlphabetStates
+                                   + static_cast<size_t>(seq2->getValue(i) - minState)];
+    if (*index == nbSites_)
+    {
+      *index = rootWeights_.size();
+      rootWeights_.push_back(0);
+      firstSites.push_back(i);
+    }
+    rootPatternLinks_[i] = *index;
+    rootWeights_[*index]++;
+  }
+  nbDistinctSites_ = rootWeights_.size();
+
   leafLikelihoods1_.resize(nbDistinctSites_);
   leafLikelihoods2_.resize(nbDistinctSites_);
+  rootStates1_.resize(nbDistinctSites_);
+  rootStates2_.resize(nbDistinctSites_);
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
    Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
    Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
    leafLikelihoods1_i->resize(nbStates_);
    leafLikelihoods2_i->resize(nbStates_);
-   int state1 = seq1->getValue(i);
-   int state2 = seq2->getValue(i);
+   int state1 = seq1->getValue(firstSites[i]);
+   int state2 = seq2->getValue(firstSites[i]);
+   size_t nbNonNull1 = 0, nbNonNull2 = 0;
+   rootStates1_[i] = -1;
+   rootStates2_[i] = -1;
     for (size_t s = 0; s < nbStates_; s++)
     {
       // Leaves likelihood are set to 1 if the char correspond to the site in the sequence,
@@ -443,7 +510,14 @@ void TwoTreeLikelihood::initTreeLikelihoods(const SequenceContainer& sequences)
       {
         throw SequenceNotFoundException("TwoTreeLikelihood::initTreelikelihoods. Leaf name in tree not found in site conainer: ", snfe.getSequenceId());
       }
+      if ((*leafLikelihoods1_i)[s] != 0) { nbNonNull1++; rootStates1_[i] = static_cast<int>(s); }
+      if ((*leafLikelihoods2_i)[s] != 0) { nbNonNull2++; rootStates2_[i] = static_cast<int>(s); }
     }
+    // Only states with a single possible value and a likelihood of 1 are considered as unambiguous:
+    if (nbNonNull1 != 1 || (*leafLikelihoods1_i)[static_cast<size_t>(rootStates1_[i])] != 1.)
+      rootStates1_[i] = -1;
+    if (nbNonNull2 != 1 || (*leafLikelihoods2_i)[static_cast<size_t>(rootStates2_[i])] != 1.)
+      rootStates2_[i] = -1;
   }
 
   // Initialize likelihood vector:
@@ -459,11 +533,7 @@ void TwoTreeLikelihood::initTreeLikelihoods(const SequenceContainer& sequences)
     for (size_t c = 0; c < nbClasses_; c++)
     {
       Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
-      rootLikelihoods_i_c->resize(nbStates_);
-      for (size_t s = 0; s < nbStates_; s++)
-      {
-        (*rootLikelihoods_i_c)[s] = 1.; // All likelihoods are initialized to 1.
-      }
+      rootLikelihoods_i_c->assign(nbStates_, 1.); // All likelihoods are initialized to 1.
     }
   }
 
@@ -481,15 +551,26 @@ void TwoTreeLikelihood::computeTreeLikelihood()
     VVdouble* rootLikelihoods_i = &rootLikelihoods_[i];
     Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
     Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
+    int state2 = rootStates2_[i];
     for (size_t c = 0; c < nbClasses_; c++)
     {
       Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
       VVdouble* pxy_c = &pxy_[c];
       for (size_t x = 0; x < nbStates_; x++)
       {
+        double l1 = (*leafLikelihoods1_i)[x];
+        if (l1 == 0)
+        {
+          (*rootLikelihoods_i_c)[x] = 0;
+          continue;
+        }
         Vdouble* pxy_c_x = &(*pxy_c)[x];
+        if (state2 >= 0)
+        {
+          (*rootLikelihoods_i_c)[x] = l1 * (*pxy_c_x)[static_cast<size_t>(state2)];
+          continue;
+        }
         double l = 0;
-        double l1 = (*leafLikelihoods1_i)[x];
         for (size_t y = 0; y < nbStates_; y++)
         {
           double l2 = (*leafLikelihoods2_i)[y];
@@ -507,16 +588,25 @@ void TwoTreeLikelihood::computeTreeLikelihood()
     // For each site in the sequence,
     VVdouble* rootLikelihoods_i = &rootLikelihoods_[i];
     Vdouble* rootLikelihoodsS_i = &rootLikelihoodsS_[i];
+    int state1 = rootStates1_[i];
     rootLikelihoodsSR_[i] = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
-      (*rootLikelihoodsS_i)[c] = 0;
       // For each rate classe,
       Vdouble* rootLikelihoods_i_c = &(*rootLikelihoods_i)[c];
-      for (size_t x = 0; x < nbStates_; x++)
+      if (state1 >= 0)
+      {
+        // Only one initial state has a non-null likelihood:
+        (*rootLikelihoodsS_i)[c] = fr[static_cast<size_t>(state1)] * (*rootLikelihoods_i_c)[static_cast<size_t>(state1)];
+      }
+      else
       {
-        // For each initial state,
-        (*rootLikelihoodsS_i)[c] += fr[x] * (*rootLikelihoods_i_c)[x];
+        (*rootLikelihoodsS_i)[c] = 0;
+        for (size_t x = 0; x < nbStates_; x++)
+        {
+          // For each initial state,
+          (*rootLikelihoodsS_i)[c] += fr[x] * (*rootLikelihoods_i_c)[x];
+        }
       }
       rootLikelihoodsSR_[i] += p[c] * (*rootLikelihoodsS_i)[c];
     }
@@ -525,32 +615,50 @@ void TwoTreeLikelihood::computeTreeLikelihood()
 
 /******************************************************************************/
 
-void TwoTreeLikelihood::computeTreeDLikelihood()
+double TwoTreeLikelihood::computeSiteLikelihood_(const VVVdouble& pxy, size_t i) const
 {
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  const Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
+  const Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
+  int state1 = rootStates1_[i];
+  int state2 = rootStates2_[i];
+  double li = 0;
+  for (size_t c = 0; c < nbClasses_; c++)
   {
-    Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
-    Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
-    double dli = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
+    const VVdouble* pxy_c = &pxy[c];
+    double lic = 0;
+    if (state1 >= 0 && state2 >= 0)
+    {
+      // Unambiguous pair of states:
+      lic = model_->freq(static_cast<size_t>(state1)) * (*pxy_c)[static_cast<size_t>(state1)][static_cast<size_t>(state2)];
+    }
+    else
     {
-      VVdouble* dpxy_c = &dpxy_[c];
-      double dlic = 0;
       for (size_t x = 0; x < nbStates_; x++)
       {
-        Vdouble* dpxy_c_x = &(*dpxy_c)[x];
         double l1 = (*leafLikelihoods1_i)[x];
-        double dlicx = 0;
+        if (l1 == 0) continue;
+        const Vdouble* pxy_c_x = &(*pxy_c)[x];
+        double licx = 0;
         for (size_t y = 0; y < nbStates_; y++)
         {
           double l2 = (*leafLikelihoods2_i)[y];
-          dlicx += l1 * l2 * (*dpxy_c_x)[y];
+          licx += l1 * l2 * (*pxy_c_x)[y];
         }
-        dlic += dlicx * model_->freq(x);
+        lic += licx * model_->freq(x);
       }
-      dli += dlic * rateDistribution_->getProbability(c);
     }
-    dLikelihoods_[i] = dli / rootLikelihoodsSR_[i];
+    li += lic * rateDistribution_->getProbability(c);
+  }
+  return li;
+}
+
+/******************************************************************************/
+
+void TwoTreeLikelihood::computeTreeDLikelihood()
+{
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+  {
+    dLikelihoods_[i] = computeSiteLikelihood_(dpxy_, i) / rootLikelihoodsSR_[i];
   }
 }
 
@@ -560,28 +668,7 @@ void TwoTreeLikelihood::computeTreeD2Likelihood()
 {
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    Vdouble* leafLikelihoods1_i = &leafLikelihoods1_[i];
-    Vdouble* leafLikelihoods2_i = &leafLikelihoods2_[i];
-    double d2li = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      VVdouble* d2pxy_c = &d2pxy_[c];
-      double d2lic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        Vdouble* d2pxy_c_x = &(*d2pxy_c)[x];
-        double l1 = (*leafLikelihoods1_i)[x];
-        double d2licx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
-        {
-          double l2 = (*leafLikelihoods2_i)[y];
-          d2licx += l1 * l2 * (*d2pxy_c_x)[y];
-        }
-        d2lic += d2licx * model_->freq(x);
-      }
-      d2li += d2lic * rateDistribution_->getProbability(c);
-    }
-    d2Likelihoods_[i] = d2li / rootLikelihoodsSR_[i];
+    d2Likelihoods_[i] = computeSiteLikelihood_(d2pxy_, i) / rootLikelihoodsSR_[i];
   }
 }
 
@@ -655,10 +742,45 @@ void DistanceEstimation::computeMatrix() throw (NullPointerException)
   vector<string> names = sites_->getSequencesNames();
   if (dist_ != 0) delete dist_;
   dist_ = new DistanceMatrix(names);
-  optimizer_->setVerbose(static_cast<unsigned int>(max(static_cast<int>(verbose_) - 2, 0)));
   for (size_t i = 0; i < n; ++i)
   {
     (*dist_)(i, i) = 0;
+  }
+  if (nbThreads_ > 1 && n > 2)
+  {
+    // Each row is computed independently, with its own copy of the model, rate distribution and optimizer.
+    // Rows are distributed dynamically, the longest first.
+    // Sequences are copied first, as a site container may build them on demand:
+    AlignedSequenceContainer sites(*sites_);
+    ThreadPool pool(nbThreads_);
+    mutex displayMutex;
+    size_t nbRowsDone = 0;
+    pool.parallelFor(n - 1, [&](size_t i)
+    {
+      unique_ptr<SubstitutionModel> model(model_->clone());
+      unique_ptr<DiscreteDistribution> rateDist(rateDist_->clone());
+      unique_ptr<Optimizer> optimizer(dynamic_cast<Optimizer*>(optimizer_->clone()));
+      optimizer->setVerbose(0);
+      optimizer->setMessageHandler(0);
+      optimizer->setProfiler(0);
+      unique_ptr<TwoTreeLikelihood> lik;
+      for (size_t j = i + 1; j < n; j++)
+      {
+        (*dist_)(i, j) = (*dist_)(j, i) = computeDistance_(sites, i, j, lik, model.get(), rateDist.get(), optimizer.get(), false);
+      }
+      if (verbose_ > 0)
+      {
+        lock_guard<mutex> lock(displayMutex);
+        ApplicationTools::displayGauge(nbRowsDone++, n - 2, '=');
+      }
+    });
+    return;
+  }
+
+  optimizer_->setVerbose(static_cast<unsigned int>(max(static_cast<int>(verbose_) - 2, 0)));
+  unique_ptr<TwoTreeLikelihood> lik;
+  for (size_t i = 0; i < n; ++i)
+  {
     if (verbose_ == 1)
     {
       ApplicationTools::displayGauge(i, n - 1, '=');
@@ -669,23 +791,7 @@ void DistanceEstimation::computeMatrix() throw (NullPointerException)
       {
         ApplicationTools::displayGauge(j - i - 1, n - i - 2, '=');
       }
-      TwoTreeLikelihood* lik =
-        new TwoTreeLikelihood(names[i], names[j], *sites_, model_.get(), rateDist_.get(), verbose_ > 3);
-      lik->initialize();
-      lik->enableDerivatives(true);
-      size_t d = SymbolListTools::getNumberOfDistinctPositions(sites_->getSequence(i), sites_->getSequence(j));
-      size_t g = SymbolListTools::getNumberOfPositionsWithoutGap(sites_->getSequence(i), sites_->getSequence(j));
-      lik->setParameterValue("BrLen", g == 0 ? lik->getMinimumBranchLength() : std::max(lik->getMinimumBranchLength(), static_cast<double>(d) / static_cast<double>(g)));
-      // Optimization:
-      optimizer_->setFunction(lik);
-      optimizer_->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
-      ParameterList params = lik->getBranchLengthsParameters();
-      params.addParameters(parameters_);
-      optimizer_->init(params);
-      optimizer_->optimize();
-      // Store results:
-      (*dist_)(i, j) = (*dist_)(j, i) = lik->getParameterValue("BrLen");
-      delete lik;
+      (*dist_)(i, j) = (*dist_)(j, i) = computeDistance_(*sites_, i, j, lik, model_.get(), rateDist_.get(), optimizer_, verbose_ > 3);
     }
     if (verbose_ > 1 && ApplicationTools::message) ApplicationTools::message->endLine();
   }
@@ -693,3 +799,29 @@ void DistanceEstimation::computeMatrix() throw (NullPointerException)
 
 /******************************************************************************/
 
+double DistanceEstimation::computeDistance_(const SiteContainer& sites, size_t i, size_t j, unique_ptr<TwoTreeLikelihood>& lik, SubstitutionModel* model, DiscreteDistribution* rateDist, Optimizer* optimizer, bool verbose) const
+{
+  const Sequence& seq1 = sites.getSequence(i);
+  const Sequence& seq2 = sites.getSequence(j);
+  // The likelihood object is reused for all pairs, only its arrays are updated:
+  if (lik.get())
+    lik->setSequences(seq1.getName(), seq2.getName(), sites);
+  else
+    lik.reset(new TwoTreeLikelihood(seq1.getName(), seq2.getName(), sites, model, rateDist, verbose));
+  lik->initialize();
+  lik->enableDerivatives(true);
+  size_t d = SymbolListTools::getNumberOfDistinctPositions(seq1, seq2);
+  size_t g = SymbolListTools::getNumberOfPositionsWithoutGap(seq1, seq2);
+  lik->setParameterValue("BrLen", g == 0 ? lik->getMinimumBranchLength() : std::max(lik->getMinimumBranchLength(), static_cast<double>(d) / static_cast<double>(g)));
+  // Optimization:
+  optimizer->setFunction(lik.get());
+  optimizer->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
+  ParameterList params = lik->getBranchLengthsParameters();
+  params.addParameters(parameters_);
+  optimizer->init(params);
+  optimizer->optimize();
+  return lik->getParameterValue("BrLen");
+}
+
+/******************************************************************************/
+
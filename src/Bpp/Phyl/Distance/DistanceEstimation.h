@@ -45,6 +45,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "../Likelihood/AbstractTreeLikelihood.h"
 #include "../Likelihood/DRHomogeneousTreeLikelihood.h"
 #include "../Likelihood/PseudoNewtonOptimizer.h"
+#include "../ThreadPool.h"
 
 #include <Bpp/Clonable.h>
 #include <Bpp/Numeric/ParameterList.h>
@@ -64,13 +65,28 @@ namespace bpp
 
 /**
  * @brief This class is a simplified version of DRHomogeneousTreeLikelihood for 2-Trees.
+ *
+ * Sites are compressed according to the pair of states they show in the two sequences,
+ * so that the number of distinct sites is bounded by the square of the alphabet size,
+ * whatever the length of the alignment. For a pair of unambiguous states, the likelihood
+ * of a site is directly read from the transition probabilities.
+ *
+ * An instance can be reused for several pairs of sequences with the setSequences() method,
+ * in which case its arrays are not reallocated.
  */
 class TwoTreeLikelihood:
   public AbstractDiscreteRatesAcrossSitesTreeLikelihood  
 {
   private:
-    SiteContainer* shrunkData_;
     std::vector<std::string> seqnames_;
+
+    /**
+     * @brief The content of the two sequences, from which getData() builds a container when needed.
+     */
+    std::vector<int> contents1_, contents2_;
+    const Alphabet* dataAlphabet_;
+    mutable std::unique_ptr<SiteContainer> pairData_;
+
     SubstitutionModel* model_;
     ParameterList brLenParameters_;
     
@@ -98,6 +114,16 @@ class TwoTreeLikelihood:
      */
     std::vector<unsigned int> rootWeights_;
 
+    /**
+     * @brief For each distinct site, the index of the model state in each sequence, or -1 if the state is ambiguous.
+     */
+    std::vector<int> rootStates1_, rootStates2_;
+
+    /**
+     * @brief Buffer used to find the index of a distinct site from the pair of alphabet states.
+     */
+    std::vector<size_t> patternIndex_;
+
     //some values we'll need:
     size_t nbSites_,         //the number of sites in the container
            nbClasses_,       //the number of rate classes
@@ -131,6 +157,21 @@ class TwoTreeLikelihood:
 
     virtual ~TwoTreeLikelihood();
 
+  public:
+    /**
+     * @brief Set the pair of sequences to compare.
+     *
+     * The likelihood arrays are recomputed for the new pair, reusing the memory already allocated.
+     * The sequences are read directly from the container, which is not copied:
+     * only their content is kept, for getData().
+     * The initialize() method has to be called again after this method.
+     *
+     * @param seq1, seq2 The names of the two sequences.
+     * @param data       The container where to find the sequences.
+     * @throw Exception If a sequence is not found, or if the alphabet does not match the one of the model.
+     */
+    void setSequences(const std::string& seq1, const std::string& seq2, const SiteContainer& data) throw (Exception);
+
   public:
 
     /**
@@ -156,6 +197,15 @@ class TwoTreeLikelihood:
     {
       throw NotImplementedException("TwoTreeLikelihood::getLikelihoodData.");
     }  
+    /**
+     * @brief Get the two sequences compared.
+     *
+     * The container is built at the first call after each setSequences(),
+     * and site positions are not kept.
+     */
+    const SiteContainer* getData() const;
+    const Alphabet* getAlphabet() const { return model_->getAlphabet(); }
+    size_t getNumberOfSites() const { return nbSites_; }
     double getLikelihood() const;
     double getLogLikelihood() const;
     double getLikelihoodForASite (size_t site) const;
@@ -259,25 +309,34 @@ class TwoTreeLikelihood:
   protected:
     
     /**
-     * @brief This method initializes the leaves according to a sequence container.
+     * @brief This method initializes the leaves according to a pair of sequences.
      *
-     * Here the container shrunkData_ is used.
+     * Sites are first compressed according to the pair of states of the two sequences,
+     * and the number of occurrences of each pair is stored in rootWeights_.
      * Likelihood is set to 1 for the state corresponding to the sequence site,
      * otherwise it is set to 0.
      *
      * The two likelihood arrays are initialized according to alphabet
-     * size and sequences length, and filled with 1.
-     *
-     * NB: This method is recursive.
+     * size and number of distinct sites, and filled with 1.
      *
-     * @param sequences The sequence container to use.
+     * @param sequence1, sequence2 The two sequences to compare.
      */
-    virtual void initTreeLikelihoods(const SequenceContainer & sequences) throw (Exception);
+    virtual void initTreeLikelihoods(const Sequence& sequence1, const Sequence& sequence2) throw (Exception);
 
     void fireParameterChanged(const ParameterList & params);
     virtual void computeTreeLikelihood();
     virtual void computeTreeDLikelihood();
     virtual void computeTreeD2Likelihood();
+
+    /**
+     * @brief Compute the likelihood of a distinct site, averaged over rate classes, for given probability matrices.
+     *
+     * @param pxy The matrices to use for each rate class (probabilities or their derivatives).
+     * @param i   The index of the distinct site.
+     * @return The sum over rate classes and states of the corresponding likelihoods.
+     */
+    double computeSiteLikelihood_(const VVVdouble& pxy, size_t i) const;
+
     /**
      * @brief This builds the <i>parameters</i> list from all parametrizable objects,
      * <i>i.e.</i> substitution model, rate distribution and tree.
@@ -318,6 +377,7 @@ class DistanceEstimation:
     MetaOptimizer* defaultOptimizer_;
     size_t verbose_;
     ParameterList parameters_;
+    size_t nbThreads_;
 
   public:
   
@@ -346,7 +406,8 @@ class DistanceEstimation:
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1)
     {
       init_();
     }
@@ -381,7 +442,8 @@ class DistanceEstimation:
       optimizer_(0),
       defaultOptimizer_(0),
       verbose_(verbose),
-      parameters_()
+      parameters_(),
+      nbThreads_(1)
     {
       init_();
       if(computeMat) computeMatrix();
@@ -402,7 +464,8 @@ class DistanceEstimation:
       optimizer_(dynamic_cast<Optimizer *>(distanceEstimation.optimizer_->clone())),
       defaultOptimizer_(dynamic_cast<MetaOptimizer *>(distanceEstimation.defaultOptimizer_->clone())),
       verbose_(distanceEstimation.verbose_),
-      parameters_(distanceEstimation.parameters_)
+      parameters_(distanceEstimation.parameters_),
+      nbThreads_(distanceEstimation.nbThreads_)
     {
       if(distanceEstimation.dist_ != 0)
         dist_ = new DistanceMatrix(*distanceEstimation.dist_);
@@ -431,6 +494,7 @@ class DistanceEstimation:
       // _defaultOptimizer has already been initialized since the default constructor has been called.
       verbose_    = distanceEstimation.verbose_;
       parameters_ = distanceEstimation.parameters_;
+      nbThreads_  = distanceEstimation.nbThreads_;
       return *this;
     }
 
@@ -471,6 +535,23 @@ class DistanceEstimation:
      * rate distribution or data are not initialized.
      */
     void computeMatrix() throw (NullPointerException);
+
+  private:
+    /**
+     * @brief Estimate the distance between two sequences.
+     *
+     * @param sites     The sequence data.
+     * @param i, j      The indices of the two sequences.
+     * @param lik       The likelihood object to reuse, created if null.
+     * @param model     The substitution model to use. Its parameters may be changed by the optimization.
+     * @param rateDist  The rate distribution to use. Its parameters may be changed by the optimization.
+     * @param optimizer The optimizer to use.
+     * @param verbose   Tell if the likelihood object should be verbose.
+     * @return The estimated distance.
+     */
+    double computeDistance_(const SiteContainer& sites, size_t i, size_t j, std::unique_ptr<TwoTreeLikelihood>& lik, SubstitutionModel* model, DiscreteDistribution* rateDist, Optimizer* optimizer, bool verbose) const;
+
+  public:
     
     /**
      * @brief Get the distance matrix.
@@ -542,6 +623,33 @@ class DistanceEstimation:
      * @return Verbose level.
      */
     size_t getVerbose() const { return verbose_; }
+
+    /**
+     * @brief Set the number of threads to use in computeMatrix().
+     *
+     * By default, distances are computed sequentially.
+     * When several threads are used, each row of the matrix is computed by a single thread,
+     * using its own copy of the model, rate distribution and optimizer, which are cloned from
+     * the ones of this instance, so that rows do not depend on which thread computed them.
+     * If no additional parameter is estimated, results do not depend on the number of threads.
+     * Otherwise, the initial values of additional parameters are reset at the beginning of each
+     * row with several threads, whereas they are carried over all pairs in the sequential case:
+     * results are then the same for any number of threads greater than 1, but may slightly
+     * differ from the sequential ones.
+     * Messages of the optimizers and likelihood objects are disabled in this case.
+     *
+     * @param nbThreads The total number of threads, including the calling one.
+     * 1 disables parallel computations, and 0 uses as many threads as hardware threads.
+     */
+    void setNumberOfThreads(size_t nbThreads)
+    {
+      nbThreads_ = (nbThreads == 0 ? ThreadPool::getHardwareConcurrency() : nbThreads);
+    }
+
+    /**
+     * @return The number of threads used in computeMatrix().
+     */
+    size_t getNumberOfThreads() const { return nbThreads_; }
 };
 
 } //end of namespace bpp.
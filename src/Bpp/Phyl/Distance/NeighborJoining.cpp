@@ -41,10 +41,13 @@
 #include "NeighborJoining.h"
 #include "../Tree.h"
 
+#include <Bpp/App/ApplicationTools.h>
+
 using namespace bpp;
 
 #include <cmath>
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
@@ -157,3 +160,220 @@ void NeighborJoining::finalStep(int idRoot)
   tree_ = new TreeTemplate<Node>(root);
 }
 
+void NeighborJoining::computeTree() throw (Exception)
+{
+  if (!fastSearch_)
+  {
+    AbstractAgglomerativeDistanceMethod::computeTree();
+    return;
+  }
+
+  // Initialization:
+  size_t n = matrix_.size();
+  size_t nbFinalNodes = rootTree_ ? 2 : 3;
+  vector<Node*> nodes(n);
+  vector<size_t> active(n);
+  vector<bool> isActive(n, true);
+  // Nodes are numbered by order of creation. The sorted distances of a node only contain
+  // the nodes which were created before it, so that each pair is found in a single row:
+  vector<size_t> creation(n);
+  vector< vector< pair<double, size_t> > > sortedRows(n);
+  flatMatrix_.resize(n * (n - 1) / 2);
+  for (size_t i = 0; i < n; ++i)
+  {
+    nodes[i]    = getLeafNode(static_cast<int>(i), matrix_.getName(i));
+    active[i]   = i;
+    creation[i] = i;
+    sumDist_[i] = 0;
+    for (size_t j = 0; j < n; ++j)
+    {
+      sumDist_[i] += matrix_(i, j);
+    }
+    vector< pair<double, size_t> >* row = &sortedRows[i];
+    row->resize(i);
+    for (size_t j = 0; j < i; ++j)
+    {
+      flatMatrix_[getFlatIndex_(i, j)] = matrix_(i, j);
+      (*row)[j] = pair<double, size_t>(matrix_(i, j), j);
+    }
+    sort(row->begin(), row->end());
+  }
+  size_t nextCreation = n;
+  int idNextNode = static_cast<int>(n);
+  vector<double> newDist(n);
+  vector<double> distances(2);
+  vector< pair<size_t, size_t> > candidates;
+  // Sums are computed in the same order as in getBestPair, using the diagonal of matrix_ for self-distances:
+  size_t iteration = 0;
+  vector<size_t> sumIteration(n, 0);
+  auto computeSum = [&](size_t i)
+  {
+    sumDist_[i] = 0;
+    for (size_t k = 0; k < active.size(); ++k)
+    {
+      size_t id = active[k];
+      sumDist_[i] += (id == i ? matrix_(i, i) : flatMatrix_[getFlatIndex_(i, id)]);
+    }
+    sumIteration[i] = iteration;
+  };
+
+  // Build tree:
+  while (active.size() > nbFinalNodes)
+  {
+    iteration++;
+    if (verbose_)
+      ApplicationTools::displayGauge(n - active.size(), n - nbFinalNodes - 1);
+    size_t nbNodes = active.size();
+    double factor = static_cast<double>(nbNodes - 2);
+    double maxSum = sumDist_[active[0]];
+    double maxAbsSum = 0;
+    for (size_t k = 0; k < nbNodes; ++k)
+    {
+      maxSum = max(maxSum, sumDist_[active[k]]);
+      maxAbsSum = max(maxAbsSum, std::abs(sumDist_[active[k]]));
+    }
+    // Updated sums carry rounding errors, so all pairs close to the best one are kept as candidates:
+    double tolerance = 1e-9 * maxAbsSum;
+
+    // Look for candidate pairs:
+    double critMax = std::log(0.);
+    candidates.clear();
+    for (size_t k = 0; k < nbNodes; ++k)
+    {
+      size_t i = active[k];
+      vector< pair<double, size_t> >* row = &sortedRows[i];
+      double bound = sumDist_[i] + maxSum;
+      for (size_t l = 0; l < row->size(); ++l)
+      {
+        double d = (*row)[l].first;
+        // Distances are sorted, so the criterion can only decrease from here:
+        if (bound - factor * d < critMax - tolerance)
+          break;
+        size_t j = (*row)[l].second;
+        if (!isActive[j] || creation[j] > creation[i])
+          continue; // Obsolete entry.
+        double crit = sumDist_[i] + sumDist_[j] - factor * d;
+        if (crit >= critMax - tolerance)
+        {
+          candidates.push_back(pair<size_t, size_t>(min(i, j), max(i, j)));
+          if (crit > critMax)
+            critMax = crit;
+        }
+      }
+    }
+    if (candidates.size() == 0)
+    {
+      throw Exception("Unexpected error: no maximum criterium found.");
+    }
+
+    // Compare candidates with sums computed again, as in getBestPair:
+    sort(candidates.begin(), candidates.end());
+    critMax = std::log(0.);
+    size_t a = 0, b = 0;
+    for (size_t k = 0; k < candidates.size(); ++k)
+    {
+      size_t i1 = candidates[k].first;
+      size_t i2 = candidates[k].second;
+      if (sumIteration[i1] != iteration) computeSum(i1);
+      if (sumIteration[i2] != iteration) computeSum(i2);
+      double crit = sumDist_[i1] + sumDist_[i2] - factor * flatMatrix_[getFlatIndex_(i1, i2)];
+      if (crit > critMax)
+      {
+        critMax = crit;
+        a = i1;
+        b = i2;
+      }
+    }
+    if (critMax == std::log(0.))
+    {
+      throw Exception("Unexpected error: no maximum criterium found.");
+    }
+
+    double dab = flatMatrix_[getFlatIndex_(a, b)];
+    double ratio = (sumDist_[a] - sumDist_[b]) / factor;
+    if (positiveLengths_)
+    {
+      distances[0] = std::max(.5 * (dab + ratio), 0.);
+      distances[1] = std::max(.5 * (dab - ratio), 0.);
+    }
+    else
+    {
+      distances[0] = .5 * (dab + ratio);
+      distances[1] = .5 * (dab - ratio);
+    }
+    nodes[a]->setDistanceToFather(distances[0]);
+    nodes[b]->setDistanceToFather(distances[1]);
+    Node* parent = getParentNode(idNextNode++, nodes[a], nodes[b]);
+    computeFlatDistancesFromPair_(a, b, distances, active, newDist);
+
+    // Actualize sums and distances:
+    active.erase(find(active.begin(), active.end(), b));
+    isActive[b] = false;
+    vector< pair<double, size_t> >().swap(sortedRows[b]);
+    sumDist_[a] = 0;
+    for (size_t k = 0; k < active.size(); ++k)
+    {
+      size_t id = active[k];
+      if (id == a) continue;
+      size_t ia = getFlatIndex_(a, id);
+      sumDist_[id] += newDist[id] - flatMatrix_[ia] - flatMatrix_[getFlatIndex_(b, id)];
+      sumDist_[a]  += newDist[id];
+      flatMatrix_[ia] = newDist[id];
+    }
+    matrix_(a, a) = 0;
+    nodes[a]    = parent;
+    creation[a] = nextCreation++;
+    vector< pair<double, size_t> >* row = &sortedRows[a];
+    row->clear();
+    for (size_t k = 0; k < active.size(); ++k)
+    {
+      size_t id = active[k];
+      if (id != a)
+        row->push_back(pair<double, size_t>(newDist[id], id));
+    }
+    sort(row->begin(), row->end());
+
+    // Remove obsolete entries from rows where they became too numerous:
+    for (size_t k = 0; k < active.size(); ++k)
+    {
+      size_t i = active[k];
+      row = &sortedRows[i];
+      if (row->size() > 2 * active.size())
+      {
+        size_t w = 0;
+        for (size_t l = 0; l < row->size(); ++l)
+        {
+          size_t j = (*row)[l].second;
+          if (isActive[j] && creation[j] < creation[i])
+            (*row)[w++] = (*row)[l];
+        }
+        row->resize(w);
+      }
+    }
+  }
+
+  // Final step, on the remaining nodes:
+  currentNodes_.clear();
+  for (size_t k = 0; k < active.size(); ++k)
+  {
+    currentNodes_[active[k]] = nodes[active[k]];
+    for (size_t l = 0; l < k; ++l)
+    {
+      matrix_(active[k], active[l]) = matrix_(active[l], active[k]) = flatMatrix_[getFlatIndex_(active[k], active[l])];
+    }
+  }
+  vector<double>().swap(flatMatrix_);
+  finalStep(idNextNode);
+}
+
+void NeighborJoining::computeFlatDistancesFromPair_(size_t a, size_t b, const std::vector<double>& branchLengths, const std::vector<size_t>& active, std::vector<double>& newDist)
+{
+  for (size_t k = 0; k < active.size(); ++k)
+  {
+    size_t pos = active[k];
+    if (pos == a || pos == b) continue;
+    double d = .5 * (flatMatrix_[getFlatIndex_(a, pos)] - branchLengths[0] + flatMatrix_[getFlatIndex_(b, pos)] - branchLengths[1]);
+    newDist[pos] = positiveLengths_ ? std::max(d, 0.) : d;
+  }
+}
+
@@ -49,6 +49,16 @@ namespace bpp
 /**
  * @brief The neighbor joining distance method.
  *
+ * By default, the tree is built using a bounded search of the best pair (fast search):
+ * - distances are stored in a flat triangular array,
+ * - the sums of distances are updated after each agglomeration instead of being recomputed,
+ * - distances of each node are sorted when the node is created, and for each node
+ *   the search stops as soon as the criterion can no longer exceed the best one found so far
+ *   (Simonsen, Mailund and Pedersen, 2008, "Rapid Neighbour-Joining").
+ * The same pairs are agglomerated as with the exhaustive search, with ties broken the same way,
+ * except that the criterion of nearly equal pairs may differ due to rounding errors in the sums.
+ * The input matrix is assumed to be symmetric.
+ *
  * Reference:
  * N Saitou and M Nei (1987), _Molecular Biology and Evolution_ 4(4) 406-25.
  */ 
@@ -58,6 +68,14 @@ class NeighborJoining :
 	protected:
     std::vector<double> sumDist_;
     bool positiveLengths_;
+    bool fastSearch_;
+
+    /**
+     * @brief The distances between current nodes, used by the fast search.
+     *
+     * The distance between nodes i < j is stored at position j * (j - 1) / 2 + i.
+     */
+    std::vector<double> flatMatrix_;
 		
 	public:
     /**
@@ -70,7 +88,9 @@ class NeighborJoining :
     NeighborJoining(bool rooted = false, bool positiveLengths = false, bool verbose = true) :
       AbstractAgglomerativeDistanceMethod(verbose, rooted),
       sumDist_(),
-      positiveLengths_(false)
+      positiveLengths_(false),
+      fastSearch_(true),
+      flatMatrix_()
     {}
 
     /**
@@ -84,7 +104,9 @@ class NeighborJoining :
 		NeighborJoining(const DistanceMatrix& matrix, bool rooted = false, bool positiveLengths = false, bool verbose = true) throw (Exception) :
       AbstractAgglomerativeDistanceMethod(matrix, verbose, rooted),
       sumDist_(),
-      positiveLengths_(positiveLengths) 
+      positiveLengths_(positiveLengths),
+      fastSearch_(true),
+      flatMatrix_()
 		{
 			sumDist_.resize(matrix.size());
 			computeTree();
@@ -104,6 +126,16 @@ class NeighborJoining :
 		}
 
     virtual void outputPositiveLengths(bool yn) { positiveLengths_ = yn; }
+
+    /**
+     * @brief Tell if the bounded search of the best pair should be used (the default).
+     *
+     * @param yn If false, all pairs are compared at each step, as in the original algorithm.
+     */
+    void setFastSearch(bool yn) { fastSearch_ = yn; }
+    bool isFastSearch() const { return fastSearch_; }
+
+		virtual void computeTree() throw (Exception);
 	
 	protected:
 		std::vector<size_t> getBestPair() throw (Exception);
@@ -111,6 +143,27 @@ class NeighborJoining :
 		double computeDistancesFromPair(const std::vector<size_t>& pair, const std::vector<double>& branchLengths, size_t pos);
 		void finalStep(int idRoot);	
 
+    /**
+     * @return The position of the distance between two distinct nodes in flatMatrix_.
+     * @param i, j The indices of the nodes.
+     */
+    static size_t getFlatIndex_(size_t i, size_t j)
+    {
+      return i < j ? j * (j - 1) / 2 + i : i * (i - 1) / 2 + j;
+    }
+
+    /**
+     * @brief Compute the distances between the agglomerated pair and all remaining nodes, for the fast search.
+     *
+     * flatMatrix_ still contains the distances before agglomeration.
+     *
+     * @param a, b          The indices of the nodes to agglomerate. The new node will take index a.
+     * @param branchLengths The branch lengths computed for the pair.
+     * @param active        The indices of all current nodes, in increasing order.
+     * @param newDist       Output vector, where the distance to each current node (other than a and b) is stored at its index.
+     */
+    virtual void computeFlatDistancesFromPair_(size_t a, size_t b, const std::vector<double>& branchLengths, const std::vector<size_t>& active, std::vector<double>& newDist);
+
 };
 
 } //end of namespace bpp.
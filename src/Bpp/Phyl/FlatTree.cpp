@@ -0,0 +1,1124 @@
+//
+// File: FlatTree.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#include "FlatTree.h"
+#include "TreeTemplate.h"
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Utils/MapTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <limits>
+
+using namespace std;
+
+/******************************************************************************/
+
+const size_t FlatTree::NO_NODE = numeric_limits<size_t>::max();
+
+/******************************************************************************/
+
+FlatTree::Annotations_::Annotations_(const Annotations_& annotations) :
+  names(annotations.names),
+  hasNames(annotations.hasNames),
+  nodeProperties(annotations.nodeProperties),
+  branchProperties(annotations.branchProperties)
+{
+  for (size_t i = 0; i < nodeProperties.size(); i++)
+  {
+    cloneProperties(nodeProperties[i]);
+    cloneProperties(branchProperties[i]);
+  }
+}
+
+/******************************************************************************/
+
+FlatTree::Annotations_& FlatTree::Annotations_::operator=(const Annotations_& annotations)
+{
+  if (this == &annotations)
+    return *this;
+  for (size_t i = 0; i < nodeProperties.size(); i++)
+  {
+    deleteProperties(nodeProperties[i]);
+    deleteProperties(branchProperties[i]);
+  }
+  names            = annotations.names;
+  hasNames         = annotations.hasNames;
+  nodeProperties   = annotations.nodeProperties;
+  branchProperties = annotations.branchProperties;
+  for (size_t i = 0; i < nodeProperties.size(); i++)
+  {
+    cloneProperties(nodeProperties[i]);
+    cloneProperties(branchProperties[i]);
+  }
+  return *this;
+}
+
+/******************************************************************************/
+
+FlatTree::Annotations_::~Annotations_()
+{
+  for (size_t i = 0; i < nodeProperties.size(); i++)
+  {
+    deleteProperties(nodeProperties[i]);
+    deleteProperties(branchProperties[i]);
+  }
+}
+
+/******************************************************************************/
+
+void FlatTree::Annotations_::deleteProperties(map<string, Clonable*>& properties)
+{
+  for (map<string, Clonable*>::iterator it = properties.begin(); it != properties.end(); it++)
+  {
+    delete it->second;
+  }
+  properties.clear();
+}
+
+/******************************************************************************/
+
+void FlatTree::Annotations_::cloneProperties(map<string, Clonable*>& properties)
+{
+  for (map<string, Clonable*>::iterator it = properties.begin(); it != properties.end(); it++)
+  {
+    it->second = it->second->clone();
+  }
+}
+
+/******************************************************************************/
+
+FlatTree::FlatTree() :
+  name_(),
+  structure_(new Structure_()),
+  annotations_(new Annotations_())
+{
+  addNode_(0);
+  structure_->root = 0;
+}
+
+/******************************************************************************/
+
+FlatTree::FlatTree(const Tree& tree) throw (Exception) :
+  name_(tree.getName()),
+  structure_(new Structure_()),
+  annotations_(new Annotations_())
+{
+  const TreeTemplate<Node>* treeTemplate = dynamic_cast<const TreeTemplate<Node>*>(&tree);
+  reserve_(tree.getNumberOfNodes());
+  if (treeTemplate)
+  {
+    // Nodes can be accessed directly:
+    copySubtree_(*treeTemplate->getRootNode());
+    return;
+  }
+
+  // Generic case, nodes are added in pre-order using their ids:
+  vector<int> stack(1, tree.getRootId());
+  while (!stack.empty())
+  {
+    int id = stack.back();
+    stack.pop_back();
+    size_t index = addNode_(id);
+    if (tree.hasFather(id))
+      addSon_(getIndex_(tree.getFatherId(id)), index);
+    else
+      structure_->root = index;
+    if (tree.hasDistanceToFather(id))
+    {
+      structure_->distances[index] = tree.getDistanceToFather(id);
+      structure_->hasDistances[index] = true;
+    }
+    if (tree.hasNodeName(id))
+    {
+      annotations_->names[index] = tree.getNodeName(id);
+      annotations_->hasNames[index] = true;
+    }
+    vector<string> names = tree.getNodePropertyNames(id);
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      annotations_->nodeProperties[index][names[i]] = tree.getNodeProperty(id, names[i])->clone();
+    }
+    names = tree.getBranchPropertyNames(id);
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      annotations_->branchProperties[index][names[i]] = tree.getBranchProperty(id, names[i])->clone();
+    }
+    vector<int> sonsId = tree.getSonsId(id);
+    stack.insert(stack.end(), sonsId.rbegin(), sonsId.rend());
+  }
+}
+
+/******************************************************************************/
+
+void FlatTree::copySubtree_(const Node& node) throw (Exception)
+{
+  vector<const Node*> stack(1, &node);
+  vector<size_t> fathers(1, NO_NODE);
+  while (!stack.empty())
+  {
+    const Node* current = stack.back();
+    size_t father = fathers.back();
+    stack.pop_back();
+    fathers.pop_back();
+    size_t index = addNode_(current->getId());
+    if (father != NO_NODE)
+      addSon_(father, index);
+    else
+      structure_->root = index;
+    if (current->hasDistanceToFather())
+    {
+      structure_->distances[index] = current->getDistanceToFather();
+      structure_->hasDistances[index] = true;
+    }
+    if (current->hasName())
+    {
+      annotations_->names[index] = current->getName();
+      annotations_->hasNames[index] = true;
+    }
+    vector<string> names = current->getNodePropertyNames();
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      annotations_->nodeProperties[index][names[i]] = current->getNodeProperty(names[i])->clone();
+    }
+    names = current->getBranchPropertyNames();
+    for (size_t i = 0; i < names.size(); i++)
+    {
+      annotations_->branchProperties[index][names[i]] = current->getBranchProperty(names[i])->clone();
+    }
+    for (size_t i = current->getNumberOfSons(); i > 0; i--)
+    {
+      stack.push_back(current->getSon(i - 1));
+      fathers.push_back(index);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void FlatTree::copySubtree_(const FlatTree& tree, size_t index)
+{
+  const Structure_& structure = *tree.structure_;
+  const Annotations_& annotations = *tree.annotations_;
+  vector<size_t> stack(1, index);
+  vector<size_t> fathers(1, NO_NODE);
+  while (!stack.empty())
+  {
+    size_t current = stack.back();
+    size_t father = fathers.back();
+    stack.pop_back();
+    fathers.pop_back();
+    size_t i = addNode_(structure.ids[current]);
+    if (father != NO_NODE)
+      addSon_(father, i);
+    else
+      structure_->root = i;
+    structure_->distances[i]    = structure.distances[current];
+    structure_->hasDistances[i] = structure.hasDistances[current];
+    annotations_->names[i]            = annotations.names[current];
+    annotations_->hasNames[i]         = annotations.hasNames[current];
+    annotations_->nodeProperties[i]   = annotations.nodeProperties[current];
+    annotations_->branchProperties[i] = annotations.branchProperties[current];
+    Annotations_::cloneProperties(annotations_->nodeProperties[i]);
+    Annotations_::cloneProperties(annotations_->branchProperties[i]);
+    // Sons are pushed in reverse order, so that they are popped in the original order:
+    size_t nbSons = tree.getNumberOfSons_(current);
+    size_t position = stack.size();
+    stack.resize(position + nbSons);
+    fathers.resize(position + nbSons, i);
+    for (size_t son = structure.firstSons[current], j = nbSons; son != NO_NODE; son = structure.nextSiblings[son], j--)
+    {
+      stack[position + j - 1] = son;
+    }
+  }
+}
+
+/******************************************************************************/
+
+FlatTree* FlatTree::cloneSubtree(int newRootId) const
+{
+  size_t index = getIndex_(newRootId);
+  FlatTree* tree = new FlatTree();
+  tree->structure_.reset(new Structure_());
+  tree->annotations_.reset(new Annotations_());
+  tree->copySubtree_(*this, index);
+  return tree;
+}
+
+/******************************************************************************/
+
+size_t FlatTree::getIndex_(int nodeId) const throw (NodeNotFoundException)
+{
+  const vector<size_t>& indices = structure_->indices;
+  if (nodeId < 0 || static_cast<size_t>(nodeId) >= indices.size() || indices[static_cast<size_t>(nodeId)] == NO_NODE)
+    throw NodeNotFoundException("FlatTree::getIndex_(). Node with id not found.", nodeId);
+  return indices[static_cast<size_t>(nodeId)];
+}
+
+/******************************************************************************/
+
+size_t FlatTree::getNumberOfSons_(size_t index) const
+{
+  const Structure_& structure = *structure_;
+  size_t n = 0;
+  for (size_t son = structure.firstSons[index]; son != NO_NODE; son = structure.nextSiblings[son])
+  {
+    n++;
+  }
+  return n;
+}
+
+/******************************************************************************/
+
+bool FlatTree::isLeaf_(size_t index) const
+{
+  // Same definition as Node::isLeaf(), degree <= 1:
+  const Structure_& structure = *structure_;
+  size_t firstSon = structure.firstSons[index];
+  if (firstSon == NO_NODE)
+    return true;
+  return structure.fathers[index] == NO_NODE && structure.nextSiblings[firstSon] == NO_NODE;
+}
+
+/******************************************************************************/
+
+FlatTree::Structure_& FlatTree::getStructure_()
+{
+  if (structure_.use_count() > 1)
+    structure_.reset(new Structure_(*structure_));
+  return *structure_;
+}
+
+/******************************************************************************/
+
+FlatTree::Annotations_& FlatTree::getAnnotations_()
+{
+  if (annotations_.use_count() > 1)
+    annotations_.reset(new Annotations_(*annotations_));
+  return *annotations_;
+}
+
+/******************************************************************************/
+
+void FlatTree::reserve_(size_t nbNodes)
+{
+  Structure_& structure = getStructure_();
+  Annotations_& annotations = getAnnotations_();
+  structure.ids.reserve(nbNodes);
+  structure.fathers.reserve(nbNodes);
+  structure.firstSons.reserve(nbNodes);
+  structure.nextSiblings.reserve(nbNodes);
+  structure.distances.reserve(nbNodes);
+  structure.hasDistances.reserve(nbNodes);
+  annotations.names.reserve(nbNodes);
+  annotations.hasNames.reserve(nbNodes);
+  annotations.nodeProperties.reserve(nbNodes);
+  annotations.branchProperties.reserve(nbNodes);
+}
+
+/******************************************************************************/
+
+size_t FlatTree::addNode_(int nodeId)
+{
+  if (nodeId < 0)
+    throw Exception("FlatTree::addNode_(). Node ids must be non-negative: " + TextTools::toString(nodeId) + ".");
+  Structure_& structure = getStructure_();
+  Annotations_& annotations = getAnnotations_();
+  size_t index = structure.ids.size();
+  size_t id = static_cast<size_t>(nodeId);
+  if (id >= structure.indices.size())
+    structure.indices.resize(id + 1, NO_NODE);
+  else if (structure.indices[id] != NO_NODE)
+    throw Exception("FlatTree::addNode_(). Non-unique id! (" + TextTools::toString(nodeId) + ").");
+  structure.indices[id] = index;
+  structure.ids.push_back(nodeId);
+  structure.fathers.push_back(NO_NODE);
+  structure.firstSons.push_back(NO_NODE);
+  structure.nextSiblings.push_back(NO_NODE);
+  structure.distances.push_back(0.);
+  structure.hasDistances.push_back(false);
+  annotations.names.push_back("");
+  annotations.hasNames.push_back(false);
+  annotations.nodeProperties.push_back(map<string, Clonable*>());
+  annotations.branchProperties.push_back(map<string, Clonable*>());
+  return index;
+}
+
+/******************************************************************************/
+
+void FlatTree::addSon_(size_t father, size_t son)
+{
+  Structure_& structure = getStructure_();
+  structure.fathers[son] = father;
+  structure.nextSiblings[son] = NO_NODE;
+  size_t last = structure.firstSons[father];
+  if (last == NO_NODE)
+  {
+    structure.firstSons[father] = son;
+    return;
+  }
+  while (structure.nextSiblings[last] != NO_NODE)
+  {
+    last = structure.nextSiblings[last];
+  }
+  structure.nextSiblings[last] = son;
+}
+
+/******************************************************************************/
+
+void FlatTree::removeSon_(size_t father, size_t son)
+{
+  Structure_& structure = getStructure_();
+  if (structure.firstSons[father] == son)
+    structure.firstSons[father] = structure.nextSiblings[son];
+  else
+  {
+    size_t previous = structure.firstSons[father];
+    while (structure.nextSiblings[previous] != son)
+    {
+      previous = structure.nextSiblings[previous];
+    }
+    structure.nextSiblings[previous] = structure.nextSiblings[son];
+  }
+  structure.fathers[son] = NO_NODE;
+  structure.nextSiblings[son] = NO_NODE;
+}
+
+/******************************************************************************/
+
+void FlatTree::removeNode_(size_t index)
+{
+  Structure_& structure = getStructure_();
+  Annotations_& annotations = getAnnotations_();
+  size_t last = structure.ids.size() - 1;
+  structure.indices[static_cast<size_t>(structure.ids[index])] = NO_NODE;
+  Annotations_::deleteProperties(annotations.nodeProperties[index]);
+  Annotations_::deleteProperties(annotations.branchProperties[index]);
+  if (index != last)
+  {
+    // Move the last node, and update its links:
+    structure.ids[index]          = structure.ids[last];
+    structure.fathers[index]      = structure.fathers[last];
+    structure.firstSons[index]    = structure.firstSons[last];
+    structure.nextSiblings[index] = structure.nextSiblings[last];
+    structure.distances[index]    = structure.distances[last];
+    structure.hasDistances[index] = structure.hasDistances[last];
+    structure.indices[static_cast<size_t>(structure.ids[index])] = index;
+    annotations.names[index]    = annotations.names[last];
+    annotations.hasNames[index] = annotations.hasNames[last];
+    annotations.nodeProperties[index].swap(annotations.nodeProperties[last]);
+    annotations.branchProperties[index].swap(annotations.branchProperties[last]);
+
+    size_t father = structure.fathers[index];
+    if (father != NO_NODE)
+    {
+      if (structure.firstSons[father] == last)
+        structure.firstSons[father] = index;
+      else
+      {
+        size_t previous = structure.firstSons[father];
+        while (structure.nextSiblings[previous] != last)
+        {
+          previous = structure.nextSiblings[previous];
+        }
+        structure.nextSiblings[previous] = index;
+      }
+    }
+    for (size_t son = structure.firstSons[index]; son != NO_NODE; son = structure.nextSiblings[son])
+    {
+      structure.fathers[son] = index;
+    }
+    if (structure.root == last)
+      structure.root = index;
+  }
+  structure.ids.pop_back();
+  structure.fathers.pop_back();
+  structure.firstSons.pop_back();
+  structure.nextSiblings.pop_back();
+  structure.distances.pop_back();
+  structure.hasDistances.pop_back();
+  annotations.names.pop_back();
+  annotations.hasNames.pop_back();
+  annotations.nodeProperties.pop_back();
+  annotations.branchProperties.pop_back();
+}
+
+/******************************************************************************/
+
+vector<size_t> FlatTree::getPostOrder() const
+{
+  const Structure_& structure = *structure_;
+  vector<size_t> order;
+  order.reserve(structure.ids.size());
+  size_t node = structure.root;
+  while (structure.firstSons[node] != NO_NODE)
+    node = structure.firstSons[node];
+  while (true)
+  {
+    order.push_back(node);
+    if (node == structure.root)
+      break;
+    if (structure.nextSiblings[node] != NO_NODE)
+    {
+      node = structure.nextSiblings[node];
+      while (structure.firstSons[node] != NO_NODE)
+        node = structure.firstSons[node];
+    }
+    else
+      node = structure.fathers[node];
+  }
+  return order;
+}
+
+/******************************************************************************/
+
+vector<size_t> FlatTree::getPreOrder() const
+{
+  const Structure_& structure = *structure_;
+  vector<size_t> order;
+  order.reserve(structure.ids.size());
+  size_t node = structure.root;
+  while (true)
+  {
+    order.push_back(node);
+    if (structure.firstSons[node] != NO_NODE)
+    {
+      node = structure.firstSons[node];
+      continue;
+    }
+    while (node != structure.root && structure.nextSiblings[node] == NO_NODE)
+      node = structure.fathers[node];
+    if (node == structure.root)
+      break;
+    node = structure.nextSiblings[node];
+  }
+  return order;
+}
+
+/******************************************************************************/
+
+size_t FlatTree::getNumberOfLeaves() const
+{
+  size_t n = 0;
+  for (size_t i = 0; i < structure_->ids.size(); i++)
+  {
+    if (isLeaf_(i))
+      n++;
+  }
+  return n;
+}
+
+/******************************************************************************/
+
+vector<double> FlatTree::getBranchLengths() const
+{
+  const Structure_& structure = *structure_;
+  vector<size_t> order = getPreOrder();
+  vector<double> brLen(order.size());
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    if (!structure.hasDistances[order[i]])
+      throw NodePException("FlatTree::getBranchLengths(). Node has no distance.", structure.ids[order[i]]);
+    brLen[i] = structure.distances[order[i]];
+  }
+  return brLen;
+}
+
+/******************************************************************************/
+
+vector<double> FlatTree::getBranchLengths() throw (NodeException)
+{
+  // Same convention as TreeTemplate, the first value is 0 and is followed by all branches in pre-order:
+  const Structure_& structure = *structure_;
+  vector<size_t> order = getPreOrder();
+  vector<double> brLen(order.size(), 0.);
+  for (size_t i = 1; i < order.size(); i++)
+  {
+    if (!structure.hasDistances[order[i]])
+      throw NodePException("FlatTree::getBranchLengths(). Node has no distance.", structure.ids[order[i]]);
+    brLen[i] = structure.distances[order[i]];
+  }
+  return brLen;
+}
+
+/******************************************************************************/
+
+vector<string> FlatTree::getLeavesNames() const
+{
+  vector<size_t> order = getPreOrder();
+  vector<string> names;
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    if (isLeaf_(order[i]))
+    {
+      if (!annotations_->hasNames[order[i]])
+        throw NodePException("FlatTree::getLeavesNames(). No name associated to this node.", structure_->ids[order[i]]);
+      names.push_back(annotations_->names[order[i]]);
+    }
+  }
+  return names;
+}
+
+/******************************************************************************/
+
+int FlatTree::getLeafId(const string& name) const throw (NodeNotFoundException)
+{
+  vector<size_t> order = getPreOrder();
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    if (isLeaf_(order[i]) && annotations_->hasNames[order[i]] && annotations_->names[order[i]] == name)
+      return structure_->ids[order[i]];
+  }
+  throw NodeNotFoundException("FlatTree::getLeafId().", name);
+}
+
+/******************************************************************************/
+
+vector<int> FlatTree::getLeavesId() const
+{
+  vector<size_t> order = getPreOrder();
+  vector<int> ids;
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    if (isLeaf_(order[i]))
+      ids.push_back(structure_->ids[order[i]]);
+  }
+  return ids;
+}
+
+/******************************************************************************/
+
+vector<int> FlatTree::getNodesId() const
+{
+  vector<size_t> order = getPostOrder();
+  vector<int> ids(order.size());
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    ids[i] = structure_->ids[order[i]];
+  }
+  return ids;
+}
+
+/******************************************************************************/
+
+vector<int> FlatTree::getInnerNodesId() const
+{
+  vector<size_t> order = getPostOrder();
+  vector<int> ids;
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    if (!isLeaf_(order[i]))
+      ids.push_back(structure_->ids[order[i]]);
+  }
+  return ids;
+}
+
+/******************************************************************************/
+
+vector<int> FlatTree::getBranchesId() const
+{
+  vector<int> ids = getNodesId();
+  ids.pop_back(); // The root is the last node in post-order.
+  return ids;
+}
+
+/******************************************************************************/
+
+vector<int> FlatTree::getSonsId(int parentId) const throw (NodeNotFoundException)
+{
+  const Structure_& structure = *structure_;
+  vector<int> ids;
+  for (size_t son = structure.firstSons[getIndex_(parentId)]; son != NO_NODE; son = structure.nextSiblings[son])
+  {
+    ids.push_back(structure.ids[son]);
+  }
+  return ids;
+}
+
+/******************************************************************************/
+
+vector<int> FlatTree::getAncestorsId(int nodeId) const throw (NodeNotFoundException)
+{
+  const Structure_& structure = *structure_;
+  vector<int> ids;
+  for (size_t node = structure.fathers[getIndex_(nodeId)]; node != NO_NODE; node = structure.fathers[node])
+  {
+    ids.push_back(structure.ids[node]);
+  }
+  return ids;
+}
+
+/******************************************************************************/
+
+int FlatTree::getFatherId(int parentId) const throw (NodeNotFoundException)
+{
+  size_t father = structure_->fathers[getIndex_(parentId)];
+  if (father == NO_NODE)
+    throw NodeNotFoundException("FlatTree::getFatherId(). Node has no father.", parentId);
+  return structure_->ids[father];
+}
+
+/******************************************************************************/
+
+string FlatTree::getNodeName(int nodeId) const throw (NodeNotFoundException)
+{
+  size_t index = getIndex_(nodeId);
+  if (!annotations_->hasNames[index])
+    throw NodeNotFoundException("FlatTree::getNodeName(). No name associated to this node.", nodeId);
+  return annotations_->names[index];
+}
+
+/******************************************************************************/
+
+void FlatTree::setNodeName(int nodeId, const string& name) throw (NodeNotFoundException)
+{
+  size_t index = getIndex_(nodeId);
+  Annotations_& annotations = getAnnotations_();
+  annotations.names[index] = name;
+  annotations.hasNames[index] = true;
+}
+
+/******************************************************************************/
+
+void FlatTree::deleteNodeName(int nodeId) throw (NodeNotFoundException)
+{
+  size_t index = getIndex_(nodeId);
+  if (!annotations_->hasNames[index])
+    return;
+  Annotations_& annotations = getAnnotations_();
+  annotations.names[index] = "";
+  annotations.hasNames[index] = false;
+}
+
+/******************************************************************************/
+
+bool FlatTree::hasNode(int nodeId) const
+{
+  const vector<size_t>& indices = structure_->indices;
+  return nodeId >= 0 && static_cast<size_t>(nodeId) < indices.size() && indices[static_cast<size_t>(nodeId)] != NO_NODE;
+}
+
+/******************************************************************************/
+
+double FlatTree::getDistanceToFather(int nodeId) const
+{
+  size_t index = getIndex_(nodeId);
+  if (!structure_->hasDistances[index])
+    throw NodePException("FlatTree::getDistanceToFather(). Node has no distance.", nodeId);
+  return structure_->distances[index];
+}
+
+/******************************************************************************/
+
+void FlatTree::setDistanceToFather(int nodeId, double length)
+{
+  size_t index = getIndex_(nodeId);
+  Structure_& structure = getStructure_();
+  structure.distances[index] = length;
+  structure.hasDistances[index] = true;
+}
+
+/******************************************************************************/
+
+void FlatTree::deleteDistanceToFather(int nodeId)
+{
+  size_t index = getIndex_(nodeId);
+  if (!structure_->hasDistances[index])
+    return;
+  getStructure_().hasDistances[index] = false;
+}
+
+/******************************************************************************/
+
+bool FlatTree::hasNodeProperty(int nodeId, const string& name) const throw (NodeNotFoundException)
+{
+  const map<string, Clonable*>& properties = annotations_->nodeProperties[getIndex_(nodeId)];
+  return properties.find(name) != properties.end();
+}
+
+/******************************************************************************/
+
+void FlatTree::setNodeProperty(int nodeId, const string& name, const Clonable& property) throw (NodeNotFoundException)
+{
+  size_t index = getIndex_(nodeId);
+  map<string, Clonable*>& properties = getAnnotations_().nodeProperties[index];
+  map<string, Clonable*>::iterator it = properties.find(name);
+  if (it != properties.end())
+    delete it->second;
+  properties[name] = property.clone();
+}
+
+/******************************************************************************/
+
+Clonable* FlatTree::getNodeProperty(int nodeId, const string& name) throw (NodeNotFoundException)
+{
+  size_t index = getIndex_(nodeId);
+  // The property may be modified through the returned pointer:
+  map<string, Clonable*>& properties = getAnnotations_().nodeProperties[index];
+  map<string, Clonable*>::iterator it = properties.find(name);
+  if (it == properties.end())
+    throw NodeNotFoundException("FlatTree::getNodeProperty(). Property not found: " + name + ".", nodeId);
+  return it->second;
+}
+
+/******************************************************************************/
+
+const Clonable* FlatTree::getNodeProperty(int nodeId, const string& name) const throw (NodeNotFoundException)
+{
+  const map<string, Clonable*>& properties = annotations_->nodeProperties[getIndex_(nodeId)];
+  map<string, Clonable*>::const_iterator it = properties.find(name);
+  if (it == properties.end())
+    throw NodeNotFoundException("FlatTree::getNodeProperty(). Property not found: " + name + ".", nodeId);
+  return it->second;
+}
+
+/******************************************************************************/
+
+Clonable* FlatTree::removeNodeProperty(int nodeId, const string& name) throw (NodeNotFoundException)
+{
+  size_t index = getIndex_(nodeId);
+  map<string, Clonable*>& properties = getAnnotations_().nodeProperties[index];
+  map<string, Clonable*>::iterator it = properties.find(name);
+  if (it == properties.end())
+    throw NodeNotFoundException("FlatTree::removeNodeProperty(). Property not found: " + name + ".", nodeId);
+  Clonable* property = it->second;
+  properties.erase(it);
+  return property;
+}
+
+/******************************************************************************/
+
+vector<string> FlatTree::getNodePropertyNames(int nodeId) const throw (NodeNotFoundException)
+{
+  return MapTools::getKeys(annotations_->nodeProperties[getIndex_(nodeId)]);
+}
+
+/******************************************************************************/
+
+bool FlatTree::hasBranchProperty(int nodeId, const string& name) const throw (NodeNotFoundException)
+{
+  const map<string, Clonable*>& properties = annotations_->branchProperties[getIndex_(nodeId)];
+  return properties.find(name) != properties.end();
+}
+
+/******************************************************************************/
+
+void FlatTree::setBranchProperty(int nodeId, const string& name, const Clonable& property) throw (NodeNotFoundException)
+{
+  size_t index = getIndex_(nodeId);
+  map<string, Clonable*>& properties = getAnnotations_().branchProperties[index];
+  map<string, Clonable*>::iterator it = properties.find(name);
+  if (it != properties.end())
+    delete it->second;
+  properties[name] = property.clone();
+}
+
+/******************************************************************************/
+
+Clonable* FlatTree::getBranchProperty(int nodeId, const string& name) throw (NodeNotFoundException)
+{
+  size_t index = getIndex_(nodeId);
+  // The property may be modified through the returned pointer:
+  map<string, Clonable*>& properties = getAnnotations_().branchProperties[index];
+  map<string, Clonable*>::iterator it = properties.find(name);
+  if (it == properties.end())
+    throw NodeNotFoundException("FlatTree::getBranchProperty(). Property not found: " + name + ".", nodeId);
+  return it->second;
+}
+
+/******************************************************************************/
+
+const Clonable* FlatTree::getBranchProperty(int nodeId, const string& name) const throw (NodeNotFoundException)
+{
+  const map<string, Clonable*>& properties = annotations_->branchProperties[getIndex_(nodeId)];
+  map<string, Clonable*>::const_iterator it = properties.find(name);
+  if (it == properties.end())
+    throw NodeNotFoundException("FlatTree::getBranchProperty(). Property not found: " + name + ".", nodeId);
+  return it->second;
+}
+
+/******************************************************************************/
+
+Clonable* FlatTree::removeBranchProperty(int nodeId, const string& name) throw (NodeNotFoundException)
+{
+  size_t index = getIndex_(nodeId);
+  map<string, Clonable*>& properties = getAnnotations_().branchProperties[index];
+  map<string, Clonable*>::iterator it = properties.find(name);
+  if (it == properties.end())
+    throw NodeNotFoundException("FlatTree::removeBranchProperty(). Property not found: " + name + ".", nodeId);
+  Clonable* property = it->second;
+  properties.erase(it);
+  return property;
+}
+
+/******************************************************************************/
+
+vector<string> FlatTree::getBranchPropertyNames(int nodeId) const throw (NodeNotFoundException)
+{
+  return MapTools::getKeys(annotations_->branchProperties[getIndex_(nodeId)]);
+}
+
+/******************************************************************************/
+
+bool FlatTree::unroot() throw (UnrootedTreeException)
+{
+  if (!isRooted()) throw UnrootedTreeException("FlatTree::unroot", this);
+  Structure_& structure = getStructure_();
+  size_t root = structure.root;
+  size_t son1 = structure.firstSons[root];
+  size_t son2 = structure.nextSiblings[son1];
+  if (structure.firstSons[son1] == NO_NODE && structure.firstSons[son2] == NO_NODE)
+    return false; // We can't unroot a single branch!
+
+  // We manage to have a subtree in position 0:
+  if (structure.firstSons[son1] == NO_NODE)
+    swap(son1, son2);
+
+  // Take care of branch lengths:
+  if (structure.hasDistances[son1])
+  {
+    if (structure.hasDistances[son2])
+    {
+      // Both nodes have lengths, we sum them:
+      structure.distances[son2] += structure.distances[son1];
+    }
+    else
+    {
+      // Only node 1 has length, we set it to node 2:
+      structure.distances[son2] = structure.distances[son1];
+      structure.hasDistances[son2] = true;
+    }
+    structure.hasDistances[son1] = false;
+  } // Else node 2 may or may not have a branch length, we do not care!
+
+  // Remove the root:
+  removeSon_(root, son1);
+  removeSon_(root, son2);
+  addSon_(son1, son2);
+  structure.root = son1;
+  removeNode_(root);
+  return true;
+}
+
+/******************************************************************************/
+
+void FlatTree::rootAt(int nodeId) throw (NodeNotFoundException)
+{
+  getIndex_(nodeId);
+  if (getRootId() == nodeId) return;
+  if (isRooted()) unroot();
+
+  // The path from the new root to the current root:
+  Structure_& structure = getStructure_();
+  Annotations_& annotations = getAnnotations_();
+  size_t newRoot = getIndex_(nodeId);
+  vector<size_t> path;
+  for (size_t node = newRoot; node != NO_NODE; node = structure.fathers[node])
+  {
+    path.push_back(node);
+  }
+  for (size_t i = path.size() - 1; i > 0; i--)
+  {
+    size_t father = path[i];
+    size_t son = path[i - 1];
+    structure.distances[father] = structure.distances[son];
+    structure.hasDistances[father] = structure.hasDistances[son];
+    removeSon_(father, son);
+    addSon_(son, father);
+
+    map<string, Clonable*>& properties = annotations.branchProperties[son];
+    for (map<string, Clonable*>::iterator it = properties.begin(); it != properties.end(); it++)
+    {
+      map<string, Clonable*>::iterator it2 = annotations.branchProperties[father].find(it->first);
+      if (it2 != annotations.branchProperties[father].end())
+        delete it2->second;
+      annotations.branchProperties[father][it->first] = it->second;
+    }
+    properties.clear();
+  }
+
+  structure.hasDistances[newRoot] = false;
+  Annotations_::deleteProperties(annotations.branchProperties[newRoot]);
+  structure.root = newRoot;
+}
+
+/******************************************************************************/
+
+void FlatTree::newOutGroup(int nodeId) throw (NodeNotFoundException)
+{
+  size_t outGroup = getIndex_(nodeId);
+  if (outGroup == structure_->root) return;
+  int rootId;
+  if (isRooted())
+  {
+    if (structure_->fathers[outGroup] == structure_->root)
+      return;  // This tree is already rooted appropriately.
+    rootId = getRootId();
+    unroot();
+  }
+  else
+  {
+    rootId = getNextId();
+  }
+  rootAt(getFatherId(nodeId));
+  size_t oldRoot = structure_->root;
+  outGroup = getIndex_(nodeId);
+  removeSon_(oldRoot, outGroup);
+  size_t newRoot = addNode_(rootId);
+  addSon_(newRoot, oldRoot);
+  addSon_(newRoot, outGroup);
+  Structure_& structure = getStructure_();
+  structure.root = newRoot;
+  // Check lengths:
+  if (structure.hasDistances[outGroup])
+  {
+    double l = structure.distances[outGroup] / 2.;
+    structure.distances[outGroup] = l;
+    structure.distances[oldRoot] = l;
+    structure.hasDistances[oldRoot] = true;
+  }
+}
+
+/******************************************************************************/
+
+void FlatTree::resetNodesId()
+{
+  // Same numbering as TreeTemplate, in post-order:
+  vector<size_t> order = getPostOrder();
+  Structure_& structure = getStructure_();
+  structure.indices.assign(order.size(), NO_NODE);
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    structure.ids[order[i]] = static_cast<int>(i);
+    structure.indices[i] = order[i];
+  }
+}
+
+/******************************************************************************/
+
+bool FlatTree::isMultifurcating() const
+{
+  if (getNumberOfSons_(structure_->root) > 3) return true;
+  for (size_t i = 0; i < structure_->ids.size(); i++)
+  {
+    if (i != structure_->root && getNumberOfSons_(i) > 2)
+      return true;
+  }
+  return false;
+}
+
+/******************************************************************************/
+
+double FlatTree::getTotalLength() throw (NodeException)
+{
+  const Structure_& structure = *structure_;
+  double length = 0;
+  for (size_t i = 0; i < structure.ids.size(); i++)
+  {
+    if (i == structure.root)
+      continue;
+    if (!structure.hasDistances[i])
+      throw NodePException("FlatTree::getTotalLength(). Node has no distance.", structure.ids[i]);
+    length += structure.distances[i];
+  }
+  return length;
+}
+
+/******************************************************************************/
+
+void FlatTree::setBranchLengths(double brLen)
+{
+  Structure_& structure = getStructure_();
+  for (size_t i = 0; i < structure.ids.size(); i++)
+  {
+    if (i == structure.root)
+      continue;
+    structure.distances[i] = brLen;
+    structure.hasDistances[i] = true;
+  }
+}
+
+/******************************************************************************/
+
+void FlatTree::setVoidBranchLengths(double brLen)
+{
+  Structure_& structure = getStructure_();
+  for (size_t i = 0; i < structure.ids.size(); i++)
+  {
+    if (i == structure.root || structure.hasDistances[i])
+      continue;
+    structure.distances[i] = brLen;
+    structure.hasDistances[i] = true;
+  }
+}
+
+/******************************************************************************/
+
+void FlatTree::scaleTree(double factor) throw (NodeException)
+{
+  Structure_& structure = getStructure_();
+  for (size_t i = 0; i < structure.ids.size(); i++)
+  {
+    if (i == structure.root)
+      continue;
+    if (!structure.hasDistances[i])
+      throw NodePException("FlatTree::scaleTree(). Node has no distance.", structure.ids[i]);
+    structure.distances[i] *= factor;
+  }
+}
+
+/******************************************************************************/
+
+int FlatTree::getNextId()
+{
+  // Smallest id not in use:
+  const vector<size_t>& indices = structure_->indices;
+  for (size_t i = 0; i < indices.size(); i++)
+  {
+    if (indices[i] == NO_NODE)
+      return static_cast<int>(i);
+  }
+  return static_cast<int>(indices.size());
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,352 @@
+//
+// File: FlatTree.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#ifndef _FLATTREE_H_
+#define _FLATTREE_H_
+
+#include "Tree.h"
+#include "TreeExceptions.h"
+
+#include <Bpp/Clonable.h>
+
+// From the STL:
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+namespace bpp
+{
+
+class Node;
+
+/**
+ * @brief A tree implementation with contiguous node storage and copy-on-write cloning.
+ *
+ * Contrary to TreeTemplate, nodes are not individual objects: each node is an index in
+ * a set of arrays (father, first son, next sibling, id, branch length...), and links between nodes
+ * are indices in these arrays. Names and properties are stored in a separate set of arrays.
+ * Nodes are stored in pre-order when the tree is built, which improves the locality of traversals.
+ *
+ * Both sets of arrays are shared between copies of a tree, and are only duplicated when one of the copies
+ * is modified. Copying a tree is therefore in constant time, and changing the branch lengths of a copy
+ * does not duplicate names and properties. This makes this class well suited for algorithms that clone
+ * trees often, like topology searches or bootstrap analyses.
+ *
+ * The class implements the generic Tree interface, and a few index-based methods for fast traversals.
+ * Node ids must be non-negative.
+ * Conversion from and to a TreeTemplate is achieved with the FlatTree(const Tree&) and TreeTemplate(const Tree&)
+ * constructors.
+ *
+ * @see TreeTemplate
+ */
+class FlatTree:
+  public Tree
+{
+  public:
+    /**
+     * @brief Index value used for missing links (father of the root, son of a leaf, etc).
+     */
+    static const size_t NO_NODE;
+
+  private:
+    /**
+     * @brief Topology and branch lengths.
+     */
+    struct Structure_
+    {
+      public:
+        size_t root;
+        std::vector<int> ids;
+        std::vector<size_t> fathers;
+        std::vector<size_t> firstSons;
+        std::vector<size_t> nextSiblings;
+        std::vector<double> distances;
+        std::vector<bool> hasDistances;
+        // Node index of each id:
+        std::vector<size_t> indices;
+
+      public:
+        Structure_() :
+          root(NO_NODE), ids(), fathers(), firstSons(), nextSiblings(),
+          distances(), hasDistances(), indices() {}
+    };
+
+    /**
+     * @brief Node names and properties.
+     */
+    struct Annotations_
+    {
+      public:
+        std::vector<std::string> names;
+        std::vector<bool> hasNames;
+        std::vector< std::map<std::string, Clonable*> > nodeProperties;
+        std::vector< std::map<std::string, Clonable*> > branchProperties;
+
+      public:
+        Annotations_() : names(), hasNames(), nodeProperties(), branchProperties() {}
+        Annotations_(const Annotations_& annotations);
+        Annotations_& operator=(const Annotations_& annotations);
+        ~Annotations_();
+
+      public:
+        static void deleteProperties(std::map<std::string, Clonable*>& properties);
+        static void cloneProperties(std::map<std::string, Clonable*>& properties);
+    };
+
+    std::string name_;
+    std::shared_ptr<Structure_> structure_;
+    std::shared_ptr<Annotations_> annotations_;
+
+  public:
+    FlatTree();
+
+    /**
+     * @brief Build a tree from any other tree.
+     *
+     * @param tree The tree to copy.
+     * @throw Exception If the tree contains negative node ids.
+     */
+    FlatTree(const Tree& tree) throw (Exception);
+
+    /**
+     * @brief Copy constructor.
+     *
+     * The copy shares its storage with the original tree, and is performed in constant time.
+     */
+    FlatTree(const FlatTree& tree) :
+      name_(tree.name_), structure_(tree.structure_), annotations_(tree.annotations_) {}
+
+    FlatTree& operator=(const FlatTree& tree)
+    {
+      name_        = tree.name_;
+      structure_   = tree.structure_;
+      annotations_ = tree.annotations_;
+      return *this;
+    }
+
+    FlatTree* clone() const { return new FlatTree(*this); }
+
+    virtual ~FlatTree() {}
+
+  public:
+    FlatTree* cloneSubtree(int newRootId) const;
+
+    std::string getName() const { return name_; }
+
+    void setName(const std::string& name) { name_ = name; }
+
+    size_t getNumberOfLeaves() const;
+
+    size_t getNumberOfNodes() const { return structure_->ids.size(); }
+
+    std::vector<double> getBranchLengths() const;
+
+    std::vector<std::string> getLeavesNames() const;
+
+    int getRootId() const { return structure_->ids[structure_->root]; }
+
+    int getLeafId(const std::string& name) const throw (NodeNotFoundException);
+
+    std::vector<int> getLeavesId() const;
+
+    std::vector<int> getNodesId() const;
+
+    std::vector<int> getInnerNodesId() const;
+
+    std::vector<int> getBranchesId() const;
+
+    std::vector<int> getSonsId(int parentId) const throw (NodeNotFoundException);
+
+    std::vector<int> getAncestorsId(int nodeId) const throw (NodeNotFoundException);
+
+    int getFatherId(int parentId) const throw (NodeNotFoundException);
+
+    bool hasFather(int nodeId) const throw (NodeNotFoundException) { return structure_->fathers[getIndex_(nodeId)] != NO_NODE; }
+
+    std::string getNodeName(int nodeId) const throw (NodeNotFoundException);
+
+    void setNodeName(int nodeId, const std::string& name) throw (NodeNotFoundException);
+
+    void deleteNodeName(int nodeId) throw (NodeNotFoundException);
+
+    bool hasNodeName(int nodeId) const throw (NodeNotFoundException) { return annotations_->hasNames[getIndex_(nodeId)]; }
+
+    bool hasNode(int nodeId) const;
+
+    bool isLeaf(int nodeId) const throw (NodeNotFoundException) { return isLeaf_(getIndex_(nodeId)); }
+
+    bool isRoot(int nodeId) const throw (NodeNotFoundException) { return getIndex_(nodeId) == structure_->root; }
+
+    double getDistanceToFather(int nodeId) const;
+
+    void setDistanceToFather(int nodeId, double length);
+
+    void deleteDistanceToFather(int nodeId);
+
+    bool hasDistanceToFather(int nodeId) const { return structure_->hasDistances[getIndex_(nodeId)]; }
+
+    bool hasNodeProperty(int nodeId, const std::string& name) const throw (NodeNotFoundException);
+
+    void setNodeProperty(int nodeId, const std::string& name, const Clonable& property) throw (NodeNotFoundException);
+
+    Clonable* getNodeProperty(int nodeId, const std::string& name) throw (NodeNotFoundException);
+
+    const Clonable* getNodeProperty(int nodeId, const std::string& name) const throw (NodeNotFoundException);
+
+    Clonable* removeNodeProperty(int nodeId, const std::string& name) throw (NodeNotFoundException);
+
+    std::vector<std::string> getNodePropertyNames(int nodeId) const throw (NodeNotFoundException);
+
+    bool hasBranchProperty(int nodeId, const std::string& name) const throw (NodeNotFoundException);
+
+    void setBranchProperty(int nodeId, const std::string& name, const Clonable& property) throw (NodeNotFoundException);
+
+    Clonable* getBranchProperty(int nodeId, const std::string& name) throw (NodeNotFoundException);
+
+    const Clonable* getBranchProperty(int nodeId, const std::string& name) const throw (NodeNotFoundException);
+
+    Clonable* removeBranchProperty(int nodeId, const std::string& name) throw (NodeNotFoundException);
+
+    std::vector<std::string> getBranchPropertyNames(int nodeId) const throw (NodeNotFoundException);
+
+    void rootAt(int nodeId) throw (NodeNotFoundException);
+
+    void newOutGroup(int nodeId) throw (NodeNotFoundException);
+
+    bool isRooted() const { return getNumberOfSons_(structure_->root) == 2; }
+
+    bool unroot() throw (UnrootedTreeException);
+
+    void resetNodesId();
+
+    bool isMultifurcating() const;
+
+    std::vector<double> getBranchLengths() throw (NodeException);
+
+    double getTotalLength() throw (NodeException);
+
+    void setBranchLengths(double brLen);
+
+    void setVoidBranchLengths(double brLen);
+
+    void scaleTree(double factor) throw (NodeException);
+
+    int getNextId();
+
+    /**
+     * @name Index-based access
+     *
+     * Node indices range from 0 to getNumberOfNodes() - 1.
+     * They may change when nodes are added or removed (unroot, rootAt and newOutGroup methods).
+     *
+     * @{
+     */
+    size_t getNodeIndex(int nodeId) const throw (NodeNotFoundException) { return getIndex_(nodeId); }
+
+    int getNodeId(size_t index) const { return structure_->ids[index]; }
+
+    size_t getRootIndex() const { return structure_->root; }
+
+    size_t getFatherIndex(size_t index) const { return structure_->fathers[index]; }
+
+    size_t getFirstSonIndex(size_t index) const { return structure_->firstSons[index]; }
+
+    size_t getNextSiblingIndex(size_t index) const { return structure_->nextSiblings[index]; }
+
+    /**
+     * @return The indices of all nodes, sons before fathers.
+     */
+    std::vector<size_t> getPostOrder() const;
+
+    /**
+     * @return The indices of all nodes, fathers before sons.
+     */
+    std::vector<size_t> getPreOrder() const;
+    /** @} */
+
+  private:
+    size_t getIndex_(int nodeId) const throw (NodeNotFoundException);
+
+    size_t getNumberOfSons_(size_t index) const;
+
+    bool isLeaf_(size_t index) const;
+
+    /**
+     * @return A reference toward the topology arrays, copied first if they are shared.
+     */
+    Structure_& getStructure_();
+
+    /**
+     * @return A reference toward the annotation arrays, copied first if they are shared.
+     */
+    Annotations_& getAnnotations_();
+
+    /**
+     * @brief Reserve space in all arrays, before a tree is copied.
+     */
+    void reserve_(size_t nbNodes);
+
+    size_t addNode_(int nodeId);
+
+    void addSon_(size_t father, size_t son);
+
+    void removeSon_(size_t father, size_t son);
+
+    /**
+     * @brief Remove an unlinked node, and move the last node to its index.
+     */
+    void removeNode_(size_t index);
+
+    /**
+     * @brief Copy a subtree of another tree into this empty tree, in pre-order.
+     */
+    void copySubtree_(const FlatTree& tree, size_t index);
+
+    /**
+     * @brief Copy a subtree made of Node objects into this empty tree, in pre-order.
+     */
+    void copySubtree_(const Node& node) throw (Exception);
+};
+
+} //end of namespace bpp.
+
+#endif //_FLATTREE_H_
+
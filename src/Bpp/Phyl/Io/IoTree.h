@@ -41,6 +41,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _IOTREE_H_
 
 #include "../Tree.h"
+#include "../TreeIterator.h"
 
 // From the STL:
 #include <string>
@@ -214,6 +215,19 @@ class IMultiTree:
      * @throw Exception If an error occured.
      */
 		virtual void read(std::istream& in, std::vector<Tree*>& trees) const throw (Exception) = 0;
+
+    /**
+     * @brief Get an iterator over the trees of a stream.
+     *
+     * Trees are parsed one at a time, when nextTree() is called, so that a large set of trees
+     * can be processed in bounded memory.
+     * The stream must remain valid as long as the iterator is used.
+     *
+     * @param in The input stream.
+     * @return A new iterator object, which is owned by the caller.
+     * @throw Exception If an error occured.
+     */
+    virtual TreeIterator* getTreeIterator(std::istream& in) const throw (Exception) = 0;
 };
 
 /**
@@ -268,6 +282,80 @@ class AbstractIMultiTree:
 
 };
 
+/**
+ * @brief Partial implementation of the TreeIterator interface, for formats where tree descriptions
+ * follow each other and end with a semi colon.
+ *
+ * The stream is read until a semi colon is found, and the corresponding description is parsed
+ * by the parseDescription_() method. Only one description is kept in memory.
+ */
+class AbstractDescriptionTreeIterator:
+  public virtual TreeIterator
+{
+  private:
+    std::istream* in_;
+    std::string description_;
+    bool hasMoreTrees_;
+
+  public:
+    /**
+     * @param in The input stream. It must remain valid as long as the iterator is used.
+     * @throw IOException If the stream is not valid.
+     */
+    AbstractDescriptionTreeIterator(std::istream& in) throw (IOException) :
+      in_(&in), description_(), hasMoreTrees_(false)
+    {
+      if (! in) { throw IOException ("AbstractDescriptionTreeIterator: failed to read from stream"); }
+      fetch_();
+    }
+
+    AbstractDescriptionTreeIterator(const AbstractDescriptionTreeIterator& it) :
+      in_(it.in_), description_(it.description_), hasMoreTrees_(it.hasMoreTrees_)
+    {}
+
+    AbstractDescriptionTreeIterator& operator=(const AbstractDescriptionTreeIterator& it)
+    {
+      in_           = it.in_;
+      description_  = it.description_;
+      hasMoreTrees_ = it.hasMoreTrees_;
+      return *this;
+    }
+
+    virtual ~AbstractDescriptionTreeIterator() {}
+
+  public:
+    Tree* nextTree() throw (Exception)
+    {
+      if (!hasMoreTrees_)
+        throw Exception("AbstractDescriptionTreeIterator::nextTree(). No more tree.");
+      std::string description;
+      description.swap(description_);
+      fetch_();
+      return parseDescription_(description);
+    }
+
+    bool hasMoreTrees() const { return hasMoreTrees_; }
+
+  protected:
+    /**
+     * @brief Build a tree from its description.
+     *
+     * @param description The description, including the ending semi colon.
+     * @return A new tree object.
+     * @throw Exception If the description could not be parsed.
+     */
+    virtual Tree* parseDescription_(const std::string& description) const throw (Exception) = 0;
+
+  private:
+    void fetch_()
+    {
+      // A description with no semi colon is ignored.
+      hasMoreTrees_ = getline(*in_, description_, ';') && !in_->eof();
+      if (hasMoreTrees_)
+        description_ += ';';
+    }
+};
+
 /**
  * @brief Partial implementation of the OTree interface.
  */
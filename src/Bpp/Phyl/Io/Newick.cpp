@@ -41,6 +41,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "../Tree.h"
 #include "../TreeTemplate.h"
 #include "../TreeTemplateTools.h"
+#include "NewickParser.h"
 
 #include <Bpp/Text/TextTools.h>
 
@@ -71,24 +72,15 @@ TreeTemplate<Node> * Newick::read(istream& in) const throw (Exception)
   // Checking the existence of specified file
   if (! in) { throw IOException ("Newick::read: failed to read from stream"); }
   
-  //We concatenate all line in file till we reach the ending semi colon:
-  string temp, description;// Initialization
-  // Main loop : for all file lines
-  while (getline(in, temp, '\n'))
-  {
-    string::size_type index = temp.find(";");
-    if(index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      break;
-    }
-    else description += temp;
-  }
-
-  if (allowComments_) description = TextTools::removeSubstrings(description, '[', ']');
+  //We read the file till we reach the ending semi colon:
+  string description;
+  getline(in, description, ';');
   if (TextTools::isEmpty(description))
     throw IOException("Newick::read: no tree was found!");
-  return TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+  if (in.eof())
+    throw IOException("Newick::read: bad format, no semi-colon found.");
+  description += ';';
+  return parenthesisToTree(description);
 }
 
 /******************************************************************************/
@@ -131,27 +123,32 @@ void Newick::read(istream& in, vector<Tree*>& trees) const throw (Exception)
   // Checking the existence of specified file
   if (! in) { throw IOException ("Newick::read: failed to read from stream"); }
   
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  //We concatenate all line in file till we reach the ending semi colon:
-  while (getline(in, temp, '\n'))
+  NewickTreeIterator it(*this, in);
+  while (it.hasMoreTrees())
   {
-    index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      if (allowComments_) description = TextTools::removeSubstrings(description, '[', ']');
-      trees.push_back(TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_));
-      description = temp.substr(index + 1);
-    }
-    else description += temp;
+    trees.push_back(it.nextTree());
   }
   //In case the file is empty, the method will not add any neww tree to the vector.
 }
 
 /******************************************************************************/
 
+TreeIterator* Newick::getTreeIterator(istream& in) const throw (Exception)
+{
+  return new NewickTreeIterator(*this, in);
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* Newick::parenthesisToTree(const string& description) const throw (Exception)
+{
+  NewickParser parser(allowComments_);
+  parser.parse(description);
+  return TreeTemplateTools::parenthesisToTree(parser, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+}
+
+/******************************************************************************/
+
 void Newick::write_(const vector<Tree*>& trees, ostream& out) const throw (Exception)
 {
   // Checking the existence of specified file, and possibility to open it in write mode
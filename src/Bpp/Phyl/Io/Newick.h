@@ -174,8 +174,21 @@ class Newick:
 			AbstractIMultiTree::read(path, trees);
 		}
 		void read(std::istream& in, std::vector<Tree*>& trees) const throw (Exception);
+
+    TreeIterator* getTreeIterator(std::istream& in) const throw (Exception);
     /**@}*/
 
+    /**
+     * @brief Build a tree from its parenthetic description, as found in a file.
+     *
+     * Comments are removed first if they are allowed.
+     *
+     * @param description The description, including the ending semi colon.
+     * @return A new tree object.
+     * @throw Exception If the description could not be parsed.
+     */
+    TreeTemplate<Node>* parenthesisToTree(const std::string& description) const throw (Exception);
+
 		/**
 		 * @name The OMultiTree interface
 		 *
@@ -204,6 +217,45 @@ class Newick:
 
 };
 
+/**
+ * @brief Iterator over the trees of a stream in the newick format.
+ *
+ * @see Newick::getTreeIterator()
+ */
+class NewickTreeIterator:
+  public AbstractDescriptionTreeIterator
+{
+  private:
+    const Newick* reader_;
+
+  public:
+    /**
+     * @param reader The reader to use for parsing trees. It must remain valid as long as the iterator is used.
+     * @param in The input stream.
+     * @throw IOException If the stream is not valid.
+     */
+    NewickTreeIterator(const Newick& reader, std::istream& in) throw (IOException) :
+      AbstractDescriptionTreeIterator(in), reader_(&reader) {}
+
+    NewickTreeIterator(const NewickTreeIterator& it) :
+      AbstractDescriptionTreeIterator(it), reader_(it.reader_) {}
+
+    NewickTreeIterator& operator=(const NewickTreeIterator& it)
+    {
+      AbstractDescriptionTreeIterator::operator=(it);
+      reader_ = it.reader_;
+      return *this;
+    }
+
+    virtual ~NewickTreeIterator() {}
+
+  protected:
+    Tree* parseDescription_(const std::string& description) const throw (Exception)
+    {
+      return reader_->parenthesisToTree(description);
+    }
+};
+
 } //end of namespace bpp.
 
 #endif	//_NEWICK_H_
@@ -0,0 +1,289 @@
+//
+// File: NewickParser.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#include "NewickParser.h"
+
+#include <Bpp/Text/TextTools.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/******************************************************************************/
+
+const size_t NewickParser::NO_FATHER = numeric_limits<size_t>::max();
+
+/******************************************************************************/
+
+const char* NewickParser::parse(const char* begin, const char* end) throw (IOException)
+{
+  elements_.clear();
+  openNodes_.clear();
+  buffers_.clear();
+  terminated_ = false;
+
+  const char* p = begin;
+  size_t current = addElement_(NO_FATHER);
+  // Tells if the sons of the current node have all been read:
+  bool closed = false;
+  while (true)
+  {
+    if (!closed)
+    {
+      while (p != end && isspace(static_cast<unsigned char>(*p))) ++p;
+      if (p != end && *p == '(')
+      {
+        elements_[current].isLeaf = false;
+        openNodes_.push_back(current);
+        current = addElement_(current);
+        ++p;
+        continue;
+      }
+    }
+    p = readTail_(p, end, elements_[current]);
+    if (p == end)
+      break;
+    char c = *p++;
+    if (c == ';')
+    {
+      terminated_ = true;
+      break;
+    }
+    else if (c == '(')
+    {
+      if (closed)
+        throw IOException("NewickParser::parse(). Invalid format: unexpected opening parenthesis at position " + TextTools::toString(p - begin - 1) + ".");
+      // Text preceding an opening parenthesis is ignored:
+      size_t father = elements_[current].father;
+      elements_[current] = Element();
+      elements_[current].father = father;
+      elements_[current].isLeaf = false;
+      openNodes_.push_back(current);
+      current = addElement_(current);
+    }
+    else if (c == ',')
+    {
+      if (openNodes_.empty())
+        throw IOException("NewickParser::parse(). Invalid format: unexpected comma at position " + TextTools::toString(p - begin - 1) + ".");
+      current = addElement_(openNodes_.back());
+      closed = false;
+    }
+    else // c == ')'
+    {
+      if (openNodes_.empty())
+        throw IOException("NewickParser::parse(). Invalid format: bad closing parenthesis at position " + TextTools::toString(p - begin - 1) + ".");
+      current = openNodes_.back();
+      openNodes_.pop_back();
+      closed = true;
+    }
+  }
+  if (!openNodes_.empty())
+    throw IOException("NewickParser::parse(). Invalid format: missing closing parenthesis.");
+  return p;
+}
+
+/******************************************************************************/
+
+void NewickParser::parse(const string& description) throw (IOException)
+{
+  const char* begin = description.data();
+  parse(begin, begin + description.size());
+  if (!terminated_)
+    throw IOException("NewickParser::parse(). Bad format: no semi-colon found.");
+}
+
+/******************************************************************************/
+
+size_t NewickParser::addElement_(size_t father)
+{
+  elements_.push_back(Element());
+  elements_.back().father = father;
+  return elements_.size() - 1;
+}
+
+/******************************************************************************/
+
+const char* NewickParser::readTail_(const char* p, const char* end, Element& element) throw (IOException)
+{
+  // The text of a node may be interrupted by comments, we keep track of its non-empty pieces:
+  const char* pieceBegin = p;
+  const char* firstBegin = 0;
+  const char* firstEnd = 0;
+  string* buffer = 0;
+  while (p != end)
+  {
+    char c = *p;
+    if (c == ',' || c == ')' || c == '(' || c == ';')
+      break;
+    if (c == '[' && allowComments_)
+    {
+      const char* close = find(p + 1, end, ']');
+      if (close == end)
+        throw IOException("NewickParser::parse(). Invalid format: unterminated comment.");
+      size_t prefixSize = annotationPrefix_.size();
+      if (prefixSize > 0 && static_cast<size_t>(close - p - 1) >= prefixSize && strncmp(p + 1, annotationPrefix_.c_str(), prefixSize) == 0)
+      {
+        element.annotationBegin = p + 1 + prefixSize;
+        element.annotationEnd = close;
+      }
+      if (!isBlank_(pieceBegin, p))
+      {
+        if (buffer)
+          buffer->append(pieceBegin, p);
+        else if (firstBegin)
+        {
+          buffers_.push_back(string(firstBegin, firstEnd));
+          buffer = &buffers_.back();
+          buffer->append(pieceBegin, p);
+        }
+        else
+        {
+          firstBegin = pieceBegin;
+          firstEnd = p;
+        }
+      }
+      p = close + 1;
+      pieceBegin = p;
+      continue;
+    }
+    ++p;
+  }
+
+  if (buffer)
+  {
+    buffer->append(pieceBegin, p);
+    splitTail_(buffer->data(), buffer->data() + buffer->size(), element);
+  }
+  else if (firstBegin)
+  {
+    if (!isBlank_(pieceBegin, p))
+    {
+      buffers_.push_back(string(firstBegin, firstEnd));
+      buffer = &buffers_.back();
+      buffer->append(pieceBegin, p);
+      splitTail_(buffer->data(), buffer->data() + buffer->size(), element);
+    }
+    else
+      splitTail_(firstBegin, firstEnd, element);
+  }
+  else
+    splitTail_(pieceBegin, p, element);
+  return p;
+}
+
+/******************************************************************************/
+
+void NewickParser::splitTail_(const char* begin, const char* end, Element& element)
+{
+  // The branch length follows the last colon:
+  const char* colon = end;
+  for (const char* q = end; q != begin; --q)
+  {
+    if (*(q - 1) == ':')
+    {
+      colon = q - 1;
+      break;
+    }
+  }
+  if (colon != end)
+  {
+    const char* b = colon + 1;
+    const char* e = end;
+    while (b != e && isspace(static_cast<unsigned char>(*b))) ++b;
+    while (e != b && isspace(static_cast<unsigned char>(*(e - 1)))) --e;
+    element.lengthBegin = b;
+    element.lengthEnd = e;
+  }
+  const char* b = begin;
+  const char* e = colon;
+  while (b != e && isspace(static_cast<unsigned char>(*b))) ++b;
+  while (e != b && isspace(static_cast<unsigned char>(*(e - 1)))) --e;
+  element.labelBegin = b;
+  element.labelEnd = e;
+}
+
+/******************************************************************************/
+
+bool NewickParser::isBlank_(const char* begin, const char* end)
+{
+  for (const char* p = begin; p != end; ++p)
+  {
+    if (!isspace(static_cast<unsigned char>(*p)))
+      return false;
+  }
+  return true;
+}
+
+/******************************************************************************/
+
+double NewickParser::toDouble(const char* begin, const char* end) throw (IOException)
+{
+  // Short numbers are copied to a null-terminated buffer on the stack:
+  char buffer[64];
+  size_t size = static_cast<size_t>(end - begin);
+  if (size == 0 || size >= sizeof(buffer))
+  {
+    try
+    {
+      return TextTools::toDouble(string(begin, end));
+    }
+    catch (Exception& e)
+    {
+      throw IOException("NewickParser::toDouble(). Invalid number: " + string(begin, end));
+    }
+  }
+  memcpy(buffer, begin, size);
+  buffer[size] = '\0';
+  char* last;
+  double x = strtod(buffer, &last);
+  if (last != buffer + size)
+    throw IOException("NewickParser::toDouble(). Invalid number: " + string(begin, end));
+  return x;
+}
+
+/******************************************************************************/
+
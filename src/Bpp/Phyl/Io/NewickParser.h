@@ -0,0 +1,189 @@
+//
+// File: NewickParser.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#ifndef _NEWICKPARSER_H_
+#define _NEWICKPARSER_H_
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <string>
+#include <vector>
+#include <deque>
+
+namespace bpp
+{
+
+/**
+ * @brief A single-pass parser for tree descriptions in the parenthesis format.
+ *
+ * The parser reads a description from a range of characters, without copying it,
+ * and stores one Element per node in a contiguous array, in pre-order:
+ * the father of a node always comes before the node, and sons are stored in the order of the description.
+ * Labels, lengths and annotations are stored as pointers into the parsed range,
+ * which must therefore remain valid as long as the elements are used.
+ * No recursion is involved, so that deep trees (e.g. caterpillars) can be parsed safely.
+ *
+ * Comments between square brackets are optionally skipped. Comments starting with a given
+ * prefix (for instance "&&NHX:") are stored as node annotations.
+ *
+ * The element array is kept from one call to another, so that parsing many trees with the same
+ * parser instance does not require any new memory allocation.
+ *
+ * @see TreeTemplateTools::parenthesisToTree, Nhx::parenthesisToTree
+ */
+class NewickParser
+{
+  public:
+    static const size_t NO_FATHER;
+
+    /**
+     * @brief The parsed description of a node.
+     */
+    struct Element
+    {
+      public:
+        size_t father;
+        bool isLeaf;
+        /**
+         * @brief The name of a leaf, or the text following the closing parenthesis of an inner node (typically a bootstrap value).
+         */
+        const char* labelBegin;
+        const char* labelEnd;
+        /**
+         * @brief The branch length, if any, as it appears in the description.
+         */
+        const char* lengthBegin;
+        const char* lengthEnd;
+        /**
+         * @brief The content of the annotation, if any, without the prefix and closing bracket.
+         */
+        const char* annotationBegin;
+        const char* annotationEnd;
+
+      public:
+        Element() :
+          father(NO_FATHER), isLeaf(true),
+          labelBegin(0), labelEnd(0),
+          lengthBegin(0), lengthEnd(0),
+          annotationBegin(0), annotationEnd(0) {}
+
+      public:
+        bool hasLabel() const { return labelBegin != labelEnd; }
+        bool hasLength() const { return lengthBegin != lengthEnd; }
+        bool hasAnnotation() const { return annotationBegin != annotationEnd; }
+
+        std::string getLabel() const { return std::string(labelBegin, labelEnd); }
+        std::string getLength() const { return std::string(lengthBegin, lengthEnd); }
+        std::string getAnnotation() const { return std::string(annotationBegin, annotationEnd); }
+    };
+
+  private:
+    bool allowComments_;
+    std::string annotationPrefix_;
+    std::vector<Element> elements_;
+    std::vector<size_t> openNodes_;
+    // Text interrupted by comments is concatenated here (std::deque keeps string addresses valid):
+    std::deque<std::string> buffers_;
+    bool terminated_;
+
+  public:
+    /**
+     * @param allowComments Tell if text between square brackets should be considered as a comment and skipped.
+     * @param annotationPrefix If not empty, comments starting with this prefix are stored as annotations.
+     * Only used if allowComments is true.
+     */
+    explicit NewickParser(bool allowComments = false, const std::string& annotationPrefix = "") :
+      allowComments_(allowComments), annotationPrefix_(annotationPrefix),
+      elements_(), openNodes_(), buffers_(), terminated_(false) {}
+
+    virtual ~NewickParser() {}
+
+  public:
+    /**
+     * @brief Parse a tree description.
+     *
+     * Parsing stops at the first semi-colon found outside of a comment, or at the end of the range.
+     * Previously parsed elements are discarded.
+     *
+     * @param begin A pointer toward the first character of the description.
+     * @param end A pointer toward the character after the last one of the description.
+     * @return A pointer toward the character following the semi-colon, or end if none was found.
+     * @throw IOException If the description is not properly formatted.
+     */
+    const char* parse(const char* begin, const char* end) throw (IOException);
+
+    /**
+     * @brief Parse a tree description ending with a semi-colon.
+     *
+     * @param description The description to parse. It must remain valid as long as the elements are used.
+     * @throw IOException If the description is not properly formatted, or does not end with a semi-colon.
+     */
+    void parse(const std::string& description) throw (IOException);
+
+    /**
+     * @return True if the last parsed description was ended by a semi-colon.
+     */
+    bool isTerminated() const { return terminated_; }
+
+    size_t getNumberOfElements() const { return elements_.size(); }
+
+    const Element& getElement(size_t i) const { return elements_[i]; }
+
+    /**
+     * @brief Convert a range of characters to a floating point number, without memory allocation.
+     *
+     * @param begin A pointer toward the first character.
+     * @param end A pointer toward the character after the last one.
+     * @throw IOException If the range does not contain a valid number.
+     */
+    static double toDouble(const char* begin, const char* end) throw (IOException);
+
+  private:
+    size_t addElement_(size_t father);
+    const char* readTail_(const char* p, const char* end, Element& element) throw (IOException);
+    void splitTail_(const char* begin, const char* end, Element& element);
+    static bool isBlank_(const char* begin, const char* end);
+};
+
+} //end of namespace bpp.
+
+#endif //_NEWICKPARSER_H_
+
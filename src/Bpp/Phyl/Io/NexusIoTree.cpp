@@ -74,18 +74,39 @@ const string NexusIOTree::getFormatDescription() const
 
 TreeTemplate<Node> * NexusIOTree::read(istream &in) const throw (Exception)
 {
-  vector<Tree*> trees;
-  read(in, trees);
-  if (trees.size() == 0)
+  NexusTreeIterator it(in);
+  if (!it.hasMoreTrees())
     throw IOException("NexusIOTree::read(). No tree found in file.");
-  for (size_t i = trees.size() - 1; i > 0; i--)
-    delete trees[i];
-  return dynamic_cast<TreeTemplate<Node>*>(trees[0]);
+  return it.nextTree();
 }
 
 /******************************************************************************/
 
 void NexusIOTree::read(std::istream& in, std::vector<Tree*>& trees) const throw (Exception)
+{
+  NexusTreeIterator it(in);
+  while (it.hasMoreTrees())
+  {
+    trees.push_back(it.nextTree());
+  }
+}
+
+/******************************************************************************/
+
+TreeIterator* NexusIOTree::getTreeIterator(std::istream& in) const throw (Exception)
+{
+  return new NexusTreeIterator(in);
+}
+
+/******************************************************************************/
+
+NexusTreeIterator::NexusTreeIterator(std::istream& in) throw (Exception) :
+  in_(&in),
+  translation_(),
+  hasTranslation_(false),
+  cmdFound_(false),
+  cmdName_(),
+  cmdArgs_()
 {
 	// Checking the existence of specified file
 	if (! in) { throw IOException ("NexusIOTree::read(). Failed to read from stream"); }
@@ -99,19 +120,16 @@ void NexusIOTree::read(std::istream& in, std::vector<Tree*>& trees) const throw
     line = TextTools::removeSurroundingWhiteSpaces(FileTools::getNextLine(in));
   }
   
-  string cmdName = "", cmdArgs = "";
-  bool cmdFound = NexusTools::getNextCommand(in, cmdName, cmdArgs, false);
-  if (! cmdFound)
+  cmdFound_ = NexusTools::getNextCommand(in, cmdName_, cmdArgs_, false);
+  if (! cmdFound_)
     throw Exception("NexusIOTree::read(). Missing tree command.");
-  cmdName = TextTools::toUpper(cmdName);
+  cmdName_ = TextTools::toUpper(cmdName_);
 
   //Look for the TRANSLATE command:
-  map<string, string> translation;
-  bool hasTranslation = false;
-  if (cmdName == "TRANSLATE")
+  if (cmdName_ == "TRANSLATE")
   {
     //Parse translation:
-    StringTokenizer st(cmdArgs, ",");
+    StringTokenizer st(cmdArgs_, ",");
     while (st.hasMoreToken())
     {
       string tok = TextTools::removeSurroundingWhiteSpaces(st.nextToken());
@@ -120,46 +138,53 @@ void NexusIOTree::read(std::istream& in, std::vector<Tree*>& trees) const throw
         throw Exception("NexusIOTree::read(). Unvalid translation description.");
       string name = nst.nextToken();
       string tln  = nst.nextToken();
-      translation[name] = tln;
+      translation_[name] = tln;
     }
-    hasTranslation = true;
-    cmdFound = NexusTools::getNextCommand(in, cmdName, cmdArgs, false);
-    if (! cmdFound)
+    hasTranslation_ = true;
+    cmdFound_ = NexusTools::getNextCommand(in, cmdName_, cmdArgs_, false);
+    if (! cmdFound_)
       throw Exception("NexusIOTree::read(). Missing tree command.");
     else
-      cmdName = TextTools::toUpper(cmdName);
+      cmdName_ = TextTools::toUpper(cmdName_);
   }
+}
 
-  //Now parse the trees:
-  while (cmdFound && cmdName != "END")
+/******************************************************************************/
+
+TreeTemplate<Node>* NexusTreeIterator::nextTree() throw (Exception)
+{
+  if (!hasMoreTrees())
+    throw Exception("NexusTreeIterator::nextTree(). No more tree.");
+  if (cmdName_ != "TREE")
+    throw Exception("NexusIOTree::read(). Unvalid command found: " + cmdName_);
+  string::size_type pos = cmdArgs_.find("=");
+  if (pos == string::npos)
+    throw Exception("NexusIOTree::read(). unvalid format, should be tree-name=tree-description");
+  string description = cmdArgs_.substr(pos + 1);
+  TreeTemplate<Node>* tree = TreeTemplateTools::parenthesisToTree(description + ";", true);
+
+  //Now translate leaf names if there is a translation:
+  //(we assume that all trees share the same translation! ===> check!)
+  if (hasTranslation_)
   {
-    if (cmdName != "TREE")
-      throw Exception("NexusIOTree::read(). Unvalid command found: " + cmdName);
-    string::size_type pos = cmdArgs.find("=");
-    if (pos == string::npos)
-      throw Exception("NexusIOTree::read(). unvalid format, should be tree-name=tree-description");
-    string description = cmdArgs.substr(pos + 1);
-	  TreeTemplate<Node>* tree = TreeTemplateTools::parenthesisToTree(description + ";", true);
-
-    //Now translate leaf names if there is a translation:
-    //(we assume that all trees share the same translation! ===> check!)
-    if (hasTranslation)
+    vector<Node*> leaves = tree->getLeaves();
+    for (size_t i = 0; i < leaves.size(); i++)
     {
-      vector<Node*> leaves = tree->getLeaves();
-      for (size_t i = 0; i < leaves.size(); i++)
+      string name = leaves[i]->getName();
+      map<string, string>::const_iterator it = translation_.find(name);
+      if (it == translation_.end())
       {
-        string name = leaves[i]->getName();
-        if (translation.find(name) == translation.end())
-        {
-          throw Exception("NexusIOTree::read(). No translation was given for this leaf: " + name);
-        }
-        leaves[i]->setName(translation[name]);
+        delete tree;
+        throw Exception("NexusIOTree::read(). No translation was given for this leaf: " + name);
       }
+      leaves[i]->setName(it->second);
     }
-    trees.push_back(tree);
-    cmdFound = NexusTools::getNextCommand(in, cmdName, cmdArgs, false);
-    if (cmdFound) cmdName = TextTools::toUpper(cmdName);
   }
+
+  //Fetch the next command:
+  cmdFound_ = NexusTools::getNextCommand(*in_, cmdName_, cmdArgs_, false);
+  if (cmdFound_) cmdName_ = TextTools::toUpper(cmdName_);
+  return tree;
 }
 
 /******************************************************************************/
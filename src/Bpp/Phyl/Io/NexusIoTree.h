@@ -43,6 +43,9 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "IoTree.h"
 #include "../TreeTemplate.h"
 
+// From the STL:
+#include <map>
+
 namespace bpp
 {
 
@@ -122,6 +125,8 @@ class NexusIOTree:
 			AbstractIMultiTree::read(path, trees);
 		}
 		void read(std::istream& in, std::vector<Tree*>& trees) const throw (Exception);
+
+    TreeIterator* getTreeIterator(std::istream& in) const throw (Exception);
     /**@}*/
 
 		/**
@@ -152,6 +157,60 @@ class NexusIOTree:
 
 };
 
+/**
+ * @brief Iterator over the trees of a stream in the Nexus format.
+ *
+ * The stream is read until the TREES block and the optional TRANSLATE command upon construction.
+ * Each TREE command is then parsed when the corresponding tree is retrieved.
+ *
+ * @see NexusIOTree::getTreeIterator()
+ */
+class NexusTreeIterator:
+  public virtual TreeIterator
+{
+  private:
+    std::istream* in_;
+    std::map<std::string, std::string> translation_;
+    bool hasTranslation_;
+    bool cmdFound_;
+    std::string cmdName_;
+    std::string cmdArgs_;
+
+  public:
+    /**
+     * @param in The input stream. It must remain valid as long as the iterator is used.
+     * @throw Exception If the stream is not valid or does not contain a TREES block.
+     */
+    NexusTreeIterator(std::istream& in) throw (Exception);
+
+    NexusTreeIterator(const NexusTreeIterator& it) :
+      in_(it.in_),
+      translation_(it.translation_),
+      hasTranslation_(it.hasTranslation_),
+      cmdFound_(it.cmdFound_),
+      cmdName_(it.cmdName_),
+      cmdArgs_(it.cmdArgs_)
+    {}
+
+    NexusTreeIterator& operator=(const NexusTreeIterator& it)
+    {
+      in_             = it.in_;
+      translation_    = it.translation_;
+      hasTranslation_ = it.hasTranslation_;
+      cmdFound_       = it.cmdFound_;
+      cmdName_        = it.cmdName_;
+      cmdArgs_        = it.cmdArgs_;
+      return *this;
+    }
+
+    virtual ~NexusTreeIterator() {}
+
+  public:
+    TreeTemplate<Node>* nextTree() throw (Exception);
+
+    bool hasMoreTrees() const { return cmdFound_ && cmdName_ != "END"; }
+};
+
 } //end of namespace bpp.
 
 #endif	//_NEXUSIOTREE_H_
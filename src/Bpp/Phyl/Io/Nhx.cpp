@@ -40,6 +40,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "Nhx.h"
 #include "../Tree.h"
 #include "../TreeTemplate.h"
+#include "../TreeTemplateTools.h"
 
 //From bpp-core:
 #include <Bpp/Text/TextTools.h>
@@ -101,23 +102,12 @@ TreeTemplate<Node>* Nhx::read(istream& in) const throw (Exception)
   // Checking the existence of specified file
   if (! in) { throw IOException ("Nhx ::read: failed to read from stream"); }
   
-  //We concatenate all line in file till we reach the ending semi colon:
-  string temp, description;// Initialization
-  // Main loop : for all file lines
-  while (! in.eof())
-  {
-    getline(in, temp, '\n');  // Copy current line in temporary string
-    string::size_type index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      break;
-    }
-    else description += temp;
-  }
-  vector<string> beginnings, endings;
-  beginnings.push_back("[&&NHX:");
-  description = TextTools::removeSubstrings(description, '[', ']', beginnings, endings);
+  //We read the file till we reach the ending semi colon:
+  string description;
+  getline(in, description, ';');
+  if (in.eof())
+    throw IOException("Nhx::read: bad format, no semi-colon found.");
+  description += ';';
   return parenthesisToTree(description);
 }
 
@@ -147,32 +137,29 @@ void Nhx::read(istream& in, vector<Tree*>& trees) const throw (Exception)
   // Checking the existence of specified file
   if (! in) { throw IOException ("Nhx::read: failed to read from stream"); }
   
-  // Main loop : for all file lines
-  string temp, description;// Initialization
-  string::size_type index;
-  vector <string > beginnings, endings;
-  beginnings.push_back("[&&NHX:");
-  while (!in.eof())
+  NhxTreeIterator it(*this, in);
+  while (it.hasMoreTrees())
   {
-    //We concatenate all line in file till we reach the ending semi colon:
-    while (!in.eof())
-    {
-      getline(in, temp, '\n');  // Copy current line in temporary string
-      index = temp.find(";");
-      if (index != string::npos)
-      {
-        description += temp.substr(0, index + 1);
-        description = TextTools::removeSubstrings(description, '[', ']', beginnings, endings);
-        trees.push_back(parenthesisToTree(description));
-        description = temp.substr(index + 1);
-      }
-      else description += temp;
-    }
+    trees.push_back(it.nextTree());
   }
 }
 
 /******************************************************************************/
 
+TreeIterator* Nhx::getTreeIterator(istream& in) const throw (Exception)
+{
+  return new NhxTreeIterator(*this, in);
+}
+
+/******************************************************************************/
+
+Tree* NhxTreeIterator::parseDescription_(const string& description) const throw (Exception)
+{
+  return reader_->parenthesisToTree(description);
+}
+
+/******************************************************************************/
+
 void Nhx::write_(const vector<Tree*>& trees, ostream& out) const throw (Exception)
 {
   // Checking the existence of specified file, and possibility to open it in write mode
@@ -281,47 +268,57 @@ Nhx::Element Nhx::getElement(const string& elt) const throw (IOException)
 
 Node* Nhx::parenthesisToNode(const string& description) const
 {
-  //cout << "NODE: " << description << endl;
-  Element elt = getElement(description);
-  
-  //New node:
-  Node* node = new Node();
-  if (!TextTools::isEmpty(elt.length))
-  {
-    node->setDistanceToFather(TextTools::toDouble(elt.length));
-  }
-  if (!TextTools::isEmpty(elt.annotation))
-  {
-    bool hasId = setNodeProperties(*node, elt.annotation);
-    if (!hasIds_ && hasId)
-      hasIds_ = true;
-    if (hasIds_ && !hasId)
-      throw Exception("Nhx::parenthesisToNode. At least one one is missing an id (ND tag).");
-  }
- 
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
-  {
-    elements.push_back(nt.nextToken());
-  }
-  if (elt.isLeaf)
+  NewickParser parser(true, "&&NHX:");
+  const char* begin = description.data();
+  parser.parse(begin, begin + description.size());
+  return parenthesisToNode_(parser);
+}
+
+/******************************************************************************/
+
+Node* Nhx::parenthesisToNode_(const NewickParser& parser) const
+{
+  // Fathers always come before their sons in the parser, so that all nodes can be created in one pass:
+  size_t nbElements = parser.getNumberOfElements();
+  vector<Node*> nodes(nbElements);
+  try
   {
-    //This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    node->setName(name);
+    for (size_t i = 0; i < nbElements; ++i)
+    {
+      const NewickParser::Element& elt = parser.getElement(i);
+      Node* node = new Node();
+      if (elt.father != NewickParser::NO_FATHER)
+        nodes[elt.father]->addSon(node);
+      nodes[i] = node;
+
+      if (elt.hasLength())
+      {
+        node->setDistanceToFather(NewickParser::toDouble(elt.lengthBegin, elt.lengthEnd));
+      }
+      if (elt.hasAnnotation())
+      {
+        bool hasId = setNodeProperties(*node, elt.getAnnotation());
+        if (!hasIds_ && hasId)
+          hasIds_ = true;
+        if (hasIds_ && !hasId)
+          throw Exception("Nhx::parenthesisToNode. At least one one is missing an id (ND tag).");
+      }
+      if (elt.isLeaf)
+      {
+        node->setName(elt.getLabel());
+      }
+    }
   }
-  else
+  catch (Exception& e)
   {
-    //This is a node:
-    for (size_t i = 0; i < elements.size(); ++i)
+    if (nbElements > 0 && nodes[0])
     {
-      //cout << "NODE: SUBNODE: " << i << ", " << elements[i] << endl;
-      Node* son = parenthesisToNode(elements[i]);
-      node->addSon(son);
+      TreeTemplateTools::deleteSubtree(nodes[0]);
+      delete nodes[0];
     }
+    throw;
   }
-  return node;
+  return nbElements > 0 ? nodes[0] : 0;
 }
 
 /******************************************************************************/
@@ -329,11 +326,16 @@ Node* Nhx::parenthesisToNode(const string& description) const
 TreeTemplate<Node>* Nhx::parenthesisToTree(const string& description) const throw (Exception) 
 {
   hasIds_ = false;
-  string::size_type semi = description.rfind(';');
-  if (semi == string::npos)
-    throw Exception("Nhx::parenthesisToTree(). Bad format: no semi-colon found.");
-  string content = description.substr(0, semi);
-  Node* node = parenthesisToNode(content);
+  NewickParser parser(true, "&&NHX:");
+  try
+  {
+    parser.parse(description);
+  }
+  catch (IOException& e)
+  {
+    throw Exception(string("Nhx::parenthesisToTree(). ") + e.what());
+  }
+  Node* node = parenthesisToNode_(parser);
   TreeTemplate<Node>* tree = new TreeTemplate<Node>();
   tree->setRootNode(node);
   if (!hasIds_)
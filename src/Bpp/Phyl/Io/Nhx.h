@@ -42,6 +42,7 @@
 
 #include "IoTree.h"
 #include "../TreeTemplate.h"
+#include "NewickParser.h"
 
 //From the STL:
 #include <set>
@@ -201,6 +202,8 @@ namespace bpp
       AbstractIMultiTree::read(path, trees);
     }
     void read(std::istream& in, std::vector<Tree*>& trees) const throw (Exception);
+
+    TreeIterator* getTreeIterator(std::istream& in) const throw (Exception);
     /**@}*/
 
     /**
@@ -218,6 +221,15 @@ namespace bpp
     }
     /** @} */
 
+    /**
+     * @brief Parse a tree description.
+     *
+     * Comments between square brackets are ignored, unless they start with "&&NHX:".
+     *
+     * @param description The description, ending with a semi colon.
+     * @return A new tree object.
+     * @throw Exception If the description could not be parsed.
+     */
     TreeTemplate<Node>* parenthesisToTree(const std::string& description) const throw (Exception);
 
     std::string treeToParenthesis(const TreeTemplate<Node>& tree) const;
@@ -264,6 +276,8 @@ namespace bpp
 
     Element getElement(const std::string& elt) const throw (IOException);
 
+    Node* parenthesisToNode_(const NewickParser& parser) const;
+
   public:
     Node* parenthesisToNode(const std::string& description) const;
   
@@ -278,6 +292,42 @@ namespace bpp
     static Clonable* stringToProperty_(const std::string& pptDesc, short type) throw (Exception);
   };
 
+  /**
+   * @brief Iterator over the trees of a stream in the NHX format.
+   *
+   * @see Nhx::getTreeIterator()
+   */
+  class NhxTreeIterator:
+    public AbstractDescriptionTreeIterator
+  {
+  private:
+    const Nhx* reader_;
+
+  public:
+    /**
+     * @param reader The reader to use for parsing trees. It must remain valid as long as the iterator is used.
+     * @param in The input stream.
+     * @throw IOException If the stream is not valid.
+     */
+    NhxTreeIterator(const Nhx& reader, std::istream& in) throw (IOException) :
+      AbstractDescriptionTreeIterator(in), reader_(&reader) {}
+
+    NhxTreeIterator(const NhxTreeIterator& it) :
+      AbstractDescriptionTreeIterator(it), reader_(it.reader_) {}
+
+    NhxTreeIterator& operator=(const NhxTreeIterator& it)
+    {
+      AbstractDescriptionTreeIterator::operator=(it);
+      reader_ = it.reader_;
+      return *this;
+    }
+
+    virtual ~NhxTreeIterator() {}
+
+  protected:
+    Tree* parseDescription_(const std::string& description) const throw (Exception);
+  };
+
 } //end of namespace bpp.
 
 #endif  //_NHX_H_
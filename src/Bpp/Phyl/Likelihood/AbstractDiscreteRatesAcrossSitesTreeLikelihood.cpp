@@ -40,21 +40,35 @@
 #include "AbstractDiscreteRatesAcrossSitesTreeLikelihood.h"
 
 #include <Bpp/Numeric/VectorTools.h>
+#include <Bpp/Text/TextTools.h>
 
 using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
 /******************************************************************************/
 
+const short AbstractDiscreteRatesAcrossSitesTreeLikelihood::PARALLEL_SITES = 0;
+const short AbstractDiscreteRatesAcrossSitesTreeLikelihood::PARALLEL_SUBTREES = 1;
+
+const int AbstractDiscreteRatesAcrossSitesTreeLikelihood::SCALING_EXPONENT = 256;
+const double AbstractDiscreteRatesAcrossSitesTreeLikelihood::SCALING_THRESHOLD = std::ldexp(1., -256);
+
+/******************************************************************************/
+
 AbstractDiscreteRatesAcrossSitesTreeLikelihood::AbstractDiscreteRatesAcrossSitesTreeLikelihood(
   DiscreteDistribution* rDist,
   bool verbose)
 throw (Exception) :
-  rateDistribution_(rDist)
+  rateDistribution_(rDist),
+  threadPool_(),
+  siteBlockSize_(0),
+  parallelMode_(PARALLEL_SITES),
+  scaling_(false)
 {
   AbstractTreeLikelihood::enableDerivatives(true);
 }
@@ -284,6 +298,110 @@ void AbstractDiscreteRatesAcrossSitesTreeLikelihood::resetLikelihoodArray(
 
 /******************************************************************************/
 
+void AbstractDiscreteRatesAcrossSitesTreeLikelihood::resetLikelihoodArray(
+  VVVdouble& likelihoodArray,
+  size_t siteBegin,
+  size_t siteEnd)
+{
+  if (siteBegin >= siteEnd) return;
+  size_t nbClasses = likelihoodArray[siteBegin].size();
+  size_t nbStates  = likelihoodArray[siteBegin][0].size();
+  for (size_t i = siteBegin; i < siteEnd; i++)
+  {
+    for (size_t c = 0; c < nbClasses; c++)
+    {
+      for (size_t s = 0; s < nbStates; s++)
+      {
+        likelihoodArray[i][c][s] = 1.;
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+void AbstractDiscreteRatesAcrossSitesTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  if (nbThreads == 0)
+    nbThreads = ThreadPool::getHardwareConcurrency();
+  if (nbThreads == getNumberOfThreads())
+    return;
+  threadPool_.reset(nbThreads > 1 ? new ThreadPool(nbThreads) : 0);
+}
+
+/******************************************************************************/
+
+size_t AbstractDiscreteRatesAcrossSitesTreeLikelihood::getSiteBlockSize() const
+{
+  if (siteBlockSize_ > 0)
+    return siteBlockSize_;
+  // Aim at 64 kB of conditional likelihoods per array and block:
+  size_t siteSize = getNumberOfClasses() * getNumberOfStates() * sizeof(double);
+  return max(static_cast<size_t>(32), static_cast<size_t>(65536) / max(siteSize, static_cast<size_t>(1)));
+}
+
+/******************************************************************************/
+
+void AbstractDiscreteRatesAcrossSitesTreeLikelihood::forEachSiteBlock_(size_t nbSites, const function<void (size_t, size_t)>& f) const
+{
+  if (!threadPool_.get())
+  {
+    f(0, nbSites);
+    return;
+  }
+  threadPool_->parallelForBlocks(nbSites, getSiteBlockSize(), f);
+}
+
+/******************************************************************************/
+
+void AbstractDiscreteRatesAcrossSitesTreeLikelihood::setParallelMode(short mode) throw (Exception)
+{
+  if (mode != PARALLEL_SITES && mode != PARALLEL_SUBTREES)
+    throw Exception("AbstractDiscreteRatesAcrossSitesTreeLikelihood::setParallelMode. Unknown mode: " + TextTools::toString(mode) + ".");
+  parallelMode_ = mode;
+}
+
+/******************************************************************************/
+
+void AbstractDiscreteRatesAcrossSitesTreeLikelihood::forEachNode_(bool postfix, const function<void (const Node*)>& f) const
+{
+  // List nodes in prefix order, with the index of their father:
+  vector<const Node*> nodes;
+  vector<size_t> fathers;
+  function<void (const Node*, size_t)> addSubtree = [&](const Node* node, size_t father) {
+      size_t k = nodes.size();
+      nodes.push_back(node);
+      fathers.push_back(father);
+      for (size_t i = 0; i < node->getNumberOfSons(); i++)
+      {
+        addSubtree(node->getSon(i), k);
+      }
+    };
+  addSubtree(tree_->getRootNode(), nodes.size());
+  size_t nbNodes = nodes.size();
+
+  if (!threadPool_.get())
+  {
+    for (size_t k = 0; k < nbNodes; k++)
+    {
+      f(nodes[postfix ? nbNodes - k - 1 : k]);
+    }
+    return;
+  }
+
+  vector< vector<size_t> > successors(nbNodes);
+  for (size_t k = 1; k < nbNodes; k++)
+  {
+    if (postfix)
+      successors[k].push_back(fathers[k]);
+    else
+      successors[fathers[k]].push_back(k);
+  }
+  threadPool_->parallelForGraph(successors, [&nodes, &f](size_t k) { f(nodes[k]); });
+}
+
+/******************************************************************************/
+
 void AbstractDiscreteRatesAcrossSitesTreeLikelihood::displayLikelihoodArray(
   const VVVdouble& likelihoodArray)
 {
@@ -308,6 +426,79 @@ void AbstractDiscreteRatesAcrossSitesTreeLikelihood::displayLikelihoodArray(
 
 /******************************************************************************/
 
+int AbstractDiscreteRatesAcrossSitesTreeLikelihood::rescaleSiteLikelihoods(VVdouble& likelihoods_i)
+{
+  size_t nbClasses = likelihoods_i.size();
+  double max = 0;
+  for (size_t c = 0; c < nbClasses; c++)
+  {
+    const Vdouble* likelihoods_i_c = &likelihoods_i[c];
+    for (size_t x = 0; x < likelihoods_i_c->size(); x++)
+    {
+      if ((*likelihoods_i_c)[x] > max) max = (*likelihoods_i_c)[x];
+    }
+  }
+  // A null site (incompatible data) is never scaled:
+  if (max >= SCALING_THRESHOLD || max <= 0.)
+    return 0;
+  int count = 0;
+  while (max < SCALING_THRESHOLD)
+  {
+    max = std::ldexp(max, SCALING_EXPONENT);
+    count++;
+  }
+  for (size_t c = 0; c < nbClasses; c++)
+  {
+    Vdouble* likelihoods_i_c = &likelihoods_i[c];
+    for (size_t x = 0; x < likelihoods_i_c->size(); x++)
+    {
+      (*likelihoods_i_c)[x] = std::ldexp((*likelihoods_i_c)[x], SCALING_EXPONENT * count);
+    }
+  }
+  return count;
+}
+
+/******************************************************************************/
+
+int AbstractDiscreteRatesAcrossSitesTreeLikelihood::rescaleSiteLikelihoods(double* likelihoods_i, size_t nbClasses, size_t nbStates, size_t stateStride)
+{
+  double max = 0;
+  for (size_t c = 0; c < nbClasses; c++)
+  {
+    const double* likelihoods_i_c = likelihoods_i + c * stateStride;
+    for (size_t x = 0; x < nbStates; x++)
+    {
+      if (likelihoods_i_c[x] > max) max = likelihoods_i_c[x];
+    }
+  }
+  if (max >= SCALING_THRESHOLD || max <= 0.)
+    return 0;
+  int count = 0;
+  while (max < SCALING_THRESHOLD)
+  {
+    max = std::ldexp(max, SCALING_EXPONENT);
+    count++;
+  }
+  for (size_t c = 0; c < nbClasses; c++)
+  {
+    double* likelihoods_i_c = likelihoods_i + c * stateStride;
+    for (size_t x = 0; x < nbStates; x++)
+    {
+      likelihoods_i_c[x] = std::ldexp(likelihoods_i_c[x], SCALING_EXPONENT * count);
+    }
+  }
+  return count;
+}
+
+/******************************************************************************/
+
+double AbstractDiscreteRatesAcrossSitesTreeLikelihood::getLogScalingFactor(int count)
+{
+  return static_cast<double>(SCALING_EXPONENT * count) * log(2.);
+}
+
+/******************************************************************************/
+
 VVdouble AbstractDiscreteRatesAcrossSitesTreeLikelihood::getTransitionProbabilities(int nodeId, size_t siteIndex) const
 {
   VVVdouble p3 = getTransitionProbabilitiesPerRateClass(nodeId, siteIndex);
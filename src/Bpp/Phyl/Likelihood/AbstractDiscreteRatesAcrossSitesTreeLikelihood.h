@@ -43,6 +43,12 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "AbstractTreeLikelihood.h"
 #include "DiscreteRatesAcrossSitesTreeLikelihood.h"
 #include "../Model/SubstitutionModel.h"
+#include "../ThreadPool.h"
+
+// From the STL:
+#include <memory>
+#include <functional>
+#include <cmath>
 
 namespace bpp
 {
@@ -59,6 +65,10 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
 {
   protected:
     DiscreteDistribution* rateDistribution_;
+    std::unique_ptr<ThreadPool> threadPool_;
+    size_t siteBlockSize_;
+    short parallelMode_;
+    bool scaling_;
     
   public:
     AbstractDiscreteRatesAcrossSitesTreeLikelihood(
@@ -69,7 +79,11 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
     AbstractDiscreteRatesAcrossSitesTreeLikelihood(
         const AbstractDiscreteRatesAcrossSitesTreeLikelihood& tl) :
       AbstractTreeLikelihood(tl),
-      rateDistribution_(tl.rateDistribution_)
+      rateDistribution_(tl.rateDistribution_),
+      threadPool_(tl.threadPool_.get() ? new ThreadPool(tl.threadPool_->getNumberOfThreads()) : 0),
+      siteBlockSize_(tl.siteBlockSize_),
+      parallelMode_(tl.parallelMode_),
+      scaling_(tl.scaling_)
     {}
 
     AbstractDiscreteRatesAcrossSitesTreeLikelihood& operator=(
@@ -77,6 +91,10 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
     {
       AbstractTreeLikelihood::operator=(tl);
       rateDistribution_ = tl.rateDistribution_;
+      threadPool_.reset(tl.threadPool_.get() ? new ThreadPool(tl.threadPool_->getNumberOfThreads()) : 0);
+      siteBlockSize_ = tl.siteBlockSize_;
+      parallelMode_ = tl.parallelMode_;
+      scaling_ = tl.scaling_;
       return *this;
     }
 
@@ -117,6 +135,149 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
     Vdouble getPosteriorRateOfEachSite() const;
     /** @} */
 
+    /**
+     * @name Parallel computations.
+     *
+     * Likelihood computations can be split into blocks of sites which are processed in parallel.
+     * Each block goes through the whole tree before the next one, so that the conditional
+     * likelihoods of a block stay in cache. Reductions over sites are always performed
+     * sequentially and in the same order, so that results do not depend on the number of threads.
+     *
+     * Alternatively, classes supporting it can traverse independent subtrees in parallel,
+     * each one for all sites. This is more efficient for large trees with few distinct sites.
+     *
+     * @{
+     */
+
+    /**
+     * @brief Split computations into blocks of sites.
+     */
+    static const short PARALLEL_SITES;
+
+    /**
+     * @brief Compute independent subtrees in parallel, for all sites at once.
+     */
+    static const short PARALLEL_SUBTREES;
+
+    /**
+     * @brief Set the number of threads to use.
+     *
+     * By default, computations are sequential.
+     *
+     * @param nbThreads The total number of threads, including the calling one.
+     * 1 disables parallel computations, and 0 uses as many threads as hardware threads.
+     */
+    virtual void setNumberOfThreads(size_t nbThreads);
+
+    /**
+     * @return The number of threads used for likelihood computations.
+     */
+    size_t getNumberOfThreads() const { return threadPool_.get() ? threadPool_->getNumberOfThreads() : 1; }
+
+    /**
+     * @brief Set the number of sites in each block of a parallel computation.
+     *
+     * @param siteBlockSize The number of sites per block, or 0 for a value computed
+     * from the size of the conditional likelihood vectors.
+     */
+    virtual void setSiteBlockSize(size_t siteBlockSize) { siteBlockSize_ = siteBlockSize; }
+
+    /**
+     * @return The number of sites in each block of a parallel computation.
+     */
+    size_t getSiteBlockSize() const;
+
+    /**
+     * @brief Set how computations are split between threads.
+     *
+     * Classes which do not support subtree parallelism always split sites.
+     *
+     * @param mode One of PARALLEL_SITES (the default) or PARALLEL_SUBTREES.
+     * @throw Exception If the mode is not valid.
+     */
+    virtual void setParallelMode(short mode) throw (Exception);
+
+    /**
+     * @return How computations are split between threads.
+     */
+    short getParallelMode() const { return parallelMode_; }
+
+    /** @} */
+
+    /**
+     * @name Numerical scaling.
+     *
+     * On large trees, conditional likelihoods may underflow. When scaling is enabled, classes supporting it
+     * multiply the conditional likelihoods of a site by 2^SCALING_EXPONENT each time their maximum drops
+     * below SCALING_THRESHOLD, and keep an integer count of these operations for each array and each site.
+     * Counts are accumulated toward the root, and log-likelihoods are corrected accordingly.
+     * As only powers of two are involved, scaling does not introduce any rounding error.
+     *
+     * When scaling is enabled, the conditional likelihood arrays returned by the likelihood data objects
+     * are scaled, and should be used together with their scaling counts.
+     *
+     * @{
+     */
+
+    /**
+     * @brief The power of two used at each scaling operation.
+     */
+    static const int SCALING_EXPONENT;
+
+    /**
+     * @brief Site likelihoods are scaled when their maximum over all classes and states is below this value.
+     */
+    static const double SCALING_THRESHOLD;
+
+    /**
+     * @brief Enable or disable scaling of conditional likelihoods.
+     *
+     * By default, no scaling is performed.
+     * Classes which do not support scaling throw an Exception when it is enabled.
+     * Likelihoods have to be recomputed for the change to be effective.
+     *
+     * @param yn Tell if conditional likelihoods should be scaled.
+     */
+    virtual void setLikelihoodScaling(bool yn) { scaling_ = yn; }
+
+    /**
+     * @return True if conditional likelihoods are scaled.
+     */
+    bool usesLikelihoodScaling() const { return scaling_; }
+
+    /**
+     * @brief Scale the conditional likelihoods of a site, if needed.
+     *
+     * @param likelihoods_i The [class][state] likelihoods of the site.
+     * @return The number of scaling operations performed.
+     */
+    static int rescaleSiteLikelihoods(VVdouble& likelihoods_i);
+
+    /**
+     * @brief Scale the conditional likelihoods of a site stored in a flat array, if needed.
+     *
+     * @param likelihoods_i A pointer toward the first value of the site.
+     * @param nbClasses The number of rate classes.
+     * @param nbStates The number of states.
+     * @param stateStride The number of doubles between two consecutive classes.
+     * @return The number of scaling operations performed.
+     */
+    static int rescaleSiteLikelihoods(double* likelihoods_i, size_t nbClasses, size_t nbStates, size_t stateStride);
+
+    /**
+     * @return The factor corresponding to a given number of scaling operations, that is 2^(SCALING_EXPONENT * count).
+     * @param count The number of scaling operations (may be negative).
+     */
+    static double getScalingFactor(int count) { return std::ldexp(1., SCALING_EXPONENT * count); }
+
+    /**
+     * @return The logarithm of getScalingFactor(count).
+     * @param count The number of scaling operations (may be negative).
+     */
+    static double getLogScalingFactor(int count);
+
+    /** @} */
+
     /**
      * @name Generic tools to deal with likelihood arrays
      *
@@ -130,6 +291,15 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
      */
     static void resetLikelihoodArray(VVVdouble & likelihoodArray);
 
+    /**
+     * @brief Set the conditional likelihoods of a range of sites to 1.
+     *
+     * @param likelihoodArray the likelihood array.
+     * @param siteBegin The first site to reset.
+     * @param siteEnd The site after the last one to reset.
+     */
+    static void resetLikelihoodArray(VVVdouble & likelihoodArray, size_t siteBegin, size_t siteEnd);
+
     /**
      * @brief Print the likelihood array to terminal (debugging tool).
      * 
@@ -138,6 +308,26 @@ class AbstractDiscreteRatesAcrossSitesTreeLikelihood:
     static void displayLikelihoodArray(const VVVdouble & likelihoodArray);
 
     /** @} */
+
+  protected:
+    /**
+     * @brief Call a function on consecutive blocks of sites, in parallel if several threads are used.
+     *
+     * If only one thread is used, the function is called once for the whole range.
+     *
+     * @param nbSites The total number of sites.
+     * @param f The function to call with the first site and the site after the last one of each block.
+     */
+    void forEachSiteBlock_(size_t nbSites, const std::function<void (size_t, size_t)>& f) const;
+
+    /**
+     * @brief Call a function on all nodes of the tree, in parallel over independent subtrees if several threads are used.
+     *
+     * @param postfix If true, each node is processed after all its sons, otherwise after its father.
+     * @param f The function to call for each node.
+     * @see ThreadPool::parallelForGraph
+     */
+    void forEachNode_(bool postfix, const std::function<void (const Node*)>& f) const;
     
 };
 
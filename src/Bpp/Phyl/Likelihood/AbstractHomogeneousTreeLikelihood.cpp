@@ -39,6 +39,7 @@
 
 #include "AbstractHomogeneousTreeLikelihood.h"
 #include "../PatternTools.h"
+#include "../Model/AbstractSubstitutionModel.h"
 
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/App/ApplicationTools.h>
@@ -189,6 +190,11 @@ void AbstractHomogeneousTreeLikelihood::setSubstitutionModel(SubstitutionModel*
 
   nbStates_ = model->getNumberOfStates();
 
+  // Let the model keep the matrices of all branches and rate classes between two updates:
+  AbstractSubstitutionModel* absModel = dynamic_cast<AbstractSubstitutionModel*>(model_);
+  if (absModel && absModel->getTransitionProbabilitiesCacheSize() < nbNodes_ * nbClasses_)
+    absModel->setTransitionProbabilitiesCacheSize(nbNodes_ * nbClasses_);
+
   // Allocate transition probabilities arrays:
   for (unsigned int l = 0; l < nbNodes_; l++)
   {
@@ -343,11 +349,37 @@ void AbstractHomogeneousTreeLikelihood::initBranchLengthsParameters(bool verbose
 
 void AbstractHomogeneousTreeLikelihood::computeAllTransitionProbabilities()
 {
-  for (unsigned int l = 0; l < nbNodes_; l++)
+  // All matrices are computed at once, one per node and rate class:
+  size_t nbMatrices = nbNodes_ * nbClasses_;
+  size_t matrixSize = nbStates_ * nbStates_;
+  vector<double> times(nbMatrices);
+  for (size_t l = 0; l < nbNodes_; l++)
+  {
+    double d = nodes_[l]->getDistanceToFather();
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      times[l * nbClasses_ + c] = d * rateDistribution_->getCategory(c);
+    }
+  }
+  vector<double> pijt(nbMatrices * matrixSize);
+  if (nbMatrices > 0)
+    model_->computePij_t(times, &pijt[0]);
+
+  for (size_t l = 0; l < nbNodes_; l++)
   {
     // For each node,
     Node* node = nodes_[l];
-    computeTransitionProbabilitiesForNode(node);
+    VVVdouble* pxy__node = &pxy_[node->getId()];
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      VVdouble* pxy__node_c = &(*pxy__node)[c];
+      const double* pijt_l_c = &pijt[(l * nbClasses_ + c) * matrixSize];
+      for (size_t x = 0; x < nbStates_; x++)
+      {
+        (*pxy__node_c)[x].assign(pijt_l_c + x * nbStates_, pijt_l_c + (x + 1) * nbStates_);
+      }
+    }
+    computeTransitionProbabilitiesDerivativesForNode_(node);
   }
   rootFreqs_ = model_->getFrequencies();
 }
@@ -375,6 +407,15 @@ void AbstractHomogeneousTreeLikelihood::computeTransitionProbabilitiesForNode(co
     }
   }
 
+  computeTransitionProbabilitiesDerivativesForNode_(node);
+}
+
+/*******************************************************************************/
+
+void AbstractHomogeneousTreeLikelihood::computeTransitionProbabilitiesDerivativesForNode_(const Node* node)
+{
+  double l = node->getDistanceToFather();
+
   if (computeFirstOrderDerivatives_)
   {
     // Computes all dpxy/dt once for all:
@@ -253,12 +253,19 @@ public:
 protected:
   /**
    * @brief Fill the pxy_, dpxy_ and d2pxy_ arrays for all nodes.
+   *
+   * Transition probabilities for all nodes and rate classes are computed
+   * with a single call to SubstitutionModel::computePij_t().
    */
   virtual void computeAllTransitionProbabilities();
   /**
    * @brief Fill the pxy_, dpxy_ and d2pxy_ arrays for one node.
    */
   virtual void computeTransitionProbabilitiesForNode(const Node* node);
+  /**
+   * @brief Fill the dpxy_ and d2pxy_ arrays for one node, if derivatives are computed.
+   */
+  void computeTransitionProbabilitiesDerivativesForNode_(const Node* node);
 };
 } // end of namespace bpp.
 
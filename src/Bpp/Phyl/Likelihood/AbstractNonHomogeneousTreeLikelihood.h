@@ -240,6 +240,18 @@ class AbstractNonHomogeneousTreeLikelihood:
     
   public: //Specific methods:
 
+    /**
+     * @brief Likelihood scaling is not supported by non-homogeneous models.
+     *
+     * @param yn Tell if conditional likelihoods should be scaled.
+     * @throw Exception If yn is true.
+     */
+    void setLikelihoodScaling(bool yn) throw (Exception)
+    {
+      if (yn)
+        throw Exception("AbstractNonHomogeneousTreeLikelihood::setLikelihoodScaling(). Likelihood scaling is not supported by non-homogeneous models.");
+    }
+
     /**
      * @brief This builds the <i>parameters</i> list from all parametrizable objects,
      * <i>i.e.</i> substitution model, rate distribution and tree.
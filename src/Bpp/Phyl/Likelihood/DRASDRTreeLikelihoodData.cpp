@@ -81,6 +81,7 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const SiteContainer& sites, const
   rootLikelihoods_.resize(nbDistinctSites_);
   rootLikelihoodsS_.resize(nbDistinctSites_);
   rootLikelihoodsSR_.resize(nbDistinctSites_);
+  rootScalingCounts_.assign(nbDistinctSites_, 0);
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
     VVdouble* rootLikelihoods_i_ = &rootLikelihoods_[i];
@@ -97,6 +98,9 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const SiteContainer& sites, const
       }
     }
   }
+
+  if (flat_)
+    initFlatArrays_();
 }
 
 /******************************************************************************/
@@ -154,6 +158,12 @@ void DRASDRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteConta
   int nbSons = static_cast<int>(node->getNumberOfSons());
 
   for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
+  {
+    nodeData->getScalingCounts()[(*node)[n]->getId()].assign(nbDistinctSites_, 0);
+  }
+
+  // With the flat layout, arrays are allocated all at once by initFlatArrays_:
+  for (int n = (node->hasFather() ? -1 : 0); n < nbSons && !flat_; n++)
   {
     const Node* neighbor = (*node)[n];
     VVVdouble* likelihoods_node_neighbor_ = &(*likelihoods_node_)[neighbor->getId()];
@@ -213,6 +223,13 @@ void DRASDRTreeLikelihoodData::reInit() throw (Exception)
 }
 
 void DRASDRTreeLikelihoodData::reInit(const Node* node) throw (Exception)
+{
+  reInit_(node);
+  if (flat_)
+    initFlatArrays_();
+}
+
+void DRASDRTreeLikelihoodData::reInit_(const Node* node) throw (Exception)
 {
   if (node->isLeaf())
   {
@@ -227,9 +244,14 @@ void DRASDRTreeLikelihoodData::reInit(const Node* node) throw (Exception)
   int nbSons = static_cast<int>(node->getNumberOfSons());
 
   for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
+  {
+    nodeData->getScalingCounts()[(*node)[n]->getId()].assign(nbDistinctSites_, 0);
+  }
+
+  for (int n = (node->hasFather() ? -1 : 0); n < nbSons && !flat_; n++)
   {
     const Node* neighbor = (*node)[n];
-    VVVdouble* array = &nodeData->getLikelihoodArrayForNeighbor(neighbor->getId());
+    VVVdouble* array = &nodeData->getLikelihoodArrays()[neighbor->getId()];
 
     array->resize(nbDistinctSites_);
     for (size_t i = 0; i < nbDistinctSites_; i++)
@@ -253,7 +275,7 @@ void DRASDRTreeLikelihoodData::reInit(const Node* node) throw (Exception)
   for (size_t l = 0; l < nbSonNodes; l++)
   {
     // For each son node,
-    reInit(node->getSon(l));
+    reInit_(node->getSon(l));
   }
 
   nodeData->getDLikelihoodArray().resize(nbDistinctSites_);
@@ -262,3 +284,136 @@ void DRASDRTreeLikelihoodData::reInit(const Node* node) throw (Exception)
 
 /******************************************************************************/
 
+void DRASDRTreeLikelihoodData::initFlatArrays_() throw (Exception)
+{
+  std::vector<const Node*> nodes = tree_->getNodes();
+  size_t nbNodes = nodes.size();
+  size_t nbIds = 0;
+  for (size_t k = 0; k < nbNodes; k++)
+  {
+    int id = nodes[k]->getId();
+    if (id < 0)
+      throw Exception("DRASDRTreeLikelihoodData::initFlatArrays_. Flat arrays require positive node ids, found " + TextTools::toString(id) + ".");
+    nbIds = std::max(nbIds, static_cast<size_t>(id) + 1);
+  }
+
+  // Compute the layout, each node neighbors being stored consecutively:
+  flatFatherIds_.assign(nbIds, -1);
+  flatSonArrays_.assign(nbIds, 0);
+  flatFatherArrays_.assign(nbIds, 0);
+  flatNeighbors_.assign(nbIds, std::vector<int>());
+  flatArrayCopies_.clear();
+  nbFlatArrays_ = 0;
+  for (size_t k = 0; k < nbNodes; k++)
+  {
+    const Node* node = nodes[k];
+    size_t id = static_cast<size_t>(node->getId());
+    if (node->hasFather())
+    {
+      flatFatherIds_[id] = node->getFather()->getId();
+      flatFatherArrays_[id] = nbFlatArrays_++;
+      flatNeighbors_[id].push_back(node->getFather()->getId());
+    }
+    for (size_t n = 0; n < node->getNumberOfSons(); n++)
+    {
+      const Node* son = node->getSon(n);
+      flatSonArrays_[static_cast<size_t>(son->getId())] = nbFlatArrays_++;
+      flatNeighbors_[id].push_back(son->getId());
+    }
+  }
+  flatStateStride_ = FlatLikelihoodArrayView::getStateStrideFor(nbStates_);
+  flatArraySize_   = FlatLikelihoodBuffer::getAlignedSize(nbDistinctSites_ * nbClasses_ * flatStateStride_);
+
+  // One more array for the root, and one working array:
+  flatLikelihoods_.resize((nbFlatArrays_ + 2) * flatArraySize_);
+
+  for (size_t k = 0; k < nbNodes; k++)
+  {
+    const Node* node = nodes[k];
+    int nbSons = static_cast<int>(node->getNumberOfSons());
+    for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
+    {
+      const Node* neighbor = (*node)[n];
+      FlatLikelihoodArrayView array = getFlatLikelihoodArray(node->getId(), neighbor->getId());
+      if (neighbor->isLeaf() && leafData_.find(neighbor->getId()) != leafData_.end())
+        array.copyFrom(leafData_[neighbor->getId()].getLikelihoodArray());
+      else
+        array.fill(1.); // All likelihoods are initialized to 1.
+    }
+  }
+  getFlatRootLikelihoodArray().fill(1.);
+  getFlatWorkingArray().fill(1.);
+}
+
+/******************************************************************************/
+
+void DRASDRTreeLikelihoodData::setFlatArrays(bool yn) throw (Exception)
+{
+  if (yn == flat_)
+    return;
+  if (!shrunkData_)
+  {
+    // Arrays not initialized yet:
+    flat_ = yn;
+    return;
+  }
+  if (yn)
+  {
+    flat_ = true;
+    initFlatArrays_();
+    for (std::map<int, DRASDRTreeLikelihoodNodeData>::iterator it = nodeData_.begin(); it != nodeData_.end(); it++)
+    {
+      std::map<int, VVVdouble>* arrays = &it->second.getLikelihoodArrays();
+      for (std::map<int, VVVdouble>::iterator itA = arrays->begin(); itA != arrays->end(); itA++)
+      {
+        getFlatLikelihoodArray(it->first, itA->first).copyFrom(itA->second);
+      }
+      arrays->clear();
+    }
+  }
+  else
+  {
+    for (size_t id = 0; id < flatNeighbors_.size(); id++)
+    {
+      const std::vector<int>* neighbors = &flatNeighbors_[id];
+      for (size_t k = 0; k < neighbors->size(); k++)
+      {
+        int nodeId = static_cast<int>(id);
+        getFlatLikelihoodArray(nodeId, (*neighbors)[k]).copyTo(nodeData_[nodeId].getLikelihoodArrays()[(*neighbors)[k]]);
+      }
+    }
+    flat_ = false;
+    flatLikelihoods_.clear();
+    flatFatherIds_.clear();
+    flatSonArrays_.clear();
+    flatFatherArrays_.clear();
+    flatNeighbors_.clear();
+    flatArrayCopies_.clear();
+    nbFlatArrays_ = 0;
+  }
+}
+
+/******************************************************************************/
+
+VVVdouble& DRASDRTreeLikelihoodData::getFlatArrayCopy_(int parentId, int neighborId) const throw (Exception)
+{
+  FlatLikelihoodArrayView array = getFlatLikelihoodArray(parentId, neighborId);
+  std::lock_guard<std::mutex> lock(flatArrayCopiesMutex_);
+  VVVdouble& copy = flatArrayCopies_[parentId][neighborId];
+  array.copyTo(copy);
+  return copy;
+}
+
+/******************************************************************************/
+
+std::map<int, VVVdouble>& DRASDRTreeLikelihoodData::getFlatArrayCopies_(int nodeId) const throw (Exception)
+{
+  const std::vector<int>& neighbors = flatNeighbors_.at(static_cast<size_t>(nodeId));
+  for (size_t k = 0; k < neighbors.size(); k++)
+    getFlatArrayCopy_(nodeId, neighbors[k]);
+  std::lock_guard<std::mutex> lock(flatArrayCopiesMutex_);
+  return flatArrayCopies_[nodeId];
+}
+
+/******************************************************************************/
+
@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #define _DRASDRHOMOGENEOUSTREELIKELIHOODDATA_H_
 
 #include "AbstractTreeLikelihoodData.h"
+#include "FlatLikelihoodArray.h"
 #include "../Model/SubstitutionModel.h"
 #include "../PatternTools.h"
 #include "../SitePatterns.h"
@@ -49,8 +50,12 @@ knowledge of the CeCILL license and that you accept its terms.
 //From SeqLib:
 #include <Bpp/Seq/Container/AlignedSequenceContainer.h>
 
+//From bpp-core:
+#include <Bpp/Text/TextTools.h>
+
 // From the STL:
 #include <map>
+#include <mutex>
 
 namespace bpp
 {
@@ -123,6 +128,19 @@ class DRASDRTreeLikelihoodNodeData :
      */
 
     mutable std::map<int, VVVdouble> nodeLikelihoods_;
+
+    /**
+     * @brief The number of scaling operations of each site of each likelihood array.
+     *
+     * <pre>
+     * x[b][i]
+     *   |---------> Neighbor node of n (id)
+     *      |------> Site i
+     * </pre>
+     * Counts are accumulated over the whole subtree defined by the array.
+     */
+    mutable std::map<int, std::vector<int> > nodeScalingCounts_;
+
     /**
      * @brief This contains all likelihood first order derivatives values used for computation.
      *
@@ -148,10 +166,11 @@ class DRASDRTreeLikelihoodNodeData :
     const Node* node_;
 
   public:
-    DRASDRTreeLikelihoodNodeData() : nodeLikelihoods_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), node_(0) {}
+    DRASDRTreeLikelihoodNodeData() : nodeLikelihoods_(), nodeScalingCounts_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), node_(0) {}
     
     DRASDRTreeLikelihoodNodeData(const DRASDRTreeLikelihoodNodeData& data) :
       nodeLikelihoods_(data.nodeLikelihoods_),
+      nodeScalingCounts_(data.nodeScalingCounts_),
       nodeDLikelihoods_(data.nodeDLikelihoods_),
       nodeD2Likelihoods_(data.nodeD2Likelihoods_),
       node_(data.node_)
@@ -160,6 +179,7 @@ class DRASDRTreeLikelihoodNodeData :
     DRASDRTreeLikelihoodNodeData& operator=(const DRASDRTreeLikelihoodNodeData& data)
     {
       nodeLikelihoods_   = data.nodeLikelihoods_;
+      nodeScalingCounts_ = data.nodeScalingCounts_;
       nodeDLikelihoods_  = data.nodeDLikelihoods_;
       nodeD2Likelihoods_ = data.nodeD2Likelihoods_;
       node_              = data.node_;
@@ -184,12 +204,26 @@ class DRASDRTreeLikelihoodNodeData :
     
     VVVdouble& getLikelihoodArrayForNeighbor(int neighborId)
     {
-      return nodeLikelihoods_[neighborId];
+      return nodeLikelihoods_.at(neighborId);
     }
     
     const VVVdouble& getLikelihoodArrayForNeighbor(int neighborId) const
     {
-      return nodeLikelihoods_[neighborId];
+      return nodeLikelihoods_.at(neighborId);
+    }
+
+    const std::map<int, std::vector<int> >& getScalingCounts() const { return nodeScalingCounts_; }
+
+    std::map<int, std::vector<int> >& getScalingCounts() { return nodeScalingCounts_; }
+
+    std::vector<int>& getScalingCountsForNeighbor(int neighborId)
+    {
+      return nodeScalingCounts_.at(neighborId);
+    }
+
+    const std::vector<int>& getScalingCountsForNeighbor(int neighborId) const
+    {
+      return nodeScalingCounts_.at(neighborId);
     }
     
     Vdouble& getDLikelihoodArray() { return nodeDLikelihoods_;  }
@@ -208,6 +242,7 @@ class DRASDRTreeLikelihoodNodeData :
     void eraseNeighborArrays()
     {
       nodeLikelihoods_.erase(nodeLikelihoods_.begin(), nodeLikelihoods_.end());
+      nodeScalingCounts_.erase(nodeScalingCounts_.begin(), nodeScalingCounts_.end());
       nodeDLikelihoods_.erase(nodeDLikelihoods_.begin(), nodeDLikelihoods_.end());
       nodeD2Likelihoods_.erase(nodeD2Likelihoods_.begin(), nodeD2Likelihoods_.end());
     }
@@ -215,6 +250,26 @@ class DRASDRTreeLikelihoodNodeData :
 
 /**
  * @brief Likelihood data structure for rate across sites models, using a double-recursive algorithm.
+ *
+ * Two storage layouts are available for the conditional likelihood arrays:
+ * - the default one, where each array is stored as a VVVdouble in the corresponding DRASDRTreeLikelihoodNodeData object,
+ * - a flat one, where all arrays are stored in a single contiguous and aligned buffer,
+ *   ordered as [node][neighbor][site][class][state], and accessed via FlatLikelihoodArrayView objects
+ *   (see setFlatArrays() and getFlatLikelihoodArray()).
+ *
+ * When the flat layout is used, the VVVdouble accessors (getLikelihoodArray(), getLikelihoodArrays())
+ * are kept for compatibility with existing code: they return copies of the flat arrays, which are
+ * refreshed at each call. Changes made to these copies are not seen by the likelihood computations.
+ * Computation loops should rather use getLikelihoodArrayRef() or getFlatLikelihoodArray(), which do not copy.
+ *
+ * With both layouts, the number of scaling operations of each site is stored for each array
+ * (see getScalingCounts()). Counts are all 0 unless likelihood scaling is enabled in the
+ * likelihood object, in which case all arrays, including the root ones, are scaled:
+ * the true value at site i of an array is its stored value times 2^(-AbstractDiscreteRatesAcrossSitesTreeLikelihood::SCALING_EXPONENT * count).
+ *
+ * Accessors only look up existing entries and never insert into the underlying maps,
+ * so that they can be called concurrently by workers processing distinct blocks of sites.
+ * Requesting the array of a node which is not in the tree throws a std::out_of_range exception.
  */
 class DRASDRTreeLikelihoodData :
   public virtual AbstractTreeLikelihoodData
@@ -226,6 +281,7 @@ class DRASDRTreeLikelihoodData :
     mutable VVVdouble rootLikelihoods_;
     mutable VVdouble  rootLikelihoodsS_;
     mutable Vdouble   rootLikelihoodsSR_;
+    mutable std::vector<int> rootScalingCounts_;
 
     SiteContainer* shrunkData_;
     size_t nbSites_; 
@@ -233,11 +289,46 @@ class DRASDRTreeLikelihoodData :
     size_t nbClasses_;
     size_t nbDistinctSites_; 
 
+    /**
+     * @name Flat storage of conditional likelihoods.
+     *
+     * @{
+     */
+    bool flat_;
+    mutable FlatLikelihoodBuffer flatLikelihoods_;
+    /**
+     * @brief Id of the father of each node (-1 for the root or missing ids), indexed by node id.
+     */
+    std::vector<int> flatFatherIds_;
+    /**
+     * @brief Index in the flat buffer of the array of the father of each node for this node, indexed by node id.
+     */
+    std::vector<size_t> flatSonArrays_;
+    /**
+     * @brief Index in the flat buffer of the array of each node for its father, indexed by node id.
+     */
+    std::vector<size_t> flatFatherArrays_;
+    /**
+     * @brief Neighbors ids of each node, in the order of their arrays in the flat buffer, indexed by node id.
+     */
+    std::vector< std::vector<int> > flatNeighbors_;
+    size_t nbFlatArrays_;
+    size_t flatStateStride_;
+    size_t flatArraySize_;
+    /**
+     * @brief Copies of flat arrays returned by the VVVdouble accessors, indexed by node id and neighbor id.
+     */
+    mutable std::map<int, std::map<int, VVVdouble> > flatArrayCopies_;
+    mutable std::mutex flatArrayCopiesMutex_;
+    /** @} */
+
   public:
-    DRASDRTreeLikelihoodData(const TreeTemplate<Node>* tree, size_t nbClasses) :
+    DRASDRTreeLikelihoodData(const TreeTemplate<Node>* tree, size_t nbClasses, bool flat = false) :
       AbstractTreeLikelihoodData(tree),
       nodeData_(), leafData_(), rootLikelihoods_(), rootLikelihoodsS_(), rootLikelihoodsSR_(),
-      shrunkData_(0), nbSites_(0), nbStates_(0), nbClasses_(nbClasses), nbDistinctSites_(0)
+      rootScalingCounts_(), shrunkData_(0), nbSites_(0), nbStates_(0), nbClasses_(nbClasses), nbDistinctSites_(0),
+      flat_(flat), flatLikelihoods_(), flatFatherIds_(), flatSonArrays_(), flatFatherArrays_(), flatNeighbors_(),
+      nbFlatArrays_(0), flatStateStride_(0), flatArraySize_(0), flatArrayCopies_(), flatArrayCopiesMutex_()
     {}
 
     DRASDRTreeLikelihoodData(const DRASDRTreeLikelihoodData& data):
@@ -246,9 +337,15 @@ class DRASDRTreeLikelihoodData :
       rootLikelihoods_(data.rootLikelihoods_),
       rootLikelihoodsS_(data.rootLikelihoodsS_),
       rootLikelihoodsSR_(data.rootLikelihoodsSR_),
+      rootScalingCounts_(data.rootScalingCounts_),
       shrunkData_(0),
       nbSites_(data.nbSites_), nbStates_(data.nbStates_),
-      nbClasses_(data.nbClasses_), nbDistinctSites_(data.nbDistinctSites_)
+      nbClasses_(data.nbClasses_), nbDistinctSites_(data.nbDistinctSites_),
+      flat_(data.flat_), flatLikelihoods_(data.flatLikelihoods_),
+      flatFatherIds_(data.flatFatherIds_), flatSonArrays_(data.flatSonArrays_),
+      flatFatherArrays_(data.flatFatherArrays_), flatNeighbors_(data.flatNeighbors_),
+      nbFlatArrays_(data.nbFlatArrays_), flatStateStride_(data.flatStateStride_),
+      flatArraySize_(data.flatArraySize_), flatArrayCopies_(), flatArrayCopiesMutex_()
     {
       if (data.shrunkData_)
         shrunkData_ = dynamic_cast<SiteContainer*>(data.shrunkData_->clone());
@@ -262,10 +359,21 @@ class DRASDRTreeLikelihoodData :
       rootLikelihoods_   = data.rootLikelihoods_;
       rootLikelihoodsS_  = data.rootLikelihoodsS_;
       rootLikelihoodsSR_ = data.rootLikelihoodsSR_;
+      rootScalingCounts_ = data.rootScalingCounts_;
       nbSites_           = data.nbSites_;
       nbStates_          = data.nbStates_;
       nbClasses_         = data.nbClasses_;
       nbDistinctSites_   = data.nbDistinctSites_;
+      flat_              = data.flat_;
+      flatLikelihoods_   = data.flatLikelihoods_;
+      flatFatherIds_     = data.flatFatherIds_;
+      flatSonArrays_     = data.flatSonArrays_;
+      flatFatherArrays_  = data.flatFatherArrays_;
+      flatNeighbors_     = data.flatNeighbors_;
+      nbFlatArrays_      = data.nbFlatArrays_;
+      flatStateStride_   = data.flatStateStride_;
+      flatArraySize_     = data.flatArraySize_;
+      flatArrayCopies_.clear();
       if (shrunkData_) delete shrunkData_;
       if (data.shrunkData_)
         shrunkData_      = dynamic_cast<SiteContainer *>(data.shrunkData_->clone());
@@ -305,22 +413,22 @@ class DRASDRTreeLikelihoodData :
 
     DRASDRTreeLikelihoodNodeData& getNodeData(int nodeId)
     { 
-      return nodeData_[nodeId];
+      return nodeData_.at(nodeId);
     }
     
     const DRASDRTreeLikelihoodNodeData& getNodeData(int nodeId) const
     { 
-      return nodeData_[nodeId];
+      return nodeData_.at(nodeId);
     }
     
     DRASDRTreeLikelihoodLeafData& getLeafData(int nodeId)
     { 
-      return leafData_[nodeId];
+      return leafData_.at(nodeId);
     }
     
     const DRASDRTreeLikelihoodLeafData& getLeafData(int nodeId) const
     { 
-      return leafData_[nodeId];
+      return leafData_.at(nodeId);
     }
     
     size_t getArrayPosition(int parentId, int sonId, size_t currentPosition) const
@@ -328,54 +436,171 @@ class DRASDRTreeLikelihoodData :
       return currentPosition;
     }
 
-    const std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId) const 
+    /**
+     * @name Likelihood arrays in the VVVdouble layout.
+     *
+     * With the flat layout, copies of the flat arrays are returned (see the class description).
+     * They are refreshed at each call, and their content must not be read while the same arrays
+     * are requested from another thread.
+     * @{
+     */
+    const std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId) const throw (Exception)
     {
-      return nodeData_[nodeId].getLikelihoodArrays();
+      if (flat_)
+        return getFlatArrayCopies_(nodeId);
+      return nodeData_.at(nodeId).getLikelihoodArrays();
     }
     
-    std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId)
+    std::map<int, VVVdouble>& getLikelihoodArrays(int nodeId) throw (Exception)
     {
-      return nodeData_[nodeId].getLikelihoodArrays();
+      if (flat_)
+        return getFlatArrayCopies_(nodeId);
+      return nodeData_.at(nodeId).getLikelihoodArrays();
     }
 
-    VVVdouble& getLikelihoodArray(int parentId, int neighborId)
+    VVVdouble& getLikelihoodArray(int parentId, int neighborId) throw (Exception)
     {
-      return nodeData_[parentId].getLikelihoodArrayForNeighbor(neighborId);
+      if (flat_)
+        return getFlatArrayCopy_(parentId, neighborId);
+      return nodeData_.at(parentId).getLikelihoodArrayForNeighbor(neighborId);
     }
     
-    const VVVdouble& getLikelihoodArray(int parentId, int neighborId) const
+    const VVVdouble& getLikelihoodArray(int parentId, int neighborId) const throw (Exception)
     {
-      return nodeData_[parentId].getLikelihoodArrayForNeighbor(neighborId);
+      if (flat_)
+        return getFlatArrayCopy_(parentId, neighborId);
+      return nodeData_.at(parentId).getLikelihoodArrayForNeighbor(neighborId);
+    }
+    /** @} */
+
+    /**
+     * @brief Get read-only access to the conditional likelihood array of a node for a given neighbor, with any layout.
+     *
+     * No copy is performed.
+     *
+     * @param parentId The id of the node.
+     * @param neighborId The id of the neighbor node.
+     * @throw Exception if 'neighborId' is not a neighbor of 'parentId'.
+     */
+    ConstLikelihoodArrayRef getLikelihoodArrayRef(int parentId, int neighborId) const throw (Exception)
+    {
+      if (flat_)
+        return ConstLikelihoodArrayRef(getFlatLikelihoodArray(parentId, neighborId));
+      else
+        return ConstLikelihoodArrayRef(nodeData_.at(parentId).getLikelihoodArrayForNeighbor(neighborId));
+    }
+
+    /**
+     * @brief Copy the conditional likelihood array of a node for a given neighbor, with any layout.
+     *
+     * The copy is a read-only snapshot: modifying it does not change the likelihoods stored in this object.
+     * As the whole array is copied at each call, this is meant for occasional access to the arrays
+     * (display, post-processing), not for computation loops.
+     *
+     * @param parentId The id of the node.
+     * @param neighborId The id of the neighbor node.
+     * @param array The output array, resized if needed.
+     * @throw Exception if 'neighborId' is not a neighbor of 'parentId'.
+     */
+    void getLikelihoodArraySnapshot(int parentId, int neighborId, VVVdouble& array) const throw (Exception)
+    {
+      if (flat_)
+        getFlatLikelihoodArray(parentId, neighborId).copyTo(array);
+      else
+        array = nodeData_.at(parentId).getLikelihoodArrayForNeighbor(neighborId);
+    }
+
+    /**
+     * @return True if conditional likelihoods are stored in a single flat buffer.
+     */
+    bool usesFlatArrays() const { return flat_; }
+
+    /**
+     * @brief Choose the storage layout of conditional likelihoods.
+     *
+     * If likelihood arrays were already initialized, their current values are transfered to the new layout.
+     *
+     * @param yn Tell if the flat layout should be used.
+     * @throw Exception if the tree contains negative node ids.
+     */
+    void setFlatArrays(bool yn) throw (Exception);
+
+    /**
+     * @brief Get a view on the conditional likelihood array of a node, for a given neighbor.
+     *
+     * Only available when the flat layout is used.
+     * Views remain valid until the next call to initLikelihoods() or reInit().
+     * The array is found in constant time, as a neighbor is either the father or a son of the node.
+     *
+     * @param parentId The id of the node.
+     * @param neighborId The id of the neighbor node.
+     * @throw Exception if 'neighborId' is not a neighbor of 'parentId'.
+     */
+    FlatLikelihoodArrayView getFlatLikelihoodArray(int parentId, int neighborId) const throw (Exception)
+    {
+      size_t nbIds = flatFatherIds_.size();
+      if (parentId >= 0 && neighborId >= 0 && static_cast<size_t>(parentId) < nbIds && static_cast<size_t>(neighborId) < nbIds)
+      {
+        if (flatFatherIds_[static_cast<size_t>(neighborId)] == parentId)
+          return getFlatArray_(flatSonArrays_[static_cast<size_t>(neighborId)]);
+        if (flatFatherIds_[static_cast<size_t>(parentId)] == neighborId)
+          return getFlatArray_(flatFatherArrays_[static_cast<size_t>(parentId)]);
+      }
+      throw Exception("DRASDRTreeLikelihoodData::getFlatLikelihoodArray. No array for node " + TextTools::toString(parentId) + " and neighbor " + TextTools::toString(neighborId) + ".");
+    }
+
+    /**
+     * @return A view on the flat array used to store the likelihoods at the root node.
+     */
+    FlatLikelihoodArrayView getFlatRootLikelihoodArray() const { return getFlatArray_(nbFlatArrays_); }
+
+    /**
+     * @return A view on a flat working array, with the same dimensions as the likelihood arrays.
+     * Its content may be overwritten by any non-const likelihood computation, so const methods,
+     * which may be called concurrently, must use their own storage (see getFlatScratchArray()).
+     */
+    FlatLikelihoodArrayView getFlatWorkingArray() { return getFlatArray_(nbFlatArrays_ + 1); }
+
+    /**
+     * @brief Get a view with the dimensions of the likelihood arrays, on a buffer owned by the caller.
+     *
+     * @param buffer The buffer to use, resized if needed.
+     * @return A view on the buffer. Values are not initialized.
+     */
+    FlatLikelihoodArrayView getFlatScratchArray(FlatLikelihoodBuffer& buffer) const
+    {
+      buffer.resize(flatArraySize_);
+      return FlatLikelihoodArrayView(buffer.getData(), nbDistinctSites_, nbClasses_, nbStates_, flatStateStride_);
     }
     
     Vdouble& getDLikelihoodArray(int nodeId)
     {
-      return nodeData_[nodeId].getDLikelihoodArray();
+      return nodeData_.at(nodeId).getDLikelihoodArray();
     }
     
     const Vdouble& getDLikelihoodArray(int nodeId) const
     {
-      return nodeData_[nodeId].getDLikelihoodArray();
+      return nodeData_.at(nodeId).getDLikelihoodArray();
     }
     
     Vdouble& getD2LikelihoodArray(int nodeId)
     {
-      return nodeData_[nodeId].getD2LikelihoodArray();
+      return nodeData_.at(nodeId).getD2LikelihoodArray();
     }
 
     const Vdouble& getD2LikelihoodArray(int nodeId) const
     {
-      return nodeData_[nodeId].getD2LikelihoodArray();
+      return nodeData_.at(nodeId).getD2LikelihoodArray();
     }
 
     VVdouble& getLeafLikelihoods(int nodeId)
     {
-      return leafData_[nodeId].getLikelihoodArray();
+      return leafData_.at(nodeId).getLikelihoodArray();
     }
     
     const VVdouble& getLeafLikelihoods(int nodeId) const
     {
-      return leafData_[nodeId].getLikelihoodArray();
+      return leafData_.at(nodeId).getLikelihoodArray();
     }
     
     VVVdouble& getRootLikelihoodArray() { return rootLikelihoods_; }
@@ -387,6 +612,45 @@ class DRASDRTreeLikelihoodData :
     Vdouble& getRootRateSiteLikelihoodArray() { return rootLikelihoodsSR_; }
     const Vdouble& getRootRateSiteLikelihoodArray() const { return rootLikelihoodsSR_; }
 
+    /**
+     * @return The number of scaling operations of each site of a likelihood array.
+     * @param parentId The id of the node.
+     * @param neighborId The id of the neighbor node defining the array.
+     */
+    std::vector<int>& getScalingCounts(int parentId, int neighborId)
+    {
+      return nodeData_.at(parentId).getScalingCountsForNeighbor(neighborId);
+    }
+
+    const std::vector<int>& getScalingCounts(int parentId, int neighborId) const
+    {
+      return nodeData_.at(parentId).getScalingCountsForNeighbor(neighborId);
+    }
+
+    /**
+     * @return The number of scaling operations of each site of the root likelihood arrays.
+     */
+    std::vector<int>& getRootScalingCounts() { return rootScalingCounts_; }
+    const std::vector<int>& getRootScalingCounts() const { return rootScalingCounts_; }
+
+    /**
+     * @return The total number of scaling operations of the arrays of all neighbors of a node, for a given site.
+     *
+     * This is the scaling of the product of these arrays, as computed for instance by
+     * DRTreeLikelihood::computeLikelihoodAtNode().
+     *
+     * @param nodeId The id of the node.
+     * @param site The index of the site in the arrays.
+     */
+    int getScalingCountAtNode(int nodeId, size_t site) const
+    {
+      const std::map<int, std::vector<int> >* counts = &nodeData_.at(nodeId).getScalingCounts();
+      int count = 0;
+      for (std::map<int, std::vector<int> >::const_iterator it = counts->begin(); it != counts->end(); it++)
+        count += it->second[site];
+      return count;
+    }
+
     size_t getNumberOfDistinctSites() const { return nbDistinctSites_; }
     
     size_t getNumberOfSites() const { return nbSites_; }
@@ -418,6 +682,8 @@ class DRASDRTreeLikelihoodData :
     void reInit(const Node* node) throw (Exception);
 
   protected:
+    void reInit_(const Node* node) throw (Exception);
+
     /**
      * @brief This method initializes the leaves according to a sequence container.
      *
@@ -435,6 +701,30 @@ class DRASDRTreeLikelihoodData :
      * @param model The model, used for initializing leaves' likelihoods.
      */
     void initLikelihoods(const Node* node, const SiteContainer& sites, const SubstitutionModel& model) throw (Exception);
+
+    /**
+     * @brief Compute the layout of the flat buffer according to the current topology, and initialize all arrays.
+     *
+     * Arrays corresponding to leaves are set to the leaf likelihoods, others are set to 1.
+     *
+     * @throw Exception if the tree contains negative node ids.
+     */
+    void initFlatArrays_() throw (Exception);
+
+    FlatLikelihoodArrayView getFlatArray_(size_t index) const
+    {
+      return FlatLikelihoodArrayView(flatLikelihoods_.getData() + index * flatArraySize_, nbDistinctSites_, nbClasses_, nbStates_, flatStateStride_);
+    }
+
+    /**
+     * @brief Refresh and return the copy of a flat array.
+     */
+    VVVdouble& getFlatArrayCopy_(int parentId, int neighborId) const throw (Exception);
+
+    /**
+     * @brief Refresh and return the copies of the flat arrays of all neighbors of a node.
+     */
+    std::map<int, VVVdouble>& getFlatArrayCopies_(int nodeId) const throw (Exception);
     
 };
 
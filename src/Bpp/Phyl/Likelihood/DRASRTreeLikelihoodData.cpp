@@ -104,6 +104,7 @@ void DRASRTreeLikelihoodData::initLikelihoods(const Node* node, const SiteContai
   _likelihoods_node->resize(nbDistinctSites_);
   _dLikelihoods_node->resize(nbDistinctSites_);
   _d2Likelihoods_node->resize(nbDistinctSites_);
+  nodeData->getScalingCounts().assign(nbDistinctSites_, 0);
 
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
@@ -207,6 +208,7 @@ SitePatterns* DRASRTreeLikelihoodData::initLikelihoodsWithPatterns(const Node* n
   _likelihoods_node->resize(nbSites);
   _dLikelihoods_node->resize(nbSites);
   _d2Likelihoods_node->resize(nbSites);
+  nodeData->getScalingCounts().assign(nbSites, 0);
 
   for (size_t i = 0; i < nbSites; i++)
   {
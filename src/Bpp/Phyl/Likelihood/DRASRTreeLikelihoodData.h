@@ -68,6 +68,9 @@ namespace bpp
  * We call this the <i>likelihood array</i> for each node.
  * In the same way, we store first and second order derivatives.
  *
+ * When likelihood scaling is enabled, the number of scaling operations applied to each site of the
+ * likelihood array, accumulated over the whole subtree, is also stored.
+ *
  * @see DRASRTreeLikelihoodData
  */
 class DRASRTreeLikelihoodNodeData :
@@ -77,15 +80,17 @@ class DRASRTreeLikelihoodNodeData :
     mutable VVVdouble nodeLikelihoods_;
     mutable VVVdouble nodeDLikelihoods_;
     mutable VVVdouble nodeD2Likelihoods_;
+    mutable std::vector<int> nodeScalingCounts_;
     const Node* node_;
 
   public:
-    DRASRTreeLikelihoodNodeData() : nodeLikelihoods_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), node_(0) {}
+    DRASRTreeLikelihoodNodeData() : nodeLikelihoods_(), nodeDLikelihoods_(), nodeD2Likelihoods_(), nodeScalingCounts_(), node_(0) {}
     
     DRASRTreeLikelihoodNodeData(const DRASRTreeLikelihoodNodeData& data) :
       nodeLikelihoods_(data.nodeLikelihoods_),
       nodeDLikelihoods_(data.nodeDLikelihoods_),
       nodeD2Likelihoods_(data.nodeD2Likelihoods_),
+      nodeScalingCounts_(data.nodeScalingCounts_),
       node_(data.node_)
     {}
     
@@ -94,6 +99,7 @@ class DRASRTreeLikelihoodNodeData :
       nodeLikelihoods_   = data.nodeLikelihoods_;
       nodeDLikelihoods_  = data.nodeDLikelihoods_;
       nodeD2Likelihoods_ = data.nodeD2Likelihoods_;
+      nodeScalingCounts_ = data.nodeScalingCounts_;
       node_              = data.node_;
       return *this;
     }
@@ -115,6 +121,9 @@ class DRASRTreeLikelihoodNodeData :
 
     VVVdouble& getD2LikelihoodArray() { return nodeD2Likelihoods_; }
     const VVVdouble& getD2LikelihoodArray() const { return nodeD2Likelihoods_; }
+
+    std::vector<int>& getScalingCounts() { return nodeScalingCounts_; }
+    const std::vector<int>& getScalingCounts() const { return nodeScalingCounts_; }
 };
 
 /**
@@ -214,15 +223,15 @@ class DRASRTreeLikelihoodData :
  
     DRASRTreeLikelihoodNodeData& getNodeData(int nodeId)
     { 
-      return nodeData_[nodeId];
+      return nodeData_.at(nodeId);
     }
     const DRASRTreeLikelihoodNodeData& getNodeData(int nodeId) const
     { 
-      return nodeData_[nodeId];
+      return nodeData_.at(nodeId);
     }
     size_t getArrayPosition(int parentId, int sonId, size_t currentPosition) const
     {
-      return patternLinks_[parentId][sonId][currentPosition];
+      return patternLinks_.at(parentId).at(sonId)[currentPosition];
     }
     size_t getRootArrayPosition(size_t currentPosition) const
     {
@@ -230,30 +239,44 @@ class DRASRTreeLikelihoodData :
     }
     const std::vector<size_t>& getArrayPositions(int parentId, int sonId) const
     {
-      return patternLinks_[parentId][sonId];
+      return patternLinks_.at(parentId).at(sonId);
     }
     std::vector<size_t>& getArrayPositions(int parentId, int sonId)
     {
-      return patternLinks_[parentId][sonId];
+      return patternLinks_.at(parentId).at(sonId);
     }
     size_t getArrayPosition(int parentId, int sonId, size_t currentPosition)
     {
-      return patternLinks_[parentId][sonId][currentPosition];
+      return patternLinks_.at(parentId).at(sonId)[currentPosition];
     }
 
     VVVdouble& getLikelihoodArray(int nodeId)
     {
-      return nodeData_[nodeId].getLikelihoodArray();
+      return nodeData_.at(nodeId).getLikelihoodArray();
     }
     
     VVVdouble& getDLikelihoodArray(int nodeId)
     {
-      return nodeData_[nodeId].getDLikelihoodArray();
+      return nodeData_.at(nodeId).getDLikelihoodArray();
     }
     
     VVVdouble& getD2LikelihoodArray(int nodeId)
     {
-      return nodeData_[nodeId].getD2LikelihoodArray();
+      return nodeData_.at(nodeId).getD2LikelihoodArray();
+    }
+
+    /**
+     * @return The number of scaling operations of each site of the likelihood array of a node, accumulated over its subtree.
+     * @param nodeId The id of the node.
+     */
+    std::vector<int>& getScalingCounts(int nodeId)
+    {
+      return nodeData_.at(nodeId).getScalingCounts();
+    }
+
+    const std::vector<int>& getScalingCounts(int nodeId) const
+    {
+      return nodeData_.at(nodeId).getScalingCounts();
     }
 
     size_t getNumberOfDistinctSites() const { return nbDistinctSites_; }
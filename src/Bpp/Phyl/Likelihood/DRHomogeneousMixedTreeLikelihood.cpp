@@ -192,6 +192,42 @@ void DRHomogeneousMixedTreeLikelihood::fireParameterChanged(const ParameterList&
   minusLogLik_ = -getLogLikelihood();
 }
 
+void DRHomogeneousMixedTreeLikelihood::setFlatLikelihoodArrays(bool yn) throw (Exception)
+{
+  DRHomogeneousTreeLikelihood::setFlatLikelihoodArrays(yn);
+  for (unsigned int i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setFlatLikelihoodArrays(yn);
+  }
+}
+
+void DRHomogeneousMixedTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  DRHomogeneousTreeLikelihood::setNumberOfThreads(nbThreads);
+  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setNumberOfThreads(nbThreads);
+  }
+}
+
+void DRHomogeneousMixedTreeLikelihood::setSiteBlockSize(size_t siteBlockSize)
+{
+  DRHomogeneousTreeLikelihood::setSiteBlockSize(siteBlockSize);
+  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setSiteBlockSize(siteBlockSize);
+  }
+}
+
+void DRHomogeneousMixedTreeLikelihood::setParallelMode(short mode) throw (Exception)
+{
+  DRHomogeneousTreeLikelihood::setParallelMode(mode);
+  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setParallelMode(mode);
+  }
+}
+
 void DRHomogeneousMixedTreeLikelihood::resetLikelihoodArrays(const Node* node)
 {
   for (unsigned int i = 0; i < treeLikelihoodsContainer_.size(); i++)
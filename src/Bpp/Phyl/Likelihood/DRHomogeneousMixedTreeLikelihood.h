@@ -159,6 +159,18 @@ public:
   double getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const;
   /** @} */
 
+  /**
+   * @brief Likelihood scaling is not supported by mixed models.
+   *
+   * @param yn Tell if conditional likelihoods should be scaled.
+   * @throw Exception If yn is true.
+   */
+  void setLikelihoodScaling(bool yn) throw (Exception)
+  {
+    if (yn)
+      throw Exception("DRHomogeneousMixedTreeLikelihood::setLikelihoodScaling(). Likelihood scaling is not supported by mixed models.");
+  }
+
   /**
    * @name DerivableFirstOrder interface.
    *
@@ -186,6 +198,38 @@ public:
 
   virtual void computeTreeDLikelihoods();
 
+  /**
+   * @brief Choose the storage layout of conditional likelihoods, for all models of the mixture.
+   *
+   * @param yn Tell if the flat layout should be used.
+   * @see DRHomogeneousTreeLikelihood::setFlatLikelihoodArrays
+   */
+  void setFlatLikelihoodArrays(bool yn) throw (Exception);
+
+  /**
+   * @brief Set the number of threads to use, for all models of the mixture.
+   *
+   * @param nbThreads The total number of threads.
+   * @see AbstractDiscreteRatesAcrossSitesTreeLikelihood::setNumberOfThreads
+   */
+  void setNumberOfThreads(size_t nbThreads);
+
+  /**
+   * @brief Set the number of sites in each block of a parallel computation, for all models of the mixture.
+   *
+   * @param siteBlockSize The number of sites per block.
+   * @see AbstractDiscreteRatesAcrossSitesTreeLikelihood::setSiteBlockSize
+   */
+  void setSiteBlockSize(size_t siteBlockSize);
+
+  /**
+   * @brief Set how computations are split between threads, for all models of the mixture.
+   *
+   * @param mode The parallel mode.
+   * @see AbstractDiscreteRatesAcrossSitesTreeLikelihood::setParallelMode
+   */
+  void setParallelMode(short mode) throw (Exception);
+
 protected:
   virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode = 0) const;
 
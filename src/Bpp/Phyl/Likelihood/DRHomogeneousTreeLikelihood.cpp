@@ -38,6 +38,8 @@
  */
 
 #include "DRHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
+#include "StateLikelihoodKernels.h"
 #include "../PatternTools.h"
 
 // From SeqLib:
@@ -159,10 +161,11 @@ double DRHomogeneousTreeLikelihood::getLikelihood() const
 {
   double l = 1.;
   Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const vector<int>* counts = &likelihoodData_->getRootScalingCounts();
   const vector<unsigned int>* w = &likelihoodData_->getWeights();
   for (size_t i = 0; i < nbDistinctSites_; i++)
   {
-    l *= std::pow((*lik)[i], (int)(*w)[i]);
+    l *= std::pow((*lik)[i] * getScalingFactor(-(*counts)[i]), (int)(*w)[i]);
   }
   return l;
 }
@@ -173,12 +176,16 @@ double DRHomogeneousTreeLikelihood::getLogLikelihood() const
 {
   double ll = 0;
   Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  const vector<int>* counts = &likelihoodData_->getRootScalingCounts();
   const vector<unsigned int>* w = &likelihoodData_->getWeights();
   vector<double> la(nbDistinctSites_);
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    la[i] = (*w)[i] * log((*lik)[i]);
-  }
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      for (size_t i = siteBegin; i < siteEnd; i++)
+      {
+        la[i] = (*w)[i] * (log((*lik)[i]) - getLogScalingFactor((*counts)[i]));
+      }
+    });
+  // The sum is always computed sequentially, in the same order:
   sort(la.begin(), la.end());
   for (size_t i = nbDistinctSites_; i > 0; i--)
   {
@@ -191,41 +198,47 @@ double DRHomogeneousTreeLikelihood::getLogLikelihood() const
 
 double DRHomogeneousTreeLikelihood::getLikelihoodForASite(size_t site) const
 {
-  return likelihoodData_->getRootRateSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)];
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return likelihoodData_->getRootRateSiteLikelihoodArray()[i] * getScalingFactor(-likelihoodData_->getRootScalingCounts()[i]);
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLogLikelihoodForASite(size_t site) const
 {
-  return log(likelihoodData_->getRootRateSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)]);
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return log(likelihoodData_->getRootRateSiteLikelihoodArray()[i]) - getLogScalingFactor(likelihoodData_->getRootScalingCounts()[i]);
 }
 
 /******************************************************************************/
 double DRHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
-  return likelihoodData_->getRootSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass];
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return likelihoodData_->getRootSiteLikelihoodArray()[i][rateClass] * getScalingFactor(-likelihoodData_->getRootScalingCounts()[i]);
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
 {
-  return log(likelihoodData_->getRootSiteLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass]);
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return log(likelihoodData_->getRootSiteLikelihoodArray()[i][rateClass]) - getLogScalingFactor(likelihoodData_->getRootScalingCounts()[i]);
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return likelihoodData_->getRootLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return likelihoodData_->getRootLikelihoodArray()[i][rateClass][static_cast<size_t>(state)] * getScalingFactor(-likelihoodData_->getRootScalingCounts()[i]);
 }
 
 /******************************************************************************/
 
 double DRHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return log(likelihoodData_->getRootLikelihoodArray()[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]);
+  size_t i = likelihoodData_->getRootArrayPosition(site);
+  return log(likelihoodData_->getRootLikelihoodArray()[i][rateClass][static_cast<size_t>(state)]) - getLogScalingFactor(likelihoodData_->getRootScalingCounts()[i]);
 }
 
 /******************************************************************************/
@@ -290,53 +303,35 @@ throw (Exception)
 ******************************************************************************/
 void DRHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* node)
 {
-  const Node* father = node->getFather();
-  VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  const VVVdouble* dpxy_node = &dpxy_.at(node->getId());
   Vdouble* dLikelihoods_node = &likelihoodData_->getDLikelihoodArray(node->getId());
-  VVVdouble* dpxy_node = &dpxy_[node->getId()];
-  VVVdouble larray;
-  computeLikelihoodAtNode_(father, larray, node);
-  Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
-
-  double dLi, dLic, dLicx;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    dLi = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble* dpxy_node_c = &(*dpxy_node)[c];
-      dLic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        Vdouble* dpxy_node_c_x = &(*dpxy_node_c)[x];
-        dLicx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
-        {
-          dLicx += (*dpxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
-        }
-        dLicx *= (*larray_i_c)[x];
-        dLic += dLicx;
-      }
-      dLi += rateDistribution_->getProbability(c) * dLic;
-    }
-    (*dLikelihoods_node)[i] = dLi / (*rootLikelihoodsSR)[i];
-    // cout << dLi << "\t" << (*rootLikelihoodsSR)[i] << endl;
-  }
+  VVVdouble larray(nbDistinctSites_);
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      computeTreeDerivativeAtNodeForSites_(node, *dpxy_node, *dLikelihoods_node, larray, siteBegin, siteEnd);
+    });
 }
 
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeTreeDLikelihoods()
 {
+  // Arrays are retrieved before the parallel loop, so that workers do not access the maps:
+  vector<const VVVdouble*> dpxy(nbNodes_);
+  vector<Vdouble*> dLikelihoods(nbNodes_);
   for (size_t k = 0; k < nbNodes_; k++)
   {
-    computeTreeDLikelihoodAtNode(nodes_[k]);
+    int id = nodes_[k]->getId();
+    dpxy[k] = &dpxy_.at(id);
+    dLikelihoods[k] = &likelihoodData_->getDLikelihoodArray(id);
   }
+  // All branches are processed for a block of sites before moving to the next one:
+  VVVdouble larray(nbDistinctSites_);
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      for (size_t k = 0; k < nbNodes_; k++)
+      {
+        computeTreeDerivativeAtNodeForSites_(nodes_[k], *dpxy[k], *dLikelihoods[k], larray, siteBegin, siteEnd);
+      }
+    });
 }
 
 /******************************************************************************/
@@ -372,57 +367,39 @@ throw (Exception)
   return -d;
 }
 
+
 /******************************************************************************
 *                           Second Order Derivatives                         *
 ******************************************************************************/
 void DRHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* node)
 {
-  const Node* father = node->getFather();
-  VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  const VVVdouble* d2pxy_node = &d2pxy_.at(node->getId());
   Vdouble* d2Likelihoods_node = &likelihoodData_->getD2LikelihoodArray(node->getId());
-  VVVdouble* d2pxy_node = &d2pxy_[node->getId()];
-  VVVdouble larray;
-  computeLikelihoodAtNode_(father, larray, node);
-  Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
-
-  double d2Li, d2Lic, d2Licx;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    VVdouble* likelihoods_father_node_i = &(*likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    d2Li = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      Vdouble* likelihoods_father_node_i_c = &(*likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble* d2pxy_node_c = &(*d2pxy_node)[c];
-      d2Lic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
-      {
-        Vdouble* d2pxy_node_c_x = &(*d2pxy_node_c)[x];
-        d2Licx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
-        {
-          d2Licx += (*d2pxy_node_c_x)[y] * (*likelihoods_father_node_i_c)[y];
-        }
-        d2Licx *= (*larray_i_c)[x];
-        d2Lic += d2Licx;
-      }
-      d2Li += rateDistribution_->getProbability(c) * d2Lic;
-    }
-    (*d2Likelihoods_node)[i] = d2Li / (*rootLikelihoodsSR)[i];
-  }
+  VVVdouble larray(nbDistinctSites_);
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      computeTreeDerivativeAtNodeForSites_(node, *d2pxy_node, *d2Likelihoods_node, larray, siteBegin, siteEnd);
+    });
 }
 
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeTreeD2Likelihoods()
 {
+  vector<const VVVdouble*> d2pxy(nbNodes_);
+  vector<Vdouble*> d2Likelihoods(nbNodes_);
   for (size_t k = 0; k < nbNodes_; k++)
   {
-    computeTreeD2LikelihoodAtNode(nodes_[k]);
+    int id = nodes_[k]->getId();
+    d2pxy[k] = &d2pxy_.at(id);
+    d2Likelihoods[k] = &likelihoodData_->getD2LikelihoodArray(id);
   }
+  VVVdouble larray(nbDistinctSites_);
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      for (size_t k = 0; k < nbNodes_; k++)
+      {
+        computeTreeDerivativeAtNodeForSites_(nodes_[k], *d2pxy[k], *d2Likelihoods[k], larray, siteBegin, siteEnd);
+      }
+    });
 }
 
 /******************************************************************************/
@@ -459,19 +436,37 @@ throw (Exception)
   return -d2;
 }
 
+
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::resetLikelihoodArrays(const Node* node)
 {
+  resetLikelihoodArraysForSites_(node, 0, nbDistinctSites_);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::resetLikelihoodArraysForSites_(const Node* node, size_t siteBegin, size_t siteEnd)
+{
+  if (likelihoodData_->usesFlatArrays())
+  {
+    for (size_t n = 0; n < node->getNumberOfSons(); n++)
+    {
+      likelihoodData_->getFlatLikelihoodArray(node->getId(), node->getSon(n)->getId()).fill(1., siteBegin, siteEnd);
+    }
+    if (node->hasFather())
+      likelihoodData_->getFlatLikelihoodArray(node->getId(), node->getFather()->getId()).fill(1., siteBegin, siteEnd);
+    return;
+  }
   for (size_t n = 0; n < node->getNumberOfSons(); n++)
   {
     const Node* subNode = node->getSon(n);
-    resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), subNode->getId()));
+    resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), subNode->getId()), siteBegin, siteEnd);
   }
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), father->getId()));
+    resetLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), father->getId()), siteBegin, siteEnd);
   }
 }
 
@@ -479,22 +474,66 @@ void DRHomogeneousTreeLikelihood::resetLikelihoodArrays(const Node* node)
 
 void DRHomogeneousTreeLikelihood::computeTreeLikelihood()
 {
-  computeSubtreeLikelihoodPostfix(tree_->getRootNode());
-  computeSubtreeLikelihoodPrefix(tree_->getRootNode());
-  computeRootLikelihood();
+  if (parallelMode_ == PARALLEL_SUBTREES)
+  {
+    // Independent subtrees are computed concurrently, for all sites at once:
+    forEachNode_(true, [this](const Node* node) {
+        computeNodeLikelihoodPostfixForSites_(node, 0, nbDistinctSites_);
+      });
+    forEachNode_(false, [this](const Node* node) {
+        computeNodeLikelihoodPrefixForSites_(node, 0, nbDistinctSites_);
+      });
+    computeRootLikelihood();
+    return;
+  }
+
+  // Each block of sites goes through the whole tree before the next one:
+  const Node* root = tree_->getRootNode();
+  forEachSiteBlock_(nbDistinctSites_, [this, root](size_t siteBegin, size_t siteEnd) {
+      computeSubtreeLikelihoodPostfixForSites_(root, siteBegin, siteEnd);
+      computeSubtreeLikelihoodPrefixForSites_(root, siteBegin, siteEnd);
+      computeRootLikelihoodForSites_(siteBegin, siteEnd);
+    });
 }
 
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* node)
 {
+  forEachSiteBlock_(nbDistinctSites_, [this, node](size_t siteBegin, size_t siteEnd) {
+      computeSubtreeLikelihoodPostfixForSites_(node, siteBegin, siteEnd);
+    });
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfixForSites_(const Node* node, size_t siteBegin, size_t siteEnd)
+{
+  // Sons first, then the node itself:
+  size_t nbSons = node->getNumberOfSons();
+  for (size_t l = 0; l < nbSons; l++)
+  {
+    computeSubtreeLikelihoodPostfixForSites_(node->getSon(l), siteBegin, siteEnd); // Recursive method.
+  }
+  computeNodeLikelihoodPostfixForSites_(node, siteBegin, siteEnd);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeNodeLikelihoodPostfixForSites_(const Node* node, size_t siteBegin, size_t siteEnd)
+{
+  if (likelihoodData_->usesFlatArrays())
+  {
+    computeNodeLikelihoodPostfixFlat_(node, siteBegin, siteEnd);
+    return;
+  }
 //  if(node->isLeaf()) return;
 // cout << node->getId() << "\t" << (node->hasName()?node->getName():"") << endl;
   if (node->getNumberOfSons() == 0)
     return;
 
   // Set all likelihood arrays to 1 for a start:
-  resetLikelihoodArrays(node);
+  resetLikelihoodArraysForSites_(node, siteBegin, siteEnd);
 
   map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
   size_t nbNodes = node->getNumberOfSons();
@@ -503,12 +542,13 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
     // For each son node...
 
     const Node* son = node->getSon(l);
-    VVVdouble* _likelihoods_node_son = &(*_likelihoods_node)[son->getId()];
+    VVVdouble* _likelihoods_node_son = &_likelihoods_node->at(son->getId());
+    vector<const vector<int>*> iCounts;
 
     if (son->isLeaf())
     {
       VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(son->getId());
-      for (size_t i = 0; i < nbDistinctSites_; i++)
+      for (size_t i = siteBegin; i < siteEnd; i++)
       {
         // For each site in the sequence,
         Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
@@ -527,7 +567,7 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
     }
     else
     {
-      computeSubtreeLikelihoodPostfix(son); // Recursive method:
+      // The conditional likelihoods of the son subtree have already been computed:
       size_t nbSons = son->getNumberOfSons();
       map<int, VVVdouble>* _likelihoods_son = &likelihoodData_->getLikelihoodArrays(son->getId());
 
@@ -536,11 +576,13 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
       for (size_t n = 0; n < nbSons; n++)
       {
         const Node* sonSon = son->getSon(n);
-        tProb[n] = &pxy_[sonSon->getId()];
-        iLik[n] = &(*_likelihoods_son)[sonSon->getId()];
+        tProb[n] = &pxy_.at(sonSon->getId());
+        iLik[n] = &_likelihoods_son->at(sonSon->getId());
+        iCounts.push_back(&likelihoodData_->getScalingCounts(son->getId(), sonSon->getId()));
       }
-      computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+      computeLikelihoodFromArraysForSites(iLik, tProb, *_likelihoods_node_son, nbSons, siteBegin, siteEnd, nbClasses_, nbStates_, false);
     }
+    updateScalingCountsForSites_(iCounts, *_likelihoods_node_son, likelihoodData_->getScalingCounts(node->getId(), son->getId()), siteBegin, siteEnd);
   }
 }
 
@@ -548,15 +590,36 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node* no
 
 void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* node)
 {
+  forEachSiteBlock_(nbDistinctSites_, [this, node](size_t siteBegin, size_t siteEnd) {
+      computeSubtreeLikelihoodPrefixForSites_(node, siteBegin, siteEnd);
+    });
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefixForSites_(const Node* node, size_t siteBegin, size_t siteEnd)
+{
+  // The node itself first, then its sons:
+  computeNodeLikelihoodPrefixForSites_(node, siteBegin, siteEnd);
+  size_t nbSons = node->getNumberOfSons();
+  for (size_t n = 0; n < nbSons; n++)
+  {
+    computeSubtreeLikelihoodPrefixForSites_(node->getSon(n), siteBegin, siteEnd); // Recursive method.
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeNodeLikelihoodPrefixForSites_(const Node* node, size_t siteBegin, size_t siteEnd)
+{
+  if (likelihoodData_->usesFlatArrays())
+  {
+    computeNodeLikelihoodPrefixFlat_(node, siteBegin, siteEnd);
+    return;
+  }
   if (!node->hasFather())
   {
-    // 'node' is the root of the tree.
-    // Just call the method on each son node:
-    size_t nbSons = node->getNumberOfSons();
-    for (size_t n = 0; n < nbSons; n++)
-    {
-      computeSubtreeLikelihoodPrefix(node->getSon(n));
-    }
+    // 'node' is the root of the tree, nothing to do.
     return;
   }
   else
@@ -564,17 +627,18 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
     const Node* father = node->getFather();
     map<int, VVVdouble>* _likelihoods_node = &likelihoodData_->getLikelihoodArrays(node->getId());
     map<int, VVVdouble>* _likelihoods_father = &likelihoodData_->getLikelihoodArrays(father->getId());
-    VVVdouble* _likelihoods_node_father = &(*_likelihoods_node)[father->getId()];
+    VVVdouble* _likelihoods_node_father = &_likelihoods_node->at(father->getId());
+    vector<const vector<int>*> iCounts;
     if (node->isLeaf())
     {
-      resetLikelihoodArray(*_likelihoods_node_father);
+      resetLikelihoodArray(*_likelihoods_node_father, siteBegin, siteEnd);
     }
 
     if (father->isLeaf())
     {
       // If the tree is rooted by a leaf
       VVdouble* _likelihoods_leaf = &likelihoodData_->getLeafLikelihoods(father->getId());
-      for (size_t i = 0; i < nbDistinctSites_; i++)
+      for (size_t i = siteBegin; i < siteEnd; i++)
       {
         // For each site in the sequence,
         Vdouble* _likelihoods_leaf_i = &(*_likelihoods_leaf)[i];
@@ -613,25 +677,27 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
       for (size_t n = 0; n < nbSons; n++)
       {
         const Node* fatherSon = nodes[n];
-        tProb[n] = &pxy_[fatherSon->getId()];
-        iLik[n] = &(*_likelihoods_father)[fatherSon->getId()];
+        tProb[n] = &pxy_.at(fatherSon->getId());
+        iLik[n] = &_likelihoods_father->at(fatherSon->getId());
+        iCounts.push_back(&likelihoodData_->getScalingCounts(father->getId(), fatherSon->getId()));
       }
 
       if (father->hasFather())
       {
         const Node* fatherFather = father->getFather();
-        computeLikelihoodFromArrays(iLik, tProb, &(*_likelihoods_father)[fatherFather->getId()], &pxy_[father->getId()], *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        iCounts.push_back(&likelihoodData_->getScalingCounts(father->getId(), fatherFather->getId()));
+        computeLikelihoodFromArraysForSites(iLik, tProb, &_likelihoods_father->at(fatherFather->getId()), &pxy_.at(father->getId()), *_likelihoods_node_father, nbSons, siteBegin, siteEnd, nbClasses_, nbStates_, false);
       }
       else
       {
-        computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        computeLikelihoodFromArraysForSites(iLik, tProb, *_likelihoods_node_father, nbSons, siteBegin, siteEnd, nbClasses_, nbStates_, false);
       }
     }
 
     if (!father->hasFather())
     {
       // We have to account for the root frequencies:
-      for (size_t i = 0; i < nbDistinctSites_; i++)
+      for (size_t i = siteBegin; i < siteEnd; i++)
       {
         VVdouble* _likelihoods_node_father_i = &(*_likelihoods_node_father)[i];
         for (size_t c = 0; c < nbClasses_; c++)
@@ -644,13 +710,7 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
         }
       }
     }
-
-    // Call the method on each son node:
-    size_t nbNodeSons = node->getNumberOfSons();
-    for (size_t i = 0; i < nbNodeSons; i++)
-    {
-      computeSubtreeLikelihoodPrefix(node->getSon(i)); // Recursive method.
-    }
+    updateScalingCountsForSites_(iCounts, *_likelihoods_node_father, likelihoodData_->getScalingCounts(node->getId(), father->getId()), siteBegin, siteEnd);
   }
 }
 
@@ -658,13 +718,27 @@ void DRHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node* nod
 
 void DRHomogeneousTreeLikelihood::computeRootLikelihood()
 {
+  forEachSiteBlock_(nbDistinctSites_, [this](size_t siteBegin, size_t siteEnd) {
+      computeRootLikelihoodForSites_(siteBegin, siteEnd);
+    });
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeRootLikelihoodForSites_(size_t siteBegin, size_t siteEnd)
+{
+  if (likelihoodData_->usesFlatArrays())
+  {
+    computeRootLikelihoodFlat_(siteBegin, siteEnd);
+    return;
+  }
   const Node* root = tree_->getRootNode();
   VVVdouble* rootLikelihoods = &likelihoodData_->getRootLikelihoodArray();
   // Set all likelihoods to 1 for a start:
   if (root->isLeaf())
   {
     VVdouble* leavesLikelihoods_root = &likelihoodData_->getLeafLikelihoods(root->getId());
-    for (size_t i = 0; i < nbDistinctSites_; i++)
+    for (size_t i = siteBegin; i < siteEnd; i++)
     {
       VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
       Vdouble* leavesLikelihoods_root_i = &(*leavesLikelihoods_root)[i];
@@ -680,25 +754,28 @@ void DRHomogeneousTreeLikelihood::computeRootLikelihood()
   }
   else
   {
-    resetLikelihoodArray(*rootLikelihoods);
+    resetLikelihoodArray(*rootLikelihoods, siteBegin, siteEnd);
   }
 
   map<int, VVVdouble>* likelihoods_root = &likelihoodData_->getLikelihoodArrays(root->getId());
   size_t nbNodes = root->getNumberOfSons();
   vector<const VVVdouble*> iLik(nbNodes);
   vector<const VVVdouble*> tProb(nbNodes);
+  vector<const vector<int>*> iCounts(nbNodes);
   for (size_t n = 0; n < nbNodes; n++)
   {
     const Node* son = root->getSon(n);
-    tProb[n] = &pxy_[son->getId()];
-    iLik[n] = &(*likelihoods_root)[son->getId()];
+    tProb[n] = &pxy_.at(son->getId());
+    iLik[n] = &likelihoods_root->at(son->getId());
+    iCounts[n] = &likelihoodData_->getScalingCounts(root->getId(), son->getId());
   }
-  computeLikelihoodFromArrays(iLik, tProb, *rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+  computeLikelihoodFromArraysForSites(iLik, tProb, *rootLikelihoods, nbNodes, siteBegin, siteEnd, nbClasses_, nbStates_, false);
+  updateScalingCountsForSites_(iCounts, *rootLikelihoods, likelihoodData_->getRootScalingCounts(), siteBegin, siteEnd);
 
   Vdouble p = rateDistribution_->getProbabilities();
   VVdouble* rootLikelihoodsS  = &likelihoodData_->getRootSiteLikelihoodArray();
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
-  for (size_t i = 0; i < nbDistinctSites_; i++)
+  for (size_t i = siteBegin; i < siteEnd; i++)
   {
     // For each site in the sequence,
     VVdouble* rootLikelihoods_i = &(*rootLikelihoods)[i];
@@ -727,17 +804,37 @@ void DRHomogeneousTreeLikelihood::computeRootLikelihood()
 /******************************************************************************/
 
 void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode) const
+{
+  if (likelihoodData_->usesFlatArrays())
+  {
+    // This method is const and may be called concurrently, so it works on its own buffer:
+    FlatLikelihoodBuffer buffer;
+    FlatLikelihoodArrayView larray = likelihoodData_->getFlatScratchArray(buffer);
+    forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+        computeLikelihoodAtNodeFlat_(node, larray, sonNode, siteBegin, siteEnd);
+      });
+    larray.copyTo(likelihoodArray);
+    return;
+  }
+  likelihoodArray.resize(nbDistinctSites_);
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      computeLikelihoodAtNodeForSites_(node, likelihoodArray, sonNode, siteBegin, siteEnd);
+    });
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodAtNodeForSites_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode, size_t siteBegin, size_t siteEnd) const
 {
   // const Node * node = tree_->getNode(nodeId);
   int nodeId = node->getId();
-  likelihoodArray.resize(nbDistinctSites_);
   map<int, VVVdouble>* likelihoods_node = &likelihoodData_->getLikelihoodArrays(nodeId);
 
   // Initialize likelihood array:
   if (node->isLeaf())
   {
     VVdouble* leavesLikelihoods_node = &likelihoodData_->getLeafLikelihoods(nodeId);
-    for (size_t i = 0; i < nbDistinctSites_; i++)
+    for (size_t i = siteBegin; i < siteEnd; i++)
     {
       VVdouble* likelihoodArray_i = &likelihoodArray[i];
       Vdouble* leavesLikelihoods_node_i = &(*leavesLikelihoods_node)[i];
@@ -757,7 +854,7 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVV
   {
     // Otherwise:
     // Set all likelihoods to 1 for a start:
-    for (size_t i = 0; i < nbDistinctSites_; i++)
+    for (size_t i = siteBegin; i < siteEnd; i++)
     {
       VVdouble* likelihoodArray_i = &likelihoodArray[i];
       likelihoodArray_i->resize(nbClasses_);
@@ -782,8 +879,8 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVV
   {
     const Node* son = node->getSon(n);
     if (son != sonNode) {
-      tProb.push_back(&pxy_[son->getId()]);
-      iLik.push_back(&(*likelihoods_node)[son->getId()]);
+      tProb.push_back(&pxy_.at(son->getId()));
+      iLik.push_back(&likelihoods_node->at(son->getId()));
     } else {
       test = true;
     }
@@ -798,14 +895,14 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVV
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    computeLikelihoodFromArrays(iLik, tProb, &(*likelihoods_node)[father->getId()], &pxy_[nodeId], likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArraysForSites(iLik, tProb, &likelihoods_node->at(father->getId()), &pxy_.at(nodeId), likelihoodArray, nbNodes, siteBegin, siteEnd, nbClasses_, nbStates_, false);
   }
   else
   {
-    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArraysForSites(iLik, tProb, likelihoodArray, nbNodes, siteBegin, siteEnd, nbClasses_, nbStates_, false);
 
     // We have to account for the equilibrium frequencies:
-    for (size_t i = 0; i < nbDistinctSites_; i++)
+    for (size_t i = siteBegin; i < siteEnd; i++)
     {
       VVdouble* likelihoodArray_i = &likelihoodArray[i];
       for (size_t c = 0; c < nbClasses_; c++)
@@ -822,25 +919,113 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node, VVV
 
 /******************************************************************************/
 
+void DRHomogeneousTreeLikelihood::computeTreeDerivativeAtNodeForSites_(const Node* node, const VVVdouble& dpxy, Vdouble& dLikelihoods, VVVdouble& larray, size_t siteBegin, size_t siteEnd)
+{
+  if (likelihoodData_->usesFlatArrays())
+  {
+    computeTreeDerivativeAtNodeFlat_(node, dpxy, dLikelihoods, siteBegin, siteEnd);
+    return;
+  }
+  const Node* father = node->getFather();
+  VVVdouble* likelihoods_father_node = &likelihoodData_->getLikelihoodArray(father->getId(), node->getId());
+  computeLikelihoodAtNodeForSites_(father, larray, node, siteBegin, siteEnd);
+  vector<int> larrayCounts;
+  rescaleDerivativeArrayForSites_(larray, larrayCounts, siteBegin, siteEnd);
+  Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
+
+  StateLikelihoodKernels::derivative(dpxy, *likelihoods_father_node, larray, rateDistribution_->getProbabilities(), *rootLikelihoodsSR, dLikelihoods, siteBegin, siteEnd, nbClasses_, nbStates_);
+  rescaleDerivativesForSites_(node, dLikelihoods, larrayCounts, siteBegin, siteEnd);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
+  const vector<const VVVdouble*>& iLik,
+  const vector<const VVVdouble*>& tProb,
+  VVVdouble& oLik,
+  size_t nbNodes,
+  size_t nbDistinctSites,
+  size_t nbClasses,
+  size_t nbStates,
+  bool reset)
+{
+  computeLikelihoodFromArraysForSites(iLik, tProb, oLik, nbNodes, 0, nbDistinctSites, nbClasses, nbStates, reset);
+}
+
+/******************************************************************************/
+
 void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
   const vector<const VVVdouble*>& iLik,
   const vector<const VVVdouble*>& tProb,
+  const VVVdouble* iLikR,
+  const VVVdouble* tProbR,
   VVVdouble& oLik,
   size_t nbNodes,
   size_t nbDistinctSites,
   size_t nbClasses,
   size_t nbStates,
   bool reset)
+{
+  computeLikelihoodFromArraysForSites(iLik, tProb, iLikR, tProbR, oLik, nbNodes, 0, nbDistinctSites, nbClasses, nbStates, reset);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
+  const vector<FlatLikelihoodArrayView>& iLik,
+  const vector<const VVVdouble*>& tProb,
+  FlatLikelihoodArrayView& oLik,
+  size_t nbNodes,
+  size_t nbDistinctSites,
+  size_t nbClasses,
+  size_t nbStates,
+  bool reset)
+{
+  computeLikelihoodFromArraysForSites(iLik, tProb, oLik, nbNodes, 0, nbDistinctSites, nbClasses, nbStates, reset);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
+  const vector<FlatLikelihoodArrayView>& iLik,
+  const vector<const VVVdouble*>& tProb,
+  const FlatLikelihoodArrayView& iLikR,
+  const VVVdouble* tProbR,
+  FlatLikelihoodArrayView& oLik,
+  size_t nbNodes,
+  size_t nbDistinctSites,
+  size_t nbClasses,
+  size_t nbStates,
+  bool reset)
+{
+  computeLikelihoodFromArraysForSites(iLik, tProb, iLikR, tProbR, oLik, nbNodes, 0, nbDistinctSites, nbClasses, nbStates, reset);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArraysForSites(
+  const vector<const VVVdouble*>& iLik,
+  const vector<const VVVdouble*>& tProb,
+  VVVdouble& oLik,
+  size_t nbNodes,
+  size_t siteBegin,
+  size_t siteEnd,
+  size_t nbClasses,
+  size_t nbStates,
+  bool reset)
 {
   if (reset)
-    resetLikelihoodArray(oLik);
+    resetLikelihoodArray(oLik, siteBegin, siteEnd);
 
+  size_t stride = LikelihoodKernels::getPackedStride(nbStates);
+  size_t classStride = nbStates * stride;
+  vector<double>& pxy = LikelihoodKernels::getPackingBuffer();
   for (size_t n = 0; n < nbNodes; n++)
   {
-    const VVVdouble* pxy_n = tProb[n];
+    LikelihoodKernels::packTransitionMatrices(*tProb[n], true, pxy, nbClasses, nbStates);
     const VVVdouble* iLik_n = iLik[n];
 
-    for (size_t i = 0; i < nbDistinctSites; i++)
+    for (size_t i = siteBegin; i < siteEnd; i++)
     {
       // For each site in the sequence,
       const VVdouble* iLik_n_i = &(*iLik_n)[i];
@@ -848,22 +1033,9 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
 
       for (size_t c = 0; c < nbClasses; c++)
       {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
+        // For each rate classe, we multiply the conditionnal likelihood by the product of
+        // the transition matrix and the likelihoods of the subtree:
+        LikelihoodKernels::multiply(&pxy[c * classStride], stride, &(*iLik_n_i)[c][0], &(*oLik_i)[c][0], nbStates);
       }
     }
   }
@@ -871,81 +1043,298 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
 
 /******************************************************************************/
 
-void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArraysForSites(
   const vector<const VVVdouble*>& iLik,
   const vector<const VVVdouble*>& tProb,
   const VVVdouble* iLikR,
   const VVVdouble* tProbR,
   VVVdouble& oLik,
   size_t nbNodes,
-  size_t nbDistinctSites,
+  size_t siteBegin,
+  size_t siteEnd,
+  size_t nbClasses,
+  size_t nbStates,
+  bool reset)
+{
+  computeLikelihoodFromArraysForSites(iLik, tProb, oLik, nbNodes, siteBegin, siteEnd, nbClasses, nbStates, reset);
+
+  // Now deal with the subtree containing the root, using the transition matrix not transposed:
+  size_t stride = LikelihoodKernels::getPackedStride(nbStates);
+  size_t classStride = nbStates * stride;
+  vector<double>& pxyR = LikelihoodKernels::getPackingBuffer();
+  LikelihoodKernels::packTransitionMatrices(*tProbR, false, pxyR, nbClasses, nbStates);
+  for (size_t i = siteBegin; i < siteEnd; i++)
+  {
+    // For each site in the sequence,
+    const VVdouble* iLikR_i = &(*iLikR)[i];
+    VVdouble* oLik_i = &(oLik)[i];
+
+    for (size_t c = 0; c < nbClasses; c++)
+    {
+      // For each rate classe,
+      LikelihoodKernels::multiply(&pxyR[c * classStride], stride, &(*iLikR_i)[c][0], &(*oLik_i)[c][0], nbStates);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArraysForSites(
+  const vector<FlatLikelihoodArrayView>& iLik,
+  const vector<const VVVdouble*>& tProb,
+  FlatLikelihoodArrayView& oLik,
+  size_t nbNodes,
+  size_t siteBegin,
+  size_t siteEnd,
   size_t nbClasses,
   size_t nbStates,
   bool reset)
 {
   if (reset)
-    resetLikelihoodArray(oLik);
+    oLik.fill(1., siteBegin, siteEnd);
 
+  size_t stride = LikelihoodKernels::getPackedStride(nbStates);
+  size_t offset = siteBegin * oLik.getSiteStride();
+  vector<double>& pxy = LikelihoodKernels::getPackingBuffer();
   for (size_t n = 0; n < nbNodes; n++)
   {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
+    LikelihoodKernels::packTransitionMatrices(*tProb[n], true, pxy, nbClasses, nbStates);
+    LikelihoodKernels::multiplyArray(&pxy[0], stride, iLik[n].getData() + offset, oLik.getData() + offset, siteEnd - siteBegin, nbClasses, nbStates, oLik.getStateStride());
+  }
+}
 
-    for (size_t i = 0; i < nbDistinctSites; i++)
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodFromArraysForSites(
+  const vector<FlatLikelihoodArrayView>& iLik,
+  const vector<const VVVdouble*>& tProb,
+  const FlatLikelihoodArrayView& iLikR,
+  const VVVdouble* tProbR,
+  FlatLikelihoodArrayView& oLik,
+  size_t nbNodes,
+  size_t siteBegin,
+  size_t siteEnd,
+  size_t nbClasses,
+  size_t nbStates,
+  bool reset)
+{
+  computeLikelihoodFromArraysForSites(iLik, tProb, oLik, nbNodes, siteBegin, siteEnd, nbClasses, nbStates, reset);
+
+  // Now deal with the subtree containing the root, using the transition matrix not transposed:
+  size_t stride = LikelihoodKernels::getPackedStride(nbStates);
+  size_t offset = siteBegin * oLik.getSiteStride();
+  vector<double>& pxyR = LikelihoodKernels::getPackingBuffer();
+  LikelihoodKernels::packTransitionMatrices(*tProbR, false, pxyR, nbClasses, nbStates);
+  LikelihoodKernels::multiplyArray(&pxyR[0], stride, iLikR.getData() + offset, oLik.getData() + offset, siteEnd - siteBegin, nbClasses, nbStates, oLik.getStateStride());
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeNodeLikelihoodPostfixFlat_(const Node* node, size_t siteBegin, size_t siteEnd)
+{
+  if (node->getNumberOfSons() == 0)
+    return;
+
+  size_t nbNodes = node->getNumberOfSons();
+  for (size_t l = 0; l < nbNodes; l++)
+  {
+    // For each son node...
+    const Node* son = node->getSon(l);
+    FlatLikelihoodArrayView likelihoods_node_son = likelihoodData_->getFlatLikelihoodArray(node->getId(), son->getId());
+    vector<const vector<int>*> iCounts;
+
+    if (son->isLeaf())
     {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
+      likelihoods_node_son.copyFrom(likelihoodData_->getLeafLikelihoods(son->getId()), siteBegin, siteEnd);
+    }
+    else
+    {
+      // The conditional likelihoods of the son subtree have already been computed:
+      size_t nbSons = son->getNumberOfSons();
 
-      for (size_t c = 0; c < nbClasses; c++)
+      vector<FlatLikelihoodArrayView> iLik(nbSons);
+      vector<const VVVdouble*> tProb(nbSons);
+      for (size_t n = 0; n < nbSons; n++)
+      {
+        const Node* sonSon = son->getSon(n);
+        tProb[n] = &pxy_.at(sonSon->getId());
+        iLik[n] = likelihoodData_->getFlatLikelihoodArray(son->getId(), sonSon->getId());
+        iCounts.push_back(&likelihoodData_->getScalingCounts(son->getId(), sonSon->getId()));
+      }
+      computeLikelihoodFromArraysForSites(iLik, tProb, likelihoods_node_son, nbSons, siteBegin, siteEnd, nbClasses_, nbStates_, true);
+    }
+    updateScalingCountsForSites_(iCounts, likelihoods_node_son, likelihoodData_->getScalingCounts(node->getId(), son->getId()), siteBegin, siteEnd);
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeNodeLikelihoodPrefixFlat_(const Node* node, size_t siteBegin, size_t siteEnd)
+{
+  if (node->hasFather())
+  {
+    const Node* father = node->getFather();
+    FlatLikelihoodArrayView likelihoods_node_father = likelihoodData_->getFlatLikelihoodArray(node->getId(), father->getId());
+    vector<const vector<int>*> iCounts;
+
+    if (father->isLeaf())
+    {
+      // If the tree is rooted by a leaf
+      likelihoods_node_father.copyFrom(likelihoodData_->getLeafLikelihoods(father->getId()), siteBegin, siteEnd);
+    }
+    else
+    {
+      // Compute the likelihoods for the subtree defined by node 'father', brothers included:
+      vector<FlatLikelihoodArrayView> iLik;
+      vector<const VVVdouble*> tProb;
+      size_t nbFatherSons = father->getNumberOfSons();
+      for (size_t n = 0; n < nbFatherSons; n++)
+      {
+        const Node* son = father->getSon(n);
+        if (son->getId() != node->getId())
+        {
+          // This is a real brother, not current node!
+          tProb.push_back(&pxy_.at(son->getId()));
+          iLik.push_back(likelihoodData_->getFlatLikelihoodArray(father->getId(), son->getId()));
+          iCounts.push_back(&likelihoodData_->getScalingCounts(father->getId(), son->getId()));
+        }
+      }
+
+      if (father->hasFather())
+      {
+        const Node* fatherFather = father->getFather();
+        iCounts.push_back(&likelihoodData_->getScalingCounts(father->getId(), fatherFather->getId()));
+        computeLikelihoodFromArraysForSites(iLik, tProb, likelihoodData_->getFlatLikelihoodArray(father->getId(), fatherFather->getId()), &pxy_.at(father->getId()), likelihoods_node_father, iLik.size(), siteBegin, siteEnd, nbClasses_, nbStates_, true);
+      }
+      else
       {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
+        computeLikelihoodFromArraysForSites(iLik, tProb, likelihoods_node_father, iLik.size(), siteBegin, siteEnd, nbClasses_, nbStates_, true);
+      }
+    }
+
+    if (!father->hasFather())
+    {
+      // We have to account for the root frequencies:
+      for (size_t i = siteBegin; i < siteEnd; i++)
+      {
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
+          double* likelihoods_node_father_i_c = likelihoods_node_father(i, c);
+          for (size_t x = 0; x < nbStates_; x++)
           {
-            // cout << "1:" << (* pxy_n_c_x)[y]  << endl;
-            // cout << "2:" << (* iLik_n_i_c)[y] << endl;
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-            // cout << i << "\t" << c << "\t" << x << "\t" << y << "\t" <<  (* pxy__son_c_x)[y] << "\t" << (* likelihoods_root_son_i_c)[y] << endl;
+            likelihoods_node_father_i_c[x] *= rootFreqs_[x];
           }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
         }
       }
     }
+    updateScalingCountsForSites_(iCounts, likelihoods_node_father, likelihoodData_->getScalingCounts(node->getId(), father->getId()), siteBegin, siteEnd);
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeRootLikelihoodFlat_(size_t siteBegin, size_t siteEnd)
+{
+  const Node* root = tree_->getRootNode();
+  FlatLikelihoodArrayView rootLikelihoods = likelihoodData_->getFlatRootLikelihoodArray();
+  if (root->isLeaf())
+    rootLikelihoods.copyFrom(likelihoodData_->getLeafLikelihoods(root->getId()), siteBegin, siteEnd);
+  else
+    rootLikelihoods.fill(1., siteBegin, siteEnd);
+
+  size_t nbNodes = root->getNumberOfSons();
+  vector<FlatLikelihoodArrayView> iLik(nbNodes);
+  vector<const VVVdouble*> tProb(nbNodes);
+  vector<const vector<int>*> iCounts(nbNodes);
+  for (size_t n = 0; n < nbNodes; n++)
+  {
+    const Node* son = root->getSon(n);
+    tProb[n] = &pxy_.at(son->getId());
+    iLik[n] = likelihoodData_->getFlatLikelihoodArray(root->getId(), son->getId());
+    iCounts[n] = &likelihoodData_->getScalingCounts(root->getId(), son->getId());
   }
+  computeLikelihoodFromArraysForSites(iLik, tProb, rootLikelihoods, nbNodes, siteBegin, siteEnd, nbClasses_, nbStates_, false);
+  updateScalingCountsForSites_(iCounts, rootLikelihoods, likelihoodData_->getRootScalingCounts(), siteBegin, siteEnd);
 
-  // Now deal with the subtree containing the root:
-  for (size_t i = 0; i < nbDistinctSites; i++)
+  Vdouble p = rateDistribution_->getProbabilities();
+  VVdouble* rootLikelihoodsS  = &likelihoodData_->getRootSiteLikelihoodArray();
+  Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
+  for (size_t i = siteBegin; i < siteEnd; i++)
   {
     // For each site in the sequence,
-    const VVdouble* iLikR_i = &(*iLikR)[i];
-    VVdouble* oLik_i = &(oLik)[i];
-
-    for (size_t c = 0; c < nbClasses; c++)
+    Vdouble* rootLikelihoodsS_i = &(*rootLikelihoodsS)[i];
+    (*rootLikelihoodsSR)[i] = 0;
+    for (size_t c = 0; c < nbClasses_; c++)
     {
       // For each rate classe,
-      const Vdouble* iLikR_i_c = &(*iLikR_i)[c];
-      Vdouble* oLik_i_c = &(*oLik_i)[c];
-      const VVdouble* pxyR_c = &(*tProbR)[c];
-      for (size_t x = 0; x < nbStates; x++)
+      const double* rootLikelihoods_i_c = rootLikelihoods(i, c);
+      double* rootLikelihoodsS_i_c = &(*rootLikelihoodsS_i)[c];
+      (*rootLikelihoodsS_i_c) = 0;
+      for (size_t x = 0; x < nbStates_; x++)
+      {
+        // For each initial state,
+        (*rootLikelihoodsS_i_c) += rootFreqs_[x] * rootLikelihoods_i_c[x];
+      }
+      (*rootLikelihoodsSR)[i] += p[c] * (*rootLikelihoodsS_i_c);
+    }
+
+    // Final checking (for numerical errors):
+    if ((*rootLikelihoodsSR)[i] < 0)
+      (*rootLikelihoodsSR)[i] = 0.;
+  }
+
+  // Keep the public root array up to date:
+  rootLikelihoods.copyTo(likelihoodData_->getRootLikelihoodArray(), siteBegin, siteEnd);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::computeLikelihoodAtNodeFlat_(const Node* node, FlatLikelihoodArrayView& likelihoodArray, const Node* sonNode, size_t siteBegin, size_t siteEnd) const
+{
+  int nodeId = node->getId();
+
+  // Initialize likelihood array:
+  if (node->isLeaf())
+    likelihoodArray.copyFrom(likelihoodData_->getLeafLikelihoods(nodeId), siteBegin, siteEnd);
+  else
+    likelihoodArray.fill(1., siteBegin, siteEnd);
+
+  size_t nbNodes = node->getNumberOfSons();
+  vector<FlatLikelihoodArrayView> iLik;
+  vector<const VVVdouble*> tProb;
+  bool test = false;
+  for (size_t n = 0; n < nbNodes; n++)
+  {
+    const Node* son = node->getSon(n);
+    if (son != sonNode) {
+      tProb.push_back(&pxy_.at(son->getId()));
+      iLik.push_back(likelihoodData_->getFlatLikelihoodArray(nodeId, son->getId()));
+    } else {
+      test = true;
+    }
+  }
+  if (sonNode && !test)
+    throw Exception("DRHomogeneousTreeLikelihood::computeLikelihoodAtNodeFlat_(...). 'sonNode' not found as a son of 'node'.");
+
+  if (node->hasFather())
+  {
+    const Node* father = node->getFather();
+    computeLikelihoodFromArraysForSites(iLik, tProb, likelihoodData_->getFlatLikelihoodArray(nodeId, father->getId()), &pxy_.at(nodeId), likelihoodArray, iLik.size(), siteBegin, siteEnd, nbClasses_, nbStates_, false);
+  }
+  else
+  {
+    computeLikelihoodFromArraysForSites(iLik, tProb, likelihoodArray, iLik.size(), siteBegin, siteEnd, nbClasses_, nbStates_, false);
+
+    // We have to account for the equilibrium frequencies:
+    for (size_t i = siteBegin; i < siteEnd; i++)
+    {
+      for (size_t c = 0; c < nbClasses_; c++)
       {
-        double likelihood = 0;
-        for (size_t y = 0; y < nbStates; y++)
+        double* likelihoodArray_i_c = likelihoodArray(i, c);
+        for (size_t x = 0; x < nbStates_; x++)
         {
-          // For each final state,
-          const Vdouble* pxyR_c_y = &(*pxyR_c)[y];
-          likelihood += (*pxyR_c_y)[x] * (*iLikR_i_c)[y];
+          likelihoodArray_i_c[x] *= rootFreqs_[x];
         }
-        // We store this conditionnal likelihood into the corresponding array:
-        (*oLik_i_c)[x] *= likelihood;
       }
     }
   }
@@ -953,20 +1342,138 @@ void DRHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
 
 /******************************************************************************/
 
+void DRHomogeneousTreeLikelihood::computeTreeDerivativeAtNodeFlat_(const Node* node, const VVVdouble& dpxy, Vdouble& dLikelihoods, size_t siteBegin, size_t siteEnd)
+{
+  const Node* father = node->getFather();
+  FlatLikelihoodArrayView likelihoods_father_node = likelihoodData_->getFlatLikelihoodArray(father->getId(), node->getId());
+  // Each block of sites uses its own part of the working array:
+  FlatLikelihoodArrayView larray = likelihoodData_->getFlatWorkingArray();
+  computeLikelihoodAtNodeFlat_(father, larray, node, siteBegin, siteEnd);
+  vector<int> larrayCounts;
+  rescaleDerivativeArrayForSites_(larray, larrayCounts, siteBegin, siteEnd);
+  Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
+
+  size_t stride = LikelihoodKernels::getPackedStride(nbStates_);
+  size_t classStride = nbStates_ * stride;
+  vector<double>& dpxyPacked = LikelihoodKernels::getPackingBuffer();
+  LikelihoodKernels::packTransitionMatrices(dpxy, true, dpxyPacked, nbClasses_, nbStates_);
+  Vdouble dLic_x(nbStates_);
+
+  double dLi, dLic;
+
+  for (size_t i = siteBegin; i < siteEnd; i++)
+  {
+    dLi = 0;
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      // dLic = sum_x larray[x] * sum_y dpxy[x][y] * likelihoods_father_node[y]
+      const double* larray_i_c = larray(i, c);
+      dLic_x.assign(larray_i_c, larray_i_c + nbStates_);
+      LikelihoodKernels::multiply(&dpxyPacked[c * classStride], stride, likelihoods_father_node(i, c), &dLic_x[0], nbStates_);
+      dLic = 0;
+      for (size_t x = 0; x < nbStates_; x++)
+      {
+        dLic += dLic_x[x];
+      }
+      dLi += rateDistribution_->getProbability(c) * dLic;
+    }
+    dLikelihoods[i] = dLi / (*rootLikelihoodsSR)[i];
+  }
+  rescaleDerivativesForSites_(node, dLikelihoods, larrayCounts, siteBegin, siteEnd);
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::updateScalingCountsForSites_(const vector<const vector<int>*>& iCounts, VVVdouble& array, vector<int>& oCounts, size_t siteBegin, size_t siteEnd) const
+{
+  for (size_t i = siteBegin; i < siteEnd; i++)
+  {
+    int count = 0;
+    for (size_t n = 0; n < iCounts.size(); n++)
+    {
+      count += (*iCounts[n])[i];
+    }
+    if (scaling_)
+      count += rescaleSiteLikelihoods(array[i]);
+    oCounts[i] = count;
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::updateScalingCountsForSites_(const vector<const vector<int>*>& iCounts, FlatLikelihoodArrayView& array, vector<int>& oCounts, size_t siteBegin, size_t siteEnd) const
+{
+  for (size_t i = siteBegin; i < siteEnd; i++)
+  {
+    int count = 0;
+    for (size_t n = 0; n < iCounts.size(); n++)
+    {
+      count += (*iCounts[n])[i];
+    }
+    if (scaling_)
+      count += rescaleSiteLikelihoods(array(i, 0), nbClasses_, nbStates_, array.getStateStride());
+    oCounts[i] = count;
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::rescaleDerivativeArrayForSites_(VVVdouble& larray, vector<int>& counts, size_t siteBegin, size_t siteEnd) const
+{
+  if (!scaling_) return;
+  counts.resize(siteEnd - siteBegin);
+  for (size_t i = siteBegin; i < siteEnd; i++)
+  {
+    counts[i - siteBegin] = rescaleSiteLikelihoods(larray[i]);
+  }
+}
+
+void DRHomogeneousTreeLikelihood::rescaleDerivativeArrayForSites_(FlatLikelihoodArrayView& larray, vector<int>& counts, size_t siteBegin, size_t siteEnd) const
+{
+  if (!scaling_) return;
+  counts.resize(siteEnd - siteBegin);
+  for (size_t i = siteBegin; i < siteEnd; i++)
+  {
+    counts[i - siteBegin] = rescaleSiteLikelihoods(larray(i, 0), nbClasses_, nbStates_, larray.getStateStride());
+  }
+}
+
+/******************************************************************************/
+
+void DRHomogeneousTreeLikelihood::rescaleDerivativesForSites_(const Node* node, Vdouble& dLikelihoods, const vector<int>& arrayCounts, size_t siteBegin, size_t siteEnd) const
+{
+  if (!scaling_) return;
+  // Derivatives are computed from all the arrays of the father node,
+  // and from their product, scaled again, but divided by the root likelihood:
+  int fatherId = node->getFather()->getId();
+  const vector<int>* rootCounts = &likelihoodData_->getRootScalingCounts();
+  for (size_t i = siteBegin; i < siteEnd; i++)
+  {
+    int count = (*rootCounts)[i] - likelihoodData_->getScalingCountAtNode(fatherId, i) - arrayCounts[i - siteBegin];
+    if (count != 0)
+      dLikelihoods[i] *= getScalingFactor(count);
+  }
+}
+
+/******************************************************************************/
+
 void DRHomogeneousTreeLikelihood::displayLikelihood(const Node* node)
 {
   cout << "Likelihoods at node " << node->getId() << ": " << endl;
+  VVVdouble array;
   for (size_t n = 0; n < node->getNumberOfSons(); n++)
   {
     const Node* subNode = node->getSon(n);
     cout << "Array for sub-node " << subNode->getId() << endl;
-    displayLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), subNode->getId()));
+    likelihoodData_->getLikelihoodArraySnapshot(node->getId(), subNode->getId(), array);
+    displayLikelihoodArray(array);
   }
   if (node->hasFather())
   {
     const Node* father = node->getFather();
     cout << "Array for father node " << father->getId() << endl;
-    displayLikelihoodArray(likelihoodData_->getLikelihoodArray(node->getId(), father->getId()));
+    likelihoodData_->getLikelihoodArraySnapshot(node->getId(), father->getId(), array);
+    displayLikelihoodArray(array);
   }
   cout << "                                         ***" << endl;
 }
@@ -58,6 +58,8 @@ namespace bpp
  * A non-uniform distribution of rates among the sites is allowed (ASRV models).</p>
  *
  * This class uses an instance of the DRASDRTreeLikelihoodData for conditionnal likelihood storage.
+ * Conditional likelihoods can optionally be stored in a single contiguous buffer,
+ * see setFlatLikelihoodArrays().
  *
  * All nodes share the same site patterns.
  */
@@ -210,6 +212,27 @@ class DRHomogeneousTreeLikelihood:
     {
       computeLikelihoodAtNode_(tree_->getNode(nodeId), likelihoodArray);
     }
+
+    /**
+     * @brief Choose the storage layout of conditional likelihoods.
+     *
+     * With the flat layout, all conditional likelihood arrays are stored in one contiguous
+     * and aligned buffer, which avoids pointer chasing and reduces memory allocations
+     * on large data sets. Likelihood values are not affected by this choice.
+     *
+     * @param yn Tell if the flat layout should be used.
+     * @throw Exception if the flat layout cannot be used with the current tree.
+     * @see DRASDRTreeLikelihoodData::setFlatArrays
+     */
+    virtual void setFlatLikelihoodArrays(bool yn) throw (Exception)
+    {
+      likelihoodData_->setFlatArrays(yn);
+    }
+
+    /**
+     * @return True if conditional likelihoods are stored in a single flat buffer.
+     */
+    bool usesFlatLikelihoodArrays() const { return likelihoodData_->usesFlatArrays(); }
       
   protected:
     virtual void computeLikelihoodAtNode_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode = 0) const;
@@ -251,6 +274,8 @@ class DRHomogeneousTreeLikelihood:
      * This method is the "core" likelihood computation function, performing all the product uppon all nodes, the summation for each ancestral state and each rate class.
      * It is designed for inner usage, and a maximum efficiency, so no checking is performed on the input parameters.
      * Use with care!
+     *
+     * Matrix-vector products are computed using the vectorized kernels of the LikelihoodKernels class.
      * 
      * @param iLik A vector of likelihood arrays, one for each conditional node.
      * @param tProb A vector of transition probabilities, one for each node.
@@ -303,6 +328,199 @@ class DRHomogeneousTreeLikelihood:
         size_t nbStates,
         bool reset = true);
 
+    /**
+     * @brief Compute conditional likelihoods, flat arrays version.
+     *
+     * @see computeLikelihoodFromArrays(const std::vector<const VVVdouble*>&, const std::vector<const VVVdouble*>&, VVVdouble&, size_t, size_t, size_t, size_t, bool)
+     */
+    static void computeLikelihoodFromArrays(
+        const std::vector<FlatLikelihoodArrayView>& iLik,
+        const std::vector<const VVVdouble*>& tProb,
+        FlatLikelihoodArrayView& oLik,
+        size_t nbNodes,
+        size_t nbDistinctSites,
+        size_t nbClasses,
+        size_t nbStates,
+        bool reset = true);
+
+    /**
+     * @brief Compute conditional likelihoods, flat arrays version for non-reversible models.
+     *
+     * @see computeLikelihoodFromArrays(const std::vector<const VVVdouble*>&, const std::vector<const VVVdouble*>&, const VVVdouble*, const VVVdouble*, VVVdouble&, size_t, size_t, size_t, size_t, bool)
+     */
+    static void computeLikelihoodFromArrays(
+        const std::vector<FlatLikelihoodArrayView>& iLik,
+        const std::vector<const VVVdouble*>& tProb,
+        const FlatLikelihoodArrayView& iLikR,
+        const VVVdouble* tProbR,
+        FlatLikelihoodArrayView& oLik,
+        size_t nbNodes,
+        size_t nbDistinctSites,
+        size_t nbClasses,
+        size_t nbStates,
+        bool reset = true);
+
+    /**
+     * @brief Compute conditional likelihoods for a range of sites.
+     *
+     * Sites outside the range [siteBegin, siteEnd) are not accessed, so that several ranges
+     * can be computed in parallel.
+     *
+     * @see computeLikelihoodFromArrays(const std::vector<const VVVdouble*>&, const std::vector<const VVVdouble*>&, VVVdouble&, size_t, size_t, size_t, size_t, bool)
+     */
+    static void computeLikelihoodFromArraysForSites(
+        const std::vector<const VVVdouble*>& iLik,
+        const std::vector<const VVVdouble*>& tProb,
+        VVVdouble& oLik,
+        size_t nbNodes,
+        size_t siteBegin,
+        size_t siteEnd,
+        size_t nbClasses,
+        size_t nbStates,
+        bool reset = true);
+
+    /**
+     * @brief Compute conditional likelihoods for a range of sites, non-reversible version.
+     *
+     * @see computeLikelihoodFromArrays(const std::vector<const VVVdouble*>&, const std::vector<const VVVdouble*>&, const VVVdouble*, const VVVdouble*, VVVdouble&, size_t, size_t, size_t, size_t, bool)
+     */
+    static void computeLikelihoodFromArraysForSites(
+        const std::vector<const VVVdouble*>& iLik,
+        const std::vector<const VVVdouble*>& tProb,
+        const VVVdouble* iLikR,
+        const VVVdouble* tProbR,
+        VVVdouble& oLik,
+        size_t nbNodes,
+        size_t siteBegin,
+        size_t siteEnd,
+        size_t nbClasses,
+        size_t nbStates,
+        bool reset = true);
+
+    /**
+     * @brief Compute conditional likelihoods for a range of sites, flat arrays version.
+     */
+    static void computeLikelihoodFromArraysForSites(
+        const std::vector<FlatLikelihoodArrayView>& iLik,
+        const std::vector<const VVVdouble*>& tProb,
+        FlatLikelihoodArrayView& oLik,
+        size_t nbNodes,
+        size_t siteBegin,
+        size_t siteEnd,
+        size_t nbClasses,
+        size_t nbStates,
+        bool reset = true);
+
+    /**
+     * @brief Compute conditional likelihoods for a range of sites, flat arrays version for non-reversible models.
+     */
+    static void computeLikelihoodFromArraysForSites(
+        const std::vector<FlatLikelihoodArrayView>& iLik,
+        const std::vector<const VVVdouble*>& tProb,
+        const FlatLikelihoodArrayView& iLikR,
+        const VVVdouble* tProbR,
+        FlatLikelihoodArrayView& oLik,
+        size_t nbNodes,
+        size_t siteBegin,
+        size_t siteEnd,
+        size_t nbClasses,
+        size_t nbStates,
+        bool reset = true);
+
+  private:
+    /**
+     * @name Implementation of the recursions for a block of sites.
+     *
+     * These methods only access sites in [siteBegin, siteEnd), and are called in parallel
+     * on distinct blocks when several threads are used.
+     *
+     * @{
+     */
+    void resetLikelihoodArraysForSites_(const Node* node, size_t siteBegin, size_t siteEnd);
+    void computeSubtreeLikelihoodPostfixForSites_(const Node* node, size_t siteBegin, size_t siteEnd);
+    void computeSubtreeLikelihoodPrefixForSites_(const Node* node, size_t siteBegin, size_t siteEnd);
+    /**
+     * @brief Compute the conditional likelihoods of a node toward its sons.
+     *
+     * Unlike computeSubtreeLikelihoodPostfixForSites_, this method is not recursive:
+     * the sons subtrees must have been computed before.
+     */
+    void computeNodeLikelihoodPostfixForSites_(const Node* node, size_t siteBegin, size_t siteEnd);
+    /**
+     * @brief Compute the conditional likelihoods of a node toward its father.
+     *
+     * Unlike computeSubtreeLikelihoodPrefixForSites_, this method is not recursive:
+     * the father node must have been computed before.
+     */
+    void computeNodeLikelihoodPrefixForSites_(const Node* node, size_t siteBegin, size_t siteEnd);
+    void computeRootLikelihoodForSites_(size_t siteBegin, size_t siteEnd);
+    /**
+     * @param node The node where to compute the likelihoods.
+     * @param likelihoodArray The output array, with at least as many elements as there are distinct sites.
+     * Only elements in [siteBegin, siteEnd) are resized and computed.
+     * @param sonNode A son node to ignore, if any.
+     * @param siteBegin The first site of the block.
+     * @param siteEnd The site after the last one of the block.
+     */
+    void computeLikelihoodAtNodeForSites_(const Node* node, VVVdouble& likelihoodArray, const Node* sonNode, size_t siteBegin, size_t siteEnd) const;
+    /**
+     * @brief Compute first or second order derivatives for a branch.
+     *
+     * @param node The node defining the branch.
+     * @param dpxy The derivatives of the transition probabilities for the branch.
+     * @param dLikelihoods The array where to store the derivatives of the likelihood, for each site.
+     * @param larray A working array, with as many elements as there are distinct sites (not used with the flat layout).
+     * @param siteBegin The first site of the block.
+     * @param siteEnd The site after the last one of the block.
+     */
+    void computeTreeDerivativeAtNodeForSites_(const Node* node, const VVVdouble& dpxy, Vdouble& dLikelihoods, VVVdouble& larray, size_t siteBegin, size_t siteEnd);
+    /**
+     * @brief Set the scaling counts of an array from the ones of the arrays it was computed from, and scale it if needed.
+     *
+     * @param iCounts The scaling counts of the input arrays.
+     * @param array The array to scale.
+     * @param oCounts The scaling counts of the array.
+     * @param siteBegin The first site of the block.
+     * @param siteEnd The site after the last one of the block.
+     */
+    void updateScalingCountsForSites_(const std::vector<const std::vector<int>*>& iCounts, VVVdouble& array, std::vector<int>& oCounts, size_t siteBegin, size_t siteEnd) const;
+    void updateScalingCountsForSites_(const std::vector<const std::vector<int>*>& iCounts, FlatLikelihoodArrayView& array, std::vector<int>& oCounts, size_t siteBegin, size_t siteEnd) const;
+    /**
+     * @brief Scale the product of the arrays of the father of a branch, used to compute derivatives.
+     *
+     * This product of scaled arrays may underflow again, and is scaled before use.
+     *
+     * @param larray The product of arrays.
+     * @param counts The number of scaling operations for each site of the block, starting at siteBegin.
+     * @param siteBegin The first site of the block.
+     * @param siteEnd The site after the last one of the block.
+     */
+    void rescaleDerivativeArrayForSites_(VVVdouble& larray, std::vector<int>& counts, size_t siteBegin, size_t siteEnd) const;
+    void rescaleDerivativeArrayForSites_(FlatLikelihoodArrayView& larray, std::vector<int>& counts, size_t siteBegin, size_t siteEnd) const;
+    /**
+     * @brief Bring the derivatives computed for a branch to the scale of the root likelihoods.
+     *
+     * @param node The node defining the branch.
+     * @param dLikelihoods The derivatives of the likelihood, for each site.
+     * @param arrayCounts The scaling counts of the product of arrays, as computed by rescaleDerivativeArrayForSites_().
+     * @param siteBegin The first site of the block.
+     * @param siteEnd The site after the last one of the block.
+     */
+    void rescaleDerivativesForSites_(const Node* node, Vdouble& dLikelihoods, const std::vector<int>& arrayCounts, size_t siteBegin, size_t siteEnd) const;
+    /** @} */
+
+    /**
+     * @name Implementation of the recursions when the flat layout is used.
+     *
+     * @{
+     */
+    void computeNodeLikelihoodPostfixFlat_(const Node* node, size_t siteBegin, size_t siteEnd);
+    void computeNodeLikelihoodPrefixFlat_(const Node* node, size_t siteBegin, size_t siteEnd);
+    void computeRootLikelihoodFlat_(size_t siteBegin, size_t siteEnd);
+    void computeLikelihoodAtNodeFlat_(const Node* node, FlatLikelihoodArrayView& likelihoodArray, const Node* sonNode, size_t siteBegin, size_t siteEnd) const;
+    void computeTreeDerivativeAtNodeFlat_(const Node* node, const VVVdouble& dpxy, Vdouble& dLikelihoods, size_t siteBegin, size_t siteEnd);
+    /** @} */
+
   friend class DRHomogeneousMixedTreeLikelihood;
 };
 
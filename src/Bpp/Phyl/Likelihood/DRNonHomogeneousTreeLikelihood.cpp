@@ -38,6 +38,7 @@
  */
 
 #include "DRNonHomogeneousTreeLikelihood.h"
+#include "LikelihoodKernels.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -179,10 +180,13 @@ double DRNonHomogeneousTreeLikelihood::getLogLikelihood() const
   Vdouble* lik = &likelihoodData_->getRootRateSiteLikelihoodArray();
   const vector<unsigned int>* w = &likelihoodData_->getWeights();
   vector<double> la(nbDistinctSites_);
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    la[i] = (*w)[i] * log((*lik)[i]);
-  }
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      for (size_t i = siteBegin; i < siteEnd; i++)
+      {
+        la[i] = (*w)[i] * log((*lik)[i]);
+      }
+    });
+  // The sum is always computed sequentially, in the same order:
   sort(la.begin(), la.end());
   for (size_t i = nbDistinctSites_; i > 0; i--)
   {
@@ -324,38 +328,40 @@ void DRNonHomogeneousTreeLikelihood::computeTreeDLikelihoodAtNode(const Node* no
   computeLikelihoodAtNode_(father, larray);
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
 
-  double dLi, dLic, dLicx, numerator, denominator;
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    VVdouble* _likelihoods_father_node_i = &(*_likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    dLi = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      Vdouble* _likelihoods_father_node_i_c = &(*_likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble*  pxy__node_c = &(*pxy__node)[c];
-      VVdouble* dpxy__node_c = &(*dpxy__node)[c];
-      dLic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      double dLi, dLic, dLicx, numerator, denominator;
+      for (size_t i = siteBegin; i < siteEnd; i++)
       {
-        numerator = 0;
-        denominator = 0;
-        Vdouble*  pxy__node_c_x = &(*pxy__node_c)[x];
-        Vdouble* dpxy__node_c_x = &(*dpxy__node_c)[x];
-        dLicx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
+        VVdouble* _likelihoods_father_node_i = &(*_likelihoods_father_node)[i];
+        VVdouble* larray_i = &larray[i];
+        dLi = 0;
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          numerator   += (*dpxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
-          denominator += (*pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+          Vdouble* _likelihoods_father_node_i_c = &(*_likelihoods_father_node_i)[c];
+          Vdouble* larray_i_c = &(*larray_i)[c];
+          VVdouble*  pxy__node_c = &(*pxy__node)[c];
+          VVdouble* dpxy__node_c = &(*dpxy__node)[c];
+          dLic = 0;
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            numerator = 0;
+            denominator = 0;
+            Vdouble*  pxy__node_c_x = &(*pxy__node_c)[x];
+            Vdouble* dpxy__node_c_x = &(*dpxy__node_c)[x];
+            dLicx = 0;
+            for (size_t y = 0; y < nbStates_; y++)
+            {
+              numerator   += (*dpxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+              denominator += (*pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+            }
+            dLicx = denominator == 0. ? 0. : (*larray_i_c)[x] * numerator / denominator;
+            dLic += dLicx;
+          }
+          dLi += rateDistribution_->getProbability(c) * dLic;
         }
-        dLicx = denominator == 0. ? 0. : (*larray_i_c)[x] * numerator / denominator;
-        dLic += dLicx;
+        (*_dLikelihoods_node)[i] = dLi / (*rootLikelihoodsSR)[i];
       }
-      dLi += rateDistribution_->getProbability(c) * dLic;
-    }
-    (*_dLikelihoods_node)[i] = dLi / (*rootLikelihoodsSR)[i];
-  }
+    });
 }
 
 /******************************************************************************/
@@ -452,39 +458,40 @@ void DRNonHomogeneousTreeLikelihood::computeTreeD2LikelihoodAtNode(const Node* n
   computeLikelihoodAtNode_(father, larray);
   Vdouble* rootLikelihoodsSR = &likelihoodData_->getRootRateSiteLikelihoodArray();
 
-  double d2Li, d2Lic, d2Licx, numerator, denominator;
-
-  for (size_t i = 0; i < nbDistinctSites_; i++)
-  {
-    VVdouble* _likelihoods_father_node_i = &(*_likelihoods_father_node)[i];
-    VVdouble* larray_i = &larray[i];
-    d2Li = 0;
-    for (size_t c = 0; c < nbClasses_; c++)
-    {
-      Vdouble* _likelihoods_father_node_i_c = &(*_likelihoods_father_node_i)[c];
-      Vdouble* larray_i_c = &(*larray_i)[c];
-      VVdouble*   pxy__node_c = &(*pxy__node)[c];
-      VVdouble* d2pxy__node_c = &(*d2pxy__node)[c];
-      d2Lic = 0;
-      for (size_t x = 0; x < nbStates_; x++)
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      double d2Li, d2Lic, d2Licx, numerator, denominator;
+      for (size_t i = siteBegin; i < siteEnd; i++)
       {
-        numerator = 0;
-        denominator = 0;
-        Vdouble*   pxy__node_c_x = &(*pxy__node_c)[x];
-        Vdouble* d2pxy__node_c_x = &(*d2pxy__node_c)[x];
-        d2Licx = 0;
-        for (size_t y = 0; y < nbStates_; y++)
+        VVdouble* _likelihoods_father_node_i = &(*_likelihoods_father_node)[i];
+        VVdouble* larray_i = &larray[i];
+        d2Li = 0;
+        for (size_t c = 0; c < nbClasses_; c++)
         {
-          numerator   += (*d2pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
-          denominator += (*pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+          Vdouble* _likelihoods_father_node_i_c = &(*_likelihoods_father_node_i)[c];
+          Vdouble* larray_i_c = &(*larray_i)[c];
+          VVdouble*   pxy__node_c = &(*pxy__node)[c];
+          VVdouble* d2pxy__node_c = &(*d2pxy__node)[c];
+          d2Lic = 0;
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            numerator = 0;
+            denominator = 0;
+            Vdouble*   pxy__node_c_x = &(*pxy__node_c)[x];
+            Vdouble* d2pxy__node_c_x = &(*d2pxy__node_c)[x];
+            d2Licx = 0;
+            for (size_t y = 0; y < nbStates_; y++)
+            {
+              numerator   += (*d2pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+              denominator += (*pxy__node_c_x)[y] * (*_likelihoods_father_node_i_c)[y];
+            }
+            d2Licx = denominator == 0. ? 0. : (*larray_i_c)[x] * numerator / denominator;
+            d2Lic += d2Licx;
+          }
+          d2Li += rateDistribution_->getProbability(c) * d2Lic;
         }
-        d2Licx = denominator == 0. ? 0. : (*larray_i_c)[x] * numerator / denominator;
-        d2Lic += d2Licx;
+        (*_d2Likelihoods_node)[i] = d2Li / (*rootLikelihoodsSR)[i];
       }
-      d2Li += rateDistribution_->getProbability(c) * d2Lic;
-    }
-    (*_d2Likelihoods_node)[i] = d2Li / (*rootLikelihoodsSR)[i];
-  }
+    });
 }
 
 /******************************************************************************/
@@ -911,7 +918,7 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPostfix(const Node*
         tProb[n] = &pxy_[sonSon->getId()];
         iLik[n] = &(*_likelihoods_son)[sonSon->getId()];
       }
-      computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_son, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+      computeLikelihoodFromArrays_(iLik, tProb, 0, 0, *_likelihoods_node_son);
     }
   }
 }
@@ -992,11 +999,11 @@ void DRNonHomogeneousTreeLikelihood::computeSubtreeLikelihoodPrefix(const Node*
       if (father->hasFather())
       {
         const Node* fatherFather = father->getFather();
-        computeLikelihoodFromArrays(iLik, tProb, &(*_likelihoods_father)[fatherFather->getId()], &pxy_[father->getId()], *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        computeLikelihoodFromArrays_(iLik, tProb, &(*_likelihoods_father)[fatherFather->getId()], &pxy_[father->getId()], *_likelihoods_node_father);
       }
       else
       {
-        computeLikelihoodFromArrays(iLik, tProb, *_likelihoods_node_father, nbSons, nbDistinctSites_, nbClasses_, nbStates_, false);
+        computeLikelihoodFromArrays_(iLik, tProb, 0, 0, *_likelihoods_node_father);
       }
     }
 
@@ -1065,7 +1072,7 @@ void DRNonHomogeneousTreeLikelihood::computeRootLikelihood()
     tProb[n] = &pxy_[son->getId()];
     iLik[n] = &(*likelihoods_root)[son->getId()];
   }
-  computeLikelihoodFromArrays(iLik, tProb, *rootLikelihoods, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+  computeLikelihoodFromArrays_(iLik, tProb, 0, 0, *rootLikelihoods);
 
   Vdouble p = rateDistribution_->getProbabilities();
   VVdouble* rootLikelihoodsS  = &likelihoodData_->getRootSiteLikelihoodArray();
@@ -1159,11 +1166,11 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodAtNode_(const Node* node,
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    computeLikelihoodFromArrays(iLik, tProb, &(*likelihoods_node)[father->getId()], &pxy_[nodeId], likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays_(iLik, tProb, &(*likelihoods_node)[father->getId()], &pxy_[nodeId], likelihoodArray);
   }
   else
   {
-    computeLikelihoodFromArrays(iLik, tProb, likelihoodArray, nbNodes, nbDistinctSites_, nbClasses_, nbStates_, false);
+    computeLikelihoodFromArrays_(iLik, tProb, 0, 0, likelihoodArray);
 
     // We have to account for the root frequencies:
     for (size_t i = 0; i < nbDistinctSites_; i++)
@@ -1196,9 +1203,12 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
   if (reset)
     resetLikelihoodArray(oLik);
 
+  size_t stride = LikelihoodKernels::getPackedStride(nbStates);
+  size_t classStride = nbStates * stride;
+  vector<double>& pxy = LikelihoodKernels::getPackingBuffer();
   for (size_t n = 0; n < nbNodes; n++)
   {
-    const VVVdouble* pxy_n = tProb[n];
+    LikelihoodKernels::packTransitionMatrices(*tProb[n], true, pxy, nbClasses, nbStates);
     const VVVdouble* iLik_n = iLik[n];
 
     for (size_t i = 0; i < nbDistinctSites; i++)
@@ -1209,22 +1219,9 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
 
       for (size_t c = 0; c < nbClasses; c++)
       {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
-        {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
-          {
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-          }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
-        }
+        // For each rate classe, we multiply the conditionnal likelihood by the product of
+        // the transition matrix and the likelihoods of the subtree:
+        LikelihoodKernels::multiply(&pxy[c * classStride], stride, &(*iLik_n_i)[c][0], &(*oLik_i)[c][0], nbStates);
       }
     }
   }
@@ -1244,72 +1241,81 @@ void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays(
   size_t nbStates,
   bool reset)
 {
-  if (reset)
-    resetLikelihoodArray(oLik);
+  computeLikelihoodFromArrays(iLik, tProb, oLik, nbNodes, nbDistinctSites, nbClasses, nbStates, reset);
 
-  for (size_t n = 0; n < nbNodes; n++)
+  // Now deal with the subtree containing the root, using the transition matrix not transposed:
+  size_t stride = LikelihoodKernels::getPackedStride(nbStates);
+  size_t classStride = nbStates * stride;
+  vector<double>& pxyR = LikelihoodKernels::getPackingBuffer();
+  LikelihoodKernels::packTransitionMatrices(*tProbR, false, pxyR, nbClasses, nbStates);
+  for (size_t i = 0; i < nbDistinctSites; i++)
   {
-    const VVVdouble* pxy_n = tProb[n];
-    const VVVdouble* iLik_n = iLik[n];
+    // For each site in the sequence,
+    const VVdouble* iLikR_i = &(*iLikR)[i];
+    VVdouble* oLik_i = &(oLik)[i];
 
-    for (size_t i = 0; i < nbDistinctSites; i++)
+    for (size_t c = 0; c < nbClasses; c++)
     {
-      // For each site in the sequence,
-      const VVdouble* iLik_n_i = &(*iLik_n)[i];
-      VVdouble* oLik_i = &(oLik)[i];
+      // For each rate classe,
+      LikelihoodKernels::multiply(&pxyR[c * classStride], stride, &(*iLikR_i)[c][0], &(*oLik_i)[c][0], nbStates);
+    }
+  }
+}
 
-      for (size_t c = 0; c < nbClasses; c++)
+/******************************************************************************/
+
+void DRNonHomogeneousTreeLikelihood::computeLikelihoodFromArrays_(
+  const vector<const VVVdouble*>& iLik,
+  const vector<const VVVdouble*>& tProb,
+  const VVVdouble* iLikR,
+  const VVVdouble* tProbR,
+  VVVdouble& oLik) const
+{
+  size_t nbNodes = iLik.size();
+  size_t stride = LikelihoodKernels::getPackedStride(nbStates_);
+  size_t classStride = nbStates_ * stride;
+  // All matrices are packed one after the other in the buffer of the calling thread,
+  // which is only read by the blocks of sites:
+  size_t matricesSize = nbClasses_ * classStride;
+  vector<double>& packed = LikelihoodKernels::getPackingBuffer();
+  packed.resize((nbNodes + 1) * matricesSize);
+  for (size_t n = 0; n < nbNodes; n++)
+  {
+    LikelihoodKernels::packTransitionMatrices(*tProb[n], true, &packed[n * matricesSize], nbClasses_, nbStates_);
+  }
+  // The subtree containing the root uses the transition matrix not transposed:
+  if (tProbR)
+    LikelihoodKernels::packTransitionMatrices(*tProbR, false, &packed[nbNodes * matricesSize], nbClasses_, nbStates_);
+  const double* pxyR = &packed[nbNodes * matricesSize];
+
+  forEachSiteBlock_(nbDistinctSites_, [&](size_t siteBegin, size_t siteEnd) {
+      for (size_t n = 0; n < nbNodes; n++)
       {
-        // For each rate classe,
-        const Vdouble* iLik_n_i_c = &(*iLik_n_i)[c];
-        Vdouble* oLik_i_c = &(*oLik_i)[c];
-        const VVdouble* pxy_n_c = &(*pxy_n)[c];
-        for (size_t x = 0; x < nbStates; x++)
+        const VVVdouble* iLik_n = iLik[n];
+        const double* pxy_n = &packed[n * matricesSize];
+        for (size_t i = siteBegin; i < siteEnd; i++)
         {
-          // For each initial state,
-          const Vdouble* pxy_n_c_x = &(*pxy_n_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates; y++)
+          const VVdouble* iLik_n_i = &(*iLik_n)[i];
+          VVdouble* oLik_i = &oLik[i];
+          for (size_t c = 0; c < nbClasses_; c++)
           {
-            // cout << "1:" << (* pxy_n_c_x)[y]  << endl;
-            // cout << "2:" << (* iLik_n_i_c)[y] << endl;
-            likelihood += (*pxy_n_c_x)[y] * (*iLik_n_i_c)[y];
-            // cout << i << "\t" << c << "\t" << x << "\t" << y << "\t" <<  (* pxy__son_c_x)[y] << "\t" << (* likelihoods_root_son_i_c)[y] << endl;
+            LikelihoodKernels::multiply(pxy_n + c * classStride, stride, &(*iLik_n_i)[c][0], &(*oLik_i)[c][0], nbStates_);
           }
-          // We store this conditionnal likelihood into the corresponding array:
-          (*oLik_i_c)[x] *= likelihood;
         }
       }
-    }
-  }
-
-  // Now deal with the subtree containing the root:
-  for (size_t i = 0; i < nbDistinctSites; i++)
-  {
-    // For each site in the sequence,
-    const VVdouble* iLikR_i = &(*iLikR)[i];
-    VVdouble* oLik_i = &(oLik)[i];
-
-    for (size_t c = 0; c < nbClasses; c++)
-    {
-      // For each rate classe,
-      const Vdouble* iLikR_i_c = &(*iLikR_i)[c];
-      Vdouble* oLik_i_c = &(*oLik_i)[c];
-      const VVdouble* pxyR_c = &(*tProbR)[c];
-      for (size_t x = 0; x < nbStates; x++)
+      if (iLikR)
       {
-        double likelihood = 0;
-        for (size_t y = 0; y < nbStates; y++)
+        for (size_t i = siteBegin; i < siteEnd; i++)
         {
-          // For each final state,
-          const Vdouble* pxyR_c_y = &(*pxyR_c)[y];
-          likelihood += (*pxyR_c_y)[x] * (*iLikR_i_c)[y];
+          const VVdouble* iLikR_i = &(*iLikR)[i];
+          VVdouble* oLik_i = &oLik[i];
+          for (size_t c = 0; c < nbClasses_; c++)
+          {
+            LikelihoodKernels::multiply(pxyR + c * classStride, stride, &(*iLikR_i)[c][0], &(*oLik_i)[c][0], nbStates_);
+          }
         }
-        // We store this conditionnal likelihood into the corresponding array:
-        (*oLik_i_c)[x] *= likelihood;
       }
-    }
-  }
+    });
 }
 
 /******************************************************************************/
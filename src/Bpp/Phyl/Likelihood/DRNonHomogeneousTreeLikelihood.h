@@ -306,6 +306,26 @@ class DRNonHomogeneousTreeLikelihood:
         size_t nbStates,
         bool reset = true);
 
+  private:
+    /**
+     * @brief Compute conditional likelihoods, in parallel over blocks of sites if several threads are used.
+     *
+     * Transition matrices are packed once, then shared by all blocks.
+     *
+     * @param iLik A vector of likelihood arrays, one for each conditional node.
+     * @param tProb A vector of transition probabilities, one for each node.
+     * @param iLikR The likelihood array for the subtree containing the root of the tree, or 0 if there is none.
+     * @param tProbR The transition probabilities for thr subtree containing the root of the tree, or 0 if there is none.
+     * @param oLik The likelihood array to store the computed likelihoods, which is not reset.
+     * @see computeLikelihoodFromArrays
+     */
+    void computeLikelihoodFromArrays_(
+        const std::vector<const VVVdouble*>& iLik,
+        const std::vector<const VVVdouble*>& tProb,
+        const VVVdouble* iLikR,
+        const VVVdouble* tProbR,
+        VVVdouble& oLik) const;
+
   friend class DRNonHomogeneousMixedTreeLikelihood;
 };
 
@@ -0,0 +1,354 @@
+//
+// File: FlatLikelihoodArray.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _FLATLIKELIHOODARRAY_H_
+#define _FLATLIKELIHOODARRAY_H_
+
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <vector>
+#include <algorithm>
+
+namespace bpp
+{
+
+/**
+ * @brief A stride-based view on a contiguous [site][class][state] likelihood block.
+ *
+ * The view does not own its memory. The state dimension is padded to a multiple of
+ * FlatLikelihoodArrayView::STATE_ALIGNMENT values, and padding values are kept to 0,
+ * so that each (site, class) vector starts on an aligned address when the block does.
+ *
+ * @see FlatLikelihoodBuffer, DRASDRTreeLikelihoodData
+ */
+class FlatLikelihoodArrayView
+{
+  public:
+    /**
+     * @brief Number of doubles the state dimension is padded to (32 bytes).
+     */
+    static const size_t STATE_ALIGNMENT = 4;
+
+  private:
+    double* data_;
+    size_t nbSites_;
+    size_t nbClasses_;
+    size_t nbStates_;
+    size_t stateStride_;
+
+  public:
+    FlatLikelihoodArrayView() :
+      data_(0), nbSites_(0), nbClasses_(0), nbStates_(0), stateStride_(0) {}
+
+    /**
+     * @param data A pointer toward the first value of the block.
+     * @param nbSites The number of sites (first dimension).
+     * @param nbClasses The number of rate classes (second dimension).
+     * @param nbStates The number of states (third dimension).
+     * @param stateStride The number of doubles between two consecutive (site, class) vectors.
+     */
+    FlatLikelihoodArrayView(double* data, size_t nbSites, size_t nbClasses, size_t nbStates, size_t stateStride) :
+      data_(data), nbSites_(nbSites), nbClasses_(nbClasses), nbStates_(nbStates), stateStride_(stateStride) {}
+
+  public:
+    /**
+     * @return The padded size of the state dimension for a given number of states.
+     * @param nbStates The number of states.
+     */
+    static size_t getStateStrideFor(size_t nbStates)
+    {
+      return ((nbStates + STATE_ALIGNMENT - 1) / STATE_ALIGNMENT) * STATE_ALIGNMENT;
+    }
+
+    double* operator()(size_t site, size_t rateClass) { return data_ + (site * nbClasses_ + rateClass) * stateStride_; }
+    const double* operator()(size_t site, size_t rateClass) const { return data_ + (site * nbClasses_ + rateClass) * stateStride_; }
+
+    double& operator()(size_t site, size_t rateClass, size_t state) { return data_[(site * nbClasses_ + rateClass) * stateStride_ + state]; }
+    const double& operator()(size_t site, size_t rateClass, size_t state) const { return data_[(site * nbClasses_ + rateClass) * stateStride_ + state]; }
+
+    double* getData() { return data_; }
+    const double* getData() const { return data_; }
+
+    size_t getNumberOfSites() const { return nbSites_; }
+    size_t getNumberOfClasses() const { return nbClasses_; }
+    size_t getNumberOfStates() const { return nbStates_; }
+    size_t getStateStride() const { return stateStride_; }
+    size_t getSiteStride() const { return nbClasses_ * stateStride_; }
+    size_t getSize() const { return nbSites_ * nbClasses_ * stateStride_; }
+
+    /**
+     * @brief Set all likelihoods to a given value, and the padding to 0.
+     *
+     * @param value The value to use.
+     */
+    void fill(double value) { fill(value, 0, nbSites_); }
+
+    /**
+     * @brief Set the likelihoods of a range of sites to a given value, and the padding to 0.
+     *
+     * @param value The value to use.
+     * @param siteBegin The first site to set.
+     * @param siteEnd The site after the last one to set.
+     */
+    void fill(double value, size_t siteBegin, size_t siteEnd)
+    {
+      for (size_t k = siteBegin * nbClasses_; k < siteEnd * nbClasses_; k++)
+      {
+        double* p = data_ + k * stateStride_;
+        std::fill(p, p + nbStates_, value);
+        std::fill(p + nbStates_, p + stateStride_, 0.);
+      }
+    }
+
+    /**
+     * @brief Copy a [site][class][state] array into this view.
+     *
+     * @param array The array to copy, with dimensions matching the ones of the view.
+     */
+    void copyFrom(const VVVdouble& array)
+    {
+      for (size_t i = 0; i < nbSites_; i++)
+      {
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          double* p = (*this)(i, c);
+          const Vdouble* array_i_c = &array[i][c];
+          for (size_t x = 0; x < nbStates_; x++)
+            p[x] = (*array_i_c)[x];
+        }
+      }
+    }
+
+    /**
+     * @brief Copy a [site][state] array into this view, for all rate classes.
+     *
+     * This is typically used for leaves.
+     *
+     * @param array The array to copy.
+     */
+    void copyFrom(const VVdouble& array) { copyFrom(array, 0, nbSites_); }
+
+    /**
+     * @brief Copy a range of sites of a [site][state] array into this view, for all rate classes.
+     *
+     * @param array The array to copy.
+     * @param siteBegin The first site to copy.
+     * @param siteEnd The site after the last one to copy.
+     */
+    void copyFrom(const VVdouble& array, size_t siteBegin, size_t siteEnd)
+    {
+      for (size_t i = siteBegin; i < siteEnd; i++)
+      {
+        const Vdouble* array_i = &array[i];
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          double* p = (*this)(i, c);
+          for (size_t x = 0; x < nbStates_; x++)
+            p[x] = (*array_i)[x];
+        }
+      }
+    }
+
+    /**
+     * @brief Copy the content of this view into a [site][class][state] array.
+     *
+     * @param array The output array, resized if needed.
+     */
+    void copyTo(VVVdouble& array) const
+    {
+      array.resize(nbSites_);
+      for (size_t i = 0; i < nbSites_; i++)
+      {
+        VVdouble* array_i = &array[i];
+        array_i->resize(nbClasses_);
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          const double* p = (*this)(i, c);
+          (*array_i)[c].assign(p, p + nbStates_);
+        }
+      }
+    }
+
+    /**
+     * @brief Copy a range of sites of this view into a [site][class][state] array.
+     *
+     * @param array The output array, which must already have the proper dimensions.
+     * @param siteBegin The first site to copy.
+     * @param siteEnd The site after the last one to copy.
+     */
+    void copyTo(VVVdouble& array, size_t siteBegin, size_t siteEnd) const
+    {
+      for (size_t i = siteBegin; i < siteEnd; i++)
+      {
+        VVdouble* array_i = &array[i];
+        for (size_t c = 0; c < nbClasses_; c++)
+        {
+          const double* p = (*this)(i, c);
+          std::copy(p, p + nbStates_, (*array_i)[c].begin());
+        }
+      }
+    }
+};
+
+/**
+ * @brief Read-only access to a [site][class][state] likelihood array, stored either as a VVVdouble or as a flat block.
+ *
+ * With both storages, the likelihoods of all states for a given site and rate class are contiguous,
+ * so they are accessed through a pointer. This allows algorithms to work with any storage layout
+ * without copying the arrays. The reference does not own its memory, and is invalidated with the array it refers to.
+ *
+ * @see DRASDRTreeLikelihoodData::getLikelihoodArrayRef()
+ */
+class ConstLikelihoodArrayRef
+{
+  private:
+    const VVVdouble* array_;
+    FlatLikelihoodArrayView flatArray_;
+
+  public:
+    ConstLikelihoodArrayRef() : array_(0), flatArray_() {}
+
+    ConstLikelihoodArrayRef(const VVVdouble& array) : array_(&array), flatArray_() {}
+
+    ConstLikelihoodArrayRef(const FlatLikelihoodArrayView& array) : array_(0), flatArray_(array) {}
+
+  public:
+    /**
+     * @return A pointer toward the likelihoods of all states for a given site and rate class.
+     * @param site The index of the site.
+     * @param rateClass The index of the rate class.
+     */
+    const double* operator()(size_t site, size_t rateClass) const
+    {
+      return array_ ? &(*array_)[site][rateClass][0] : flatArray_(site, rateClass);
+    }
+};
+
+/**
+ * @brief A contiguous, 64 bytes aligned buffer of doubles.
+ *
+ * Memory is reallocated only when the requested size increases.
+ * The alignment is preserved upon copy.
+ */
+class FlatLikelihoodBuffer
+{
+  public:
+    /**
+     * @brief Alignment of the first value, in number of doubles (64 bytes).
+     */
+    static const size_t ALIGNMENT = 8;
+
+  private:
+    std::vector<double> storage_;
+    size_t offset_;
+    size_t size_;
+
+  public:
+    FlatLikelihoodBuffer() : storage_(), offset_(0), size_(0) {}
+
+    FlatLikelihoodBuffer(const FlatLikelihoodBuffer& buffer) :
+      storage_(), offset_(0), size_(0)
+    {
+      resize(buffer.size_);
+      std::copy(buffer.getData(), buffer.getData() + buffer.size_, getData());
+    }
+
+    FlatLikelihoodBuffer& operator=(const FlatLikelihoodBuffer& buffer)
+    {
+      if (this != &buffer)
+      {
+        resize(buffer.size_);
+        std::copy(buffer.getData(), buffer.getData() + buffer.size_, getData());
+      }
+      return *this;
+    }
+
+    virtual ~FlatLikelihoodBuffer() {}
+
+  public:
+    /**
+     * @brief Set the size of the buffer.
+     *
+     * Values are not preserved if a reallocation occurs.
+     *
+     * @param size The new number of doubles.
+     */
+    void resize(size_t size)
+    {
+      if (storage_.size() < size + ALIGNMENT)
+      {
+        std::vector<double> tmp(size + ALIGNMENT);
+        storage_.swap(tmp);
+        size_t misalignment = (reinterpret_cast<size_t>(&storage_[0]) / sizeof(double)) % ALIGNMENT;
+        offset_ = (misalignment == 0 ? 0 : ALIGNMENT - misalignment);
+      }
+      size_ = size;
+    }
+
+    /**
+     * @brief Free all memory.
+     */
+    void clear()
+    {
+      std::vector<double> tmp;
+      storage_.swap(tmp);
+      offset_ = 0;
+      size_ = 0;
+    }
+
+    size_t getSize() const { return size_; }
+
+    double* getData() { return storage_.size() > 0 ? &storage_[offset_] : 0; }
+    const double* getData() const { return storage_.size() > 0 ? &storage_[offset_] : 0; }
+
+    /**
+     * @return A padded block size, so that consecutive blocks all start on an aligned address.
+     * @param size The number of doubles in the block.
+     */
+    static size_t getAlignedSize(size_t size)
+    {
+      return ((size + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+    }
+};
+
+} //end of namespace bpp.
+
+#endif //_FLATLIKELIHOODARRAY_H_
+
@@ -0,0 +1,472 @@
+//
+// File: LikelihoodKernels.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "LikelihoodKernels.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  define BPP_LIKELIHOODKERNELS_X86
+#  include <immintrin.h>
+#  define BPP_TARGET_SSE2   __attribute__((target("sse2")))
+#  define BPP_TARGET_AVX2   __attribute__((target("avx2,fma")))
+#  define BPP_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+namespace
+{
+
+/*
+ * Portable version, processing states by blocks to let the compiler vectorize the inner loop.
+ */
+inline void multiplyGeneric(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+{
+  double acc[64];
+  for (size_t x0 = 0; x0 < nbStates; x0 += 64)
+  {
+    size_t len = min(static_cast<size_t>(64), nbStates - x0);
+    for (size_t k = 0; k < len; k++)
+      acc[k] = 0;
+    for (size_t y = 0; y < nbStates; y++)
+    {
+      double v = in[y];
+      const double* row = m + y * mStride + x0;
+      for (size_t k = 0; k < len; k++)
+        acc[k] += row[k] * v;
+    }
+    for (size_t k = 0; k < len; k++)
+      out[x0 + k] *= acc[k];
+  }
+}
+
+void multiplyArrayGeneric(const double* m, size_t mStride, const double* in, double* out,
+    size_t nbSites, size_t nbClasses, size_t nbStates, size_t stateStride)
+{
+  size_t mClassStride = nbStates * mStride;
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    for (size_t c = 0; c < nbClasses; c++)
+    {
+      size_t pos = (i * nbClasses + c) * stateStride;
+      multiplyGeneric(m + c * mClassStride, mStride, in + pos, out + pos, nbStates);
+    }
+  }
+}
+
+#ifdef BPP_LIKELIHOODKERNELS_X86
+
+/*
+ * Scalar computation of the states [x0, nbStates).
+ */
+inline void multiplyTail(const double* m, size_t mStride, const double* in, double* out, size_t x0, size_t nbStates)
+{
+  for (size_t x = x0; x < nbStates; x++)
+  {
+    double l = 0;
+    for (size_t y = 0; y < nbStates; y++)
+      l += m[y * mStride + x] * in[y];
+    out[x] *= l;
+  }
+}
+
+/**************************************** SSE2 ****************************************/
+
+/*
+ * Compute 2 * K consecutive states, starting at m and out.
+ */
+template<size_t K>
+BPP_TARGET_SSE2 inline void multiplyChunkSse2(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+{
+  __m128d acc[K];
+  for (size_t k = 0; k < K; k++)
+    acc[k] = _mm_setzero_pd();
+  for (size_t y = 0; y < nbStates; y++)
+  {
+    __m128d v = _mm_set1_pd(in[y]);
+    const double* row = m + y * mStride;
+    for (size_t k = 0; k < K; k++)
+      acc[k] = _mm_add_pd(acc[k], _mm_mul_pd(_mm_loadu_pd(row + 2 * k), v));
+  }
+  for (size_t k = 0; k < K; k++)
+    _mm_storeu_pd(out + 2 * k, _mm_mul_pd(_mm_loadu_pd(out + 2 * k), acc[k]));
+}
+
+BPP_TARGET_SSE2 inline void multiplySse2Inline(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+{
+  switch (nbStates)
+  {
+  case 4:
+    multiplyChunkSse2<2>(m, mStride, in, out, 4);
+    return;
+  case 20:
+    multiplyChunkSse2<10>(m, mStride, in, out, 20);
+    return;
+  case 61:
+    multiplyChunkSse2<8>(m, mStride, in, out, 61);
+    multiplyChunkSse2<8>(m + 16, mStride, in, out + 16, 61);
+    multiplyChunkSse2<8>(m + 32, mStride, in, out + 32, 61);
+    multiplyChunkSse2<6>(m + 48, mStride, in, out + 48, 61);
+    multiplyTail(m, mStride, in, out, 60, 61);
+    return;
+  default:
+    size_t x = 0;
+    for ( ; x + 16 <= nbStates; x += 16)
+      multiplyChunkSse2<8>(m + x, mStride, in, out + x, nbStates);
+    for ( ; x + 2 <= nbStates; x += 2)
+      multiplyChunkSse2<1>(m + x, mStride, in, out + x, nbStates);
+    multiplyTail(m, mStride, in, out, x, nbStates);
+  }
+}
+
+BPP_TARGET_SSE2 void multiplySse2(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+{
+  multiplySse2Inline(m, mStride, in, out, nbStates);
+}
+
+BPP_TARGET_SSE2 void multiplyArraySse2(const double* m, size_t mStride, const double* in, double* out,
+    size_t nbSites, size_t nbClasses, size_t nbStates, size_t stateStride)
+{
+  size_t mClassStride = nbStates * mStride;
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    for (size_t c = 0; c < nbClasses; c++)
+    {
+      size_t pos = (i * nbClasses + c) * stateStride;
+      multiplySse2Inline(m + c * mClassStride, mStride, in + pos, out + pos, nbStates);
+    }
+  }
+}
+
+/**************************************** AVX2 ****************************************/
+
+/*
+ * Compute 4 * K consecutive states, starting at m and out.
+ */
+template<size_t K>
+BPP_TARGET_AVX2 inline void multiplyChunkAvx2(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+{
+  __m256d acc[K];
+  for (size_t k = 0; k < K; k++)
+    acc[k] = _mm256_setzero_pd();
+  for (size_t y = 0; y < nbStates; y++)
+  {
+    __m256d v = _mm256_broadcast_sd(in + y);
+    const double* row = m + y * mStride;
+    for (size_t k = 0; k < K; k++)
+      acc[k] = _mm256_fmadd_pd(_mm256_loadu_pd(row + 4 * k), v, acc[k]);
+  }
+  for (size_t k = 0; k < K; k++)
+    _mm256_storeu_pd(out + 4 * k, _mm256_mul_pd(_mm256_loadu_pd(out + 4 * k), acc[k]));
+}
+
+BPP_TARGET_AVX2 inline void multiplyAvx2Inline(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+{
+  switch (nbStates)
+  {
+  case 4:
+    multiplyChunkAvx2<1>(m, mStride, in, out, 4);
+    return;
+  case 20:
+    multiplyChunkAvx2<5>(m, mStride, in, out, 20);
+    return;
+  case 61:
+    multiplyChunkAvx2<4>(m, mStride, in, out, 61);
+    multiplyChunkAvx2<4>(m + 16, mStride, in, out + 16, 61);
+    multiplyChunkAvx2<4>(m + 32, mStride, in, out + 32, 61);
+    multiplyChunkAvx2<3>(m + 48, mStride, in, out + 48, 61);
+    multiplyTail(m, mStride, in, out, 60, 61);
+    return;
+  default:
+    size_t x = 0;
+    for ( ; x + 16 <= nbStates; x += 16)
+      multiplyChunkAvx2<4>(m + x, mStride, in, out + x, nbStates);
+    for ( ; x + 4 <= nbStates; x += 4)
+      multiplyChunkAvx2<1>(m + x, mStride, in, out + x, nbStates);
+    multiplyTail(m, mStride, in, out, x, nbStates);
+  }
+}
+
+BPP_TARGET_AVX2 void multiplyAvx2(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+{
+  multiplyAvx2Inline(m, mStride, in, out, nbStates);
+}
+
+BPP_TARGET_AVX2 void multiplyArrayAvx2(const double* m, size_t mStride, const double* in, double* out,
+    size_t nbSites, size_t nbClasses, size_t nbStates, size_t stateStride)
+{
+  size_t mClassStride = nbStates * mStride;
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    for (size_t c = 0; c < nbClasses; c++)
+    {
+      size_t pos = (i * nbClasses + c) * stateStride;
+      multiplyAvx2Inline(m + c * mClassStride, mStride, in + pos, out + pos, nbStates);
+    }
+  }
+}
+
+/*************************************** AVX-512 **************************************/
+
+/*
+ * Compute up to 8 * K consecutive states, starting at m and out.
+ * Only the states selected by 'lastMask' are computed in the last vector.
+ * Packed matrices are padded to a multiple of 8, so that rows can always be read entirely.
+ */
+template<size_t K>
+BPP_TARGET_AVX512 inline void multiplyChunkAvx512(const double* m, size_t mStride, const double* in, double* out, size_t nbStates, __mmask8 lastMask)
+{
+  __m512d acc[K];
+  for (size_t k = 0; k < K; k++)
+    acc[k] = _mm512_setzero_pd();
+  for (size_t y = 0; y < nbStates; y++)
+  {
+    __m512d v = _mm512_set1_pd(in[y]);
+    const double* row = m + y * mStride;
+    for (size_t k = 0; k < K; k++)
+      acc[k] = _mm512_fmadd_pd(_mm512_loadu_pd(row + 8 * k), v, acc[k]);
+  }
+  for (size_t k = 0; k + 1 < K; k++)
+    _mm512_storeu_pd(out + 8 * k, _mm512_mul_pd(_mm512_loadu_pd(out + 8 * k), acc[k]));
+  double* last = out + 8 * (K - 1);
+  _mm512_mask_storeu_pd(last, lastMask, _mm512_mul_pd(_mm512_maskz_loadu_pd(lastMask, last), acc[K - 1]));
+}
+
+BPP_TARGET_AVX512 inline void multiplyAvx512Inline(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+{
+  switch (nbStates)
+  {
+  case 4:
+    multiplyChunkAvx2<1>(m, mStride, in, out, 4);
+    return;
+  case 20:
+    multiplyChunkAvx512<3>(m, mStride, in, out, 20, 0x0F);
+    return;
+  case 61:
+    multiplyChunkAvx512<4>(m, mStride, in, out, 61, 0xFF);
+    multiplyChunkAvx512<4>(m + 32, mStride, in, out + 32, 61, 0x1F);
+    return;
+  default:
+    size_t x = 0;
+    for ( ; x + 32 <= nbStates; x += 32)
+      multiplyChunkAvx512<4>(m + x, mStride, in, out + x, nbStates, 0xFF);
+    size_t r = nbStates - x;
+    if (r == 0)
+      return;
+    __mmask8 mask = static_cast<__mmask8>(r % 8 == 0 ? 0xFF : (1 << (r % 8)) - 1);
+    switch ((r + 7) / 8)
+    {
+    case 1: multiplyChunkAvx512<1>(m + x, mStride, in, out + x, nbStates, mask); break;
+    case 2: multiplyChunkAvx512<2>(m + x, mStride, in, out + x, nbStates, mask); break;
+    case 3: multiplyChunkAvx512<3>(m + x, mStride, in, out + x, nbStates, mask); break;
+    default: multiplyChunkAvx512<4>(m + x, mStride, in, out + x, nbStates, mask);
+    }
+  }
+}
+
+BPP_TARGET_AVX512 void multiplyAvx512(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+{
+  multiplyAvx512Inline(m, mStride, in, out, nbStates);
+}
+
+BPP_TARGET_AVX512 void multiplyArrayAvx512(const double* m, size_t mStride, const double* in, double* out,
+    size_t nbSites, size_t nbClasses, size_t nbStates, size_t stateStride)
+{
+  size_t mClassStride = nbStates * mStride;
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    for (size_t c = 0; c < nbClasses; c++)
+    {
+      size_t pos = (i * nbClasses + c) * stateStride;
+      multiplyAvx512Inline(m + c * mClassStride, mStride, in + pos, out + pos, nbStates);
+    }
+  }
+}
+
+#endif //BPP_LIKELIHOODKERNELS_X86
+
+} // end of anonymous namespace.
+
+/******************************************************************************/
+
+LikelihoodKernels::InstructionSet LikelihoodKernels::getBestInstructionSet()
+{
+#ifdef BPP_LIKELIHOODKERNELS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return SSE2;
+#endif
+  return GENERIC;
+}
+
+/******************************************************************************/
+
+LikelihoodKernels::Kernels_ LikelihoodKernels::createKernels_(InstructionSet instructionSet)
+{
+  Kernels_ kernels;
+  kernels.instructionSet = instructionSet;
+  switch (instructionSet)
+  {
+#ifdef BPP_LIKELIHOODKERNELS_X86
+  case AVX512:
+    kernels.multiply      = &multiplyAvx512;
+    kernels.multiplyArray = &multiplyArrayAvx512;
+    break;
+  case AVX2:
+    kernels.multiply      = &multiplyAvx2;
+    kernels.multiplyArray = &multiplyArrayAvx2;
+    break;
+  case SSE2:
+    kernels.multiply      = &multiplySse2;
+    kernels.multiplyArray = &multiplyArraySse2;
+    break;
+#endif
+  default:
+    kernels.instructionSet = GENERIC;
+    kernels.multiply       = &multiplyGeneric;
+    kernels.multiplyArray  = &multiplyArrayGeneric;
+  }
+  return kernels;
+}
+
+/******************************************************************************/
+
+const LikelihoodKernels::Kernels_* LikelihoodKernels::getKernelsFor_(InstructionSet instructionSet)
+{
+  // Immutable, and initialized only once:
+  static const Kernels_ kernels[] = {
+    createKernels_(GENERIC),
+    createKernels_(SSE2),
+    createKernels_(AVX2),
+    createKernels_(AVX512)
+  };
+  return &kernels[instructionSet];
+}
+
+/******************************************************************************/
+
+atomic<const LikelihoodKernels::Kernels_*>& LikelihoodKernels::getCurrentKernels_()
+{
+  static atomic<const Kernels_*> kernels(getKernelsFor_(getBestInstructionSet()));
+  return kernels;
+}
+
+/******************************************************************************/
+
+LikelihoodKernels::InstructionSet LikelihoodKernels::getInstructionSet()
+{
+  return getKernels_()->instructionSet;
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::setInstructionSet(InstructionSet instructionSet) throw (Exception)
+{
+  if (instructionSet > getBestInstructionSet())
+    throw Exception("LikelihoodKernels::setInstructionSet. Instruction set " + getInstructionSetName(instructionSet) + " is not supported.");
+  getCurrentKernels_().store(getKernelsFor_(instructionSet), memory_order_release);
+}
+
+/******************************************************************************/
+
+string LikelihoodKernels::getInstructionSetName(InstructionSet instructionSet)
+{
+  switch (instructionSet)
+  {
+  case AVX512: return "AVX-512";
+  case AVX2:   return "AVX2";
+  case SSE2:   return "SSE2";
+  default:     return "generic";
+  }
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::packTransitionMatrices(const VVVdouble& pxy, bool transpose, vector<double>& packed, size_t nbClasses, size_t nbStates)
+{
+  packed.resize(nbClasses * nbStates * getPackedStride(nbStates));
+  if (packed.size() > 0)
+    packTransitionMatrices(pxy, transpose, &packed[0], nbClasses, nbStates);
+}
+
+/******************************************************************************/
+
+void LikelihoodKernels::packTransitionMatrices(const VVVdouble& pxy, bool transpose, double* packed, size_t nbClasses, size_t nbStates)
+{
+  size_t stride = getPackedStride(nbStates);
+  // Only padding values have to be set to 0, all others are overwritten:
+  for (size_t c = 0; c < nbClasses; c++)
+  {
+    const VVdouble* pxy_c = &pxy[c];
+    double* packed_c = packed + c * nbStates * stride;
+    for (size_t y = 0; y < nbStates; y++)
+    {
+      for (size_t x = nbStates; x < stride; x++)
+        packed_c[y * stride + x] = 0.;
+    }
+    for (size_t x = 0; x < nbStates; x++)
+    {
+      const Vdouble* pxy_c_x = &(*pxy_c)[x];
+      for (size_t y = 0; y < nbStates; y++)
+      {
+        if (transpose)
+          packed_c[y * stride + x] = (*pxy_c_x)[y];
+        else
+          packed_c[x * stride + y] = (*pxy_c_x)[y];
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+vector<double>& LikelihoodKernels::getPackingBuffer()
+{
+  thread_local vector<double> buffer;
+  return buffer;
+}
+
+/******************************************************************************/
+
@@ -0,0 +1,202 @@
+//
+// File: LikelihoodKernels.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _LIKELIHOODKERNELS_H_
+#define _LIKELIHOODKERNELS_H_
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <vector>
+#include <string>
+#include <atomic>
+
+namespace bpp
+{
+
+/**
+ * @brief Vectorized kernels for conditional likelihood computations.
+ *
+ * The core operation of the double-recursive likelihood classes is, for each site and rate class,
+ * @f[ L_{out}(x) \leftarrow L_{out}(x) \times \sum_y M(y, x) \times L_{in}(y), @f]
+ * where @f$M@f$ is a transition probability matrix, possibly transposed.
+ * This class provides implementations of this product using SSE2, AVX2 or AVX-512 instructions,
+ * selected at run time according to the capacities of the processor.
+ * Specialized versions are used for 4, 20 and 61 states; other alphabet sizes use a generic version.
+ * On non-x86 platforms, or with compilers not supporting function multiversioning,
+ * a portable scalar implementation is used.
+ *
+ * Matrices have to be packed first using packTransitionMatrices().
+ * Packed rows are padded with zeros to a multiple of 8 values, so that kernels can read whole vectors.
+ * Likelihood vectors do not need to be padded nor aligned.
+ */
+class LikelihoodKernels
+{
+  public:
+    enum InstructionSet { GENERIC = 0, SSE2 = 1, AVX2 = 2, AVX512 = 3 };
+
+  public:
+    /**
+     * @return The instruction set currently used by the kernels.
+     */
+    static InstructionSet getInstructionSet();
+
+    /**
+     * @return The most efficient instruction set supported by this processor.
+     */
+    static InstructionSet getBestInstructionSet();
+
+    /**
+     * @brief Set the instruction set to use (mostly for testing and benchmarking purpose).
+     *
+     * The kernels in use are switched atomically, so that this function can be called while
+     * other threads compute likelihoods. Computations already running may however still use
+     * the previous instruction set.
+     *
+     * @param instructionSet The instruction set to use.
+     * @throw Exception If the instruction set is not supported by this processor.
+     */
+    static void setInstructionSet(InstructionSet instructionSet) throw (Exception);
+
+    /**
+     * @return The name of an instruction set.
+     * @param instructionSet The instruction set.
+     */
+    static std::string getInstructionSetName(InstructionSet instructionSet);
+
+    /**
+     * @return The number of values between two rows of a packed matrix.
+     * @param nbStates The number of states.
+     */
+    static size_t getPackedStride(size_t nbStates) { return ((nbStates + 7) / 8) * 8; }
+
+    /**
+     * @brief Pack transition matrices for all rate classes.
+     *
+     * The packed array is ordered as [c][y][x], each row being padded to getPackedStride(nbStates) values.
+     *
+     * @param pxy The transition probabilities, as a [c][x][y] array.
+     * @param transpose If true, packed[c][y][x] = pxy[c][x][y], which corresponds to the
+     * conditional likelihood of a son node. Otherwise packed[c][y][x] = pxy[c][y][x], which
+     * corresponds to the subtree containing the root.
+     * @param packed The output array, resized if needed. Its memory is only reallocated when it grows,
+     * so that the same array should be reused from one call to the other (see getPackingBuffer()).
+     * @param nbClasses The number of rate classes.
+     * @param nbStates The number of states.
+     */
+    static void packTransitionMatrices(const VVVdouble& pxy, bool transpose, std::vector<double>& packed, size_t nbClasses, size_t nbStates);
+
+    /**
+     * @brief Pack transition matrices for all rate classes into an existing array.
+     *
+     * @param pxy The transition probabilities, as a [c][x][y] array.
+     * @param transpose See the other version.
+     * @param packed The output array, of size at least nbClasses * nbStates * getPackedStride(nbStates).
+     * @param nbClasses The number of rate classes.
+     * @param nbStates The number of states.
+     */
+    static void packTransitionMatrices(const VVVdouble& pxy, bool transpose, double* packed, size_t nbClasses, size_t nbStates);
+
+    /**
+     * @return A scratch array for packed matrices, private to the calling thread.
+     *
+     * The array is kept from one call to the other, so that the static likelihood functions,
+     * which may run concurrently on blocks of sites, do not allocate memory each time they pack
+     * matrices. Its content is only valid until the next function using it is called.
+     */
+    static std::vector<double>& getPackingBuffer();
+
+    /**
+     * @brief Compute out[x] *= sum_y m[y * mStride + x] * in[y], for one site and rate class.
+     *
+     * @param m The packed matrix for the rate class.
+     * @param mStride The stride of the packed matrix.
+     * @param in The input conditional likelihoods.
+     * @param out The output conditional likelihoods.
+     * @param nbStates The number of states.
+     */
+    static void multiply(const double* m, size_t mStride, const double* in, double* out, size_t nbStates)
+    {
+      getKernels_()->multiply(m, mStride, in, out, nbStates);
+    }
+
+    /**
+     * @brief Apply multiply() to all sites and rate classes of a flat [site][class][state] array.
+     *
+     * @param m The packed matrices for all rate classes.
+     * @param mStride The stride of the packed matrices.
+     * @param in The input conditional likelihoods.
+     * @param out The output conditional likelihoods.
+     * @param nbSites The number of sites.
+     * @param nbClasses The number of rate classes.
+     * @param nbStates The number of states.
+     * @param stateStride The number of values between two consecutive (site, class) vectors in 'in' and 'out'.
+     */
+    static void multiplyArray(const double* m, size_t mStride, const double* in, double* out,
+        size_t nbSites, size_t nbClasses, size_t nbStates, size_t stateStride)
+    {
+      getKernels_()->multiplyArray(m, mStride, in, out, nbSites, nbClasses, nbStates, stateStride);
+    }
+
+  private:
+    typedef void (*MultiplyFunction)(const double*, size_t, const double*, double*, size_t);
+    typedef void (*MultiplyArrayFunction)(const double*, size_t, const double*, double*, size_t, size_t, size_t, size_t);
+
+    struct Kernels_
+    {
+      InstructionSet instructionSet;
+      MultiplyFunction multiply;
+      MultiplyArrayFunction multiplyArray;
+    };
+
+    /**
+     * @return The kernels currently in use.
+     */
+    static const Kernels_* getKernels_() { return getCurrentKernels_().load(std::memory_order_acquire); }
+
+    static std::atomic<const Kernels_*>& getCurrentKernels_();
+    static const Kernels_* getKernelsFor_(InstructionSet instructionSet);
+    static Kernels_ createKernels_(InstructionSet instructionSet);
+};
+
+} //end of namespace bpp.
+
+#endif //_LIKELIHOODKERNELS_H_
+
@@ -67,17 +67,20 @@ vector<size_t> MarginalAncestralStateReconstruction::getAncestralStatesForNode(i
     VVVdouble larray;
 
     likelihood_->computeLikelihoodAtNode(nodeId, larray);
+    const DRASDRTreeLikelihoodData* data = likelihood_->getLikelihoodData();
     for (size_t i = 0; i < nbDistinctSites_; i++)
     {
       VVdouble* larray_i = &larray[i];
       Vdouble* probs_i = &probs[i];
       probs_i->resize(nbStates_);
+      // Arrays may be scaled differently at this node and at the root:
+      double scale = AbstractDiscreteRatesAcrossSitesTreeLikelihood::getScalingFactor(data->getRootScalingCounts()[i] - data->getScalingCountAtNode(nodeId, i));
       for (size_t c = 0; c < nbClasses_; c++)
       {
         Vdouble* larray_i_c = &(*larray_i)[c];
         for (size_t x = 0; x < nbStates_; x++)
         {
-          (*probs_i)[x] += (*larray_i_c)[x] * r_[c] / l_[i];
+          (*probs_i)[x] += (*larray_i_c)[x] * r_[c] / l_[i] * scale;
         }
       }
       if (sample)
@@ -38,6 +38,7 @@
  */
 
 #include "NNIHomogeneousTreeLikelihood.h"
+#include "../Model/AbstractSubstitutionModel.h"
 
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/App/ApplicationTools.h>
@@ -77,7 +78,7 @@ void BranchLikelihood::computeAllTransitionProbabilities()
   for (size_t c = 0; c < nbClasses_; c++)
   {
     VVdouble* pxy__c = &pxy_[c];
-    RowMatrix<double> Q = model_->getPij_t(l * rDist_->getCategory(c));
+    const Matrix<double>& Q = model_->getPij_t(l * rDist_->getCategory(c));
     for (size_t x = 0; x < nbStates_; x++)
     {
       Vdouble* pxy__c_x = &(*pxy__c)[x];
@@ -94,28 +95,32 @@ void BranchLikelihood::computeLogLikelihood()
 {
   lnL_ = 0;
 
-  vector<double> la(array1_->size());
-  for (size_t i = 0; i < array1_->size(); i++)
+  size_t nbSites = array1_ ? array1_->size() : flatArray1_.getNumberOfSites();
+  la_.resize(nbSites);
+  for (size_t i = 0; i < nbSites; i++)
   {
     double Li = 0;
     for (size_t c = 0; c < nbClasses_; c++)
     {
       double rc = rDist_->getProbability(c);
+      const double* array1_i_c = array1_ ? &(*array1_)[i][c][0] : flatArray1_(i, c);
+      const double* array2_i_c = array2_ ? &(*array2_)[i][c][0] : flatArray2_(i, c);
       for (size_t x = 0; x < nbStates_; x++)
       {
+        const Vdouble* pxy_c_x = &pxy_[c][x];
         for (size_t y = 0; y < nbStates_; y++)
         {
-          Li += rc * (*array1_)[i][c][x] * pxy_[c][x][y] * (*array2_)[i][c][y];
+          Li += rc * array1_i_c[x] * (*pxy_c_x)[y] * array2_i_c[y];
         }
       }
     }
-    la[i] = weights_[i] * log(Li);
+    la_[i] = weights_[i] * log(Li);
   }
 
-  sort(la.begin(), la.end());
-  for (size_t i = array1_->size(); i > 0; i--)
+  sort(la_.begin(), la_.end());
+  for (size_t i = nbSites; i > 0; i--)
   {
-    lnL_ -= la[i - 1];
+    lnL_ -= la_[i - 1];
   }
 }
 
@@ -132,13 +137,19 @@ throw (Exception) :
   brLikFunction_(0),
   brentOptimizer_(0),
   brLenNNIValues_(),
-  brLenNNIParams_()
+  brLenNNIParams_(),
+  nniContext_(),
+  nniContexts_(),
+  nniWorkspace_(),
+  nniBlocks_(),
+  nniBranchIndex_()
 {
   brentOptimizer_ = new BrentOneDimension();
   brentOptimizer_->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
   brentOptimizer_->setProfiler(0);
   brentOptimizer_->setMessageHandler(0);
   brentOptimizer_->setVerbose(0);
+  initBranchIndex_();
 }
 
 /******************************************************************************/
@@ -155,13 +166,19 @@ throw (Exception) :
   brLikFunction_(0),
   brentOptimizer_(0),
   brLenNNIValues_(),
-  brLenNNIParams_()
+  brLenNNIParams_(),
+  nniContext_(),
+  nniContexts_(),
+  nniWorkspace_(),
+  nniBlocks_(),
+  nniBranchIndex_()
 {
   brentOptimizer_ = new BrentOneDimension();
   brentOptimizer_->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
   brentOptimizer_->setProfiler(0);
   brentOptimizer_->setMessageHandler(0);
   brentOptimizer_->setVerbose(0);
+  initBranchIndex_();
   // We have to do this since the DRHomogeneousTreeLikelihood constructor will not call the overloaded setData method:
   brLikFunction_ = new BranchLikelihood(getLikelihoodData()->getWeights());
 }
@@ -173,12 +190,18 @@ NNIHomogeneousTreeLikelihood::NNIHomogeneousTreeLikelihood(const NNIHomogeneousT
   brLikFunction_(0),
   brentOptimizer_(0),
   brLenNNIValues_(),
-  brLenNNIParams_()
+  brLenNNIParams_(),
+  nniContext_(),
+  nniContexts_(),
+  nniWorkspace_(),
+  nniBlocks_(),
+  nniBranchIndex_()
 {
   brLikFunction_  = dynamic_cast<BranchLikelihood*>(lik.brLikFunction_->clone());
   brentOptimizer_ = dynamic_cast<BrentOneDimension*>(lik.brentOptimizer_->clone());
   brLenNNIValues_ = lik.brLenNNIValues_;
   brLenNNIParams_ = lik.brLenNNIParams_;
+  initBranchIndex_();
 }
 
 /******************************************************************************/
@@ -192,6 +215,8 @@ NNIHomogeneousTreeLikelihood& NNIHomogeneousTreeLikelihood::operator=(const NNIH
   brentOptimizer_ = dynamic_cast<BrentOneDimension*>(lik.brentOptimizer_->clone());
   brLenNNIValues_ = lik.brLenNNIValues_;
   brLenNNIParams_ = lik.brLenNNIParams_;
+  nniBlocks_.clear();
+  initBranchIndex_();
   return *this;
 }
 
@@ -204,7 +229,79 @@ NNIHomogeneousTreeLikelihood::~NNIHomogeneousTreeLikelihood()
 }
 
 /******************************************************************************/
+void NNIHomogeneousTreeLikelihood::initBranchIndex_()
+{
+  int maxId = 0;
+  for (size_t i = 0; i < nodes_.size(); i++)
+    maxId = max(maxId, nodes_[i]->getId());
+  nniBranchIndex_.assign(static_cast<size_t>(maxId) + 1, nodes_.size());
+  for (size_t i = 0; i < nodes_.size(); i++)
+  {
+    if (nodes_[i]->getId() >= 0)
+      nniBranchIndex_[static_cast<size_t>(nodes_[i]->getId())] = i;
+  }
+}
+
+/*******************************************************************************/
 double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const throw (NodeException)
+{
+  initNNIContext_(nodeId, nniContext_);
+  double brLen;
+  double diff = evaluateNNI_(nniContext_, model_, rateDistribution_, *brLikFunction_, *brentOptimizer_, nniWorkspace_, brLen);
+  brLenNNIValues_[nodeId] = brLen;
+  return diff;
+}
+
+/*******************************************************************************/
+void NNIHomogeneousTreeLikelihood::testNNIs(const vector<int>& nodeIds, vector<double>& diffs) const throw (NodeException)
+{
+  size_t nbNNIs = nodeIds.size();
+  diffs.resize(nbNNIs);
+  if (!threadPool_.get() || nbNNIs < 2)
+  {
+    for (size_t i = 0; i < nbNNIs; i++)
+      diffs[i] = testNNI(nodeIds[i]);
+    return;
+  }
+
+  // Data are gathered sequentially, as the likelihood data object may be updated on access:
+  if (nniContexts_.size() < nbNNIs)
+    nniContexts_.resize(nbNNIs);
+  for (size_t i = 0; i < nbNNIs; i++)
+    initNNIContext_(nodeIds[i], nniContexts_[i]);
+
+  // NNIs are then evaluated by blocks, each one with its own function, optimizer, scratch arrays and model,
+  // since computing transition probabilities modifies the model.
+  // Blocks are created once, and their model is copied again whenever the model changed since the last call,
+  // so that its whole state (parameters, frequencies, scale...) is kept in sync.
+  // Models which do not provide a version are copied at each call:
+  size_t nbBlocks = min(nbNNIs, threadPool_->getNumberOfThreads());
+  size_t blockSize = (nbNNIs + nbBlocks - 1) / nbBlocks;
+  nbBlocks = (nbNNIs + blockSize - 1) / blockSize;
+  const AbstractSubstitutionModel* versionedModel = dynamic_cast<const AbstractSubstitutionModel*>(model_);
+  unsigned int modelVersion = versionedModel ? versionedModel->getModelVersion() : 0;
+  for (size_t b = 0; b < nbBlocks; b++)
+  {
+    if (b == nniBlocks_.size())
+      nniBlocks_.push_back(unique_ptr<NNIBlock>(new NNIBlock(*model_, getLikelihoodData()->getWeights())));
+    else if (!versionedModel || nniBlocks_[b]->modelVersion != modelVersion)
+      nniBlocks_[b]->model.reset(model_->clone());
+    nniBlocks_[b]->modelVersion = modelVersion;
+  }
+
+  vector<double> brLens(nbNNIs);
+  threadPool_->parallelForBlocks(nbNNIs, blockSize, [&](size_t begin, size_t end) {
+    NNIBlock* block = nniBlocks_[begin / blockSize].get();
+    for (size_t i = begin; i < end; i++)
+      diffs[i] = evaluateNNI_(nniContexts_[i], block->model.get(), rateDistribution_, *block->brLik, block->optimizer, block->workspace, brLens[i]);
+  });
+
+  for (size_t i = 0; i < nbNNIs; i++)
+    brLenNNIValues_[nodeIds[i]] = brLens[i];
+}
+
+/*******************************************************************************/
+void NNIHomogeneousTreeLikelihood::initNNIContext_(int nodeId, NNIContext& context) const throw (NodeException)
 {
   const Node* son    = tree_->getNode(nodeId);
   if (!son->hasFather()) throw NodePException("DRHomogeneousTreeLikelihood::testNNI(). Node 'son' must not be the root node.", son);
@@ -218,96 +315,217 @@ double NNIHomogeneousTreeLikelihood::testNNI(int nodeId) const throw (NodeExcept
   // const Node * uncle = grandFather->getSon(parentPosition > 1 ? parentPosition - 1 : 1 - parentPosition);
   const Node* uncle = grandFather->getSon(parentPosition > 1 ? 0 : 1 - parentPosition);
 
-  // Retrieving arrays of interest:
-  const DRASDRTreeLikelihoodNodeData* parentData = &getLikelihoodData()->getNodeData(parent->getId());
-  const VVVdouble* sonArray   = &parentData->getLikelihoodArrayForNeighbor(son->getId());
-  vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
-  size_t nbParentNeighbors = parentNeighbors.size();
-  vector<const VVVdouble*> parentArrays(nbParentNeighbors);
-  vector<const VVVdouble*> parentTProbs(nbParentNeighbors);
-  for (size_t k = 0; k < nbParentNeighbors; k++)
+  context.nodeId = nodeId;
+  context.grandFatherArrays.clear();
+  context.grandFatherFlatArrays.clear();
+  context.grandFatherTProbs.clear();
+  context.parentArrays.clear();
+  context.parentFlatArrays.clear();
+  context.parentTProbs.clear();
+  context.scalingCounts.clear();
+
+  // Retrieving arrays of interest.
+  // Neighbors are enumerated in place, in the same order as TreeTemplateTools::getRemainingNeighbors,
+  // so that no temporary vector is needed. The father of the parent node is the grand father.
+  // With the flat layout, views on the flat buffer are used directly.
+  const DRASDRTreeLikelihoodData* likelihoodData = getLikelihoodData();
+  bool flat = likelihoodData->usesFlatArrays();
+  bool scaling = usesLikelihoodScaling();
+
+  // Array 2 (parent array) is computed from the uncle array and the other neighbors of the parent:
+  for (size_t k = 0; k < parent->getNumberOfSons(); k++)
   {
-    const Node* n = parentNeighbors[k]; // This neighbor
-    parentArrays[k] = &parentData->getLikelihoodArrayForNeighbor(n->getId());
-    // if(n != grandFather) parentTProbs[k] = & pxy_[n->getId()];
-    // else                 parentTProbs[k] = & pxy_[parent->getId()];
-    parentTProbs[k] = &pxy_[n->getId()];
+    const Node* n = parent->getSon(k); // This neighbor
+    if (n == son) continue;
+    if (flat) context.parentFlatArrays.push_back(likelihoodData->getFlatLikelihoodArray(parent->getId(), n->getId()));
+    else      context.parentArrays.push_back(&likelihoodData->getLikelihoodArray(parent->getId(), n->getId()));
+    context.parentTProbs.push_back(&pxy_[n->getId()]);
   }
+  if (flat) context.parentFlatArrays.push_back(likelihoodData->getFlatLikelihoodArray(grandFather->getId(), uncle->getId()));
+  else      context.parentArrays.push_back(&likelihoodData->getLikelihoodArray(grandFather->getId(), uncle->getId()));
+  context.parentTProbs.push_back(&pxy_[uncle->getId()]);
 
-  const DRASDRTreeLikelihoodNodeData* grandFatherData = &getLikelihoodData()->getNodeData(grandFather->getId());
-  const VVVdouble* uncleArray      = &grandFatherData->getLikelihoodArrayForNeighbor(uncle->getId());
-  vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
-  size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
-  vector<const VVVdouble*> grandFatherArrays;
-  vector<const VVVdouble*> grandFatherTProbs;
-  for (size_t k = 0; k < nbGrandFatherNeighbors; k++)
+  // Array 1 (grand father array) is computed from the son array and the other neighbors of the grand father:
+  for (size_t k = 0; k < grandFather->getNumberOfSons(); k++)
   {
-    const Node* n = grandFatherNeighbors[k]; // This neighbor
-    if (grandFather->getFather() == NULL || n != grandFather->getFather())
+    const Node* n = grandFather->getSon(k); // This neighbor
+    if (n == parent || n == uncle) continue;
+    if (flat) context.grandFatherFlatArrays.push_back(likelihoodData->getFlatLikelihoodArray(grandFather->getId(), n->getId()));
+    else      context.grandFatherArrays.push_back(&likelihoodData->getLikelihoodArray(grandFather->getId(), n->getId()));
+    context.grandFatherTProbs.push_back(&pxy_[n->getId()]);
+    if (scaling) context.scalingCounts.push_back(&likelihoodData->getScalingCounts(grandFather->getId(), n->getId()));
+  }
+  if (flat) context.grandFatherFlatArrays.push_back(likelihoodData->getFlatLikelihoodArray(parent->getId(), son->getId()));
+  else      context.grandFatherArrays.push_back(&likelihoodData->getLikelihoodArray(parent->getId(), son->getId()));
+  context.grandFatherTProbs.push_back(&pxy_[son->getId()]);
+  if (grandFather->hasFather())
+  {
+    const Node* n = grandFather->getFather();
+    if (flat) context.grandFatherFatherFlatArray = likelihoodData->getFlatLikelihoodArray(grandFather->getId(), n->getId());
+    else      context.grandFatherFatherArray = &likelihoodData->getLikelihoodArray(grandFather->getId(), n->getId());
+    context.grandFatherTProb = &pxy_[grandFather->getId()];
+    if (scaling) context.scalingCounts.push_back(&likelihoodData->getScalingCounts(grandFather->getId(), n->getId()));
+  }
+  else
+  {
+    context.grandFatherFatherArray = 0;
+    context.grandFatherTProb = 0;
+  }
+
+  // If likelihood arrays are scaled, the scaling counts of all arrays combined will be summed:
+  if (scaling)
+  {
+    context.scalingCounts.push_back(&likelihoodData->getScalingCounts(parent->getId(), son->getId()));
+    for (size_t k = 0; k < parent->getNumberOfSons(); k++)
     {
-      grandFatherArrays.push_back(&grandFatherData->getLikelihoodArrayForNeighbor(n->getId()));
-      grandFatherTProbs.push_back(&pxy_[n->getId()]);
+      const Node* n = parent->getSon(k);
+      if (n == son) continue;
+      context.scalingCounts.push_back(&likelihoodData->getScalingCounts(parent->getId(), n->getId()));
     }
+    context.scalingCounts.push_back(&likelihoodData->getScalingCounts(grandFather->getId(), uncle->getId()));
   }
 
-  // Compute array 1: grand father array
-  VVVdouble array1 = *sonArray;
-  resetLikelihoodArray(array1);
-  grandFatherArrays.push_back(sonArray);
-  grandFatherTProbs.push_back(&pxy_[son->getId()]);
-  if (grandFather->hasFather())
+  // The branch length of the parent node is kept up to date with the corresponding parameter (see applyParameters()):
+  context.brLen = parent->getDistanceToFather();
+}
+
+/*******************************************************************************/
+double NNIHomogeneousTreeLikelihood::evaluateNNI_(
+  const NNIContext& context,
+  const SubstitutionModel* model,
+  const DiscreteDistribution* rDist,
+  BranchLikelihood& brLik,
+  BrentOneDimension& optimizer,
+  NNIWorkspace& workspace,
+  double& brLen) const
+{
+  bool grandFatherIsRoot = (context.grandFatherTProb == 0);
+  // Both arrays are products of scaled arrays, which may underflow again, and are scaled too:
+  bool scaling = (context.scalingCounts.size() > 0);
+  if (scaling)
+    workspace.scalingCounts.resize(nbDistinctSites_);
+  if (context.parentFlatArrays.size() > 0)
   {
-    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, &grandFatherData->getLikelihoodArrayForNeighbor(grandFather->getFather()->getId()), &pxy_[grandFather->getId()], array1, nbGrandFatherNeighbors, nbDistinctSites_, nbClasses_, nbStates_, false);
+    // Flat layout: both arrays are stored in the scratch flat buffer.
+    size_t stateStride = FlatLikelihoodArrayView::getStateStrideFor(nbStates_);
+    size_t arraySize = FlatLikelihoodBuffer::getAlignedSize(nbDistinctSites_ * nbClasses_ * stateStride);
+    workspace.flatArrays.resize(2 * arraySize);
+    FlatLikelihoodArrayView array1(workspace.flatArrays.getData(), nbDistinctSites_, nbClasses_, nbStates_, stateStride);
+    FlatLikelihoodArrayView array2(workspace.flatArrays.getData() + arraySize, nbDistinctSites_, nbClasses_, nbStates_, stateStride);
+
+    // Compute array 1: grand father array
+    if (!grandFatherIsRoot)
+    {
+      computeLikelihoodFromArrays(context.grandFatherFlatArrays, context.grandFatherTProbs, context.grandFatherFatherFlatArray, context.grandFatherTProb, array1, context.grandFatherFlatArrays.size(), nbDistinctSites_, nbClasses_, nbStates_, true);
+    }
+    else
+    {
+      computeLikelihoodFromArrays(context.grandFatherFlatArrays, context.grandFatherTProbs, array1, context.grandFatherFlatArrays.size(), nbDistinctSites_, nbClasses_, nbStates_, true);
+
+      // This is the root node, we have to account for the ancestral frequencies:
+      for (size_t i = 0; i < nbDistinctSites_; i++)
+      {
+        for (size_t j = 0; j < nbClasses_; j++)
+        {
+          double* array1_i_j = array1(i, j);
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            array1_i_j[x] *= rootFreqs_[x];
+          }
+        }
+      }
+    }
+
+    // Compute array 2: parent array
+    computeLikelihoodFromArrays(context.parentFlatArrays, context.parentTProbs, array2, context.parentFlatArrays.size(), nbDistinctSites_, nbClasses_, nbStates_, true);
+
+    if (scaling)
+    {
+      for (size_t i = 0; i < nbDistinctSites_; i++)
+      {
+        workspace.scalingCounts[i] = rescaleSiteLikelihoods(array1(i, 0), nbClasses_, nbStates_, stateStride)
+                                   + rescaleSiteLikelihoods(array2(i, 0), nbClasses_, nbStates_, stateStride);
+      }
+    }
+
+    brLik.initModel(model, rDist);
+    brLik.initLikelihoods(array1, array2);
   }
   else
   {
-    computeLikelihoodFromArrays(grandFatherArrays, grandFatherTProbs, array1, nbGrandFatherNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false);
-
-    // This is the root node, we have to account for the ancestral frequencies:
-    for (size_t i = 0; i < nbDistinctSites_; i++)
+    // Compute array 1: grand father array
+    VVVdouble* array1 = &workspace.array1;
+    VectorTools::resize3(*array1, nbDistinctSites_, nbClasses_, nbStates_);
+    if (!grandFatherIsRoot)
     {
-      for (size_t j = 0; j < nbClasses_; j++)
+      computeLikelihoodFromArrays(context.grandFatherArrays, context.grandFatherTProbs, context.grandFatherFatherArray, context.grandFatherTProb, *array1, context.grandFatherArrays.size(), nbDistinctSites_, nbClasses_, nbStates_, true);
+    }
+    else
+    {
+      computeLikelihoodFromArrays(context.grandFatherArrays, context.grandFatherTProbs, *array1, context.grandFatherArrays.size(), nbDistinctSites_, nbClasses_, nbStates_, true);
+
+      // This is the root node, we have to account for the ancestral frequencies:
+      for (size_t i = 0; i < nbDistinctSites_; i++)
       {
-        for (size_t x = 0; x < nbStates_; x++)
+        for (size_t j = 0; j < nbClasses_; j++)
         {
-          array1[i][j][x] *= rootFreqs_[x];
+          for (size_t x = 0; x < nbStates_; x++)
+          {
+            (*array1)[i][j][x] *= rootFreqs_[x];
+          }
         }
       }
     }
+
+    // Compute array 2: parent array
+    VVVdouble* array2 = &workspace.array2;
+    VectorTools::resize3(*array2, nbDistinctSites_, nbClasses_, nbStates_);
+    computeLikelihoodFromArrays(context.parentArrays, context.parentTProbs, *array2, context.parentArrays.size(), nbDistinctSites_, nbClasses_, nbStates_, true);
+
+    if (scaling)
+    {
+      for (size_t i = 0; i < nbDistinctSites_; i++)
+      {
+        workspace.scalingCounts[i] = rescaleSiteLikelihoods((*array1)[i]) + rescaleSiteLikelihoods((*array2)[i]);
+      }
+    }
+
+    brLik.initModel(model, rDist);
+    brLik.initLikelihoods(array1, array2);
   }
 
-  // Compute array 2: parent array
-  VVVdouble array2 = *uncleArray;
-  resetLikelihoodArray(array2);
-  parentArrays.push_back(uncleArray);
-  parentTProbs.push_back(&pxy_[uncle->getId()]);
-  computeLikelihoodFromArrays(parentArrays, parentTProbs, array2, nbParentNeighbors + 1, nbDistinctSites_, nbClasses_, nbStates_, false);
+  // If likelihood arrays are scaled, sum the scaling counts of all arrays combined:
+  double logScaling = 0;
+  if (scaling)
+  {
+    const vector<unsigned int>* weights = &getLikelihoodData()->getWeights();
+    for (size_t i = 0; i < nbDistinctSites_; i++)
+    {
+      int count = workspace.scalingCounts[i];
+      for (size_t k = 0; k < context.scalingCounts.size(); k++)
+        count += (*context.scalingCounts[k])[i];
+      logScaling += (*weights)[i] * getLogScalingFactor(count);
+    }
+  }
 
   // Initialize BranchLikelihood:
-  brLikFunction_->initModel(model_, rateDistribution_);
-  brLikFunction_->initLikelihoods(&array1, &array2);
+  // The constraint is shared with the branch length parameters, and not copied.
   ParameterList parameters;
-  size_t pos = 0;
-  while (pos < nodes_.size() && nodes_[pos]->getId() != parent->getId()) pos++;
-  if (pos == nodes_.size()) throw Exception("NNIHomogeneousTreeLikelihood::testNNI. Unvalid node id.");
-  Parameter brLen = getParameter("BrLen" + TextTools::toString(pos));
-  brLen.setName("BrLen");
-  parameters.addParameter(brLen);
-  brLikFunction_->setParameters(parameters);
+  parameters.addParameter(Parameter("BrLen", context.brLen, brLenConstraint_.get()));
+  brLik.setParameters(parameters);
 
   // Re-estimate branch length:
-  brentOptimizer_->setFunction(brLikFunction_);
-  brentOptimizer_->getStopCondition()->setTolerance(0.1);
-  brentOptimizer_->setInitialInterval(brLen.getValue(), brLen.getValue() + 0.01);
-  brentOptimizer_->init(parameters);
-  brentOptimizer_->optimize();
-  // brLenNNIValues_[nodeId] = brLikFunction_->getParameterValue("BrLen");
-  brLenNNIValues_[nodeId] = brentOptimizer_->getParameters().getParameter("BrLen").getValue();
-  brLikFunction_->resetLikelihoods(); // Array1 and Array2 will be destroyed after this function call.
-                                      // We should not keep pointers towards them...
+  optimizer.setFunction(&brLik);
+  optimizer.getStopCondition()->setTolerance(0.1);
+  optimizer.setInitialInterval(context.brLen, context.brLen + 0.01);
+  optimizer.init(parameters);
+  optimizer.optimize();
+  brLen = optimizer.getParameters().getParameter("BrLen").getValue();
+  brLik.resetLikelihoods(); // Scratch arrays will be overwritten by the next call.
+                            // We should not keep pointers towards them...
 
   // Return the resulting likelihood:
-  return brLikFunction_->getValue() - getValue();
+  return brLik.getValue() + logScaling - getValue();
 }
 
 /*******************************************************************************/
@@ -329,9 +547,7 @@ void NNIHomogeneousTreeLikelihood::doNNI(int nodeId) throw (NodeException)
   grandFather->removeSon(uncle);
   parent->addSon(uncle);
   grandFather->addSon(son);
-  size_t pos = 0;
-  while (pos < nodes_.size() && nodes_[pos]->getId() != parent->getId()) pos++;
-  if (pos == nodes_.size()) throw Exception("NNIHomogeneousTreeLikelihood::doNNI. Unvalid node id.");
+  size_t pos = getBranchIndex_(parent->getId());
 
   string name = "BrLen" + TextTools::toString(pos);
   if (brLenNNIValues_.find(nodeId) != brLenNNIValues_.end())
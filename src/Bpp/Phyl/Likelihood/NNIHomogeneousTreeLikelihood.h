@@ -41,13 +41,19 @@
 #define _NNIHOMOGENEOUSTREELIKELIHOOD_H_
 
 #include "DRHomogeneousTreeLikelihood.h"
+#include "FlatLikelihoodArray.h"
 #include "../NNISearchable.h"
 
+#include <Bpp/Text/TextTools.h>
 #include <Bpp/Numeric/VectorTools.h>
 #include <Bpp/Numeric/Parametrizable.h>
+#include <Bpp/Numeric/AutoParameter.h>
 #include <Bpp/Numeric/Prob/DiscreteDistribution.h>
 #include <Bpp/Numeric/Function/BrentOneDimension.h>
 
+// From the STL:
+#include <memory>
+
 namespace bpp
 {
 /**
@@ -56,6 +62,7 @@ namespace bpp
  * This class is used internally by DRHomogeneousTreeLikelihood to test NNI movements.
  * This function needs:
  * - two likelihood arrays corresponding to the conditional likelihoods at top and bottom nodes,
+ *   either as VVVdouble objects or as flat arrays,
  * - a substitution model and a rate distribution, whose parameters will not be estimated but taken "as is",
  * It takes only one parameter, the branch length.
  */
@@ -71,6 +78,8 @@ protected:
   VVVdouble pxy_;
   double lnL_;
   std::vector<unsigned int> weights_;
+  FlatLikelihoodArrayView flatArray1_, flatArray2_;
+  Vdouble la_;
 
 public:
   BranchLikelihood(const std::vector<unsigned int>& weights) :
@@ -83,7 +92,10 @@ public:
     nbClasses_(0),
     pxy_(),
     lnL_(log(0.)),
-    weights_(weights)
+    weights_(weights),
+    flatArray1_(),
+    flatArray2_(),
+    la_()
   {
     addParameter_(new Parameter("BrLen", 1, 0));
   }
@@ -98,7 +110,10 @@ public:
     nbClasses_(bl.nbClasses_),
     pxy_(bl.pxy_),
     lnL_(bl.lnL_),
-    weights_(bl.weights_)
+    weights_(bl.weights_),
+    flatArray1_(bl.flatArray1_),
+    flatArray2_(bl.flatArray2_),
+    la_()
   {}
 
   BranchLikelihood& operator=(const BranchLikelihood& bl)
@@ -113,6 +128,8 @@ public:
     pxy_ = bl.pxy_;
     lnL_ = bl.lnL_;
     weights_ = bl.weights_;
+    flatArray1_ = bl.flatArray1_;
+    flatArray2_ = bl.flatArray2_;
     return *this;
   }
 
@@ -131,12 +148,30 @@ public:
   {
     array1_ = array1;
     array2_ = array2;
+    flatArray1_ = FlatLikelihoodArrayView();
+    flatArray2_ = FlatLikelihoodArrayView();
+  }
+
+  /**
+   * @brief Use flat arrays instead of VVVdouble ones.
+   *
+   * @warning No checking on alphabet size or number of rate classes is performed,
+   * use with care!
+   */
+  void initLikelihoods(const FlatLikelihoodArrayView& array1, const FlatLikelihoodArrayView& array2)
+  {
+    array1_ = 0;
+    array2_ = 0;
+    flatArray1_ = array1;
+    flatArray2_ = array2;
   }
 
   void resetLikelihoods()
   {
     array1_ = 0;
     array2_ = 0;
+    flatArray1_ = FlatLikelihoodArrayView();
+    flatArray2_ = FlatLikelihoodArrayView();
   }
 
   void setParameters(const ParameterList& parameters)
@@ -180,6 +215,100 @@ protected:
 
   ParameterList brLenNNIParams_;
 
+  /**
+   * @brief Pointers toward all the data needed to test one NNI.
+   *
+   * Depending on the storage layout of the likelihood data object, input arrays
+   * are either VVVdouble pointers or flat views.
+   * Gathering these pointers may update the likelihood data object, and is hence done sequentially.
+   * Evaluating a NNI from an NNIContext only reads the pointed data.
+   * Contexts are reused from one NNI to the other, so that their vectors are allocated only once.
+   */
+  struct NNIContext
+  {
+    int nodeId;
+    std::vector<const VVVdouble*> grandFatherArrays;
+    std::vector<FlatLikelihoodArrayView> grandFatherFlatArrays;
+    std::vector<const VVVdouble*> grandFatherTProbs;
+    const VVVdouble* grandFatherFatherArray;
+    FlatLikelihoodArrayView grandFatherFatherFlatArray;
+    const VVVdouble* grandFatherTProb;
+    std::vector<const VVVdouble*> parentArrays;
+    std::vector<FlatLikelihoodArrayView> parentFlatArrays;
+    std::vector<const VVVdouble*> parentTProbs;
+    std::vector<const std::vector<int>*> scalingCounts;
+    double brLen;
+
+    NNIContext() :
+      nodeId(0),
+      grandFatherArrays(),
+      grandFatherFlatArrays(),
+      grandFatherTProbs(),
+      grandFatherFatherArray(0),
+      grandFatherFatherFlatArray(),
+      grandFatherTProb(0),
+      parentArrays(),
+      parentFlatArrays(),
+      parentTProbs(),
+      scalingCounts(),
+      brLen(0)
+    {}
+  };
+
+  /**
+   * @brief Scratch arrays used for evaluating NNIs.
+   *
+   * Arrays are only reallocated when the dimensions of the data change.
+   */
+  struct NNIWorkspace
+  {
+    VVVdouble array1;
+    VVVdouble array2;
+    FlatLikelihoodBuffer flatArrays;
+    std::vector<int> scalingCounts;
+
+    NNIWorkspace() : array1(), array2(), flatArrays(), scalingCounts() {}
+  };
+
+  /**
+   * @brief Objects used by one block of NNIs evaluated concurrently (see testNNIs()).
+   *
+   * Blocks are kept from one call to the other: the substitution model is only copied again
+   * when its version changed, and the scratch arrays are reused.
+   * The rate distribution is only read, and is shared by all blocks.
+   */
+  struct NNIBlock
+  {
+    std::unique_ptr<SubstitutionModel> model;
+    unsigned int modelVersion;
+    std::unique_ptr<BranchLikelihood> brLik;
+    BrentOneDimension optimizer;
+    NNIWorkspace workspace;
+
+    NNIBlock(const SubstitutionModel& mod, const std::vector<unsigned int>& weights) :
+      model(mod.clone()),
+      modelVersion(0),
+      brLik(new BranchLikelihood(weights)),
+      optimizer(),
+      workspace()
+    {
+      optimizer.setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
+      optimizer.setProfiler(0);
+      optimizer.setMessageHandler(0);
+      optimizer.setVerbose(0);
+    }
+  };
+
+  mutable NNIContext nniContext_;
+  mutable std::vector<NNIContext> nniContexts_;
+  mutable NNIWorkspace nniWorkspace_;
+  mutable std::vector< std::unique_ptr<NNIBlock> > nniBlocks_;
+
+  /**
+   * @brief The position in nodes_ of each node, indexed by node id.
+   */
+  std::vector<size_t> nniBranchIndex_;
+
 public:
   /**
    * @brief Build a new NNIHomogeneousTreeLikelihood object.
@@ -238,6 +367,13 @@ public:
     DRHomogeneousTreeLikelihood::setData(sites);
     if (brLikFunction_) delete brLikFunction_;
     brLikFunction_ = new BranchLikelihood(getLikelihoodData()->getWeights());
+    nniBlocks_.clear();
+  }
+
+  void setSubstitutionModel(SubstitutionModel* model) throw (Exception)
+  {
+    DRHomogeneousTreeLikelihood::setSubstitutionModel(model);
+    nniBlocks_.clear();
   }
 
   /**
@@ -257,6 +393,20 @@ public:
 
   double testNNI(int nodeId) const throw (NodeException);
 
+  /**
+   * @brief Test several NNIs.
+   *
+   * If more than one thread is used (see setNumberOfThreads()), the NNIs are evaluated concurrently,
+   * by blocks. Each block has its own copy of the substitution model, its own BranchLikelihood function,
+   * its own Brent optimizer and its own scratch arrays, which are all kept between calls.
+   * The results are identical to the ones of successive calls to testNNI().
+   *
+   * @param nodeIds The ids of the nodes defining the NNI movements.
+   * @param diffs [out] The likelihood variation of each NNI.
+   * @throw NodeException If one of the nodes does not define a valid NNI.
+   */
+  void testNNIs(const std::vector<int>& nodeIds, std::vector<double>& diffs) const throw (NodeException);
+
   void doNNI(int nodeId) throw (NodeException);
 
   void topologyChangeTested(const TopologyChangeEvent& event)
@@ -272,6 +422,57 @@ public:
     brLenNNIValues_.clear();
   }
   /** @} */
+
+protected:
+  /**
+   * @brief Gather all data needed to test a NNI.
+   *
+   * @param nodeId The id of the node defining the NNI movement.
+   * @param context [out] The data of the NNI.
+   * @throw NodeException If the node does not define a valid NNI.
+   */
+  void initNNIContext_(int nodeId, NNIContext& context) const throw (NodeException);
+
+  /**
+   * @brief Compute the position in nodes_ of each node.
+   */
+  void initBranchIndex_();
+
+  /**
+   * @return The position in nodes_ of a node.
+   * @param nodeId The id of the node.
+   * @throw Exception If the node has no branch length parameter.
+   */
+  size_t getBranchIndex_(int nodeId) const throw (Exception)
+  {
+    if (nodeId < 0 || static_cast<size_t>(nodeId) >= nniBranchIndex_.size() || nniBranchIndex_[static_cast<size_t>(nodeId)] == nodes_.size())
+      throw Exception("NNIHomogeneousTreeLikelihood::getBranchIndex_. Unvalid node id: " + TextTools::toString(nodeId) + ".");
+    return nniBranchIndex_[static_cast<size_t>(nodeId)];
+  }
+
+  /**
+   * @brief Estimate the branch length and likelihood variation of a NNI.
+   *
+   * This method does not modify the object and can be called concurrently,
+   * provided that each call uses distinct brLik, optimizer, workspace and model objects.
+   *
+   * @param context The data of the NNI, as returned by initNNIContext_().
+   * @param model The substitution model to use.
+   * @param rDist The rate distribution to use.
+   * @param brLik The function used for the branch length estimation.
+   * @param optimizer The optimizer used for the branch length estimation.
+   * @param workspace The scratch arrays to use.
+   * @param brLen [out] The estimated branch length.
+   * @return The likelihood variation of the NNI.
+   */
+  double evaluateNNI_(
+    const NNIContext& context,
+    const SubstitutionModel* model,
+    const DiscreteDistribution* rDist,
+    BranchLikelihood& brLik,
+    BrentOneDimension& optimizer,
+    NNIWorkspace& workspace,
+    double& brLen) const;
 };
 } // end of namespace bpp.
 
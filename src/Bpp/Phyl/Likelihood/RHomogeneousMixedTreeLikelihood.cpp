@@ -160,6 +160,34 @@ void RHomogeneousMixedTreeLikelihood::setData(const SiteContainer& sites) throw
 }
 
 
+void RHomogeneousMixedTreeLikelihood::setNumberOfThreads(size_t nbThreads)
+{
+  RHomogeneousTreeLikelihood::setNumberOfThreads(nbThreads);
+  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setNumberOfThreads(nbThreads);
+  }
+}
+
+void RHomogeneousMixedTreeLikelihood::setSiteBlockSize(size_t siteBlockSize)
+{
+  RHomogeneousTreeLikelihood::setSiteBlockSize(siteBlockSize);
+  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setSiteBlockSize(siteBlockSize);
+  }
+}
+
+void RHomogeneousMixedTreeLikelihood::setParallelMode(short mode) throw (Exception)
+{
+  RHomogeneousTreeLikelihood::setParallelMode(mode);
+  for (size_t i = 0; i < treeLikelihoodsContainer_.size(); i++)
+  {
+    treeLikelihoodsContainer_[i]->setParallelMode(mode);
+  }
+}
+
+
 void RHomogeneousMixedTreeLikelihood::fireParameterChanged(const ParameterList& params)
 {
   // checks in the model will change
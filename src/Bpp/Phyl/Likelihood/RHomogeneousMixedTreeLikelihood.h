@@ -148,6 +148,18 @@ public:
   double getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const;
   /** @} */
 
+  /**
+   * @brief Likelihood scaling is not supported by mixed models.
+   *
+   * @param yn Tell if conditional likelihoods should be scaled.
+   * @throw Exception If yn is true.
+   */
+  void setLikelihoodScaling(bool yn) throw (Exception)
+  {
+    if (yn)
+      throw Exception("RHomogeneousMixedTreeLikelihood::setLikelihoodScaling(). Likelihood scaling is not supported by mixed models.");
+  }
+
 public:
   // Specific methods:
   void initialize() throw (Exception);
@@ -164,6 +176,30 @@ public:
 
   virtual void computeTreeD2Likelihood(const std::string& variable);
 
+  /**
+   * @brief Set the number of threads to use, for all models of the mixture.
+   *
+   * @param nbThreads The total number of threads.
+   * @see AbstractDiscreteRatesAcrossSitesTreeLikelihood::setNumberOfThreads
+   */
+  void setNumberOfThreads(size_t nbThreads);
+
+  /**
+   * @brief Set the number of sites in each block of a parallel computation, for all models of the mixture.
+   *
+   * @param siteBlockSize The number of sites per block.
+   * @see AbstractDiscreteRatesAcrossSitesTreeLikelihood::setSiteBlockSize
+   */
+  void setSiteBlockSize(size_t siteBlockSize);
+
+  /**
+   * @brief Set how computations are split between threads, for all models of the mixture.
+   *
+   * @param mode The parallel mode.
+   * @see AbstractDiscreteRatesAcrossSitesTreeLikelihood::setParallelMode
+   */
+  void setParallelMode(short mode) throw (Exception);
+
 protected:
   /**
    * @brief Compute the likelihood for a subtree defined by the Tree::Node <i>node</i>.
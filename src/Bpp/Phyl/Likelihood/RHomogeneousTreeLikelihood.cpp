@@ -38,6 +38,7 @@
  */
 
 #include "RHomogeneousTreeLikelihood.h"
+#include "StateLikelihoodKernels.h"
 #include "../PatternTools.h"
 
 #include <Bpp/Text/TextTools.h>
@@ -165,10 +166,13 @@ double RHomogeneousTreeLikelihood::getLogLikelihood() const
 {
   double ll = 0;
   vector<double> la(nbSites_);
-  for (size_t i = 0; i < nbSites_; i++)
-  {
-    la[i] = getLogLikelihoodForASite(i);
-  }
+  forEachSiteBlock_(nbSites_, [&](size_t siteBegin, size_t siteEnd) {
+      for (size_t i = siteBegin; i < siteEnd; i++)
+      {
+        la[i] = getLogLikelihoodForASite(i);
+      }
+    });
+  // The sum is always computed sequentially, in the same order:
   sort(la.begin(), la.end());
   for (size_t i = nbSites_; i > 0; i--)
   {
@@ -194,6 +198,16 @@ double RHomogeneousTreeLikelihood::getLikelihoodForASite(size_t site) const
 double RHomogeneousTreeLikelihood::getLogLikelihoodForASite(size_t site) const
 {
   double l = 0;
+  if (scaling_)
+  {
+    // Scaled values are summed, as all classes share the same scaling:
+    for (size_t i = 0; i < nbClasses_; i++)
+    {
+      double li = getScaledLikelihoodForASiteForARateClass_(site, i) * rateDistribution_->getProbability(i);
+      if (li > 0) l+= li; //Corrects for numerical instabilities leading to slightly negative likelihoods
+    }
+    return log(l) - getLogScalingFactor(getRootScalingCount_(site));
+  }
   for (size_t i = 0; i < nbClasses_; i++)
   {
     double li = getLikelihoodForASiteForARateClass(site, i) * rateDistribution_->getProbability(i);
@@ -205,6 +219,13 @@ double RHomogeneousTreeLikelihood::getLogLikelihoodForASite(size_t site) const
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClass(size_t site, size_t rateClass) const
+{
+  return getScaledLikelihoodForASiteForARateClass_(site, rateClass) * getScalingFactor(-getRootScalingCount_(site));
+}
+
+/******************************************************************************/
+
+double RHomogeneousTreeLikelihood::getScaledLikelihoodForASiteForARateClass_(size_t site, size_t rateClass) const
 {
   double l = 0;
   Vdouble* la = &likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass];
@@ -228,21 +249,21 @@ double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClass(size_t
     l += (*la)[i] * rootFreqs_[i];
   }
   //if(l <= 0.) cerr << "WARNING!!! Negative likelihood." << endl;
-  return log(l);
+  return log(l) - getLogScalingFactor(getRootScalingCount_(site));
 }
 
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)];
+  return likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)] * getScalingFactor(-getRootScalingCount_(site));
 }
 
 /******************************************************************************/
 
 double RHomogeneousTreeLikelihood::getLogLikelihoodForASiteForARateClassForAState(size_t site, size_t rateClass, int state) const
 {
-  return log(likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]);
+  return log(likelihoodData_->getLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass][static_cast<size_t>(state)]) - getLogScalingFactor(getRootScalingCount_(site));
 }
 
 /******************************************************************************/
@@ -302,13 +323,7 @@ double RHomogeneousTreeLikelihood::getDLikelihoodForASiteForARateClass(
   size_t site,
   size_t rateClass) const
 {
-  double dl = 0;
-  Vdouble* dla = &likelihoodData_->getDLikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass];
-  for (size_t i = 0; i < nbStates_; i++)
-  {
-    dl += (*dla)[i] * rootFreqs_[i];
-  }
-  return dl;
+  return getRootArraySum_(likelihoodData_->getDLikelihoodArray(tree_->getRootNode()->getId()), site, rateClass) * getScalingFactor(-getRootScalingCount_(site));
 }
 
 /******************************************************************************/
@@ -329,6 +344,19 @@ double RHomogeneousTreeLikelihood::getDLikelihoodForASite(size_t site) const
 double RHomogeneousTreeLikelihood::getDLogLikelihoodForASite(size_t site) const
 {
   // d(f(g(x)))/dx = dg(x)/dx . df(g(x))/dg :
+  if (scaling_)
+  {
+    // The ratio is computed on scaled values, which share the same scaling:
+    const VVVdouble* dLikelihoods_root = &likelihoodData_->getDLikelihoodArray(tree_->getRootNode()->getId());
+    double dl = 0, l = 0;
+    for (size_t i = 0; i < nbClasses_; i++)
+    {
+      double p = rateDistribution_->getProbability(i);
+      dl += getRootArraySum_(*dLikelihoods_root, site, i) * p;
+      l  += getScaledLikelihoodForASiteForARateClass_(site, i) * p;
+    }
+    return dl / l;
+  }
   return getDLikelihoodForASite(site) / getLikelihoodForASite(site);
 }
 
@@ -401,55 +429,16 @@ void RHomogeneousTreeLikelihood::computeTreeDLikelihood(const string& variable)
 
     if (son == branch)
     {
-      VVVdouble* dpxy__son = &dpxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
-      {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* dpxy__son_c = &(*dpxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            double dl = 0;
-            Vdouble* dpxy__son_c_x = &(*dpxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
-            {
-              dl += (*dpxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-            }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
-          }
-        }
-      }
+      VVVdouble* dpxy__son = &dpxy_.at(son->getId());
+      multiplyLikelihoods_(*dpxy__son, *_likelihoods_son, _patternLinks_father_son, *_dLikelihoods_father, nbSites);
     }
     else
     {
-      VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
-      {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
-            {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-            }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
-          }
-        }
-      }
+      VVVdouble* pxy__son = &pxy_.at(son->getId());
+      multiplyLikelihoods_(*pxy__son, *_likelihoods_son, _patternLinks_father_son, *_dLikelihoods_father, nbSites);
     }
   }
+  rescaleDerivativeArray_(father, *_dLikelihoods_father);
 
   // Now we go down the tree toward the root node:
   computeDownSubtreeDLikelihood(father);
@@ -486,60 +475,21 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeDLikelihood(const Node* node)
   {
     const Node* son = father->getSon(l);
 
-    VVVdouble* pxy__son = &pxy_[son->getId()];
+    VVVdouble* pxy__son = &pxy_.at(son->getId());
     vector<size_t> * _patternLinks_father_son = &likelihoodData_->getArrayPositions(father->getId(), son->getId());
 
     if (son == node)
     {
       VVVdouble* _dLikelihoods_son = &likelihoodData_->getDLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
-      {
-        VVdouble* _dLikelihoods_son_i = &(*_dLikelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* _dLikelihoods_son_i_c = &(*_dLikelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
-            {
-              dl += (*pxy__son_c_x)[y] * (*_dLikelihoods_son_i_c)[y];
-            }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
-          }
-        }
-      }
+      multiplyLikelihoods_(*pxy__son, *_dLikelihoods_son, _patternLinks_father_son, *_dLikelihoods_father, nbSites);
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
-      {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _dLikelihoods_father_i = &(*_dLikelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _dLikelihoods_father_i_c = &(*_dLikelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
-            {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-            }
-            (*_dLikelihoods_father_i_c)[x] *= dl;
-          }
-        }
-      }
+      multiplyLikelihoods_(*pxy__son, *_likelihoods_son, _patternLinks_father_son, *_dLikelihoods_father, nbSites);
     }
   }
+  rescaleDerivativeArray_(father, *_dLikelihoods_father);
 
   //Next step: move toward grand father...
   computeDownSubtreeDLikelihood(father);
@@ -553,13 +503,7 @@ double RHomogeneousTreeLikelihood::getD2LikelihoodForASiteForARateClass(
   size_t site,
   size_t rateClass) const
 {
-  double d2l = 0;
-  Vdouble* d2la = &likelihoodData_->getD2LikelihoodArray(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)][rateClass];
-  for (size_t i = 0; i < nbStates_; i++)
-  {
-    d2l += (*d2la)[i] * rootFreqs_[i];
-  }
-  return d2l;
+  return getRootArraySum_(likelihoodData_->getD2LikelihoodArray(tree_->getRootNode()->getId()), site, rateClass) * getScalingFactor(-getRootScalingCount_(site));
 }
 
 /******************************************************************************/
@@ -579,6 +523,21 @@ double RHomogeneousTreeLikelihood::getD2LikelihoodForASite(size_t site) const
 
 double RHomogeneousTreeLikelihood::getD2LogLikelihoodForASite(size_t site) const
 {
+  if (scaling_)
+  {
+    // Ratios are computed on scaled values, which share the same scaling:
+    const VVVdouble* dLikelihoods_root = &likelihoodData_->getDLikelihoodArray(tree_->getRootNode()->getId());
+    const VVVdouble* d2Likelihoods_root = &likelihoodData_->getD2LikelihoodArray(tree_->getRootNode()->getId());
+    double d2l = 0, dl = 0, l = 0;
+    for (size_t i = 0; i < nbClasses_; i++)
+    {
+      double p = rateDistribution_->getProbability(i);
+      d2l += getRootArraySum_(*d2Likelihoods_root, site, i) * p;
+      dl  += getRootArraySum_(*dLikelihoods_root, site, i) * p;
+      l   += getScaledLikelihoodForASiteForARateClass_(site, i) * p;
+    }
+    return d2l / l - pow(dl / l, 2);
+  }
   return getD2LikelihoodForASite(site) / getLikelihoodForASite(site)
          - pow( getDLikelihoodForASite(site) / getLikelihoodForASite(site), 2);
 }
@@ -652,55 +611,16 @@ void RHomogeneousTreeLikelihood::computeTreeD2Likelihood(const string& variable)
 
     if (son == branch)
     {
-      VVVdouble* d2pxy__son = &d2pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
-      {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* d2pxy__son_c = &(*d2pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            double d2l = 0;
-            Vdouble* d2pxy__son_c_x = &(*d2pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
-            {
-              d2l += (*d2pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-            }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
-          }
-        }
-      }
+      VVVdouble* d2pxy__son = &d2pxy_.at(son->getId());
+      multiplyLikelihoods_(*d2pxy__son, *_likelihoods_son, _patternLinks_father_son, *_d2Likelihoods_father, nbSites);
     }
     else
     {
-      VVVdouble* pxy__son = &pxy_[son->getId()];
-      for (size_t i = 0; i < nbSites; i++)
-      {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            double d2l = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
-            {
-              d2l += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-            }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
-          }
-        }
-      }
+      VVVdouble* pxy__son = &pxy_.at(son->getId());
+      multiplyLikelihoods_(*pxy__son, *_likelihoods_son, _patternLinks_father_son, *_d2Likelihoods_father, nbSites);
     }
   }
+  rescaleDerivativeArray_(father, *_d2Likelihoods_father);
 
   // Now we go down the tree toward the root node:
   computeDownSubtreeD2Likelihood(father);
@@ -737,60 +657,21 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
   {
     const Node* son = father->getSon(l);
 
-    VVVdouble* pxy__son = &pxy_[son->getId()];
+    VVVdouble* pxy__son = &pxy_.at(son->getId());
     vector<size_t> * _patternLinks_father_son = &likelihoodData_->getArrayPositions(father->getId(), son->getId());
 
     if (son == node)
     {
       VVVdouble* _d2Likelihoods_son = &likelihoodData_->getD2LikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
-      {
-        VVdouble* _d2Likelihoods_son_i = &(*_d2Likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* _d2Likelihoods_son_i_c = &(*_d2Likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            double d2l = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
-            {
-              d2l += (*pxy__son_c_x)[y] * (*_d2Likelihoods_son_i_c)[y];
-            }
-            (*_d2Likelihoods_father_i_c)[x] *= d2l;
-          }
-        }
-      }
+      multiplyLikelihoods_(*pxy__son, *_d2Likelihoods_son, _patternLinks_father_son, *_d2Likelihoods_father, nbSites);
     }
     else
     {
       VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
-      for (size_t i = 0; i < nbSites; i++)
-      {
-        VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_father_son)[i]];
-        VVdouble* _d2Likelihoods_father_i = &(*_d2Likelihoods_father)[i];
-        for (size_t c = 0; c < nbClasses_; c++)
-        {
-          Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-          Vdouble* _d2Likelihoods_father_i_c = &(*_d2Likelihoods_father_i)[c];
-          VVdouble* pxy__son_c = &(*pxy__son)[c];
-          for (size_t x = 0; x < nbStates_; x++)
-          {
-            double dl = 0;
-            Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-            for (size_t y = 0; y < nbStates_; y++)
-            {
-              dl += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-            }
-            (*_d2Likelihoods_father_i_c)[x] *= dl;
-          }
-        }
-      }
+      multiplyLikelihoods_(*pxy__son, *_likelihoods_son, _patternLinks_father_son, *_d2Likelihoods_father, nbSites);
     }
   }
+  rescaleDerivativeArray_(father, *_d2Likelihoods_father);
 
   //Next step: move toward grand father...
   computeDownSubtreeD2Likelihood(father);
@@ -800,6 +681,12 @@ void RHomogeneousTreeLikelihood::computeDownSubtreeD2Likelihood(const Node* node
 
 void RHomogeneousTreeLikelihood::computeTreeLikelihood()
 {
+  if (parallelMode_ == PARALLEL_SUBTREES)
+  {
+    // Independent subtrees are computed concurrently:
+    forEachNode_(true, [this](const Node* node) { computeNodeLikelihood_(node); });
+    return;
+  }
   computeSubtreeLikelihood(tree_->getRootNode());
 }
 
@@ -809,6 +696,21 @@ void RHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
 {
   if (node->isLeaf()) return;
 
+  // Sons first, then the node itself:
+  size_t nbNodes = node->getNumberOfSons();
+  for (size_t l = 0; l < nbNodes; l++)
+  {
+    computeSubtreeLikelihood(node->getSon(l)); //Recursive method.
+  }
+  computeNodeLikelihood_(node);
+}
+
+/******************************************************************************/
+
+void RHomogeneousTreeLikelihood::computeNodeLikelihood_(const Node* node)
+{
+  if (node->isLeaf()) return;
+
   size_t nbSites = likelihoodData_->getLikelihoodArray(node->getId()).size();
   size_t nbNodes = node->getNumberOfSons();
 
@@ -836,33 +738,70 @@ void RHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
 
     const Node* son = node->getSon(l);
 
-    computeSubtreeLikelihood(son); //Recursive method:
-
-    VVVdouble* pxy__son = &pxy_[son->getId()];
+    VVVdouble* pxy__son = &pxy_.at(son->getId());
     vector<size_t> * _patternLinks_node_son = &likelihoodData_->getArrayPositions(node->getId(), son->getId());
     VVVdouble* _likelihoods_son = &likelihoodData_->getLikelihoodArray(son->getId());
 
-    for (size_t i = 0; i < nbSites; i++)
-    {
-      //For each site in the sequence,
-      VVdouble* _likelihoods_son_i = &(*_likelihoods_son)[(*_patternLinks_node_son)[i]];
-      VVdouble* _likelihoods_node_i = &(*_likelihoods_node)[i];
-      for (size_t c = 0; c < nbClasses_; c++)
+    multiplyLikelihoods_(*pxy__son, *_likelihoods_son, _patternLinks_node_son, *_likelihoods_node, nbSites);
+  }
+
+  // Scaling counts are accumulated from the sons, then the node is scaled if needed:
+  vector<int>* scalingCounts_node = &likelihoodData_->getScalingCounts(node->getId());
+  vector<const vector<int>*> scalingCounts_sons(nbNodes);
+  vector<const vector<size_t>*> patternLinks_sons(nbNodes);
+  for (size_t l = 0; l < nbNodes; l++)
+  {
+    const Node* son = node->getSon(l);
+    scalingCounts_sons[l] = &likelihoodData_->getScalingCounts(son->getId());
+    patternLinks_sons[l] = &likelihoodData_->getArrayPositions(node->getId(), son->getId());
+  }
+  forEachSiteBlock_(nbSites, [&](size_t siteBegin, size_t siteEnd) {
+      for (size_t i = siteBegin; i < siteEnd; i++)
       {
-        //For each rate classe,
-        Vdouble* _likelihoods_son_i_c = &(*_likelihoods_son_i)[c];
-        Vdouble* _likelihoods_node_i_c = &(*_likelihoods_node_i)[c];
-        VVdouble* pxy__son_c = &(*pxy__son)[c];
-        for (size_t x = 0; x < nbStates_; x++)
+        int count = 0;
+        for (size_t l = 0; l < nbNodes; l++)
         {
-          //For each initial state,
-          Vdouble* pxy__son_c_x = &(*pxy__son_c)[x];
-          double likelihood = 0;
-          for (size_t y = 0; y < nbStates_; y++)
-            likelihood += (*pxy__son_c_x)[y] * (*_likelihoods_son_i_c)[y];
-          
-          (*_likelihoods_node_i_c)[x] *= likelihood;
+          count += (*scalingCounts_sons[l])[(*patternLinks_sons[l])[i]];
         }
+        if (scaling_)
+          count += rescaleSiteLikelihoods((*_likelihoods_node)[i]);
+        (*scalingCounts_node)[i] = count;
+      }
+    });
+}
+
+/******************************************************************************/
+
+void RHomogeneousTreeLikelihood::rescaleDerivativeArray_(const Node* node, VVVdouble& dArray) const
+{
+  const vector<int>* scalingCounts_node = &likelihoodData_->getScalingCounts(node->getId());
+  size_t nbSites = dArray.size();
+  size_t nbNodes = node->getNumberOfSons();
+  vector<const vector<int>*> scalingCounts_sons(nbNodes);
+  vector<const vector<size_t>*> patternLinks_sons(nbNodes);
+  for (size_t l = 0; l < nbNodes; l++)
+  {
+    const Node* son = node->getSon(l);
+    scalingCounts_sons[l] = &likelihoodData_->getScalingCounts(son->getId());
+    patternLinks_sons[l] = &likelihoodData_->getArrayPositions(node->getId(), son->getId());
+  }
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    // Scaling operations performed on the node itself:
+    int count = (*scalingCounts_node)[i];
+    for (size_t l = 0; l < nbNodes; l++)
+    {
+      count -= (*scalingCounts_sons[l])[(*patternLinks_sons[l])[i]];
+    }
+    if (count == 0) continue;
+    double factor = getScalingFactor(count);
+    VVdouble* dArray_i = &dArray[i];
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      Vdouble* dArray_i_c = &(*dArray_i)[c];
+      for (size_t x = 0; x < nbStates_; x++)
+      {
+        (*dArray_i_c)[x] *= factor;
       }
     }
   }
@@ -870,6 +809,33 @@ void RHomogeneousTreeLikelihood::computeSubtreeLikelihood(const Node* node)
 
 /******************************************************************************/
 
+double RHomogeneousTreeLikelihood::getRootArraySum_(const VVVdouble& array, size_t site, size_t rateClass) const
+{
+  double l = 0;
+  const Vdouble* array_i_c = &array[likelihoodData_->getRootArrayPosition(site)][rateClass];
+  for (size_t i = 0; i < nbStates_; i++)
+  {
+    l += (*array_i_c)[i] * rootFreqs_[i];
+  }
+  return l;
+}
+
+/******************************************************************************/
+
+void RHomogeneousTreeLikelihood::multiplyLikelihoods_(
+  const VVVdouble& pxy,
+  const VVVdouble& iLik,
+  const vector<size_t>* positions,
+  VVVdouble& oLik,
+  size_t nbSites) const
+{
+  forEachSiteBlock_(nbSites, [&](size_t siteBegin, size_t siteEnd) {
+      StateLikelihoodKernels::multiply(pxy, iLik, positions, oLik, siteBegin, siteEnd, nbClasses_, nbStates_);
+    });
+}
+
+/******************************************************************************/
+
 void RHomogeneousTreeLikelihood::displayLikelihood(const Node* node)
 {
   cout << "Likelihoods at node " << node->getName() << ": " << endl;
@@ -266,6 +266,57 @@ namespace bpp
      */
     virtual void displayLikelihood(const Node* node);
 
+  private:
+    /**
+     * @brief Compute the conditional likelihoods of a node from the ones of its sons.
+     *
+     * Unlike computeSubtreeLikelihood, this method is not recursive:
+     * the sons subtrees must have been computed before.
+     *
+     * @param node The node to compute.
+     */
+    void computeNodeLikelihood_(const Node* node);
+
+    /**
+     * @brief Multiply the conditional likelihoods of a node by the ones of a son node.
+     *
+     * Sites are split into blocks computed in parallel if several threads are used.
+     * As the number of distinct sites can be different at each node, blocks are
+     * defined for each pair of nodes.
+     *
+     * @see StateLikelihoodKernels::multiply
+     */
+    void multiplyLikelihoods_(const VVVdouble& pxy, const VVVdouble& iLik, const std::vector<size_t>* positions, VVVdouble& oLik, size_t nbSites) const;
+
+    /**
+     * @brief Bring a derivative array of a node to the same scale as its likelihood array.
+     *
+     * Derivative arrays are computed from the likelihood arrays of the sons, so that they do not
+     * include the scaling operations performed on the node itself.
+     *
+     * @param node The node.
+     * @param dArray The first or second order derivative array of the node.
+     */
+    void rescaleDerivativeArray_(const Node* node, VVVdouble& dArray) const;
+
+    /**
+     * @return The conditional likelihood of a site for a rate class, as stored in the root array (that is, possibly scaled).
+     */
+    double getScaledLikelihoodForASiteForARateClass_(size_t site, size_t rateClass) const;
+
+    /**
+     * @return The sum over all states of a root array for a site and a rate class, weighted by the root frequencies.
+     */
+    double getRootArraySum_(const VVVdouble& array, size_t site, size_t rateClass) const;
+
+    /**
+     * @return The number of scaling operations of a site at the root node.
+     */
+    int getRootScalingCount_(size_t site) const
+    {
+      return likelihoodData_->getScalingCounts(tree_->getRootNode()->getId())[likelihoodData_->getRootArrayPosition(site)];
+    }
+
     friend class RHomogeneousMixedTreeLikelihood;
   };
 
@@ -0,0 +1,497 @@
+//
+// File: SPRHomogeneousTreeLikelihood.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "SPRHomogeneousTreeLikelihood.h"
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/Numeric/AutoParameter.h>
+
+using namespace bpp;
+
+// From the STL:
+#include <algorithm>
+
+using namespace std;
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::testSPRs(
+  int nodeId,
+  unsigned int regraftRadius,
+  unsigned int rerootRadius,
+  vector<int>& regraftIds,
+  vector<int>& rerootIds,
+  vector<double>& diffs) const throw (NodeException)
+{
+  regraftIds.clear();
+  rerootIds.clear();
+  diffs.clear();
+
+  const Node* node = tree_->getNode(nodeId);
+  if (!node->hasFather()) throw NodePException("SPRHomogeneousTreeLikelihood::testSPRs(). Node must not be the root node.", node);
+  const Node* father = node->getFather();
+  if (!father->hasFather()) throw NodePException("SPRHomogeneousTreeLikelihood::testSPRs(). The father node must not be the root node.", father);
+  if (father->getNumberOfSons() != 2) throw NodePException("SPRHomogeneousTreeLikelihood::testSPRs(). The father node must have exactly two sons.", father);
+  const Node* grandFather = father->getFather();
+  const Node* brother = father->getSon(father->getSon(0) == node ? 1 : 0);
+  const DRASDRTreeLikelihoodData* likelihoodData = getLikelihoodData();
+
+  // Working arrays for each depth, the first ones are used here.
+  // They must not be reallocated during the enumeration of branches, which keeps references to them:
+  if (sprScratch_.size() <= max(regraftRadius, rerootRadius))
+    sprScratch_.resize(max(regraftRadius, rerootRadius) + 1);
+  SPRScratch& scratch = sprScratch_[0];
+
+  // Likelihoods of the pruned subtree, for each root position.
+  // The first one is the original position:
+  vector<int> subtreeIds(1, nodeId);
+  if (sprSubtreeLiks_.empty())
+    sprSubtreeLiks_.resize(1);
+  likelihoodData->getLikelihoodArraySnapshot(father->getId(), nodeId, sprSubtreeLiks_[0].array);
+  sprSubtreeLiks_[0].freqs = false;
+  sprSubtreeLiks_[0].counts = likelihoodData->getScalingCounts(father->getId(), nodeId);
+  if (rerootRadius > 0 && node->getNumberOfSons() == 2)
+  {
+    // The two sons of the node are joined, and the subtree is rerooted on any branch below them:
+    const Node* son1 = node->getSon(0);
+    const Node* son2 = node->getSon(1);
+    computeTransitionProbabilities_(son1->getDistanceToFather() + son2->getDistanceToFather(), scratch.pxy);
+    auto addRoot = [&](int rootId, const SPRPartial& lik) {
+      if (subtreeIds.size() == sprSubtreeLiks_.size())
+        sprSubtreeLiks_.push_back(lik);
+      else
+        sprSubtreeLiks_[subtreeIds.size()] = lik;
+      subtreeIds.push_back(rootId);
+    };
+    applyBranch_(likelihoodData->getLikelihoodArrayRef(nodeId, son2->getId()), false, scratch.pxy, scratch.lik.array);
+    scratch.lik.freqs = false;
+    scratch.lik.counts = likelihoodData->getScalingCounts(nodeId, son2->getId());
+    enumerateBranches_(son1, node, scratch.lik, 1, rerootRadius, addRoot);
+    applyBranch_(likelihoodData->getLikelihoodArrayRef(nodeId, son1->getId()), false, scratch.pxy, scratch.lik.array);
+    scratch.lik.counts = likelihoodData->getScalingCounts(nodeId, son1->getId());
+    enumerateBranches_(son2, node, scratch.lik, 1, rerootRadius, addRoot);
+  }
+
+  // Score all regraft positions for all root positions:
+  double brLen = node->getDistanceToFather();
+  auto score = [&](int regraftId, const SPRPartial& lik, size_t firstRoot) {
+    for (size_t k = firstRoot; k < subtreeIds.size(); k++)
+    {
+      double optimizedBrLen;
+      double diff = evaluateSPR_(lik, sprSubtreeLiks_[k], brLen, optimizedBrLen);
+      regraftIds.push_back(regraftId);
+      rerootIds.push_back(subtreeIds[k]);
+      diffs.push_back(diff);
+      brLenSPRValues_[make_tuple(nodeId, regraftId, subtreeIds[k])] = optimizedBrLen;
+    }
+  };
+
+  // The father node is removed, and the grand father and brother nodes are joined:
+  double mergedLength = father->getDistanceToFather() + brother->getDistanceToFather();
+  ConstLikelihoodArrayRef grandFatherArray = likelihoodData->getLikelihoodArrayRef(father->getId(), grandFather->getId());
+  const vector<int>* grandFatherCounts = &likelihoodData->getScalingCounts(father->getId(), grandFather->getId());
+  ConstLikelihoodArrayRef brotherArray = likelihoodData->getLikelihoodArrayRef(father->getId(), brother->getId());
+  const vector<int>* brotherCounts = &likelihoodData->getScalingCounts(father->getId(), brother->getId());
+
+  // With a rerooted subtree, regrafting on the joined branch is a valid movement:
+  if (subtreeIds.size() > 1)
+  {
+    likelihoodData->getLikelihoodArraySnapshot(father->getId(), grandFather->getId(), scratch.lik.array);
+    scratch.lik.freqs = true;
+    scratch.lik.counts = *grandFatherCounts;
+    computeMiddlePartial_(scratch.lik, brotherArray, false, *brotherCounts, mergedLength, scratch);
+    score(brother->getId(), scratch.middleLik, 1);
+  }
+
+  if (regraftRadius > 0)
+  {
+    auto scoreAll = [&](int regraftId, const SPRPartial& lik) { score(regraftId, lik, 0); };
+    computeTransitionProbabilities_(mergedLength, scratch.pxy);
+    applyBranch_(grandFatherArray, true, scratch.pxy, scratch.lik.array);
+    scratch.lik.freqs = true;
+    scratch.lik.counts = *grandFatherCounts;
+    enumerateBranches_(brother, father, scratch.lik, 1, regraftRadius, scoreAll);
+    applyBranch_(brotherArray, false, scratch.pxy, scratch.lik.array);
+    scratch.lik.freqs = false;
+    scratch.lik.counts = *brotherCounts;
+    enumerateBranches_(grandFather, father, scratch.lik, 1, regraftRadius, scoreAll);
+  }
+}
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::enumerateBranches_(
+  const Node* node,
+  const Node* from,
+  const SPRPartial& fromLik,
+  unsigned int depth,
+  unsigned int maxDepth,
+  const std::function<void (int, const SPRPartial&)>& f) const
+{
+  if (node->isLeaf()) return;
+  const DRASDRTreeLikelihoodData* likelihoodData = getLikelihoodData();
+  // Deeper calls use the next working arrays, so these ones remain valid during the whole loop:
+  SPRScratch& scratch = sprScratch_[depth];
+
+  // Likelihoods of all other neighbors, brought to the current node:
+  vector<const Node*>& neighbors = scratch.neighbors;
+  neighbors.clear();
+  for (int n = (node->hasFather() ? -1 : 0); n < static_cast<int>(node->getNumberOfSons()); n++)
+  {
+    const Node* neighbor = (*node)[n];
+    if (neighbor != from)
+      neighbors.push_back(neighbor);
+  }
+  if (scratch.neighborLiks.size() < neighbors.size())
+    scratch.neighborLiks.resize(neighbors.size());
+  for (size_t k = 0; k < neighbors.size(); k++)
+    getNeighborPartial_(node, neighbors[k], scratch.neighborLiks[k]);
+
+  SPRPartial& lik = scratch.lik;
+  SPRPartial& nextLik = scratch.nextLik;
+  for (size_t k = 0; k < neighbors.size(); k++)
+  {
+    const Node* neighbor = neighbors[k];
+    // Likelihoods at the current node of the part of the tree which does not contain the neighbor:
+    lik = fromLik;
+    for (size_t l = 0; l < neighbors.size(); l++)
+    {
+      if (l != k)
+        multiplyPartials_(scratch.neighborLiks[l], lik);
+    }
+    rescalePartial_(lik);
+
+    const Node* lowerNode = (neighbor == node->getFather() ? node : neighbor);
+    double length = lowerNode->getDistanceToFather();
+    computeMiddlePartial_(lik,
+                          likelihoodData->getLikelihoodArrayRef(node->getId(), neighbor->getId()),
+                          neighbor == node->getFather(),
+                          likelihoodData->getScalingCounts(node->getId(), neighbor->getId()),
+                          length, scratch);
+    f(lowerNode->getId(), scratch.middleLik);
+
+    if (depth < maxDepth)
+    {
+      // The branch is not modified: its transition probabilities are the ones of the tree.
+      applyBranch_(lik.array, lik.freqs, pxy_.at(lowerNode->getId()), nextLik.array);
+      nextLik.freqs = lik.freqs;
+      nextLik.counts = lik.counts;
+      enumerateBranches_(neighbor, node, nextLik, depth + 1, maxDepth, f);
+    }
+  }
+}
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::computeTransitionProbabilities_(double length, VVVdouble& pxy) const
+{
+  pxy.resize(nbClasses_);
+  for (size_t c = 0; c < nbClasses_; c++)
+  {
+    const Matrix<double>& p = model_->getPij_t(length * rateDistribution_->getCategory(c));
+    VVdouble* pxy_c = &pxy[c];
+    pxy_c->resize(nbStates_);
+    for (size_t x = 0; x < nbStates_; x++)
+    {
+      Vdouble* pxy_c_x = &(*pxy_c)[x];
+      pxy_c_x->resize(nbStates_);
+      for (size_t y = 0; y < nbStates_; y++)
+      {
+        (*pxy_c_x)[y] = p(x, y);
+      }
+    }
+  }
+}
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::applyBranch_(const ConstLikelihoodArrayRef& iLik, bool freqs, const VVVdouble& pxy, VVVdouble& oLik) const
+{
+  // With a reversible model, likelihoods which account for the ancestral frequencies
+  // are propagated from the root, otherwise toward the root:
+  VectorTools::resize3(oLik, nbDistinctSites_, nbClasses_, nbStates_);
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+  {
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      const double* iLik_i_c = iLik(i, c);
+      Vdouble* oLik_i_c = &oLik[i][c];
+      const VVdouble* pxy_c = &pxy[c];
+      for (size_t x = 0; x < nbStates_; x++)
+      {
+        double l = 0;
+        if (freqs)
+        {
+          for (size_t y = 0; y < nbStates_; y++)
+            l += iLik_i_c[y] * (*pxy_c)[y][x];
+        }
+        else
+        {
+          const Vdouble* pxy_c_x = &(*pxy_c)[x];
+          for (size_t y = 0; y < nbStates_; y++)
+            l += (*pxy_c_x)[y] * iLik_i_c[y];
+        }
+        (*oLik_i_c)[x] = l;
+      }
+    }
+  }
+}
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::getNeighborPartial_(const Node* node, const Node* neighbor, SPRPartial& oLik) const
+{
+  const DRASDRTreeLikelihoodData* likelihoodData = getLikelihoodData();
+  bool freqs = (neighbor == node->getFather());
+  const Node* lowerNode = (freqs ? node : neighbor);
+  applyBranch_(likelihoodData->getLikelihoodArrayRef(node->getId(), neighbor->getId()), freqs, pxy_.at(lowerNode->getId()), oLik.array);
+  oLik.freqs = freqs;
+  oLik.counts = likelihoodData->getScalingCounts(node->getId(), neighbor->getId());
+}
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::multiplyPartials_(const SPRPartial& iLik, SPRPartial& oLik) const
+{
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+  {
+    for (size_t c = 0; c < nbClasses_; c++)
+    {
+      const Vdouble* iLik_i_c = &iLik.array[i][c];
+      Vdouble* oLik_i_c = &oLik.array[i][c];
+      for (size_t x = 0; x < nbStates_; x++)
+        (*oLik_i_c)[x] *= (*iLik_i_c)[x];
+    }
+    oLik.counts[i] += iLik.counts[i];
+  }
+  oLik.freqs = oLik.freqs || iLik.freqs;
+}
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::rescalePartial_(SPRPartial& lik) const
+{
+  if (!usesLikelihoodScaling()) return;
+  for (size_t i = 0; i < nbDistinctSites_; i++)
+    lik.counts[i] += rescaleSiteLikelihoods(lik.array[i]);
+}
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::computeMiddlePartial_(
+  const SPRPartial& lik1,
+  const ConstLikelihoodArrayRef& array2,
+  bool freqs2,
+  const vector<int>& counts2,
+  double length,
+  SPRScratch& scratch) const
+{
+  // The branch is split in two halves of equal length, which share the same transition probabilities:
+  computeTransitionProbabilities_(length / 2., scratch.pxy);
+  SPRPartial& oLik = scratch.middleLik;
+  applyBranch_(lik1.array, lik1.freqs, scratch.pxy, oLik.array);
+  oLik.freqs = lik1.freqs;
+  oLik.counts = lik1.counts;
+  SPRPartial& lik2 = scratch.lik2;
+  applyBranch_(array2, freqs2, scratch.pxy, lik2.array);
+  lik2.freqs = freqs2;
+  lik2.counts = counts2;
+  multiplyPartials_(lik2, oLik);
+  rescalePartial_(oLik);
+}
+
+/*******************************************************************************/
+double SPRHomogeneousTreeLikelihood::evaluateSPR_(const SPRPartial& lik1, const SPRPartial& lik2, double brLen, double& optimizedBrLen) const
+{
+  // The ancestral frequencies must be accounted for exactly once, in the first array:
+  const SPRPartial* upperLik = (lik2.freqs ? &lik2 : &lik1);
+  const SPRPartial* lowerLik = (lik2.freqs ? &lik1 : &lik2);
+  if (!upperLik->freqs)
+  {
+    sprRootLik_ = *upperLik;
+    for (size_t i = 0; i < nbDistinctSites_; i++)
+      for (size_t c = 0; c < nbClasses_; c++)
+        for (size_t x = 0; x < nbStates_; x++)
+          sprRootLik_.array[i][c][x] *= rootFreqs_[x];
+    upperLik = &sprRootLik_;
+  }
+
+  // If likelihood arrays are scaled, sum the scaling counts of both arrays:
+  double logScaling = 0;
+  if (usesLikelihoodScaling())
+  {
+    const vector<unsigned int>* weights = &getLikelihoodData()->getWeights();
+    for (size_t i = 0; i < nbDistinctSites_; i++)
+      logScaling += (*weights)[i] * getLogScalingFactor(upperLik->counts[i] + lowerLik->counts[i]);
+  }
+
+  // Initialize BranchLikelihood:
+  brLikFunction_->initModel(model_, rateDistribution_);
+  brLikFunction_->initLikelihoods(&upperLik->array, &lowerLik->array);
+  ParameterList parameters;
+  double initBrLen = max(minimumBrLen_, min(maximumBrLen_, brLen));
+  parameters.addParameter(Parameter("BrLen", initBrLen, brLenConstraint_.get()));
+  brLikFunction_->setParameters(parameters);
+
+  // Re-estimate branch length:
+  brentOptimizer_->setFunction(brLikFunction_);
+  brentOptimizer_->getStopCondition()->setTolerance(0.1);
+  brentOptimizer_->setInitialInterval(initBrLen, initBrLen + 0.01);
+  brentOptimizer_->init(parameters);
+  brentOptimizer_->optimize();
+  optimizedBrLen = brentOptimizer_->getParameters().getParameter("BrLen").getValue();
+  double value = brentOptimizer_->getFunctionValue();
+  brLikFunction_->resetLikelihoods(); // Working arrays will be overwritten by the next evaluation.
+
+  // Return the resulting likelihood, which is the one obtained after applying the movement with the estimated branch length:
+  return value + logScaling - getValue();
+}
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::doSPR(int nodeId, int regraftId, int rerootId) throw (NodeException)
+{
+  Node* node = tree_->getNode(nodeId);
+  if (!node->hasFather()) throw NodePException("SPRHomogeneousTreeLikelihood::doSPR(). Node must not be the root node.", node);
+  Node* father = node->getFather();
+  if (!father->hasFather()) throw NodePException("SPRHomogeneousTreeLikelihood::doSPR(). The father node must not be the root node.", father);
+  if (father->getNumberOfSons() != 2) throw NodePException("SPRHomogeneousTreeLikelihood::doSPR(). The father node must have exactly two sons.", father);
+  Node* grandFather = father->getFather();
+  Node* brother = father->getSon(father->getSon(0) == node ? 1 : 0);
+  Node* regraftNode = tree_->getNode(regraftId);
+  if (regraftNode == father || (regraftNode == brother && rerootId == nodeId))
+    throw NodePException("SPRHomogeneousTreeLikelihood::doSPR(). Invalid regraft node.", regraftNode);
+  for (const Node* n = regraftNode; n->hasFather(); n = n->getFather())
+  {
+    if (n == node)
+      throw NodePException("SPRHomogeneousTreeLikelihood::doSPR(). The regraft node must not be in the pruned subtree.", regraftNode);
+  }
+  if (!regraftNode->hasFather() && regraftNode != brother)
+    throw NodePException("SPRHomogeneousTreeLikelihood::doSPR(). The regraft node must not be the root node.", regraftNode);
+
+  // Estimated length of the branch connecting the subtree:
+  double brLen = node->getDistanceToFather();
+  map<tuple<int, int, int>, double>::const_iterator it = brLenSPRValues_.find(make_tuple(nodeId, regraftId, rerootId));
+  if (it != brLenSPRValues_.end())
+    brLen = it->second;
+
+  vector<Node*> changedNodes;
+  if (rerootId != nodeId)
+  {
+    // Reroot the subtree: the two sons of the node are joined,
+    // and the node is inserted on the branch above the reroot node.
+    Node* rerootNode = tree_->getNode(rerootId);
+    if (node->getNumberOfSons() != 2)
+      throw NodePException("SPRHomogeneousTreeLikelihood::doSPR(). The pruned node must have exactly two sons to be rerooted.", node);
+    if (!rerootNode->hasFather() || rerootNode->getFather() == node)
+      throw NodePException("SPRHomogeneousTreeLikelihood::doSPR(). Invalid reroot node.", rerootNode);
+    // Path from the son of the node to the father of the reroot node:
+    vector<Node*> path;
+    for (Node* n = rerootNode->getFather(); n != node; n = n->getFather())
+    {
+      if (!n->hasFather())
+        throw NodePException("SPRHomogeneousTreeLikelihood::doSPR(). The reroot node must be in the pruned subtree.", rerootNode);
+      path.push_back(n);
+    }
+    reverse(path.begin(), path.end());
+    Node* son = path.front();
+    Node* otherSon = node->getSon(node->getSon(0) == son ? 1 : 0);
+    double rerootLength = rerootNode->getDistanceToFather();
+
+    node->removeSon(son);
+    node->removeSon(otherSon);
+    son->addSon(otherSon);
+    otherSon->setDistanceToFather(son->getDistanceToFather() + otherSon->getDistanceToFather());
+    changedNodes.push_back(otherSon);
+
+    path.back()->removeSon(rerootNode);
+    for (size_t i = 1; i < path.size(); i++)
+    {
+      // Reverse the branch between path[i - 1] and path[i]:
+      double length = path[i]->getDistanceToFather();
+      path[i - 1]->removeSon(path[i]);
+      path[i]->addSon(path[i - 1]);
+      path[i - 1]->setDistanceToFather(length);
+      changedNodes.push_back(path[i - 1]);
+    }
+    node->addSon(rerootNode);
+    node->addSon(path.back());
+    rerootNode->setDistanceToFather(rerootLength / 2.);
+    path.back()->setDistanceToFather(rerootLength / 2.);
+    changedNodes.push_back(rerootNode);
+    changedNodes.push_back(path.back());
+  }
+
+  // Prune: remove the father node and join the grand father and brother nodes.
+  size_t pos = grandFather->getSonPosition(father);
+  father->removeSon(brother);
+  grandFather->removeSon(father);
+  grandFather->addSon(pos, brother);
+  brother->setDistanceToFather(father->getDistanceToFather() + brother->getDistanceToFather());
+  changedNodes.push_back(brother);
+
+  // Regraft: insert the father node on the branch above the regraft node.
+  Node* regraftFather = regraftNode->getFather();
+  double regraftLength = regraftNode->getDistanceToFather();
+  pos = regraftFather->getSonPosition(regraftNode);
+  regraftFather->removeSon(regraftNode);
+  regraftFather->addSon(pos, father);
+  father->addSon(regraftNode);
+  regraftNode->setDistanceToFather(regraftLength / 2.);
+  father->setDistanceToFather(regraftLength / 2.);
+  node->setDistanceToFather(brLen);
+  changedNodes.push_back(regraftNode);
+  changedNodes.push_back(father);
+  changedNodes.push_back(node);
+
+  for (size_t i = 0; i < changedNodes.size(); i++)
+    setBranchLengthForTopologyChange_(changedNodes[i], changedNodes[i]->getDistanceToFather());
+}
+
+/*******************************************************************************/
+void SPRHomogeneousTreeLikelihood::setBranchLengthForTopologyChange_(Node* node, double length)
+{
+  length = max(minimumBrLen_, min(maximumBrLen_, length));
+  node->setDistanceToFather(length);
+  string name = "BrLen" + TextTools::toString(getBranchIndex_(node->getId()));
+  brLenParameters_.setParameterValue(name, length);
+  getParameter_(name).setValue(length);
+  if (brLenNNIParams_.hasParameter(name))
+    brLenNNIParams_.setParameterValue(name, length);
+  else
+  {
+    brLenNNIParams_.addParameter(brLenParameters_.getParameter(name));
+    // As for NNIs, the constraint is not needed here:
+    brLenNNIParams_[brLenNNIParams_.size() - 1].removeConstraint();
+  }
+}
+
+/*******************************************************************************/
+
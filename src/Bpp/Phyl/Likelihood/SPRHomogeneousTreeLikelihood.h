@@ -0,0 +1,337 @@
+//
+// File: SPRHomogeneousTreeLikelihood.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _SPRHOMOGENEOUSTREELIKELIHOOD_H_
+#define _SPRHOMOGENEOUSTREELIKELIHOOD_H_
+
+#include "NNIHomogeneousTreeLikelihood.h"
+#include "../SPRSearchable.h"
+
+// From the STL:
+#include <map>
+#include <tuple>
+#include <functional>
+
+namespace bpp
+{
+
+/**
+ * @brief This class adds support for SPR and TBR topology estimation to the NNIHomogeneousTreeLikelihood class.
+ *
+ * All regraft positions of a subtree are scored at once, without recomputing the likelihood of the whole tree.
+ * Starting from the pruning point, the conditional likelihoods of the pruned tree are updated incrementally
+ * from the ones stored in the likelihood data object, branch after branch, up to the given radius.
+ * The same is done within the pruned subtree for the reroot positions of TBR movements.
+ *
+ * When testing a movement, the branch to which the subtree is regrafted is split in two branches of equal length,
+ * the two branches joined by the pruning are merged into a single branch with the sum of their lengths,
+ * and only the length of the branch connecting the subtree is optimized (roughly).
+ * A movement performed with doSPR() uses exactly these branch lengths,
+ * so that the score variation of a movement is the one of the likelihood after its application.
+ *
+ * As the pruned subtree may be attached anywhere in the tree, the substitution model is assumed to be reversible.
+ *
+ * Working arrays are allocated once for each depth of the enumeration, and reused from one call to the other.
+ * The transition probabilities of the branches of the tree are read from the ones already computed,
+ * only the ones of the branches which are split or joined by a movement are computed.
+ */
+class SPRHomogeneousTreeLikelihood :
+  public NNIHomogeneousTreeLikelihood,
+  public virtual SPRSearchable
+{
+protected:
+  /**
+   * @brief Estimated branch lengths of the tested movements, indexed by (node, regraft node, reroot node).
+   */
+  mutable std::map<std::tuple<int, int, int>, double> brLenSPRValues_;
+
+  /**
+   * @brief A conditional likelihood array together with its scaling counts.
+   *
+   * The array is the likelihood of a part of the tree, conditioned on the state at one node.
+   * If 'freqs' is true, the part contains the root of the tree and the array accounts for the
+   * ancestral frequencies.
+   */
+  struct SPRPartial
+  {
+    VVVdouble array;
+    bool freqs;
+    std::vector<int> counts;
+
+    SPRPartial() : array(), freqs(false), counts() {}
+  };
+
+  /**
+   * @brief Working arrays used at one depth of the enumeration of branches.
+   */
+  struct SPRScratch
+  {
+    std::vector<const Node*> neighbors;
+    std::vector<SPRPartial> neighborLiks;
+    SPRPartial lik, nextLik, middleLik, lik2;
+    VVVdouble pxy;
+
+    SPRScratch() : neighbors(), neighborLiks(), lik(), nextLik(), middleLik(), lik2(), pxy() {}
+  };
+
+  /**
+   * @brief Working arrays, indexed by depth (see enumerateBranches_()).
+   */
+  mutable std::vector<SPRScratch> sprScratch_;
+
+  /**
+   * @brief Likelihoods of the pruned subtree for each of its root positions, only the first ones are used.
+   */
+  mutable std::vector<SPRPartial> sprSubtreeLiks_;
+
+  /**
+   * @brief Working array used to account for the ancestral frequencies in evaluateSPR_().
+   */
+  mutable SPRPartial sprRootLik_;
+
+public:
+  /**
+   * @brief Build a new SPRHomogeneousTreeLikelihood object.
+   *
+   * @param tree The tree to use.
+   * @param model The substitution model to use.
+   * @param rDist The rate across sites distribution to use.
+   * @param checkRooted Tell if we have to check for the tree to be unrooted.
+   * If true, any rooted tree will be unrooted before likelihood computation.
+   * @param verbose Should I display some info?
+   * @throw Exception in an error occured.
+   */
+  SPRHomogeneousTreeLikelihood(
+    const Tree& tree,
+    SubstitutionModel* model,
+    DiscreteDistribution* rDist,
+    bool checkRooted = true,
+    bool verbose = true)
+  throw (Exception) :
+    NNIHomogeneousTreeLikelihood(tree, model, rDist, checkRooted, verbose),
+    brLenSPRValues_(),
+    sprScratch_(),
+    sprSubtreeLiks_(),
+    sprRootLik_()
+  {}
+
+  /**
+   * @brief Build a new SPRHomogeneousTreeLikelihood object.
+   *
+   * @param tree The tree to use.
+   * @param data Sequences to use.
+   * @param model The substitution model to use.
+   * @param rDist The rate across sites distribution to use.
+   * @param checkRooted Tell if we have to check for the tree to be unrooted.
+   * If true, any rooted tree will be unrooted before likelihood computation.
+   * @param verbose Should I display some info?
+   * @throw Exception in an error occured.
+   */
+  SPRHomogeneousTreeLikelihood(
+    const Tree& tree,
+    const SiteContainer& data,
+    SubstitutionModel* model,
+    DiscreteDistribution* rDist,
+    bool checkRooted = true,
+    bool verbose = true)
+  throw (Exception) :
+    NNIHomogeneousTreeLikelihood(tree, data, model, rDist, checkRooted, verbose),
+    brLenSPRValues_(),
+    sprScratch_(),
+    sprSubtreeLiks_(),
+    sprRootLik_()
+  {}
+
+  SPRHomogeneousTreeLikelihood(const SPRHomogeneousTreeLikelihood& lik) :
+    NNIHomogeneousTreeLikelihood(lik),
+    brLenSPRValues_(lik.brLenSPRValues_),
+    sprScratch_(),
+    sprSubtreeLiks_(),
+    sprRootLik_()
+  {}
+
+  SPRHomogeneousTreeLikelihood& operator=(const SPRHomogeneousTreeLikelihood& lik)
+  {
+    NNIHomogeneousTreeLikelihood::operator=(lik);
+    brLenSPRValues_ = lik.brLenSPRValues_;
+    return *this;
+  }
+
+  virtual ~SPRHomogeneousTreeLikelihood() {}
+
+  SPRHomogeneousTreeLikelihood* clone() const { return new SPRHomogeneousTreeLikelihood(*this); }
+
+public:
+  /**
+   * @name The SPRSearchable interface.
+   *
+   * As for NNIs, performing a movement only changes the topology and the branch lengths,
+   * the likelihood data have to be re-initialized by calling the topologyChangePerformed() method.
+   * @{
+   */
+  const Tree& getTopology() const { return getTree(); }
+
+  double getTopologyValue() const throw (Exception) { return getValue(); }
+
+  void testSPRs(
+      int nodeId,
+      unsigned int regraftRadius,
+      unsigned int rerootRadius,
+      std::vector<int>& regraftIds,
+      std::vector<int>& rerootIds,
+      std::vector<double>& diffs) const throw (NodeException);
+
+  void doSPR(int nodeId, int regraftId, int rerootId) throw (NodeException);
+
+  void topologyChangeSuccessful(const TopologyChangeEvent& event)
+  {
+    NNIHomogeneousTreeLikelihood::topologyChangeSuccessful(event);
+    brLenSPRValues_.clear();
+  }
+  /** @} */
+
+protected:
+  /**
+   * @brief Compute the transition probabilities of a branch, for all rate classes.
+   *
+   * @param length The length of the branch.
+   * @param pxy [out] The [class][state][state] probabilities.
+   */
+  void computeTransitionProbabilities_(double length, VVVdouble& pxy) const;
+
+  /**
+   * @brief Compute the likelihoods at a node from the likelihoods at the other end of a branch.
+   *
+   * @param iLik The likelihoods at the other end of the branch.
+   * @param freqs Tell if iLik accounts for the ancestral frequencies.
+   * @param pxy The transition probabilities of the branch.
+   * @param oLik [out] The likelihoods at the node.
+   */
+  void applyBranch_(const ConstLikelihoodArrayRef& iLik, bool freqs, const VVVdouble& pxy, VVVdouble& oLik) const;
+
+  /**
+   * @brief Multiply likelihoods by the ones of another part of the tree at the same node.
+   *
+   * @param iLik The likelihoods to multiply by.
+   * @param oLik [in,out] The likelihoods to update.
+   */
+  void multiplyPartials_(const SPRPartial& iLik, SPRPartial& oLik) const;
+
+  /**
+   * @brief Rescale likelihoods if likelihood scaling is used.
+   *
+   * @param lik The likelihoods to rescale.
+   */
+  void rescalePartial_(SPRPartial& lik) const;
+
+  /**
+   * @brief Retrieve the likelihoods of the part of the tree containing a neighbor, when the branch between a node and this neighbor is cut,
+   * at the neighbor, and bring them to the node.
+   *
+   * @param node The node.
+   * @param neighbor The neighbor.
+   * @param oLik [out] The likelihoods at the node.
+   */
+  void getNeighborPartial_(const Node* node, const Node* neighbor, SPRPartial& oLik) const;
+
+  /**
+   * @brief Compute the likelihoods at the middle of a branch.
+   *
+   * @param lik1 The likelihoods of the part of the tree at one end of the branch.
+   * @param array2 The likelihoods of the part of the tree at the other end of the branch.
+   * @param freqs2 Tell if array2 accounts for the ancestral frequencies.
+   * @param counts2 The scaling counts of array2.
+   * @param length The length of the branch.
+   * @param scratch [in,out] The working arrays to use, lik1 must not be one of them.
+   * The likelihoods at the middle of the branch are stored in scratch.middleLik.
+   */
+  void computeMiddlePartial_(
+      const SPRPartial& lik1,
+      const ConstLikelihoodArrayRef& array2,
+      bool freqs2,
+      const std::vector<int>& counts2,
+      double length,
+      SPRScratch& scratch) const;
+
+  /**
+   * @brief Recursively enumerate all branches within a given distance, and compute the likelihoods at their middle.
+   *
+   * The likelihoods of each visited branch (node, son) are computed from the likelihoods at node of the part of the tree
+   * which does not contain son, and from the stored likelihoods of the part which contains son.
+   *
+   * @param node The current node.
+   * @param from The node from which the current node was reached, which is not visited.
+   * @param fromLik The likelihoods at the current node of the part of the tree containing 'from'.
+   * @param depth The distance of the branches of the current node, also the index of the working arrays used.
+   * sprScratch_ must have more than maxDepth elements.
+   * @param maxDepth The maximum distance.
+   * @param f The function to call for each visited branch, with the id of the lower node of the branch and its likelihoods.
+   */
+  void enumerateBranches_(
+      const Node* node,
+      const Node* from,
+      const SPRPartial& fromLik,
+      unsigned int depth,
+      unsigned int maxDepth,
+      const std::function<void (int, const SPRPartial&)>& f) const;
+
+  /**
+   * @brief Optimize the length of the branch connecting two parts of the tree, and return the corresponding score variation.
+   *
+   * @param lik1 The likelihoods of the first part at the middle of the branch.
+   * @param lik2 The likelihoods of the second part at the middle of the branch.
+   * @param brLen The initial branch length.
+   * @param optimizedBrLen [out] The estimated branch length.
+   * @return The likelihood variation.
+   */
+  double evaluateSPR_(const SPRPartial& lik1, const SPRPartial& lik2, double brLen, double& optimizedBrLen) const;
+
+  /**
+   * @brief Set a branch length and the corresponding parameter, and record it for the next topologyChangeTested() call.
+   *
+   * @param node The node defining the branch.
+   * @param length The new length.
+   */
+  void setBranchLengthForTopologyChange_(Node* node, double length);
+};
+
+} // end of namespace bpp.
+
+#endif  // _SPRHOMOGENEOUSTREELIKELIHOOD_H_
+
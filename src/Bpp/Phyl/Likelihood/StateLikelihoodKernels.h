@@ -0,0 +1,360 @@
+//
+// File: StateLikelihoodKernels.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#ifndef _STATELIKELIHOODKERNELS_H_
+#define _STATELIKELIHOODKERNELS_H_
+
+#include <Bpp/Numeric/VectorTools.h>
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Likelihood loops instantiated for a fixed number of states.
+ *
+ * The number of states being a compile-time constant, the compiler can fully unroll the
+ * loops over states, and keep the transition matrix of a rate class in registers or in a
+ * local, contiguous array while iterating over sites.
+ * Sites outside the range [siteBegin, siteEnd) are not accessed, so that distinct ranges can be
+ * computed in parallel. Loops are ordered by rate class first and then by site, and the matrix is stored transposed
+ * so that the innermost loop runs over contiguous output states and can be vectorized.
+ * None of this changes the order of the floating point operations for a given site and state.
+ *
+ * The generic implementation, for any number of states, is obtained with N = 0.
+ *
+ * @see StateLikelihoodKernels
+ */
+template<size_t N>
+class FixedStateLikelihoodKernels
+{
+  private:
+    /**
+     * @brief Number of states rounded up to a multiple of 4, used as the row length of local arrays.
+     *
+     * Padding values are kept to 0, so that loops over output states have a trip count that can
+     * be vectorized without any remainder.
+     */
+    static const size_t NP = ((N + 3) / 4) * 4;
+
+  public:
+    /**
+     * @brief Multiply conditional likelihoods by the likelihoods of a son node.
+     *
+     * For each site i, rate class c and state x:
+     * @f[ L_{out}(i, c, x) \leftarrow L_{out}(i, c, x) \times \sum_y P_c(x, y) \times L_{in}(p(i), c, y), @f]
+     * where p(i) is the position of site i in the input array.
+     *
+     * @param pxy The transition probabilities (or their derivatives), as a [c][x][y] array.
+     * @param iLik The input likelihood array.
+     * @param positions The positions of sites in the input array, or NULL if the arrays are aligned.
+     * @param oLik The output likelihood array.
+     * @param siteBegin The first site to compute in the output array.
+     * @param siteEnd The site after the last one to compute in the output array.
+     * @param nbClasses The number of rate classes.
+     * @param nbStates The number of states, ignored if N > 0.
+     */
+    static void multiply(
+      const VVVdouble& pxy,
+      const VVVdouble& iLik,
+      const std::vector<size_t>* positions,
+      VVVdouble& oLik,
+      size_t siteBegin,
+      size_t siteEnd,
+      size_t nbClasses,
+      size_t /*nbStates*/)
+    {
+      double m[N][NP] = { { 0 } };
+      for (size_t c = 0; c < nbClasses; c++)
+      {
+        const VVdouble* pxy_c = &pxy[c];
+        for (size_t x = 0; x < N; x++)
+        {
+          const Vdouble* pxy_c_x = &(*pxy_c)[x];
+          for (size_t y = 0; y < N; y++)
+            m[y][x] = (*pxy_c_x)[y];
+        }
+        for (size_t i = siteBegin; i < siteEnd; i++)
+        {
+          const double* iLik_i_c = &iLik[positions ? (*positions)[i] : i][c][0];
+          double* oLik_i_c = &oLik[i][c][0];
+          double likelihoods[NP] = { 0 };
+          for (size_t y = 0; y < N; y++)
+          {
+            double iLik_i_c_y = iLik_i_c[y];
+            for (size_t x = 0; x < NP; x++)
+              likelihoods[x] += m[y][x] * iLik_i_c_y;
+          }
+          for (size_t x = 0; x < N; x++)
+            oLik_i_c[x] *= likelihoods[x];
+        }
+      }
+    }
+
+    /**
+     * @brief Compute the derivatives of the site likelihoods according to a branch length.
+     *
+     * For each site i:
+     * @f[ D(i) = \frac{\sum_c p_c \sum_x L_{up}(i, c, x) \sum_y P'_c(x, y) \times L_{down}(i, c, y)}{L(i)}. @f]
+     *
+     * @param dpxy The derivatives of the transition probabilities, as a [c][x][y] array.
+     * @param likelihoodsFatherNode The likelihoods of the subtree under the branch.
+     * @param likelihoodsFather The likelihoods of the rest of the tree, at the father node.
+     * @param probabilities The probabilities of each rate class.
+     * @param rootLikelihoods The likelihood of each site.
+     * @param derivatives The output array.
+     * @param siteBegin The first site to compute.
+     * @param siteEnd The site after the last one to compute.
+     * @param nbClasses The number of rate classes.
+     * @param nbStates The number of states, ignored if N > 0.
+     */
+    static void derivative(
+      const VVVdouble& dpxy,
+      const VVVdouble& likelihoodsFatherNode,
+      const VVVdouble& likelihoodsFather,
+      const Vdouble& probabilities,
+      const Vdouble& rootLikelihoods,
+      Vdouble& derivatives,
+      size_t siteBegin,
+      size_t siteEnd,
+      size_t nbClasses,
+      size_t /*nbStates*/)
+    {
+      double m[N][NP] = { { 0 } };
+      for (size_t i = siteBegin; i < siteEnd; i++)
+        derivatives[i] = 0;
+      for (size_t c = 0; c < nbClasses; c++)
+      {
+        const VVdouble* dpxy_c = &dpxy[c];
+        for (size_t x = 0; x < N; x++)
+        {
+          const Vdouble* dpxy_c_x = &(*dpxy_c)[x];
+          for (size_t y = 0; y < N; y++)
+            m[y][x] = (*dpxy_c_x)[y];
+        }
+        double p = probabilities[c];
+        for (size_t i = siteBegin; i < siteEnd; i++)
+        {
+          const double* likelihoodsFatherNode_i_c = &likelihoodsFatherNode[i][c][0];
+          const double* likelihoodsFather_i_c = &likelihoodsFather[i][c][0];
+          double dLicx[NP] = { 0 };
+          for (size_t y = 0; y < N; y++)
+          {
+            double likelihoodsFatherNode_i_c_y = likelihoodsFatherNode_i_c[y];
+            for (size_t x = 0; x < NP; x++)
+              dLicx[x] += m[y][x] * likelihoodsFatherNode_i_c_y;
+          }
+          double dLic = 0;
+          for (size_t x = 0; x < N; x++)
+            dLic += dLicx[x] * likelihoodsFather_i_c[x];
+          derivatives[i] += p * dLic;
+        }
+      }
+      for (size_t i = siteBegin; i < siteEnd; i++)
+        derivatives[i] /= rootLikelihoods[i];
+    }
+};
+
+/**
+ * @brief Generic implementation, for any number of states.
+ */
+template<>
+class FixedStateLikelihoodKernels<0>
+{
+  public:
+    static void multiply(
+      const VVVdouble& pxy,
+      const VVVdouble& iLik,
+      const std::vector<size_t>* positions,
+      VVVdouble& oLik,
+      size_t siteBegin,
+      size_t siteEnd,
+      size_t nbClasses,
+      size_t nbStates)
+    {
+      for (size_t c = 0; c < nbClasses; c++)
+      {
+        const VVdouble* pxy_c = &pxy[c];
+        for (size_t i = siteBegin; i < siteEnd; i++)
+        {
+          const Vdouble* iLik_i_c = &iLik[positions ? (*positions)[i] : i][c];
+          Vdouble* oLik_i_c = &oLik[i][c];
+          for (size_t x = 0; x < nbStates; x++)
+          {
+            const Vdouble* pxy_c_x = &(*pxy_c)[x];
+            double likelihood = 0;
+            for (size_t y = 0; y < nbStates; y++)
+              likelihood += (*pxy_c_x)[y] * (*iLik_i_c)[y];
+            (*oLik_i_c)[x] *= likelihood;
+          }
+        }
+      }
+    }
+
+    static void derivative(
+      const VVVdouble& dpxy,
+      const VVVdouble& likelihoodsFatherNode,
+      const VVVdouble& likelihoodsFather,
+      const Vdouble& probabilities,
+      const Vdouble& rootLikelihoods,
+      Vdouble& derivatives,
+      size_t siteBegin,
+      size_t siteEnd,
+      size_t nbClasses,
+      size_t nbStates)
+    {
+      for (size_t i = siteBegin; i < siteEnd; i++)
+        derivatives[i] = 0;
+      for (size_t c = 0; c < nbClasses; c++)
+      {
+        const VVdouble* dpxy_c = &dpxy[c];
+        double p = probabilities[c];
+        for (size_t i = siteBegin; i < siteEnd; i++)
+        {
+          const Vdouble* likelihoodsFatherNode_i_c = &likelihoodsFatherNode[i][c];
+          const Vdouble* likelihoodsFather_i_c = &likelihoodsFather[i][c];
+          double dLic = 0;
+          for (size_t x = 0; x < nbStates; x++)
+          {
+            const Vdouble* dpxy_c_x = &(*dpxy_c)[x];
+            double dLicx = 0;
+            for (size_t y = 0; y < nbStates; y++)
+              dLicx += (*dpxy_c_x)[y] * (*likelihoodsFatherNode_i_c)[y];
+            dLic += dLicx * (*likelihoodsFather_i_c)[x];
+          }
+          derivatives[i] += p * dLic;
+        }
+      }
+      for (size_t i = siteBegin; i < siteEnd; i++)
+        derivatives[i] /= rootLikelihoods[i];
+    }
+};
+
+/**
+ * @brief Dispatch likelihood loops to the implementation matching the number of states.
+ *
+ * Specialized instantiations are available for nucleotides (4 states), proteins (20 states)
+ * and codons (61 states, standard genetic code). Other alphabets use the generic loops.
+ *
+ * @see FixedStateLikelihoodKernels
+ */
+class StateLikelihoodKernels
+{
+  public:
+    /**
+     * @return True if a specialized implementation is available for this number of states.
+     * @param nbStates The number of states.
+     */
+    static bool isSpecialized(size_t nbStates)
+    {
+      return nbStates == 4 || nbStates == 20 || nbStates == 61;
+    }
+
+    /**
+     * @brief Multiply conditional likelihoods by the likelihoods of a son node.
+     *
+     * @see FixedStateLikelihoodKernels::multiply
+     */
+    static void multiply(
+      const VVVdouble& pxy,
+      const VVVdouble& iLik,
+      const std::vector<size_t>* positions,
+      VVVdouble& oLik,
+      size_t siteBegin,
+      size_t siteEnd,
+      size_t nbClasses,
+      size_t nbStates)
+    {
+      switch (nbStates)
+      {
+      case 4:
+        FixedStateLikelihoodKernels<4>::multiply(pxy, iLik, positions, oLik, siteBegin, siteEnd, nbClasses, nbStates);
+        break;
+      case 20:
+        FixedStateLikelihoodKernels<20>::multiply(pxy, iLik, positions, oLik, siteBegin, siteEnd, nbClasses, nbStates);
+        break;
+      case 61:
+        FixedStateLikelihoodKernels<61>::multiply(pxy, iLik, positions, oLik, siteBegin, siteEnd, nbClasses, nbStates);
+        break;
+      default:
+        FixedStateLikelihoodKernels<0>::multiply(pxy, iLik, positions, oLik, siteBegin, siteEnd, nbClasses, nbStates);
+      }
+    }
+
+    /**
+     * @brief Compute the derivatives of the site likelihoods according to a branch length.
+     *
+     * @see FixedStateLikelihoodKernels::derivative
+     */
+    static void derivative(
+      const VVVdouble& dpxy,
+      const VVVdouble& likelihoodsFatherNode,
+      const VVVdouble& likelihoodsFather,
+      const Vdouble& probabilities,
+      const Vdouble& rootLikelihoods,
+      Vdouble& derivatives,
+      size_t siteBegin,
+      size_t siteEnd,
+      size_t nbClasses,
+      size_t nbStates)
+    {
+      switch (nbStates)
+      {
+      case 4:
+        FixedStateLikelihoodKernels<4>::derivative(dpxy, likelihoodsFatherNode, likelihoodsFather, probabilities, rootLikelihoods, derivatives, siteBegin, siteEnd, nbClasses, nbStates);
+        break;
+      case 20:
+        FixedStateLikelihoodKernels<20>::derivative(dpxy, likelihoodsFatherNode, likelihoodsFather, probabilities, rootLikelihoods, derivatives, siteBegin, siteEnd, nbClasses, nbStates);
+        break;
+      case 61:
+        FixedStateLikelihoodKernels<61>::derivative(dpxy, likelihoodsFatherNode, likelihoodsFather, probabilities, rootLikelihoods, derivatives, siteBegin, siteEnd, nbClasses, nbStates);
+        break;
+      default:
+        FixedStateLikelihoodKernels<0>::derivative(dpxy, likelihoodsFatherNode, likelihoodsFather, probabilities, rootLikelihoods, derivatives, siteBegin, siteEnd, nbClasses, nbStates);
+      }
+    }
+};
+
+} //end of namespace bpp.
+
+#endif //_STATELIKELIHOODKERNELS_H_
+
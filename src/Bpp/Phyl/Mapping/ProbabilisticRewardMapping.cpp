@@ -44,16 +44,36 @@ using namespace bpp;
 void ProbabilisticRewardMapping::setTree(const Tree& tree)
 {
   AbstractRewardMapping::setTree(tree);
-  for (size_t i = 0; i < getNumberOfSites(); i++) 
+  for (size_t i = 0; i < mapping_.size(); i++) 
     mapping_[i].resize(getNumberOfBranches());
 }
 
 void ProbabilisticRewardMapping::setNumberOfSites(size_t numberOfSites)
 {
+  expand();
   AbstractRewardMapping::setNumberOfSites(numberOfSites);
   mapping_.resize(numberOfSites);
   for (size_t i = 0; i < numberOfSites; i++) {
     mapping_[i].resize(getNumberOfBranches());
   }
 }
- 
+
+void ProbabilisticRewardMapping::setSitePatterns(const std::vector<size_t>& patternIndices, size_t numberOfPatterns)
+{
+  AbstractRewardMapping::setNumberOfSites(patternIndices.size());
+  patternIndices_ = patternIndices;
+  mapping_.assign(numberOfPatterns, std::vector<double>(getNumberOfBranches(), 0.));
+}
+
+void ProbabilisticRewardMapping::expand()
+{
+  if (!isCompressed())
+    return;
+  std::vector< std::vector<double> > patterns;
+  patterns.swap(mapping_);
+  mapping_.resize(patternIndices_.size());
+  for (size_t i = 0; i < patternIndices_.size(); i++)
+    mapping_[i] = patterns[patternIndices_[i]];
+  patternIndices_.clear();
+}
+
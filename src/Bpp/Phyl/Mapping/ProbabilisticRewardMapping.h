@@ -69,9 +69,13 @@ namespace bpp
     /**
      * @brief Rewards storage.
      *
-     * Rewards are stored by sites.
+     * Rewards are stored by sites, or by site patterns if the mapping is compressed.
      */
     std::vector< std::vector<double> > mapping_;
+    /**
+     * @brief Pattern of each site, empty if the mapping is not compressed.
+     */
+    std::vector<size_t> patternIndices_;
     
   public:
     
@@ -83,10 +87,25 @@ namespace bpp
      * @param numberOfSites The number of sites to map.
      */
     ProbabilisticRewardMapping(const Tree& tree, const Reward* reward, size_t numberOfSites) :
-      AbstractMapping(tree), AbstractRewardMapping(tree), reward_(reward), mapping_(0)
+      AbstractMapping(tree), AbstractRewardMapping(tree), reward_(reward), mapping_(0), patternIndices_()
     {
       setNumberOfSites(numberOfSites);
     }
+
+    /**
+     * @brief Build a new ProbabilisticRewardMapping object, storing rewards per site pattern.
+     *
+     * @param tree The tree object to use. It will be cloned for internal use.
+     * @param reward A pointer toward the Reward object that has been used for the mapping, if any.
+     * @param patternIndices The index of the pattern of each site to map.
+     * @param numberOfPatterns The number of distinct site patterns.
+     * @see setSitePatterns
+     */
+    ProbabilisticRewardMapping(const Tree& tree, const Reward* reward, const std::vector<size_t>& patternIndices, size_t numberOfPatterns) :
+      AbstractMapping(tree), AbstractRewardMapping(tree), reward_(reward), mapping_(0), patternIndices_()
+    {
+      setSitePatterns(patternIndices, numberOfPatterns);
+    }
     
     /**
      * @brief Build a new ProbabilisticRewardMapping object.
@@ -94,14 +113,14 @@ namespace bpp
      * @param tree The tree object to use. It will be cloned for internal use.
      */
     ProbabilisticRewardMapping(const Tree& tree) :
-    AbstractMapping(tree), AbstractRewardMapping(tree), reward_(0), mapping_(0)
+    AbstractMapping(tree), AbstractRewardMapping(tree), reward_(0), mapping_(0), patternIndices_()
     {}
     
 
     ProbabilisticRewardMapping* clone() const { return new ProbabilisticRewardMapping(*this); }
 
     ProbabilisticRewardMapping(const ProbabilisticRewardMapping& prm):
-    AbstractMapping(prm), AbstractRewardMapping(prm), reward_(prm.reward_), mapping_(prm.mapping_)
+    AbstractMapping(prm), AbstractRewardMapping(prm), reward_(prm.reward_), mapping_(prm.mapping_), patternIndices_(prm.patternIndices_)
     {}
 
     ProbabilisticRewardMapping& operator=(const ProbabilisticRewardMapping& prm)
@@ -109,6 +128,7 @@ namespace bpp
       AbstractRewardMapping::operator=(prm);
       reward_  = prm.reward_;
       mapping_ = prm.mapping_;
+      patternIndices_ = prm.patternIndices_;
       return *this;
     }
 
@@ -118,7 +138,7 @@ namespace bpp
 
     virtual double getReward(int nodeId, size_t siteIndex) const
     {
-      return mapping_[siteIndex][getNodeIndex(nodeId)];
+      return mapping_[getPatternIndex(siteIndex)][getNodeIndex(nodeId)];
     }
     
     /**
@@ -128,7 +148,50 @@ namespace bpp
      */
     virtual void setTree(const Tree& tree);
 
+    /**
+     * @brief Set the number of sites of the mapping.
+     *
+     * A compressed mapping is expanded first.
+     *
+     * @param numberOfSites The new number of sites.
+     */
     virtual void setNumberOfSites(size_t numberOfSites);
+
+    /**
+     * @brief Store rewards per site pattern.
+     *
+     * All sites with the same pattern then share their rewards, and modifying
+     * the reward of one of them modifies the rewards of all the others.
+     * The number of sites is set to the size of patternIndices, and all rewards are reset to 0.
+     *
+     * @param patternIndices The index of the pattern of each site.
+     * @param numberOfPatterns The number of distinct site patterns.
+     */
+    void setSitePatterns(const std::vector<size_t>& patternIndices, size_t numberOfPatterns);
+
+    /**
+     * @brief Store rewards per site again, copying the rewards of each pattern to all its sites.
+     */
+    void expand();
+
+    /**
+     * @return True if rewards are stored per site pattern.
+     */
+    bool isCompressed() const { return patternIndices_.size() > 0; }
+
+    /**
+     * @return The number of site patterns stored, which is the number of sites if the mapping is not compressed.
+     */
+    size_t getNumberOfPatterns() const { return mapping_.size(); }
+
+    /**
+     * @return The index of the pattern of a site, which is the site index if the mapping is not compressed.
+     * @param siteIndex The index of the site.
+     */
+    size_t getPatternIndex(size_t siteIndex) const
+    {
+      return patternIndices_.size() > 0 ? patternIndices_[siteIndex] : siteIndex;
+    }
     
     /**
      * @brief Direct access to rewards.
@@ -137,7 +200,7 @@ namespace bpp
      */
     virtual double& operator()(size_t nodeIndex, size_t siteIndex)
     {
-      return mapping_[siteIndex][nodeIndex];
+      return mapping_[getPatternIndex(siteIndex)][nodeIndex];
     }
 
     /**
@@ -147,7 +210,7 @@ namespace bpp
      */
     virtual const double& operator()(size_t nodeIndex, size_t siteIndex) const
     {
-      return mapping_[siteIndex][nodeIndex];
+      return mapping_[getPatternIndex(siteIndex)][nodeIndex];
     }
      
     /**
@@ -157,7 +220,7 @@ namespace bpp
      */
     std::vector<double>& operator[](size_t siteIndex)
     {
-      return mapping_[siteIndex];
+      return mapping_[getPatternIndex(siteIndex)];
     }
 
     /**
@@ -167,7 +230,18 @@ namespace bpp
      */
     const std::vector<double>& operator[](size_t siteIndex) const
     {
-      return mapping_[siteIndex];
+      return mapping_[getPatternIndex(siteIndex)];
+    }
+
+    /**
+     * @brief Direct access to the rewards of a site pattern.
+     *
+     * @param patternIndex The index of the pattern (see getPatternIndex()).
+     * @warning No index checking is performed, use with care!
+     */
+    std::vector<double>& getPatternRewards(size_t patternIndex)
+    {
+      return mapping_[patternIndex];
     }
 };
 
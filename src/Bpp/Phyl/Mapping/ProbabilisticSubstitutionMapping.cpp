@@ -41,26 +41,123 @@ knowledge of the CeCILL license and that you accept its terms.
 
 using namespace bpp;
 
+// From the STL:
+#include <algorithm>
+
+using namespace std;
+
+/******************************************************************************/
+
 void ProbabilisticSubstitutionMapping::setTree(const Tree& tree)
 {
   AbstractSubstitutionMapping::setTree(tree);
-  for (size_t i = 0; i < getNumberOfSites(); i++) {
-    mapping_[i].resize(getNumberOfBranches());
-    for (size_t j = 0; j < getNumberOfBranches(); j++) {
-      mapping_[i][j].resize(1);
-    }
-  }
+  nbTypes_ = getNumberOfSubstitutionTypes();
+  updateStrides_();
+  mapping_.assign(getNumberOfBranches() * nbPatterns_ * nbTypes_, 0.);
 }
 
+/******************************************************************************/
+
 void ProbabilisticSubstitutionMapping::setNumberOfSites(size_t numberOfSites)
 {
+  expand();
+  size_t oldNbSites = (mapping_.size() > 0 ? nbPatterns_ : 0);
+  size_t oldNbTypes = nbTypes_;
+  size_t oldSiteStride = siteStride_;
+  size_t oldBranchStride = branchStride_;
+  vector<double> oldMapping;
+  oldMapping.swap(mapping_);
+
   AbstractSubstitutionMapping::setNumberOfSites(numberOfSites);
-  mapping_.resize(numberOfSites);
-  for (size_t i = 0; i < numberOfSites; i++) {
-    mapping_[i].resize(getNumberOfBranches());
-    for (size_t j = 0; j < getNumberOfBranches(); j++) {
-      mapping_[i][j].resize(getNumberOfSubstitutionTypes());
+  nbPatterns_ = numberOfSites;
+  nbTypes_ = getNumberOfSubstitutionTypes();
+  updateStrides_();
+  mapping_.assign(getNumberOfBranches() * numberOfSites * nbTypes_, 0.);
+
+  // Keep the numbers already stored:
+  size_t nbSites = min(oldNbSites, numberOfSites);
+  size_t nbTypes = min(oldNbTypes, nbTypes_);
+  for (size_t j = 0; j < getNumberOfBranches(); j++)
+  {
+    for (size_t i = 0; i < nbSites; i++)
+    {
+      const double* from = &oldMapping[j * oldBranchStride + i * oldSiteStride];
+      copy(from, from + nbTypes, &mapping_[j * branchStride_ + i * siteStride_]);
     }
   }
 }
- 
+
+/******************************************************************************/
+
+void ProbabilisticSubstitutionMapping::setLayout(Layout layout)
+{
+  if (layout == layout_)
+    return;
+  vector<double> oldMapping(mapping_);
+  size_t oldSiteStride = siteStride_;
+  size_t oldBranchStride = branchStride_;
+  layout_ = layout;
+  updateStrides_();
+  for (size_t j = 0; j < getNumberOfBranches(); j++)
+  {
+    for (size_t i = 0; i < nbPatterns_; i++)
+    {
+      const double* from = &oldMapping[j * oldBranchStride + i * oldSiteStride];
+      copy(from, from + nbTypes_, &mapping_[j * branchStride_ + i * siteStride_]);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void ProbabilisticSubstitutionMapping::setSitePatterns(const vector<size_t>& patternIndices, size_t numberOfPatterns)
+{
+  AbstractSubstitutionMapping::setNumberOfSites(patternIndices.size());
+  patternIndices_ = patternIndices;
+  nbPatterns_ = numberOfPatterns;
+  nbTypes_ = getNumberOfSubstitutionTypes();
+  updateStrides_();
+  mapping_.assign(getNumberOfBranches() * nbPatterns_ * nbTypes_, 0.);
+}
+
+/******************************************************************************/
+
+void ProbabilisticSubstitutionMapping::expand()
+{
+  if (!isCompressed())
+    return;
+  vector<double> oldMapping;
+  oldMapping.swap(mapping_);
+  vector<size_t> patternIndices;
+  patternIndices.swap(patternIndices_);
+  size_t oldSiteStride = siteStride_;
+  size_t oldBranchStride = branchStride_;
+  nbPatterns_ = getNumberOfSites();
+  updateStrides_();
+  mapping_.resize(getNumberOfBranches() * nbPatterns_ * nbTypes_);
+  for (size_t j = 0; j < getNumberOfBranches(); j++)
+  {
+    for (size_t i = 0; i < nbPatterns_; i++)
+    {
+      const double* from = &oldMapping[j * oldBranchStride + patternIndices[i] * oldSiteStride];
+      copy(from, from + nbTypes_, &mapping_[j * branchStride_ + i * siteStride_]);
+    }
+  }
+}
+
+/******************************************************************************/
+
+void ProbabilisticSubstitutionMapping::updateStrides_()
+{
+  if (layout_ == SITE_MAJOR)
+  {
+    branchStride_ = nbTypes_;
+    siteStride_   = getNumberOfBranches() * nbTypes_;
+  }
+  else
+  {
+    siteStride_   = nbTypes_;
+    branchStride_ = nbPatterns_ * nbTypes_;
+  }
+}
+
@@ -63,14 +63,68 @@ namespace bpp
 class ProbabilisticSubstitutionMapping:
   public AbstractSubstitutionMapping
 {
+  public:
+    /**
+     * @brief Storage orders of the substitution numbers.
+     *
+     * With both layouts, the numbers of all types for a given branch and site are contiguous.
+     */
+    enum Layout
+    {
+      SITE_MAJOR,  ///< All branches of a site are contiguous.
+      BRANCH_MAJOR ///< All sites of a branch are contiguous.
+    };
+
+    /**
+     * @brief View on the substitution numbers of one site, as returned by operator[].
+     *
+     * view[nodeIndex][type] is the number of substitutions of a given type on a branch.
+     */
+    template<class T>
+    class SiteView
+    {
+      private:
+        T* data_;
+        size_t branchStride_;
+        size_t nbBranches_;
+
+      public:
+        SiteView(T* data, size_t branchStride, size_t nbBranches) :
+          data_(data), branchStride_(branchStride), nbBranches_(nbBranches) {}
+
+      public:
+        /**
+         * @return A pointer toward the numbers of all types for a branch.
+         * @param nodeIndex The index of the branch.
+         */
+        T* operator[](size_t nodeIndex) const { return data_ + nodeIndex * branchStride_; }
+
+        size_t size() const { return nbBranches_; }
+    };
+
   private:
     const SubstitutionCount* substitutionCount_;
+    Layout layout_;
+    size_t nbTypes_;
+    size_t siteStride_;
+    size_t branchStride_;
     /**
      * @brief Substitution numbers storage.
      *
-     * Numbers are stored by sites.
+     * Numbers are stored in a single buffer, in the order given by layout_:
+     * the number of type t for branch l and site pattern p is at l * branchStride_ + p * siteStride_ + t.
+     */
+    std::vector<double> mapping_;
+    /**
+     * @brief Number of site patterns stored.
+     *
+     * Equal to the number of sites if the mapping is not compressed.
      */
-    std::vector< std::vector< std::vector<double> > > mapping_;
+    size_t nbPatterns_;
+    /**
+     * @brief Pattern of each site, empty if the mapping is not compressed.
+     */
+    std::vector<size_t> patternIndices_;
   
   public:
     
@@ -82,34 +136,62 @@ class ProbabilisticSubstitutionMapping:
      * This object allows to get the substitution types description, if there are several. If set to 0, then
      * the mapping will be considered as having only one type of substitution mapped.
      * @param numberOfSites The number of sites to map.
+     * @param layout The storage order of the substitution numbers.
      */
-    ProbabilisticSubstitutionMapping(const Tree& tree, const SubstitutionCount* sc, size_t numberOfSites) :
-      AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(sc), mapping_(0)
+    ProbabilisticSubstitutionMapping(const Tree& tree, const SubstitutionCount* sc, size_t numberOfSites, Layout layout = SITE_MAJOR) :
+      AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(sc), layout_(layout),
+      nbTypes_(0), siteStride_(0), branchStride_(0), mapping_(0), nbPatterns_(0), patternIndices_()
     {
       setNumberOfSites(numberOfSites);
     }
 
+    /**
+     * @brief Build a new ProbabilisticSubstitutionMapping object, storing numbers per site pattern.
+     *
+     * @param tree The tree object to use. It will be cloned for internal use.
+     * @param sc A pointer toward the substitution count object that has been used for the mapping, if any.
+     * @param patternIndices The index of the pattern of each site to map.
+     * @param numberOfPatterns The number of distinct site patterns.
+     * @param layout The storage order of the substitution numbers.
+     * @see setSitePatterns
+     */
+    ProbabilisticSubstitutionMapping(const Tree& tree, const SubstitutionCount* sc, const std::vector<size_t>& patternIndices, size_t numberOfPatterns, Layout layout = SITE_MAJOR) :
+      AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(sc), layout_(layout),
+      nbTypes_(0), siteStride_(0), branchStride_(0), mapping_(0), nbPatterns_(0), patternIndices_()
+    {
+      setSitePatterns(patternIndices, numberOfPatterns);
+    }
+
     /**
      * @brief Build a new ProbabilisticSubstitutionMapping object.
      *
      * @param tree The tree object to use. It will be cloned for internal use.
      */
     ProbabilisticSubstitutionMapping(const Tree& tree) :
-    AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(0), mapping_(0)
+    AbstractMapping(tree), AbstractSubstitutionMapping(tree), substitutionCount_(0), layout_(SITE_MAJOR),
+    nbTypes_(0), siteStride_(0), branchStride_(0), mapping_(0), nbPatterns_(0), patternIndices_()
     {}
     
 
     ProbabilisticSubstitutionMapping* clone() const { return new ProbabilisticSubstitutionMapping(*this); }
 
     ProbabilisticSubstitutionMapping(const ProbabilisticSubstitutionMapping& psm):
-    AbstractMapping(psm), AbstractSubstitutionMapping(psm), substitutionCount_(psm.substitutionCount_), mapping_(psm.mapping_)
+    AbstractMapping(psm), AbstractSubstitutionMapping(psm), substitutionCount_(psm.substitutionCount_), layout_(psm.layout_),
+    nbTypes_(psm.nbTypes_), siteStride_(psm.siteStride_), branchStride_(psm.branchStride_), mapping_(psm.mapping_),
+    nbPatterns_(psm.nbPatterns_), patternIndices_(psm.patternIndices_)
     {}
 
     ProbabilisticSubstitutionMapping& operator=(const ProbabilisticSubstitutionMapping& psm)
     {
       AbstractSubstitutionMapping::operator=(psm);
       substitutionCount_ = psm.substitutionCount_;
+      layout_            = psm.layout_;
+      nbTypes_           = psm.nbTypes_;
+      siteStride_        = psm.siteStride_;
+      branchStride_      = psm.branchStride_;
       mapping_           = psm.mapping_;
+      nbPatterns_        = psm.nbPatterns_;
+      patternIndices_    = psm.patternIndices_;
       return *this;
     }
 
@@ -125,22 +207,102 @@ class ProbabilisticSubstitutionMapping:
      
     virtual double getNumberOfSubstitutions(int nodeId, size_t siteIndex, size_t type) const
     {
-      return mapping_[siteIndex][getNodeIndex(nodeId)][type];
+      return mapping_[getNodeIndex(nodeId) * branchStride_ + getPatternIndex(siteIndex) * siteStride_ + type];
     }
     
     virtual std::vector<double> getNumberOfSubstitutions(int nodeId, size_t siteIndex) const
     {
-      return mapping_[siteIndex][getNodeIndex(nodeId)];
+      const double* values = &mapping_[getNodeIndex(nodeId) * branchStride_ + getPatternIndex(siteIndex) * siteStride_];
+      return std::vector<double>(values, values + nbTypes_);
     }
     
     /**
      * @brief (Re)-set the phylogenetic tree associated to this mapping.
      *
+     * All substitution numbers are reset to 0.
+     *
      * @param tree The new tree.
      */
     virtual void setTree(const Tree& tree);
 
+    /**
+     * @brief Set the number of sites of the mapping.
+     *
+     * Numbers already stored for the remaining sites are kept.
+     * A compressed mapping is expanded first.
+     *
+     * @param numberOfSites The new number of sites.
+     */
     virtual void setNumberOfSites(size_t numberOfSites);
+
+    /**
+     * @return The storage order of the substitution numbers.
+     */
+    Layout getLayout() const { return layout_; }
+
+    /**
+     * @brief Change the storage order of the substitution numbers.
+     *
+     * @param layout The new layout.
+     */
+    void setLayout(Layout layout);
+
+    /**
+     * @brief Store substitution numbers per site pattern.
+     *
+     * All sites with the same pattern then share their numbers, and modifying
+     * the numbers of one of them modifies the numbers of all the others.
+     * The number of sites is set to the size of patternIndices, and all numbers are reset to 0.
+     *
+     * @param patternIndices The index of the pattern of each site.
+     * @param numberOfPatterns The number of distinct site patterns.
+     */
+    void setSitePatterns(const std::vector<size_t>& patternIndices, size_t numberOfPatterns);
+
+    /**
+     * @brief Store substitution numbers per site again, copying the numbers of each pattern to all its sites.
+     */
+    void expand();
+
+    /**
+     * @return True if substitution numbers are stored per site pattern.
+     */
+    bool isCompressed() const { return patternIndices_.size() > 0; }
+
+    /**
+     * @return The number of site patterns stored, which is the number of sites if the mapping is not compressed.
+     */
+    size_t getNumberOfPatterns() const { return nbPatterns_; }
+
+    /**
+     * @return The index of the pattern of a site in the buffer, which is the site index if the mapping is not compressed.
+     * @param siteIndex The index of the site.
+     */
+    size_t getPatternIndex(size_t siteIndex) const
+    {
+      return patternIndices_.size() > 0 ? patternIndices_[siteIndex] : siteIndex;
+    }
+
+    /**
+     * @brief Direct access to the buffer of substitution numbers.
+     *
+     * The number of type t for branch l and site i is at
+     * l * getBranchStride() + getPatternIndex(i) * getSiteStride() + t.
+     *
+     * @warning No index checking is performed, use with care!
+     */
+    double* getData() { return mapping_.size() > 0 ? &mapping_[0] : 0; }
+    const double* getData() const { return mapping_.size() > 0 ? &mapping_[0] : 0; }
+
+    /**
+     * @return The distance in the buffer between the numbers of two consecutive site patterns on a branch.
+     */
+    size_t getSiteStride() const { return siteStride_; }
+
+    /**
+     * @return The distance in the buffer between the numbers of two consecutive branches for a site pattern.
+     */
+    size_t getBranchStride() const { return branchStride_; }
     
     /**
      * @brief Direct access to substitution numbers.
@@ -149,7 +311,7 @@ class ProbabilisticSubstitutionMapping:
      */
     virtual double& operator()(size_t nodeIndex, size_t siteIndex, size_t type)
     {
-      return mapping_[siteIndex][nodeIndex][type];
+      return mapping_[nodeIndex * branchStride_ + getPatternIndex(siteIndex) * siteStride_ + type];
     }
 
     /**
@@ -159,28 +321,46 @@ class ProbabilisticSubstitutionMapping:
      */
     virtual const double& operator()(size_t nodeIndex, size_t siteIndex, size_t type) const
     {
-      return mapping_[siteIndex][nodeIndex][type];
+      return mapping_[nodeIndex * branchStride_ + getPatternIndex(siteIndex) * siteStride_ + type];
     }
-     
+
     /**
-     * @brief Direct access to substitution numbers.
+     * @brief Direct access to the substitution numbers of a site.
      *
+     * mapping[siteIndex][nodeIndex][type] is the same as mapping(nodeIndex, siteIndex, type).
+     *
+     * @deprecated The numbers are no longer stored as nested vectors. Use operator() or the
+     * strided buffer (see getData()) instead.
+     * If the mapping is empty, the returned view has no branch.
      * @warning No index checking is performed, use with care!
      */
-    std::vector< std::vector<double> >& operator[](size_t siteIndex)
+    SiteView<double> operator[](size_t siteIndex)
     {
-      return mapping_[siteIndex];
+      // An empty mapping (no branch or no type) gives an empty view:
+      if (mapping_.empty())
+        return SiteView<double>(0, branchStride_, 0);
+      return SiteView<double>(mapping_.data() + getPatternIndex(siteIndex) * siteStride_, branchStride_, getNumberOfBranches());
     }
 
     /**
-     * @brief Direct access to substitution numbers.
+     * @brief Direct access to the substitution numbers of a site.
      *
+     * @deprecated See the non-const version.
      * @warning No index checking is performed, use with care!
      */
-    const std::vector< std::vector<double> >& operator[](size_t siteIndex) const
+    SiteView<const double> operator[](size_t siteIndex) const
     {
-      return mapping_[siteIndex];
+      // An empty mapping (no branch or no type) gives an empty view:
+      if (mapping_.empty())
+        return SiteView<const double>(0, branchStride_, 0);
+      return SiteView<const double>(mapping_.data() + getPatternIndex(siteIndex) * siteStride_, branchStride_, getNumberOfBranches());
     }
+
+  private:
+    /**
+     * @brief Compute the strides of the buffer from the layout and the dimensions of the mapping.
+     */
+    void updateStrides_();
 };
 
 } //end of namespace bpp.
@@ -59,7 +59,8 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
   const DRTreeLikelihood& drtl,
   const vector<int>& nodeIds,
   Reward& reward,
-  bool verbose) throw (Exception)
+  bool verbose,
+  bool compressed) throw (Exception)
 {
   // Preamble:
   if (!drtl.isInitialized())
@@ -82,7 +83,9 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
   size_t nbNodes         = nodes.size();
 
   // We create a new ProbabilisticRewardMapping object:
-  ProbabilisticRewardMapping* rewards = new ProbabilisticRewardMapping(tree, &reward, nbSites);
+  ProbabilisticRewardMapping* rewards = compressed ?
+    new ProbabilisticRewardMapping(tree, &reward, *rootPatternLinks, nbDistinctSites) :
+    new ProbabilisticRewardMapping(tree, &reward, nbSites);
 
   // Store likelihood for each rate for each site:
   VVVdouble lik;
@@ -150,7 +153,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
       const Node* currentSon = father->getSon(n);
       if (currentSon->getId() != currentNode->getId())
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+        ConstLikelihoodArrayRef likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentSon->getId());
 
         // Now iterate over all site partitions:
         unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
@@ -170,11 +173,10 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
               pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
               first = false;
             }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
             VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
             for (size_t c = 0; c < nbClasses; c++)
             {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+              const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
               Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
               VVdouble* pxy_c = &pxy[c];
               for (size_t x = 0; x < nbStates; x++)
@@ -183,7 +185,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
                 double likelihood = 0.;
                 for (size_t y = 0; y < nbStates; y++)
                 {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
+                  likelihood += (*pxy_c_x)[y] * likelihoodsFather_son_i_c[y];
                 }
                 (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
               }
@@ -195,7 +197,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
     if (father->hasFather())
     {
       const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+      ConstLikelihoodArrayRef likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentSon->getId());
       // Now iterate over all site partitions:
       unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
       VVVdouble pxy;
@@ -214,11 +216,10 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
             pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
             first = false;
           }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
           VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
           for (size_t c = 0; c < nbClasses; c++)
           {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+            const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
             Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
             VVdouble* pxy_c = &pxy[c];
             for (size_t x = 0; x < nbStates; x++)
@@ -227,7 +228,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
               for (size_t y = 0; y < nbStates; y++)
               {
                 Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
+                likelihood += (*pxy_c_x)[x] * likelihoodsFather_son_i_c[y];
               }
               (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
             }
@@ -253,12 +254,29 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
       }
     }
 
+    // Likelihood arrays may be scaled: bring the father part to the scale of the root likelihoods.
+    for (size_t i = 0; i < nbDistinctSites; i++)
+    {
+      int count = drtl.getLikelihoodData()->getScalingCountAtNode(tree.getRootId(), i) - drtl.getLikelihoodData()->getScalingCountAtNode(father->getId(), i);
+      if (count == 0) continue;
+      double scale = AbstractDiscreteRatesAcrossSitesTreeLikelihood::getScalingFactor(count);
+      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+      for (size_t c = 0; c < nbClasses; c++)
+      {
+        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+        for (size_t x = 0; x < nbStates; x++)
+        {
+          (*likelihoodsFatherConstantPart_i_c)[x] *= scale;
+        }
+      }
+    }
+
     // Then, we deal with the node of interest.
     // We first average upon 'y' to save computations, and then upon 'x'.
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
+    ConstLikelihoodArrayRef likelihoodsFather_node = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentNode->getId());
     unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
     VVVdouble pxy;
     bool first;
@@ -298,11 +316,10 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
           pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
           first = false;
         }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
         VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
         for (size_t c = 0; c < nbClasses; ++c)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
+          const double* likelihoodsFather_node_i_c = likelihoodsFather_node(i, c);
           Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
           const VVdouble* pxy_c = &pxy[c];
           VVdouble* nxy_c = &nxy[c];
@@ -314,7 +331,7 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
             {
               double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
                                       * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
+                                      * likelihoodsFather_node_i_c[y];
 
               // Now the vector computation:
               rewardsForCurrentNode[i] += likelihood_cxy * (*nxy_c)[x][y];
@@ -331,9 +348,19 @@ ProbabilisticRewardMapping* RewardMappingTools::computeRewardVectors(
     }
 
     // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; ++i)
+    if (compressed)
     {
-      (*rewards)(l, i) = rewardsForCurrentNode[(*rootPatternLinks)[i]] / Lr[(*rootPatternLinks)[i]];
+      for (size_t i = 0; i < nbDistinctSites; ++i)
+      {
+        rewards->getPatternRewards(i)[l] = rewardsForCurrentNode[i] / Lr[i];
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < nbSites; ++i)
+      {
+        (*rewards)(l, i) = rewardsForCurrentNode[(*rootPatternLinks)[i]] / Lr[(*rootPatternLinks)[i]];
+      }
     }
   }
   if (verbose)
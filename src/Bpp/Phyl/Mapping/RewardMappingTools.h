@@ -75,6 +75,8 @@ public:
    *                          are computed on.
    * @param reward            The Reward to use.
    * @param verbose           Print info to screen.
+   * @param compressed        Store rewards per site pattern instead of per site
+   *                          (see ProbabilisticRewardMapping::setSitePatterns()).
    * @return A vector of reward vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
@@ -82,7 +84,8 @@ public:
     const DRTreeLikelihood& drtl,
     const std::vector<int>& nodeIds,
     Reward& reward,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    bool compressed = false) throw (Exception);
 
 
   /**
@@ -51,10 +51,17 @@
 #include <Bpp/Numeric/DataTable.h>
 #include <Bpp/Seq/AlphabetIndex/UserAlphabetIndex1.h>
 
+#include "../ThreadPool.h"
+
 using namespace bpp;
 
 // From the STL:
 #include <iomanip>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <stdint.h>
 
 using namespace std;
 
@@ -64,7 +71,9 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   const DRTreeLikelihood& drtl,
   const vector<int>& nodeIds,
   SubstitutionCount& substitutionCount,
-  bool verbose) throw (Exception)
+  bool verbose,
+  size_t nbThreads,
+  bool compressed) throw (Exception)
 {
   // Preamble:
   if (!drtl.isInitialized())
@@ -88,7 +97,9 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
   size_t nbNodes         = nodes.size();
 
   // We create a new ProbabilisticSubstitutionMapping object:
-  ProbabilisticSubstitutionMapping* substitutions = new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
+  ProbabilisticSubstitutionMapping* substitutions = compressed ?
+    new ProbabilisticSubstitutionMapping(tree, &substitutionCount, *rootPatternLinks, nbDistinctSites) :
+    new ProbabilisticSubstitutionMapping(tree, &substitutionCount, nbSites);
 
   // Store likelihood for each rate for each site:
   VVVdouble lik;
@@ -110,238 +121,268 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     }
   }
 
-  // Compute the number of substitutions for each class and each branch in the tree:
+  // Compute the number of substitutions for each class and each branch in the tree.
+  // Everything needed from the likelihood object and the substitution count is gathered first,
+  // as they are not safe to use concurrently. Branches are processed by chunks of one branch per
+  // thread, so that the transition probabilities and counts kept in memory do not depend on the
+  // size of the tree. Counts are computed only once for each model and each length, and kept in a
+  // cache of bounded size shared by all chunks, with the type dimension contiguous:
+  // counts[k][(x * nbStates + y) * nbTypes + t].
   if (verbose)
     ApplicationTools::displayTask("Compute joint node-pairs likelihood", true);
 
+  vector<size_t> branchIndices;
+  bool needsRootFrequencies = false;
   for (size_t l = 0; l < nbNodes; ++l)
   {
-    // For each node,
-    const Node* currentNode = nodes[l];
-    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, currentNode->getId()))
+    if (nodeIds.size() > 0 && !VectorTools::contains(nodeIds, nodes[l]->getId()))
       continue;
+    branchIndices.push_back(l);
+    if (!nodes[l]->getFather()->hasFather())
+      needsRootFrequencies = true;
+  }
+  size_t nbBranches = branchIndices.size();
 
-    const Node* father = currentNode->getFather();
+  // Account for root frequencies:
+  VVdouble rootFrequencies;
+  if (needsRootFrequencies)
+  {
+    rootFrequencies.resize(nbDistinctSites);
+    for (size_t i = 0; i < nbDistinctSites; i++)
+    {
+      rootFrequencies[i] = drtl.getRootFrequencies(i);
+    }
+  }
 
+  unique_ptr<ThreadPool> pool;
+  if (nbThreads != 1 && nbBranches > 1)
+    pool.reset(new ThreadPool(nbThreads));
+  size_t chunkSize = pool.get() ? pool->getNumberOfThreads() : 1;
+
+  // When the cache is full, the least recently used matrix is replaced. Matrices used by the current
+  // chunk are never replaced, so that the cache may exceed its size if a single chunk needs more.
+  size_t countsCacheSize = max(2 * chunkSize, static_cast<size_t>(16)) * nbClasses;
+  vector< vector<double> > counts;
+  map<pair<const SubstitutionModel*, double>, size_t> countsIndex;
+  vector< pair<const SubstitutionModel*, double> > countsKeys;
+  vector<size_t> countsLastUse;
+  size_t countsUse = 0;
+  size_t chunkFirstUse = 0;
+  const SubstitutionModel* currentModel = 0;
+  vector<BranchMappingData_> branches(chunkSize);
+
+  // Gather the data of the branch above nodes[l] into branch:
+  function<void (size_t, BranchMappingData_&)> gatherBranch = [&](size_t l, BranchMappingData_& branch)
+  {
+    const Node* currentNode = nodes[l];
+    const Node* father = currentNode->getFather();
     double d = currentNode->getDistanceToFather();
+    branch.index = l;
+    branch.neighbors.clear();
+    branch.parts.clear();
 
-    if (verbose)
-      ApplicationTools::displayGauge(l, nbNodes - 1);
-    VVdouble substitutionsForCurrentNode(nbDistinctSites);
-    for (size_t i = 0; i < nbDistinctSites; ++i)
+    // First, what will remain constant:
+    size_t nbSons = father->getNumberOfSons();
+    for (size_t n = 0; n < nbSons; n++)
     {
-      substitutionsForCurrentNode[i].resize(nbTypes);
+      const Node* currentSon = father->getSon(n);
+      if (currentSon->getId() != currentNode->getId())
+        getNeighborParts_(drtl, father->getId(), currentSon->getId(), currentSon->getId(), false, branch.neighbors);
     }
+    if (father->hasFather())
+      getNeighborParts_(drtl, father->getId(), father->getFather()->getId(), father->getId(), true, branch.neighbors);
+    branch.fatherIsRoot = !father->hasFather();
 
-    // Now we've got to compute likelihoods in a smart manner... ;)
-    VVVdouble likelihoodsFatherConstantPart(nbDistinctSites);
+    // Likelihood arrays may be scaled: bring the father part to the scale of the root likelihoods.
+    branch.scales.resize(nbDistinctSites);
     for (size_t i = 0; i < nbDistinctSites; i++)
     {
-      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-      likelihoodsFatherConstantPart_i->resize(nbClasses);
-      for (size_t c = 0; c < nbClasses; c++)
-      {
-        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-        likelihoodsFatherConstantPart_i_c->resize(nbStates);
-        double rc = rDist->getProbability(c);
-        for (size_t s = 0; s < nbStates; s++)
-        {
-          // (* likelihoodsFatherConstantPart_i_c)[s] = rc * model->freq(s);
-          // freq is already accounted in the array
-          (*likelihoodsFatherConstantPart_i_c)[s] = rc;
-        }
-      }
+      int count = drtl.getLikelihoodData()->getScalingCountAtNode(tree.getRootId(), i) - drtl.getLikelihoodData()->getScalingCountAtNode(father->getId(), i);
+      branch.scales[i] = (count == 0 ? 1. : AbstractDiscreteRatesAcrossSitesTreeLikelihood::getScalingFactor(count));
     }
 
-    // First, what will remain constant:
-    size_t nbSons =  father->getNumberOfSons();
-    for (size_t n = 0; n < nbSons; n++)
+    // Then, the node of interest:
+    branch.likelihoods = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentNode->getId());
+    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
+    while (mit->hasNext())
     {
-      const Node* currentSon = father->getSon(n);
-      if (currentSon->getId() != currentNode->getId())
+      TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
+      BranchMappingPart_ part;
+      unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
+      while (sit->hasNext())
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-
-        // Now iterate over all site partitions:
-        unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
-        VVVdouble pxy;
-        bool first;
-        while (mit->hasNext())
+        part.sites.push_back(sit->next());
+      }
+      if (part.sites.size() == 0)
+        continue;
+      // We retrieve the transition probabilities for this site partition:
+      part.pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), part.sites[0]);
+
+      // And the substitution counts, for each rate class:
+      const SubstitutionModel* model = bmd->getModel();
+      part.counts.resize(nbClasses);
+      for (size_t c = 0; c < nbClasses; ++c)
+      {
+        double length = d * rcRates[c];
+        pair<const SubstitutionModel*, double> key(model, length);
+        map<pair<const SubstitutionModel*, double>, size_t>::iterator it = countsIndex.find(key);
+        if (it != countsIndex.end())
         {
-          TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-          unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-          first = true;
-          while (sit->hasNext())
+          part.counts[c] = it->second;
+          countsLastUse[it->second] = ++countsUse;
+          continue;
+        }
+        if (model != currentModel)
+        {
+          substitutionCount.setSubstitutionModel(model);
+          currentModel = model;
+        }
+        size_t k = counts.size();
+        if (counts.size() >= countsCacheSize)
+        {
+          for (size_t j = 0; j < counts.size(); ++j)
           {
-            size_t i = sit->next();
-            // We retrieve the transition probabilities for this site partition:
-            if (first)
-            {
-              pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
-              first = false;
-            }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-            VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-            for (size_t c = 0; c < nbClasses; c++)
+            if (countsLastUse[j] <= chunkFirstUse && (k == counts.size() || countsLastUse[j] < countsLastUse[k]))
+              k = j;
+          }
+        }
+        if (k == counts.size())
+        {
+          counts.push_back(vector<double>(nbStates * nbStates * nbTypes));
+          countsKeys.push_back(key);
+          countsLastUse.push_back(0);
+        }
+        else
+        {
+          countsIndex.erase(countsKeys[k]);
+          countsKeys[k] = key;
+        }
+        vector<double>& nxy = counts[k];
+        for (size_t t = 0; t < nbTypes; ++t)
+        {
+          unique_ptr< Matrix<double> > nijt(substitutionCount.getAllNumbersOfSubstitutions(length, t + 1));
+          for (size_t x = 0; x < nbStates; ++x)
+          {
+            for (size_t y = 0; y < nbStates; ++y)
             {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-              Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-              VVdouble* pxy_c = &pxy[c];
-              for (size_t x = 0; x < nbStates; x++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[x];
-                double likelihood = 0.;
-                for (size_t y = 0; y < nbStates; y++)
-                {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
-                }
-                (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
-              }
+              nxy[(x * nbStates + y) * nbTypes + t] = (*nijt)(x, y);
             }
           }
         }
+        part.counts[c] = k;
+        countsIndex[key] = k;
+        countsLastUse[k] = ++countsUse;
       }
+      branch.parts.push_back(part);
     }
-    if (father->hasFather())
+  };
+
+  // Each branch of a chunk can now be processed independently, and only writes its own part of the mapping.
+  // Working arrays are allocated once for each position in the chunk:
+  // likelihoodsFatherConstantPart[(i * nbClasses + c) * nbStates + x]
+  // substitutionsForCurrentNode[i * nbTypes + t]
+  vector< vector<double> > likelihoodsFatherConstantParts(chunkSize, vector<double>(nbDistinctSites * nbClasses * nbStates));
+  vector< vector<double> > substitutionsForCurrentNodes(chunkSize, vector<double>(nbDistinctSites * nbTypes));
+  mutex displayMutex;
+  size_t nbBranchesDone = 0;
+  function<void (size_t)> mapBranch = [&](size_t b)
+  {
+    const BranchMappingData_* branch = &branches[b];
+
+    // Now we've got to compute likelihoods in a smart manner... ;)
+    vector<double>& likelihoodsFatherConstantPart = likelihoodsFatherConstantParts[b];
+    for (size_t i = 0; i < nbDistinctSites; i++)
     {
-      const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
-      // Now iterate over all site partitions:
-      unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
-      VVVdouble pxy;
-      bool first;
-      while (mit->hasNext())
+      for (size_t c = 0; c < nbClasses; c++)
       {
-        TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-        unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-        first = true;
-        while (sit->hasNext())
+        // freq is already accounted in the array
+        double rc = branch->scales[i] * rcProbs[c];
+        double* likelihoodsFatherConstantPart_i_c = &likelihoodsFatherConstantPart[(i * nbClasses + c) * nbStates];
+        for (size_t x = 0; x < nbStates; x++)
         {
-          size_t i = sit->next();
-          // We retrieve the transition probabilities for this site partition:
-          if (first)
-          {
-            pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
-            first = false;
-          }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
-          VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
-          for (size_t c = 0; c < nbClasses; c++)
+          likelihoodsFatherConstantPart_i_c[x] = rc;
+        }
+      }
+    }
+    for (size_t k = 0; k < branch->neighbors.size(); k++)
+    {
+      const BranchMappingPart_* part = &branch->neighbors[k];
+      for (size_t s = 0; s < part->sites.size(); s++)
+      {
+        size_t i = part->sites[s];
+        for (size_t c = 0; c < nbClasses; c++)
+        {
+          const double* likelihoodsFather_son_i_c = part->likelihoods(i, c);
+          double* likelihoodsFatherConstantPart_i_c = &likelihoodsFatherConstantPart[(i * nbClasses + c) * nbStates];
+          const VVdouble* pxy_c = &part->pxy[c];
+          for (size_t x = 0; x < nbStates; x++)
           {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
-            Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-            VVdouble* pxy_c = &pxy[c];
-            for (size_t x = 0; x < nbStates; x++)
+            double likelihood = 0.;
+            for (size_t y = 0; y < nbStates; y++)
             {
-              double likelihood = 0.;
-              for (size_t y = 0; y < nbStates; y++)
-              {
-                Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
-              }
-              (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
+              // The transition goes from the son to the father when the neighbor is the grand-father:
+              likelihood += (part->upward ? (*pxy_c)[y][x] : (*pxy_c)[x][y]) * likelihoodsFather_son_i_c[y];
             }
+            likelihoodsFatherConstantPart_i_c[x] *= likelihood;
           }
         }
       }
     }
-    else
+    if (branch->fatherIsRoot)
     {
-      // Account for root frequencies:
       for (size_t i = 0; i < nbDistinctSites; i++)
       {
-        vector<double> freqs = drtl.getRootFrequencies(i);
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+        const Vdouble* freqs = &rootFrequencies[i];
         for (size_t c = 0; c < nbClasses; c++)
         {
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+          double* likelihoodsFatherConstantPart_i_c = &likelihoodsFatherConstantPart[(i * nbClasses + c) * nbStates];
           for (size_t x = 0; x < nbStates; x++)
           {
-            (*likelihoodsFatherConstantPart_i_c)[x] *= freqs[x];
+            likelihoodsFatherConstantPart_i_c[x] *= (*freqs)[x];
           }
         }
       }
     }
 
-
     // Then, we deal with the node of interest.
     // We first average upon 'y' to save computations, and then upon 'x'.
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
-
-    // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
-    unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
-    VVVdouble pxy;
-    bool first;
-    while (mit->hasNext())
+    vector<double>& substitutionsForCurrentNode = substitutionsForCurrentNodes[b];
+    fill(substitutionsForCurrentNode.begin(), substitutionsForCurrentNode.end(), 0.);
+    for (size_t k = 0; k < branch->parts.size(); k++)
     {
-      TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
-      substitutionCount.setSubstitutionModel(bmd->getModel());
-      // compute all nxy first:
-      VVVVdouble nxy(nbClasses);
-      for (size_t c = 0; c < nbClasses; ++c)
+      const BranchMappingPart_* part = &branch->parts[k];
+      for (size_t s = 0; s < part->sites.size(); s++)
       {
-        VVVdouble* nxy_c = &nxy[c];
-        double rc = rcRates[c];
-        nxy_c->resize(nbTypes);
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          VVdouble* nxy_c_t = &(*nxy_c)[t];
-          Matrix<double>* nijt = substitutionCount.getAllNumbersOfSubstitutions(d * rc, t + 1);
-          nxy_c_t->resize(nbStates);
-          for (size_t x = 0; x < nbStates; ++x)
-          {
-            Vdouble* nxy_c_t_x = &(*nxy_c_t)[x];
-            nxy_c_t_x->resize(nbStates);
-            for (size_t y = 0; y < nbStates; ++y)
-            {
-              (*nxy_c_t_x)[y] = (*nijt)(x, y);
-            }
-          }
-          delete nijt;
-        }
-      }
-
-      // Now loop over sites:
-      unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
-      first = true;
-      while (sit->hasNext())
-      {
-        size_t i = sit->next();
-        // We retrieve the transition probabilities and substitution counts for this site partition:
-        if (first)
-        {
-          pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
-          first = false;
-        }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
-        VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+        size_t i = part->sites[s];
+        double* substitutionsForCurrentNode_i = &substitutionsForCurrentNode[i * nbTypes];
         for (size_t c = 0; c < nbClasses; ++c)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
-          Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
-          const VVdouble* pxy_c = &pxy[c];
-          VVVdouble* nxy_c = &nxy[c];
+          const double* likelihoodsFather_node_i_c = branch->likelihoods(i, c);
+          const double* likelihoodsFatherConstantPart_i_c = &likelihoodsFatherConstantPart[(i * nbClasses + c) * nbStates];
+          const VVdouble* pxy_c = &part->pxy[c];
+          const double* nxy_c = &counts[part->counts[c]][0];
           for (size_t x = 0; x < nbStates; ++x)
           {
-            double* likelihoodsFatherConstantPart_i_c_x = &(*likelihoodsFatherConstantPart_i_c)[x];
+            double likelihoodsFatherConstantPart_i_c_x = likelihoodsFatherConstantPart_i_c[x];
+            if (likelihoodsFatherConstantPart_i_c_x == 0) continue;
             const Vdouble* pxy_c_x = &(*pxy_c)[x];
             for (size_t y = 0; y < nbStates; ++y)
             {
-              double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
+              double likelihood_cxy = likelihoodsFatherConstantPart_i_c_x
                                       * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
-
+                                      * likelihoodsFather_node_i_c[y];
+              const double* nxy_c_x_y = nxy_c + (x * nbStates + y) * nbTypes;
               for (size_t t = 0; t < nbTypes; ++t)
               {
                 // Now the vector computation:
-                substitutionsForCurrentNode[i][t] += likelihood_cxy * (*nxy_c)[t][x][y];
-                //                                   <------------>   <--------------->
-                // Posterior probability                   |                 |
-                // for site i and rate class c *           |                 |
-                // likelihood for this site----------------+                 |
-                //                                                           |
-                // Substitution function for site i and rate class c----------+
+                substitutionsForCurrentNode_i[t] += likelihood_cxy * nxy_c_x_y[t];
+                //                                  <------------>   <----------->
+                // Posterior probability                  |                |
+                // for site i and rate class c *          |                |
+                // likelihood for this site---------------+                |
+                //                                                         |
+                // Substitution function for site i and rate class c-------+
               }
             }
           }
@@ -350,13 +391,49 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     }
 
     // Now we just have to copy the substitutions into the result vector:
-    for (size_t i = 0; i < nbSites; ++i)
+    if (compressed)
     {
-      for (size_t t = 0; t < nbTypes; ++t)
+      double* values = substitutions->getData() + branch->index * substitutions->getBranchStride();
+      size_t stride = substitutions->getSiteStride();
+      for (size_t i = 0; i < nbDistinctSites; ++i)
       {
-        (*substitutions)(l, i, t) = substitutionsForCurrentNode[(*rootPatternLinks)[i]][t] / Lr[(*rootPatternLinks)[i]];
+        for (size_t t = 0; t < nbTypes; ++t)
+        {
+          values[i * stride + t] = substitutionsForCurrentNode[i * nbTypes + t] / Lr[i];
+        }
       }
     }
+    else
+    {
+      for (size_t i = 0; i < nbSites; ++i)
+      {
+        size_t pattern = (*rootPatternLinks)[i];
+        for (size_t t = 0; t < nbTypes; ++t)
+        {
+          (*substitutions)(branch->index, i, t) = substitutionsForCurrentNode[pattern * nbTypes + t] / Lr[pattern];
+        }
+      }
+    }
+
+    if (verbose)
+    {
+      lock_guard<mutex> lock(displayMutex);
+      ApplicationTools::displayGauge(nbBranchesDone++, nbBranches - 1);
+    }
+  };
+
+  for (size_t first = 0; first < nbBranches; first += chunkSize)
+  {
+    size_t nbBranchesInChunk = min(chunkSize, nbBranches - first);
+    chunkFirstUse = countsUse;
+    for (size_t b = 0; b < nbBranchesInChunk; ++b)
+    {
+      gatherBranch(branchIndices[first + b], branches[b]);
+    }
+    if (pool.get())
+      pool->parallelFor(nbBranchesInChunk, mapBranch);
+    else
+      mapBranch(0);
   }
   if (verbose)
   {
@@ -370,6 +447,38 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
 
 /******************************************************************************/
 
+void SubstitutionMappingTools::getNeighborParts_(
+  const DRTreeLikelihood& drtl,
+  int fatherId,
+  int neighborId,
+  int branchId,
+  bool upward,
+  vector<BranchMappingPart_>& parts)
+{
+  ConstLikelihoodArrayRef likelihoods = drtl.getLikelihoodData()->getLikelihoodArrayRef(fatherId, neighborId);
+  // Iterate over all site partitions:
+  unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(branchId));
+  while (mit->hasNext())
+  {
+    TreeLikelihood::ConstBranchModelDescription* bmd = mit->next();
+    BranchMappingPart_ part;
+    unique_ptr<TreeLikelihood::SiteIterator> sit(bmd->getNewSiteIterator());
+    while (sit->hasNext())
+    {
+      part.sites.push_back(sit->next());
+    }
+    if (part.sites.size() == 0)
+      continue;
+    // We retrieve the transition probabilities for this site partition:
+    part.pxy = drtl.getTransitionProbabilitiesPerRateClass(branchId, part.sites[0]);
+    part.likelihoods = likelihoods;
+    part.upward = upward;
+    parts.push_back(part);
+  }
+}
+
+/******************************************************************************/
+
 ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionVectors(
   const DRTreeLikelihood& drtl,
   const SubstitutionModelSet& modelSet,
@@ -471,7 +580,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       const Node* currentSon = father->getSon(n);
       if (currentSon->getId() != currentNode->getId())
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+        ConstLikelihoodArrayRef likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentSon->getId());
 
         // Now iterate over all site partitions:
         unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
@@ -491,11 +600,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
               pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
               first = false;
             }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
             VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
             for (size_t c = 0; c < nbClasses; c++)
             {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+              const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
               Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
               VVdouble* pxy_c = &pxy[c];
               for (size_t x = 0; x < nbStates; x++)
@@ -504,7 +612,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
                 double likelihood = 0.;
                 for (size_t y = 0; y < nbStates; y++)
                 {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
+                  likelihood += (*pxy_c_x)[y] * likelihoodsFather_son_i_c[y];
                 }
                 (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
               }
@@ -516,7 +624,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     if (father->hasFather())
     {
       const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+      ConstLikelihoodArrayRef likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentSon->getId());
       // Now iterate over all site partitions:
       unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
       VVVdouble pxy;
@@ -535,11 +643,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
             pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
             first = false;
           }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
           VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
           for (size_t c = 0; c < nbClasses; c++)
           {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+            const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
             Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
             VVdouble* pxy_c = &pxy[c];
             for (size_t x = 0; x < nbStates; x++)
@@ -548,7 +655,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
               for (size_t y = 0; y < nbStates; y++)
               {
                 Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
+                likelihood += (*pxy_c_x)[x] * likelihoodsFather_son_i_c[y];
               }
               (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
             }
@@ -574,13 +681,29 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       }
     }
 
+    // Likelihood arrays may be scaled: bring the father part to the scale of the root likelihoods.
+    for (size_t i = 0; i < nbDistinctSites; i++)
+    {
+      int count = drtl.getLikelihoodData()->getScalingCountAtNode(tree.getRootId(), i) - drtl.getLikelihoodData()->getScalingCountAtNode(father->getId(), i);
+      if (count == 0) continue;
+      double scale = AbstractDiscreteRatesAcrossSitesTreeLikelihood::getScalingFactor(count);
+      VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
+      for (size_t c = 0; c < nbClasses; c++)
+      {
+        Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
+        for (size_t x = 0; x < nbStates; x++)
+        {
+          (*likelihoodsFatherConstantPart_i_c)[x] *= scale;
+        }
+      }
+    }
 
     // Then, we deal with the node of interest.
     // We first average upon 'y' to save computations, and then upon 'x'.
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &(drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId()));
+    ConstLikelihoodArrayRef likelihoodsFather_node = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentNode->getId());
     unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
     VVVdouble pxy;
     bool first;
@@ -626,11 +749,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
           pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
           first = false;
         }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
         VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
         for (size_t c = 0; c < nbClasses; ++c)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
+          const double* likelihoodsFather_node_i_c = likelihoodsFather_node(i, c);
           Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
           const VVdouble* pxy_c = &pxy[c];
           VVVdouble* nxy_c = &nxy[c];
@@ -642,7 +764,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
             {
               double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
                                       * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
+                                      * likelihoodsFather_node_i_c[y];
 
               for (size_t t = 0; t < nbTypes; ++t)
               {
@@ -760,7 +882,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
       const Node* currentSon = father->getSon(n);
       if (currentSon->getId() != currentNode->getId())
       {
-        const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+        ConstLikelihoodArrayRef likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentSon->getId());
 
         // Now iterate over all site partitions:
         unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentSon->getId()));
@@ -780,11 +902,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
               pxy = drtl.getTransitionProbabilitiesPerRateClass(currentSon->getId(), i);
               first = false;
             }
-            const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
             VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
             for (size_t c = 0; c < nbClasses; ++c)
             {
-              const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+              const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
               Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
               VVdouble* pxy_c = &pxy[c];
               for (size_t x = 0; x < nbStates; ++x)
@@ -793,7 +914,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
                 double likelihood = 0.;
                 for (size_t y = 0; y < nbStates; ++y)
                 {
-                  likelihood += (*pxy_c_x)[y] * (*likelihoodsFather_son_i_c)[y];
+                  likelihood += (*pxy_c_x)[y] * likelihoodsFather_son_i_c[y];
                 }
                 (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
               }
@@ -805,7 +926,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     if (father->hasFather())
     {
       const Node* currentSon = father->getFather();
-      const VVVdouble* likelihoodsFather_son = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentSon->getId());
+      ConstLikelihoodArrayRef likelihoodsFather_son = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentSon->getId());
       // Now iterate over all site partitions:
       unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(father->getId()));
       VVVdouble pxy;
@@ -824,11 +945,10 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
             pxy = drtl.getTransitionProbabilitiesPerRateClass(father->getId(), i);
             first = false;
           }
-          const VVdouble* likelihoodsFather_son_i = &(*likelihoodsFather_son)[i];
           VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
           for (size_t c = 0; c < nbClasses; ++c)
           {
-            const Vdouble* likelihoodsFather_son_i_c = &(*likelihoodsFather_son_i)[c];
+            const double* likelihoodsFather_son_i_c = likelihoodsFather_son(i, c);
             Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
             VVdouble* pxy_c = &pxy[c];
             for (size_t x = 0; x < nbStates; ++x)
@@ -837,7 +957,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
               for (size_t y = 0; y < nbStates; ++y)
               {
                 Vdouble* pxy_c_x = &(*pxy_c)[y];
-                likelihood += (*pxy_c_x)[x] * (*likelihoodsFather_son_i_c)[y];
+                likelihood += (*pxy_c_x)[x] * likelihoodsFather_son_i_c[y];
               }
               (*likelihoodsFatherConstantPart_i_c)[x] *= likelihood;
             }
@@ -868,7 +988,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
     // ('y' is the state at 'node' and 'x' the state at 'father'.)
 
     // Iterate over all site partitions:
-    const VVVdouble* likelihoodsFather_node = &drtl.getLikelihoodData()->getLikelihoodArray(father->getId(), currentNode->getId());
+    ConstLikelihoodArrayRef likelihoodsFather_node = drtl.getLikelihoodData()->getLikelihoodArrayRef(father->getId(), currentNode->getId());
     unique_ptr<TreeLikelihood::ConstBranchModelIterator> mit(drtl.getNewBranchModelIterator(currentNode->getId()));
     VVVdouble pxy;
     bool first;
@@ -913,7 +1033,6 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
           pxy = drtl.getTransitionProbabilitiesPerRateClass(currentNode->getId(), i);
           first = false;
         }
-        const VVdouble* likelihoodsFather_node_i = &(*likelihoodsFather_node)[i];
         VVdouble* likelihoodsFatherConstantPart_i = &likelihoodsFatherConstantPart[i];
         RowMatrix<double> pairProbabilities(nbStates, nbStates);
         MatrixTools::fill(pairProbabilities, 0.);
@@ -928,7 +1047,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
         }
         for (size_t c = 0; c < nbClasses; ++c)
         {
-          const Vdouble* likelihoodsFather_node_i_c = &(*likelihoodsFather_node_i)[c];
+          const double* likelihoodsFather_node_i_c = likelihoodsFather_node(i, c);
           Vdouble* likelihoodsFatherConstantPart_i_c = &(*likelihoodsFatherConstantPart_i)[c];
           const VVdouble* pxy_c = &pxy[c];
           VVVdouble* nxy_c = &nxy[c];
@@ -940,7 +1059,7 @@ ProbabilisticSubstitutionMapping* SubstitutionMappingTools::computeSubstitutionV
             {
               double likelihood_cxy = (*likelihoodsFatherConstantPart_i_c_x)
                                       * (*pxy_c_x)[y]
-                                      * (*likelihoodsFather_node_i_c)[y];
+                                      * likelihoodsFather_node_i_c[y];
               pairProbabilities(x, y) += likelihood_cxy; // Sum over all rate classes.
               for (size_t t = 0; t < nbTypes; ++t)
               {
@@ -1329,6 +1448,200 @@ throw (IOException)
 
 /**************************************************************************************************/
 
+namespace
+{
+  const char BINARY_MAGIC[8] = { 'B', 'p', 'p', 'P', 'S', 'M', '1', '\0' };
+  const size_t BINARY_ALIGNMENT = 64;
+
+  template<class T>
+  void writeBinary(ostream& out, T value)
+  {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template<class T>
+  T readBinary(istream& in)
+  {
+    T value;
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    if (!in)
+      throw IOException("SubstitutionMappingTools::readFromBinaryStream. Unexpected end of input.");
+    return value;
+  }
+
+  // Values of one row of the buffer (one site for site-major layouts, one branch otherwise):
+  template<class T>
+  void writeBinaryRow(ostream& out, const double* values, size_t size, vector<T>& buffer)
+  {
+    buffer.resize(size);
+    for (size_t k = 0; k < size; k++)
+    {
+      buffer[k] = static_cast<T>(values[k]);
+    }
+    out.write(reinterpret_cast<const char*>(&buffer[0]), static_cast<streamsize>(size * sizeof(T)));
+  }
+
+  template<class T>
+  void readBinaryRow(istream& in, double* values, size_t size, vector<T>& buffer)
+  {
+    buffer.resize(size);
+    in.read(reinterpret_cast<char*>(&buffer[0]), static_cast<streamsize>(size * sizeof(T)));
+    if (!in)
+      throw IOException("SubstitutionMappingTools::readFromBinaryStream. Unexpected end of input.");
+    for (size_t k = 0; k < size; k++)
+    {
+      values[k] = static_cast<double>(buffer[k]);
+    }
+  }
+}
+
+void SubstitutionMappingTools::writeToBinaryStream(
+  const ProbabilisticSubstitutionMapping& substitutions,
+  ostream& out,
+  bool singlePrecision)
+throw (IOException)
+{
+  if (!out)
+    throw IOException("SubstitutionMappingTools::writeToBinaryStream. Can't write to stream.");
+  size_t nbBranches = substitutions.getNumberOfBranches();
+  size_t nbSites    = substitutions.getNumberOfSites();
+  size_t nbTypes    = substitutions.getNumberOfSubstitutionTypes();
+  bool siteMajor    = (substitutions.getLayout() == ProbabilisticSubstitutionMapping::SITE_MAJOR);
+  size_t offset     = 64 + 4 * (nbBranches + nbSites);
+  offset = (offset + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+
+  // Header:
+  out.write(BINARY_MAGIC, 8);
+  writeBinary<uint32_t>(out, 1);
+  writeBinary<uint32_t>(out, siteMajor ? 0 : 1);
+  writeBinary<uint32_t>(out, singlePrecision ? 4 : 8);
+  writeBinary<uint32_t>(out, 0);
+  writeBinary<uint64_t>(out, nbBranches);
+  writeBinary<uint64_t>(out, nbSites);
+  writeBinary<uint64_t>(out, nbTypes);
+  writeBinary<uint64_t>(out, offset);
+  writeBinary<uint64_t>(out, 0);
+
+  for (size_t j = 0; j < nbBranches; j++)
+  {
+    writeBinary<int32_t>(out, substitutions.getNode(j)->getId());
+  }
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    writeBinary<int32_t>(out, substitutions.getSitePosition(i));
+  }
+  out.write(string(offset - 64 - 4 * (nbBranches + nbSites), '\0').c_str(), static_cast<streamsize>(offset - 64 - 4 * (nbBranches + nbSites)));
+
+  // Values:
+  const double* values = substitutions.getData();
+  size_t nbRows  = siteMajor ? nbSites : nbBranches;
+  size_t rowSize = (siteMajor ? nbBranches : nbSites) * nbTypes;
+  if (!singlePrecision && !substitutions.isCompressed())
+  {
+    if (values)
+      out.write(reinterpret_cast<const char*>(values), static_cast<streamsize>(nbRows * rowSize * sizeof(double)));
+  }
+  else
+  {
+    // Compressed mappings are expanded row by row:
+    vector<double> row;
+    vector<float> singleBuffer;
+    for (size_t r = 0; r < nbRows && rowSize > 0; r++)
+    {
+      const double* rowValues = 0;
+      if (!substitutions.isCompressed())
+        rowValues = values + r * rowSize;
+      else
+      {
+        row.resize(rowSize);
+        for (size_t k = 0; k < rowSize / nbTypes; k++)
+        {
+          const double* cell = &substitutions(siteMajor ? k : r, siteMajor ? r : k, 0);
+          copy(cell, cell + nbTypes, &row[k * nbTypes]);
+        }
+        rowValues = &row[0];
+      }
+      if (singlePrecision)
+        writeBinaryRow(out, rowValues, rowSize, singleBuffer);
+      else
+        out.write(reinterpret_cast<const char*>(rowValues), static_cast<streamsize>(rowSize * sizeof(double)));
+    }
+  }
+  if (!out)
+    throw IOException("SubstitutionMappingTools::writeToBinaryStream. Error while writing values.");
+}
+
+/**************************************************************************************************/
+
+void SubstitutionMappingTools::readFromBinaryStream(istream& in, ProbabilisticSubstitutionMapping& substitutions)
+throw (IOException)
+{
+  char magic[8];
+  in.read(magic, 8);
+  if (!in || !equal(magic, magic + 8, BINARY_MAGIC))
+    throw IOException("SubstitutionMappingTools::readFromBinaryStream. Not a binary substitution mapping.");
+  if (readBinary<uint32_t>(in) != 1)
+    throw IOException("SubstitutionMappingTools::readFromBinaryStream. The mapping was written with another byte order.");
+  bool siteMajor     = (readBinary<uint32_t>(in) == 0);
+  uint32_t valueSize = readBinary<uint32_t>(in);
+  readBinary<uint32_t>(in);
+  size_t nbBranches  = static_cast<size_t>(readBinary<uint64_t>(in));
+  size_t nbSites     = static_cast<size_t>(readBinary<uint64_t>(in));
+  size_t nbTypes     = static_cast<size_t>(readBinary<uint64_t>(in));
+  size_t offset      = static_cast<size_t>(readBinary<uint64_t>(in));
+  readBinary<uint64_t>(in);
+  if (valueSize != 4 && valueSize != 8)
+    throw IOException("SubstitutionMappingTools::readFromBinaryStream. Unsupported value size: " + TextTools::toString(valueSize) + ".");
+  if (nbTypes != substitutions.getNumberOfSubstitutionTypes())
+    throw IOException("SubstitutionMappingTools::readFromBinaryStream. The numbers of substitution types do not match.");
+  if (offset < 64 + 4 * (nbBranches + nbSites))
+    throw IOException("SubstitutionMappingTools::readFromBinaryStream. Bad offset of values.");
+
+  vector<size_t> branchIndices(nbBranches);
+  try
+  {
+    for (size_t j = 0; j < nbBranches; j++)
+    {
+      branchIndices[j] = substitutions.getNodeIndex(readBinary<int32_t>(in));
+    }
+  }
+  catch (NodeNotFoundException& e)
+  {
+    throw IOException(string("SubstitutionMappingTools::readFromBinaryStream. Unknown branch. ") + e.what());
+  }
+  substitutions.setNumberOfSites(nbSites);
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    substitutions.setSitePosition(i, readBinary<int32_t>(in));
+  }
+  in.ignore(static_cast<streamsize>(offset - 64 - 4 * (nbBranches + nbSites)));
+
+  // Values are read row by row, and copied at their place in the layout of the mapping:
+  size_t nbRows  = siteMajor ? nbSites : nbBranches;
+  size_t nbCells = siteMajor ? nbBranches : nbSites;
+  vector<double> row(nbCells * nbTypes);
+  vector<float> singleBuffer;
+  vector<double> doubleBuffer;
+  for (size_t r = 0; r < nbRows && row.size() > 0; r++)
+  {
+    if (valueSize == 4)
+      readBinaryRow(in, &row[0], row.size(), singleBuffer);
+    else
+      readBinaryRow(in, &row[0], row.size(), doubleBuffer);
+    for (size_t k = 0; k < nbCells; k++)
+    {
+      size_t br   = branchIndices[siteMajor ? k : r];
+      size_t site = siteMajor ? r : k;
+      for (size_t t = 0; t < nbTypes; t++)
+      {
+        substitutions(br, site, t) = row[k * nbTypes + t];
+      }
+    }
+  }
+}
+
+/**************************************************************************************************/
+
 vector<double> SubstitutionMappingTools::computeTotalSubstitutionVectorForSitePerBranch(const SubstitutionMapping& smap, size_t siteIndex)
 {
   size_t nbBranches = smap.getNumberOfBranches();
@@ -1387,6 +1700,22 @@ vector<double> SubstitutionMappingTools::computeSumForBranch(const SubstitutionM
   size_t nbSites = smap.getNumberOfSites();
   size_t nbTypes = smap.getNumberOfSubstitutionTypes();
   Vdouble v(nbTypes, 0);
+  const ProbabilisticSubstitutionMapping* psm = dynamic_cast<const ProbabilisticSubstitutionMapping*>(&smap);
+  if (psm && nbSites > 0)
+  {
+    // Strided scan of the buffer:
+    const double* values = psm->getData() + branchIndex * psm->getBranchStride();
+    size_t stride = psm->getSiteStride();
+    for (size_t i = 0; i < nbSites; ++i)
+    {
+      const double* values_i = values + psm->getPatternIndex(i) * stride;
+      for (size_t t = 0; t < nbTypes; ++t)
+      {
+        v[t] += values_i[t];
+      }
+    }
+    return v;
+  }
   for (size_t i = 0; i < nbSites; ++i)
   {
     for (size_t t = 0; t < nbTypes; ++t)
@@ -1404,6 +1733,21 @@ vector<double> SubstitutionMappingTools::computeSumForSite(const SubstitutionMap
   size_t nbBranches = smap.getNumberOfBranches();
   size_t nbTypes = smap.getNumberOfSubstitutionTypes();
   Vdouble v(nbTypes, 0);
+  const ProbabilisticSubstitutionMapping* psm = dynamic_cast<const ProbabilisticSubstitutionMapping*>(&smap);
+  if (psm && nbBranches > 0)
+  {
+    // Strided scan of the buffer:
+    const double* values = psm->getData() + psm->getPatternIndex(siteIndex) * psm->getSiteStride();
+    size_t stride = psm->getBranchStride();
+    for (size_t i = 0; i < nbBranches; ++i, values += stride)
+    {
+      for (size_t t = 0; t < nbTypes; ++t)
+      {
+        v[t] += values[t];
+      }
+    }
+    return v;
+  }
   for (size_t i = 0; i < nbBranches; ++i)
   {
     for (size_t t = 0; t < nbTypes; ++t)
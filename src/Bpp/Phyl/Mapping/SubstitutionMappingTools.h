@@ -61,6 +61,37 @@ namespace bpp
  */
 class SubstitutionMappingTools
 {
+private:
+  /**
+   * @brief Transition probabilities and conditional likelihoods used on a branch, for a set of sites sharing the same model.
+   */
+  struct BranchMappingPart_
+  {
+    std::vector<size_t> sites;
+    VVVdouble pxy;
+    ConstLikelihoodArrayRef likelihoods;
+    bool upward;
+    std::vector<size_t> counts;
+
+    BranchMappingPart_() : sites(), pxy(), likelihoods(), upward(false), counts() {}
+  };
+
+  /**
+   * @brief Everything needed to compute the substitution vectors of a branch,
+   * gathered before the branches are processed.
+   */
+  struct BranchMappingData_
+  {
+    size_t index;
+    std::vector<BranchMappingPart_> neighbors;
+    bool fatherIsRoot;
+    std::vector<double> scales;
+    ConstLikelihoodArrayRef likelihoods;
+    std::vector<BranchMappingPart_> parts;
+
+    BranchMappingData_() : index(0), neighbors(), fatherIsRoot(false), scales(), likelihoods(), parts() {}
+  };
+
 public:
   SubstitutionMappingTools() {}
   virtual ~SubstitutionMappingTools() {}
@@ -73,16 +104,20 @@ public:
    * @param drtl              A DRTreeLikelihood object.
    * @param substitutionCount The SubstitutionCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads used to process branches.
+   * @param compressed        Store substitution numbers per site pattern instead of per site.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
     const DRTreeLikelihood& drtl,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception)
+    bool verbose = true,
+    size_t nbThreads = 1,
+    bool compressed = false) throw (Exception)
   {
     std::vector<int> nodeIds;
-    return computeSubstitutionVectors(drtl, nodeIds, substitutionCount, verbose);
+    return computeSubstitutionVectors(drtl, nodeIds, substitutionCount, verbose, nbThreads, compressed);
   }
 
   /**
@@ -95,14 +130,27 @@ public:
    *                          on all nodes.
    * @param substitutionCount The SubstitutionCount to use.
    * @param verbose           Print info to screen.
+   * @param nbThreads         The number of threads used to process branches.
+   *                          1 disables parallel computations, and 0 uses as many
+   *                          threads as hardware threads.
+   * @param compressed        Store substitution numbers per site pattern instead of per site
+   *                          (see ProbabilisticSubstitutionMapping::setSitePatterns()).
+   *                          This saves memory when the alignment has many identical sites.
    * @return A vector of substitutions vectors (one for each site).
    * @throw Exception If the likelihood object is not initialized.
+   *
+   * Substitution counts are computed once for each model and each branch length
+   * times rate, and shared by all branches with the same values. Likelihood arrays and
+   * counts are all retrieved before the branches are processed, so that branches can
+   * then be processed concurrently. Results do not depend on the number of threads.
    */
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
     const DRTreeLikelihood& drtl,
     const std::vector<int>& nodeIds,
     SubstitutionCount& substitutionCount,
-    bool verbose = true) throw (Exception);
+    bool verbose = true,
+    size_t nbThreads = 1,
+    bool compressed = false) throw (Exception);
 
   static ProbabilisticSubstitutionMapping* computeSubstitutionVectors(
     const DRTreeLikelihood& drtl,
@@ -229,6 +277,52 @@ public:
   throw (IOException);
 
 
+  /**
+   * @brief Write a mapping to a stream, in binary format.
+   *
+   * All types of substitutions are written. The output starts with a header of 64 bytes:
+   * - the 8 characters "BppPSM1" and a null character,
+   * - the 32 bits integer 1, to check the byte order,
+   * - the layout of the values (32 bits, 0 for site-major and 1 for branch-major),
+   * - the size of the values in bytes (32 bits, 4 or 8),
+   * - 4 unused bytes,
+   * - the numbers of branches, sites and types of substitutions (64 bits each),
+   * - the offset of the values from the beginning of the output (64 bits),
+   * - 8 unused bytes.
+   *
+   * It is followed by the ids of the nodes of all branches and by the positions of all sites
+   * (32 bits each). The values start at the given offset, which is a multiple of 64, and are
+   * stored in the layout of the mapping (see ProbabilisticSubstitutionMapping::getData()),
+   * so that a file can be mapped in memory and the values accessed directly.
+   * Mappings stored per site pattern are written expanded.
+   * Integers and values are written with the byte order of the machine.
+   *
+   * @param substitutions   The substitutions vectors to write.
+   * @param out             The output stream where to write the vectors, opened in binary mode.
+   * @param singlePrecision Tell if values should be written as 32 bits floats instead of 64 bits doubles.
+   * @throw IOException If an output error happens.
+   */
+  static void writeToBinaryStream(
+    const ProbabilisticSubstitutionMapping& substitutions,
+    std::ostream& out,
+    bool singlePrecision = false)
+  throw (IOException);
+
+
+  /**
+   * @brief Read a mapping written with writeToBinaryStream().
+   *
+   * Branches are matched using the ids of their nodes, and the numbers of
+   * substitution types must be the same. The layout of the mapping is left unchanged.
+   *
+   * @param in            The input stream where to read the vectors, opened in binary mode.
+   * @param substitutions The mapping object to fill.
+   * @throw IOException If an input error happens or if the input is not compatible with the mapping.
+   */
+  static void readFromBinaryStream(std::istream& in, ProbabilisticSubstitutionMapping& substitutions)
+  throw (IOException);
+
+
   /**
    * @brief Sum all type of substitutions for each branch of a given position (specified by its index).
    *
@@ -462,6 +556,26 @@ public:
     const std::vector<int>& ids,
     SubstitutionModel* model,
     const SubstitutionRegister& reg);
+
+private:
+  /**
+   * @brief Retrieve the transition probabilities and conditional likelihoods of a
+   * neighbor of the father of a branch, for each set of sites sharing the same model.
+   *
+   * @param drtl       A DRTreeLikelihood object.
+   * @param fatherId   The id of the father node.
+   * @param neighborId The id of the neighbor of the father.
+   * @param branchId   The id of the node defining the branch between the father and its neighbor.
+   * @param upward     Tell if the neighbor is the father of the father node.
+   * @param parts      The vector where to append the parts.
+   */
+  static void getNeighborParts_(
+    const DRTreeLikelihood& drtl,
+    int fatherId,
+    int neighborId,
+    int branchId,
+    bool upward,
+    std::vector<BranchMappingPart_>& parts);
 };
 } // end of namespace bpp.
 
@@ -48,11 +48,20 @@
 // From SeqLib:
 #include <Bpp/Seq/Container/SequenceContainerTools.h>
 
+// From the STL:
+#include <algorithm>
+#include <cmath>
+
 using namespace bpp;
 using namespace std;
 
 /******************************************************************************/
 
+const size_t AbstractSubstitutionModel::DEFAULT_PIJT_CACHE_SIZE = 0;
+const size_t AbstractSubstitutionModel::PIJT_BLOCK_SIZE = 16;
+
+/******************************************************************************/
+
 AbstractSubstitutionModel::AbstractSubstitutionModel(const Alphabet* alpha, StateMap* stateMap, const std::string& prefix) :
   AbstractParameterAliasable(prefix),
   alphabet_(alpha),
@@ -73,7 +82,17 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(const Alphabet* alpha, Stat
   isNonSingular_(false),
   leftEigenVectors_(size_, size_),
   vPowGen_(),
-  tmpMat_(size_, size_)
+  tmpMat_(size_, size_),
+  generatorRows_(),
+  generatorColumns_(),
+  modelVersion_(0),
+  pijtCaches_(),
+  pijtCacheMutex_(),
+  pijtCacheSize_(DEFAULT_PIJT_CACHE_SIZE),
+  expWorkspace_(),
+  expTime_(0),
+  expVersion_(0),
+  expOrder_(-1)
 {
   for (size_t i = 0; i < size_; i++)
   {
@@ -85,6 +104,8 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(const Alphabet* alpha, Stat
 
 void AbstractSubstitutionModel::updateMatrices()
 {
+  modelVersion_++;
+
   // if the object is not an AbstractReversibleSubstitutionModel,
   // computes the exchangeability_ Matrix (otherwise the generator_
   // has been computed from the exchangeability_)
@@ -119,19 +140,495 @@ void AbstractSubstitutionModel::updateMatrices()
     }
     catch (ZeroDivisionException& e)
     {
-      ApplicationTools::displayMessage("Singularity during diagonalization. Taylor series used instead.");
+      ApplicationTools::displayMessage("Singularity during diagonalization. Pade approximant used instead.");
 
       isNonSingular_ = false;
       isDiagonalizable_ = false;
-      MatrixTools::Taylor(generator_, 30, vPowGen_);
+    }
+  }
+  else
+  {
+    // A previous decomposition must not be used anymore:
+    isNonSingular_ = false;
+    isDiagonalizable_ = false;
+  }
+}
+
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::setTransitionProbabilitiesCacheSize(size_t size)
+{
+  lock_guard<mutex> lock(pijtCacheMutex_);
+  pijtCacheSize_ = size;
+  for (map<thread::id, TransitionProbabilitiesCache>::iterator it = pijtCaches_.begin(); it != pijtCaches_.end(); ++it)
+  {
+    TransitionProbabilitiesCache& cache = it->second;
+    while (cache.entries.size() > pijtCacheSize_)
+    {
+      cache.index.erase(cache.entries.back().t);
+      cache.entries.pop_back();
     }
   }
 }
 
+/******************************************************************************/
+
+AbstractSubstitutionModel::TransitionProbabilitiesCacheEntry& AbstractSubstitutionModel::getTransitionProbabilitiesCacheEntry_(double t) const
+{
+  TransitionProbabilitiesCache& cache = pijtCaches_[this_thread::get_id()];
+  if (cache.version != modelVersion_)
+  {
+    cache.entries.clear();
+    cache.index.clear();
+    cache.version = modelVersion_;
+  }
+
+  map<double, TransitionProbabilitiesCacheList::iterator>::iterator it = cache.index.find(t);
+  if (it != cache.index.end())
+  {
+    // Move the entry to the front of the list:
+    cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+    return cache.entries.front();
+  }
+
+  // Discard the least recently used entry if needed:
+  if (cache.entries.size() >= pijtCacheSize_)
+  {
+    cache.index.erase(cache.entries.back().t);
+    cache.entries.pop_back();
+  }
+  cache.entries.push_front(TransitionProbabilitiesCacheEntry(t));
+  cache.index[t] = cache.entries.begin();
+  return cache.entries.front();
+}
 
 /******************************************************************************/
 
 const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
+{
+  if (pijtCacheSize_ == 0)
+  {
+    computePij_t_(t);
+    return pijt_;
+  }
+  lock_guard<mutex> lock(pijtCacheMutex_);
+  TransitionProbabilitiesCacheEntry& entry = getTransitionProbabilitiesCacheEntry_(t);
+  if (!entry.hasPijt)
+  {
+    computePij_t_(t);
+    entry.pijt = pijt_;
+    entry.hasPijt = true;
+  }
+  return entry.pijt;
+}
+
+const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
+{
+  if (pijtCacheSize_ == 0)
+  {
+    computedPij_dt_(t);
+    return dpijt_;
+  }
+  lock_guard<mutex> lock(pijtCacheMutex_);
+  TransitionProbabilitiesCacheEntry& entry = getTransitionProbabilitiesCacheEntry_(t);
+  if (!entry.hasdPijt)
+  {
+    computedPij_dt_(t);
+    entry.dpijt = dpijt_;
+    entry.hasdPijt = true;
+  }
+  return entry.dpijt;
+}
+
+const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
+{
+  if (pijtCacheSize_ == 0)
+  {
+    computed2Pij_dt2_(t);
+    return d2pijt_;
+  }
+  lock_guard<mutex> lock(pijtCacheMutex_);
+  TransitionProbabilitiesCacheEntry& entry = getTransitionProbabilitiesCacheEntry_(t);
+  if (!entry.hasd2Pijt)
+  {
+    computed2Pij_dt2_(t);
+    entry.d2pijt = d2pijt_;
+    entry.hasd2Pijt = true;
+  }
+  return entry.d2pijt;
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computePij_t(const vector<double>& times, double* pijt) const
+{
+  if (!isNonSingular_ || !isDiagonalizable_)
+  {
+    SubstitutionModel::computePij_t(times, pijt);
+    return;
+  }
+
+  size_t nbTimes = times.size();
+  size_t n2 = size_ * size_;
+
+  // Contiguous copies of the eigen vectors:
+  vector<double> right(n2);
+  vector<double> left(n2);
+  for (size_t i = 0; i < size_; i++)
+  {
+    for (size_t j = 0; j < size_; j++)
+    {
+      right[i * size_ + j] = rightEigenVectors_(i, j);
+      left[i * size_ + j]  = leftEigenVectors_(i, j);
+    }
+  }
+
+  // Exponentials of the eigen values, for all times at once:
+  vector<double> expEigenValues(nbTimes * size_);
+  for (size_t k = 0; k < nbTimes; k++)
+  {
+    double l = rate_ * times[k];
+    double* expEigenValues_k = &expEigenValues[k * size_];
+    for (size_t i = 0; i < size_; i++)
+    {
+      expEigenValues_k[i] = eigenValues_[i] * l;
+    }
+  }
+  for (size_t ki = 0; ki < nbTimes * size_; ki++)
+  {
+    expEigenValues[ki] = std::exp(expEigenValues[ki]);
+  }
+
+  // P(t) = right * diag(exp(lambda * t)) * left:
+  vector<double> tmp(n2);
+  for (size_t k = 0; k < nbTimes; k++)
+  {
+    double* pijt_k = pijt + k * n2;
+    if (times[k] == 0)
+    {
+      std::fill(pijt_k, pijt_k + n2, 0.);
+      for (size_t i = 0; i < size_; i++)
+      {
+        pijt_k[i * size_ + i] = 1.;
+      }
+      continue;
+    }
+    const double* expEigenValues_k = &expEigenValues[k * size_];
+    for (size_t i = 0; i < size_; i++)
+    {
+      for (size_t l = 0; l < size_; l++)
+      {
+        tmp[i * size_ + l] = right[i * size_ + l] * expEigenValues_k[l];
+      }
+    }
+    std::fill(pijt_k, pijt_k + n2, 0.);
+    // Rows of left are processed by blocks, so that they stay in cache for all rows of the result:
+    for (size_t lb = 0; lb < size_; lb += PIJT_BLOCK_SIZE)
+    {
+      size_t le = std::min(lb + PIJT_BLOCK_SIZE, size_);
+      for (size_t i = 0; i < size_; i++)
+      {
+        double* pijt_k_i = pijt_k + i * size_;
+        const double* tmp_i = &tmp[i * size_];
+        for (size_t l = lb; l < le; l++)
+        {
+          double a = tmp_i[l];
+          const double* left_l = &left[l * size_];
+          for (size_t j = 0; j < size_; j++)
+          {
+            pijt_k_i[j] += a * left_l[j];
+          }
+        }
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+
+namespace
+{
+  // o = a * b, for n * n row-major matrices.
+  void multiplyMatrices(const double* a, const double* b, double* o, size_t n)
+  {
+    std::fill(o, o + n * n, 0.);
+    for (size_t i = 0; i < n; i++)
+    {
+      const double* a_i = a + i * n;
+      double* o_i = o + i * n;
+      for (size_t l = 0; l < n; l++)
+      {
+        double a_il = a_i[l];
+        const double* b_l = b + l * n;
+        for (size_t j = 0; j < n; j++)
+        {
+          o_i[j] += a_il * b_l[j];
+        }
+      }
+    }
+  }
+
+  // o = (d * I + c * Q) * b, for n * n row-major matrices, the
+  // off-diagonal entries of Q being restricted to the given structure.
+  void multiplySparse(const double* q, const vector<size_t>& rows, const vector<size_t>& columns,
+                      double c, double d, const double* b, double* o, size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      double* o_i = o + i * n;
+      const double* b_i = b + i * n;
+      double f = d + c * q[i * n + i];
+      for (size_t j = 0; j < n; j++)
+      {
+        o_i[j] = f * b_i[j];
+      }
+      for (size_t k = rows[i]; k < rows[i + 1]; k++)
+      {
+        size_t l = columns[k];
+        double q_il = c * q[i * n + l];
+        if (q_il == 0) continue;
+        const double* b_l = b + l * n;
+        for (size_t j = 0; j < n; j++)
+        {
+          o_i[j] += q_il * b_l[j];
+        }
+      }
+    }
+  }
+}
+
+void AbstractSubstitutionModel::computeExponential_(double t, int order) const
+{
+  size_t n = size_;
+  size_t n2 = n * n;
+  bool update = (expOrder_ < 0 || expVersion_ != modelVersion_ || expTime_ != t || expWorkspace_.size() != 9 * n2);
+  if (update && generatorRows_.size() == n + 1)
+  {
+    expWorkspace_.resize(9 * n2);
+    computeUniformizedExponential_(t);
+    expTime_ = t;
+    expVersion_ = modelVersion_;
+    expOrder_ = 0;
+  }
+  else if (update)
+  {
+    expWorkspace_.resize(9 * n2);
+    double* a   = &expWorkspace_[0];
+    double* x   = a + n2;
+    double* num = x + n2;
+    double* den = num + n2;
+    double* tmp = den + n2;
+    double* q   = tmp + 4 * n2;
+
+    // A = rate * t * Q, and its infinite norm:
+    double l = rate_ * t;
+    double norm = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+      double rowNorm = 0;
+      for (size_t j = 0; j < n; j++)
+      {
+        q[i * n + j] = generator_(i, j);
+        a[i * n + j] = l * generator_(i, j);
+        rowNorm += std::abs(a[i * n + j]);
+      }
+      norm = std::max(norm, rowNorm);
+    }
+
+    // Scaling, so that the norm of A / 2^s is lower than 1/2:
+    int s = 0;
+    if (norm > 0.5)
+    {
+      std::frexp(norm, &s);
+      s++;
+      double f = std::ldexp(1., -s);
+      for (size_t ij = 0; ij < n2; ij++)
+      {
+        a[ij] *= f;
+      }
+    }
+
+    // Pade approximant of degree (6, 6): exp(A) ~ den^-1 * num
+    double c = 0.5;
+    for (size_t ij = 0; ij < n2; ij++)
+    {
+      x[ij] = a[ij];
+      num[ij] = c * a[ij];
+      den[ij] = -c * a[ij];
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+      num[i * n + i] += 1.;
+      den[i * n + i] += 1.;
+    }
+    bool positive = true;
+    for (unsigned int k = 2; k <= 6; k++)
+    {
+      c = c * static_cast<double>(6 - k + 1) / static_cast<double>(k * (12 - k + 1));
+      multiplyMatrices(a, x, tmp, n);
+      std::swap(x, tmp);
+      for (size_t ij = 0; ij < n2; ij++)
+      {
+        num[ij] += c * x[ij];
+        den[ij] += (positive ? c : -c) * x[ij];
+      }
+      positive = !positive;
+    }
+
+    // Solve den * P = num, by Gaussian elimination with partial pivoting:
+    for (size_t k = 0; k < n; k++)
+    {
+      size_t pivot = k;
+      for (size_t i = k + 1; i < n; i++)
+      {
+        if (std::abs(den[i * n + k]) > std::abs(den[pivot * n + k]))
+          pivot = i;
+      }
+      if (pivot != k)
+      {
+        std::swap_ranges(den + k * n, den + (k + 1) * n, den + pivot * n);
+        std::swap_ranges(num + k * n, num + (k + 1) * n, num + pivot * n);
+      }
+      for (size_t i = k + 1; i < n; i++)
+      {
+        double f = den[i * n + k] / den[k * n + k];
+        if (f == 0) continue;
+        for (size_t j = k; j < n; j++)
+        {
+          den[i * n + j] -= f * den[k * n + j];
+        }
+        for (size_t j = 0; j < n; j++)
+        {
+          num[i * n + j] -= f * num[k * n + j];
+        }
+      }
+    }
+    for (size_t k = n; k > 0; k--)
+    {
+      size_t i = k - 1;
+      for (size_t i2 = i + 1; i2 < n; i2++)
+      {
+        double f = den[i * n + i2];
+        for (size_t j = 0; j < n; j++)
+        {
+          num[i * n + j] -= f * num[i2 * n + j];
+        }
+      }
+      double f = 1. / den[i * n + i];
+      for (size_t j = 0; j < n; j++)
+      {
+        num[i * n + j] *= f;
+      }
+    }
+
+    // Squaring:
+    for (int k = 0; k < s; k++)
+    {
+      multiplyMatrices(num, num, tmp, n);
+      std::swap(num, tmp);
+    }
+    std::copy(num, num + n2, &expWorkspace_[5 * n2]);
+    expTime_ = t;
+    expVersion_ = modelVersion_;
+    expOrder_ = 0;
+  }
+
+  // Derivatives: d^k/dt^k exp(rate * t * Q) = (rate * Q)^k * exp(rate * t * Q)
+  const double* q = &expWorkspace_[8 * n2];
+  for (int k = expOrder_ + 1; k <= order; k++)
+  {
+    double* d = &expWorkspace_[(5 + k) * n2];
+    if (generatorRows_.size() == n + 1)
+      multiplySparse(q, generatorRows_, generatorColumns_, rate_, 0., d - n2, d, n);
+    else
+    {
+      multiplyMatrices(q, d - n2, d, n);
+      for (size_t ij = 0; ij < n2; ij++)
+      {
+        d[ij] *= rate_;
+      }
+    }
+    expOrder_ = k;
+  }
+}
+
+void AbstractSubstitutionModel::computeUniformizedExponential_(double t) const
+{
+  size_t n = size_;
+  size_t n2 = n * n;
+  double* x   = &expWorkspace_[0];
+  double* tmp = x + n2;
+  double* e   = x + 5 * n2;
+  double* q   = x + 8 * n2;
+
+  double l = rate_ * t;
+  double mu = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j < n; j++)
+    {
+      q[i * n + j] = generator_(i, j);
+    }
+    mu = std::max(mu, -l * generator_(i, i));
+  }
+
+  // Scaling, so that mu / 2^s is lower than 1:
+  int s = 0;
+  if (mu > 1.)
+    std::frexp(mu, &s);
+  double f = std::ldexp(l, -s);
+  double m = std::ldexp(mu, -s);
+
+  std::fill(x, x + n2, 0.);
+  std::fill(e, e + n2, 0.);
+  double w = std::exp(-m);
+  for (size_t i = 0; i < n; i++)
+  {
+    x[i * n + i] = 1.;
+    e[i * n + i] = w;
+  }
+  if (m > 0)
+  {
+    // Entries of B^k are probabilities, so the truncation error is bounded by the remaining weights:
+    for (unsigned int k = 1; w > NumConstants::VERY_TINY(); k++)
+    {
+      multiplySparse(q, generatorRows_, generatorColumns_, f / m, 1., x, tmp, n);
+      std::swap(x, tmp);
+      w *= m / static_cast<double>(k);
+      for (size_t ij = 0; ij < n2; ij++)
+      {
+        e[ij] += w * x[ij];
+      }
+    }
+  }
+
+  // Squaring:
+  double* p = e;
+  for (int k = 0; k < s; k++)
+  {
+    multiplyMatrices(p, p, tmp, n);
+    std::swap(p, tmp);
+  }
+  if (p != e)
+    std::copy(p, p + n2, e);
+}
+
+void AbstractSubstitutionModel::copyExponential_(int order, RowMatrix<double>& m) const
+{
+  const double* e = &expWorkspace_[static_cast<size_t>(5 + order) * size_ * size_];
+  for (size_t i = 0; i < size_; i++)
+  {
+    for (size_t j = 0; j < size_; j++)
+    {
+      m(i, j) = e[i * size_ + j];
+    }
+  }
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computePij_t_(double t) const
 {
   if (t == 0)
   {
@@ -177,32 +674,13 @@ const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
   }
   else
   {
-    MatrixTools::getId(size_, pijt_);
-    double s = 1.0;
-    double v = rate_ * t;
-    size_t m = 0;
-    while (v > 0.5)    // exp(r*t*A)=(exp(r*t/(2^m) A))^(2^m)
-    {
-      m += 1;
-      v /= 2;
-    }
-    for (size_t i = 1; i < vPowGen_.size(); i++)
-    {
-      s *= v / static_cast<double>(i);
-      MatrixTools::add(pijt_, s, vPowGen_[i]);
-    }
-    while (m > 0)  // recover the 2^m
-    {
-      MatrixTools::mult(pijt_, pijt_, tmpMat_);
-      MatrixTools::copy(tmpMat_, pijt_);
-      m--;
-    }
+    computeExponential_(t, 0);
+    copyExponential_(0, pijt_);
   }
 //  MatrixTools::print(pijt_);
-  return pijt_;
 }
 
-const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
+void AbstractSubstitutionModel::computedPij_dt_(double t) const
 {
   if (isNonSingular_)
   {
@@ -244,34 +722,12 @@ const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
   }
   else
   {
-    MatrixTools::getId(size_, dpijt_);
-    double s = 1.0;
-    double v = rate_ * t;
-    size_t m = 0;
-    while (v > 0.5)    // r*A*exp(t*r*A)=r*A*(exp(r*t/(2^m) A))^(2^m)
-    {
-      m += 1;
-      v /= 2;
-    }
-    for (size_t i = 1; i < vPowGen_.size(); i++)
-    {
-      s *= v / static_cast<double>(i);
-      MatrixTools::add(dpijt_, s, vPowGen_[i]);
-    }
-    while (m > 0)  // recover the 2^m
-    {
-      MatrixTools::mult(dpijt_, dpijt_, tmpMat_);
-      MatrixTools::copy(tmpMat_, dpijt_);
-      m--;
-    }
-    MatrixTools::scale(dpijt_, rate_);
-    MatrixTools::mult(vPowGen_[1], dpijt_, tmpMat_);
-    MatrixTools::copy(tmpMat_, dpijt_);
+    computeExponential_(t, 1);
+    copyExponential_(1, dpijt_);
   }
-  return dpijt_;
 }
 
-const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
+void AbstractSubstitutionModel::computed2Pij_dt2_(double t) const
 {
   if (isNonSingular_)
   {
@@ -317,31 +773,9 @@ const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
   }
   else
   {
-    MatrixTools::getId(size_, d2pijt_);
-    double s = 1.0;
-    double v = rate_ * t;
-    size_t m = 0;
-    while (v > 0.5)    // r^2*A^2*exp(t*r*A)=r^2*A^2*(exp(r*t/(2^m) A))^(2^m)
-    {
-      m += 1;
-      v /= 2;
-    }
-    for (size_t i = 1; i < vPowGen_.size(); i++)
-    {
-      s *= v / static_cast<double>(i);
-      MatrixTools::add(d2pijt_, s, vPowGen_[i]);
-    }
-    while (m > 0)  // recover the 2^m
-    {
-      MatrixTools::mult(d2pijt_, d2pijt_, tmpMat_);
-      MatrixTools::copy(tmpMat_, d2pijt_);
-      m--;
-    }
-    MatrixTools::scale(d2pijt_, rate_ * rate_);
-    MatrixTools::mult(vPowGen_[2], d2pijt_, tmpMat_);
-    MatrixTools::copy(tmpMat_, d2pijt_);
+    computeExponential_(t, 2);
+    copyExponential_(2, d2pijt_);
   }
-  return d2pijt_;
 }
 
 /******************************************************************************/
@@ -409,6 +843,7 @@ double AbstractSubstitutionModel::getScale() const
 
 void AbstractSubstitutionModel::setScale(double scale) {
   MatrixTools::scale(generator_, scale);
+  modelVersion_++;
 }
 
 /******************************************************************************/
@@ -428,7 +863,10 @@ void AbstractSubstitutionModel::setRate(double rate)
   if (hasParameter("rate"))
     setParameterValue("rate", rate);
   else
+  {
     rate_ = rate;
+    modelVersion_++;
+  }
 }
 
 void AbstractSubstitutionModel::addRateParameter()
@@ -465,7 +903,56 @@ void AbstractReversibleSubstitutionModel::updateMatrices()
   {
     exchangeability_(i, i) = generator_(i, i) / freq_[i];
   }
-  AbstractSubstitutionModel::updateMatrices();
+
+  if (enableEigenDecomposition() && updateSymmetricEigenDecomposition_())
+    modelVersion_++;
+  else
+    AbstractSubstitutionModel::updateMatrices();
+}
+
+/******************************************************************************/
+
+bool AbstractReversibleSubstitutionModel::updateSymmetricEigenDecomposition_()
+{
+  Vdouble sqrtFreq(size_);
+  for (size_t i = 0; i < size_; i++)
+  {
+    if (freq_[i] <= NumConstants::TINY())
+      return false;
+    sqrtFreq[i] = sqrt(freq_[i]);
+  }
+
+  // Pi^1/2 Q Pi^-1/2 is symmetric up to rounding errors. Both triangles are
+  // averaged so that it is exactly, and the symmetric solver is used:
+  RowMatrix<double> sym(size_, size_);
+  for (size_t i = 0; i < size_; i++)
+  {
+    sym(i, i) = generator_(i, i);
+    for (size_t j = 0; j < i; j++)
+    {
+      double x = (generator_(i, j) * sqrtFreq[i] / sqrtFreq[j] + generator_(j, i) * sqrtFreq[j] / sqrtFreq[i]) / 2.;
+      sym(i, j) = x;
+      sym(j, i) = x;
+    }
+  }
+
+  EigenValue<double> ev(sym);
+  const RowMatrix<double>& v = ev.getV();
+  eigenValues_ = ev.getRealEigenValues();
+  iEigenValues_.assign(size_, 0.);
+  rightEigenVectors_.resize(size_, size_);
+  leftEigenVectors_.resize(size_, size_);
+  for (size_t i = 0; i < size_; i++)
+  {
+    for (size_t j = 0; j < size_; j++)
+    {
+      rightEigenVectors_(i, j) = v(i, j) / sqrtFreq[i];
+      leftEigenVectors_(j, i) = v(i, j) * sqrtFreq[i];
+    }
+  }
+  isNonSingular_ = true;
+  isDiagonalizable_ = true;
+  return true;
 }
 
 /******************************************************************************/
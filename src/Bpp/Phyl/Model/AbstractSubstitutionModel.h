@@ -46,6 +46,10 @@
 #include <Bpp/Numeric/VectorTools.h>
 
 #include <memory>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
 
 namespace bpp
 {
@@ -72,6 +76,17 @@ namespace bpp
  * is used to compute all probabilities, and then the result for the initial and final state
  * of interest is retrieved.
  *
+ * Transition probabilities, and their derivatives, can hence be stored in a cache of
+ * getTransitionProbabilitiesCacheSize() matrices, indexed by the time t (disabled by default,
+ * see setTransitionProbabilitiesCacheSize()). Homogeneous likelihood classes enlarge the cache
+ * of their model so that it holds one entry per branch and rate class.
+ * The least recently used matrices are discarded first, and the whole cache is
+ * invalidated whenever the model changes (parameter change, update of the matrices,
+ * new frequencies, rate or scale). Derived classes which override updateMatrices()
+ * without calling the parent implementation must increment modelVersion_ themselves.
+ * The references returned by getPij_t, getdPij_dt and getd2Pij_dt2 remain valid until
+ * the cache is invalidated or the corresponding entry is discarded.
+ *
  * @note This class is dedicated to "simple" substitution models, for which the number of states is equivalent to the number of characters in the alphabet.
  * Consider using the MarkovModulatedSubstitutionModel for more complexe cases.
  */
@@ -164,8 +179,8 @@ protected:
   RowMatrix<double> leftEigenVectors_;
 
   /**
-   * @brief vector of the powers of generator_ for Taylor development (if
-   * rightEigenVectors_ is singular).
+   * @brief vector of the powers of generator_, for subclasses which need
+   * them. Transition probabilities do not rely on it.
    */
   std::vector< RowMatrix<double> > vPowGen_;
 
@@ -173,7 +188,90 @@ protected:
    * @brief For computational issues
    */
   mutable RowMatrix<double> tmpMat_;
-  
+
+  /**
+   * @brief Off-diagonal structure of the generator, for sparse generators.
+   *
+   * When not empty, the only off-diagonal entries of row i of generator_
+   * which may be non-null are in the columns generatorColumns_[k], for k
+   * in [generatorRows_[i], generatorRows_[i + 1]). The exponential of
+   * generators which could not be diagonalized is then computed by
+   * uniformization on this structure.
+   */
+  std::vector<size_t> generatorRows_;
+  std::vector<size_t> generatorColumns_;
+
+  /**
+   * @brief Version of the model, incremented each time the transition probabilities may change.
+   */
+  unsigned int modelVersion_;
+
+private:
+  /**
+   * @brief An entry of the transition probabilities cache.
+   *
+   * Matrices are only computed when requested.
+   */
+  struct TransitionProbabilitiesCacheEntry
+  {
+    double t;
+    bool hasPijt;
+    bool hasdPijt;
+    bool hasd2Pijt;
+    RowMatrix<double> pijt;
+    RowMatrix<double> dpijt;
+    RowMatrix<double> d2pijt;
+
+    TransitionProbabilitiesCacheEntry(double time) :
+      t(time), hasPijt(false), hasdPijt(false), hasd2Pijt(false), pijt(), dpijt(), d2pijt() {}
+  };
+
+  typedef std::list<TransitionProbabilitiesCacheEntry> TransitionProbabilitiesCacheList;
+
+  /**
+   * @brief The cached entries of one thread, the most recently used first.
+   */
+  struct TransitionProbabilitiesCache
+  {
+    TransitionProbabilitiesCacheList entries;
+    std::map<double, TransitionProbabilitiesCacheList::iterator> index;
+    unsigned int version;
+
+    TransitionProbabilitiesCache() : entries(), index(), version(0) {}
+  };
+
+  /**
+   * @brief One cache per calling thread, all accessed under pijtCacheMutex_.
+   *
+   * A thread only evicts its own entries, so that a matrix it retrieved
+   * remains valid until its next call, as with the uncached methods.
+   */
+  mutable std::map<std::thread::id, TransitionProbabilitiesCache> pijtCaches_;
+  mutable std::mutex pijtCacheMutex_;
+  size_t pijtCacheSize_;
+
+  /**
+   * @brief Workspace of computeExponential_(), and the last matrices computed.
+   */
+  mutable std::vector<double> expWorkspace_;
+  mutable double expTime_;
+  mutable unsigned int expVersion_;
+  mutable int expOrder_;
+
+public:
+  /**
+   * @brief Default number of matrices stored in the transition probabilities cache.
+   *
+   * The cache is disabled by default (0).
+   */
+  static const size_t DEFAULT_PIJT_CACHE_SIZE;
+
+protected:
+  /**
+   * @brief Number of rows of the left eigen vectors matrix processed together in computePij_t().
+   */
+  static const size_t PIJT_BLOCK_SIZE;
+
 public:
   AbstractSubstitutionModel(const Alphabet* alpha, StateMap* stateMap, const std::string& prefix);
 
@@ -197,7 +295,17 @@ public:
     isNonSingular_(model.isNonSingular_),
     leftEigenVectors_(model.leftEigenVectors_),
     vPowGen_(model.vPowGen_),
-    tmpMat_(model.tmpMat_)
+    tmpMat_(model.tmpMat_),
+    generatorRows_(model.generatorRows_),
+    generatorColumns_(model.generatorColumns_),
+    modelVersion_(model.modelVersion_),
+    pijtCaches_(),
+    pijtCacheMutex_(),
+    pijtCacheSize_(model.pijtCacheSize_),
+    expWorkspace_(),
+    expTime_(0),
+    expVersion_(0),
+    expOrder_(-1)
   {}
 
   AbstractSubstitutionModel& operator=(const AbstractSubstitutionModel& model)
@@ -222,6 +330,12 @@ public:
     leftEigenVectors_  = model.leftEigenVectors_;
     vPowGen_           = model.vPowGen_;
     tmpMat_            = model.tmpMat_;
+    generatorRows_     = model.generatorRows_;
+    generatorColumns_  = model.generatorColumns_;
+    modelVersion_      = model.modelVersion_ + 1;
+    pijtCacheSize_     = model.pijtCacheSize_;
+    clearTransitionProbabilitiesCache();
+    expOrder_          = -1;
     return *this;
   }
   
@@ -256,6 +370,18 @@ public:
   virtual const Matrix<double>& getdPij_dt(double t) const;
   virtual const Matrix<double>& getd2Pij_dt2(double t) const;
 
+  /**
+   * @brief Compute all probabilities of change for several times at once.
+   *
+   * When the generator is diagonalizable, the exponentials of all eigen values are
+   * computed for all times first, and each matrix is then obtained from contiguous
+   * copies of the eigen vectors. The cache is not used. Otherwise, getPij_t() is
+   * called for each time.
+   *
+   * @see SubstitutionModel::computePij_t()
+   */
+  virtual void computePij_t(const std::vector<double>& times, double* pijt) const;
+
   const Vdouble& getEigenValues() const { return eigenValues_; }
 
   const Vdouble& getIEigenValues() const { return iEigenValues_; }
@@ -286,6 +412,45 @@ public:
 
   bool enableEigenDecomposition() { return eigenDecompose_; }
 
+  /**
+   * @name Transition probabilities cache.
+   *
+   * @{
+   */
+
+  /**
+   * @brief Set the maximum number of matrices stored in the cache.
+   *
+   * Each thread calling getPij_t(), getdPij_dt() or getd2Pij_dt2() has its own
+   * cache of this size. Matrices are only reused across likelihood updates when
+   * the cache can hold one entry per branch and rate class, that is
+   * (number of nodes - 1) * number of classes for a homogeneous model:
+   * with fewer entries, the least recently used ones are discarded before they
+   * are requested again.
+   *
+   * @param size The number of times t for which matrices are stored. 0 disables the cache.
+   */
+  void setTransitionProbabilitiesCacheSize(size_t size);
+
+  size_t getTransitionProbabilitiesCacheSize() const { return pijtCacheSize_; }
+
+  /**
+   * @return The version of the model, which changes each time the transition probabilities may change.
+   * A copy of the model has the same version as the original, until one of them is modified.
+   */
+  unsigned int getModelVersion() const { return modelVersion_; }
+
+  /**
+   * @brief Remove all matrices from the cache.
+   */
+  void clearTransitionProbabilitiesCache() const
+  {
+    std::lock_guard<std::mutex> lock(pijtCacheMutex_);
+    pijtCaches_.clear();
+  }
+
+  /** @} */
+
   /**
    * @brief Tells the model that a parameter value has changed.
    *
@@ -294,7 +459,8 @@ public:
   virtual void fireParameterChanged(const ParameterList& parameters)
   {
     AbstractParameterAliasable::fireParameterChanged(parameters);
-    
+    modelVersion_++;
+
     if (parameters.hasParameter(getNamespace()+"rate"))
     {
       rate_=parameters.getParameterValue(getNamespace()+"rate");
@@ -331,6 +497,65 @@ protected:
    */
   virtual void updateMatrices();
 
+  /**
+   * @brief Compute the transition probabilities and their derivatives, without using the cache.
+   *
+   * Results are stored in the pijt_, dpijt_ and d2pijt_ matrices.
+   *
+   * @param t The time.
+   */
+  void computePij_t_(double t) const;
+  void computedPij_dt_(double t) const;
+  void computed2Pij_dt2_(double t) const;
+
+private:
+  /**
+   * @return The cache entry of the calling thread for a given time, created if needed.
+   *
+   * pijtCacheMutex_ must be held by the caller.
+   *
+   * @param t The time.
+   */
+  TransitionProbabilitiesCacheEntry& getTransitionProbabilitiesCacheEntry_(double t) const;
+
+  /**
+   * @brief Compute exp(rate * t * Q) and its derivatives with respect to t, when the generator is not diagonalizable.
+   *
+   * A Pade approximant of degree (6, 6) is used, with scaling and squaring,
+   * unless the structure of the generator is known (see generatorRows_),
+   * in which case computeUniformizedExponential_() is used.
+   * The derivatives are obtained from the exponential by multiplication by rate * Q.
+   * Results are kept for the last time, and only the missing orders are computed.
+   *
+   * @param t The time.
+   * @param order The maximum order of derivation needed (0, 1 or 2).
+   */
+  void computeExponential_(double t, int order) const;
+
+  /**
+   * @brief Compute exp(rate * t * Q) by uniformization on the sparse generator.
+   *
+   * With \f$\mu \geq \max_i |Q_{i,i}|\f$ and \f$B = I + Q / \mu\f$,
+   * \f[
+   * \exp(Q) = \sum_k e^{-\mu} \frac{\mu^k}{k!} B^k,
+   * \f]
+   * where all terms are non-negative and each product by \f$B\f$ only
+   * involves the non-null entries of the generator. The time is scaled so
+   * that \f$\mu \leq 1\f$ and the result is squared back.
+   * The exponential is stored in expWorkspace_ as by computeExponential_().
+   *
+   * @param t The time.
+   */
+  void computeUniformizedExponential_(double t) const;
+
+  /**
+   * @brief Copy a result of computeExponential_() into a matrix.
+   *
+   * @param order The order of derivation.
+   * @param m The output matrix, with the proper dimensions.
+   */
+  void copyExponential_(int order, RowMatrix<double>& m) const;
+
 public:
   double getScale() const;
 
@@ -364,7 +589,9 @@ public:
  * vector. It then computes eigen values and vectors and fills the
  * corresponding vector (eigenValues_) and matrices (leftEigenVectors_
  * and rightEigenVectors_). Because of reversibility,
- * isDiagonalizable_ is set to true.
+ * isDiagonalizable_ is set to true, and the decomposition is
+ * performed on the symmetric matrix
+ * \f$\Pi^{1/2} Q \Pi^{-1/2}\f$, which requires no matrix inversion.
  *
  * The freq_ vector and exchangeability_ matrices are hence the only
  * things to provide to create a substitution model. It is also
@@ -418,8 +645,26 @@ protected:
    *
    * Eigen values and vectors are computed from the scaled generator and assigned to the
    * eigenValues_, rightEigenVectors_ and leftEigenVectors_ variables.
+   * As \f$Q\f$ is reversible,
+   * \f[
+   * A = \Pi^{1/2} \times Q \times \Pi^{-1/2}
+   * \f]
+   * is symmetric and has an orthogonal decomposition \f$A = V \times D \times V^T\f$.
+   * Right and left eigen vectors of \f$Q\f$ are then \f$\Pi^{-1/2} \times V\f$ and
+   * \f$V^T \times \Pi^{1/2}\f$. The general decomposition of
+   * AbstractSubstitutionModel::updateMatrices() is used instead if some
+   * frequencies are null.
    */
   virtual void updateMatrices();
+
+private:
+  /**
+   * @brief Diagonalize the generator through its symmetrized form.
+   *
+   * @return false if the decomposition could not be performed (null
+   * frequencies), in which case eigen values and vectors are left unchanged.
+   */
+  bool updateSymmetricEigenDecomposition_();
 };
 
 } //end of namespace bpp.
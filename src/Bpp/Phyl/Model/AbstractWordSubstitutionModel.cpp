@@ -269,6 +269,7 @@ void AbstractWordSubstitutionModel::setNamespace(const std::string& prefix)
 
 void AbstractWordSubstitutionModel::updateMatrices()
 {
+  modelVersion_++;
   // First we update position specific models. This need to be done
   // here and not in fireParameterChanged, as some parameter aliases
   // might have been defined and need to be resolved first.
@@ -296,6 +297,9 @@ void AbstractWordSubstitutionModel::updateMatrices()
     vsize.push_back(VSubMod_[k]->getNumberOfStates());
   }
 
+  if (generatorRows_.size() != salph + 1)
+    updateGeneratorStructure_();
+
   RowMatrix<double> gk, exch;
 
   m = 1;
@@ -333,10 +337,9 @@ void AbstractWordSubstitutionModel::updateMatrices()
   for (i = 0; i < salph; i++)
   {
     x = 0;
-    for (j = 0; j < salph; j++)
+    for (k = generatorRows_[i]; k < generatorRows_[i + 1]; k++)
     {
-      if (j != i)
-        x += generator_(i, j);
+      x += generator_(i, generatorColumns_[k]);
     }
     generator_(i, i) = -x;
   }
@@ -351,9 +354,9 @@ void AbstractWordSubstitutionModel::updateMatrices()
     for (i = 0; i < salph; i++)
     {
       bool flag = true;
-      for (j = 0; j < salph; j++)
+      for (k = generatorRows_[i]; k < generatorRows_[i + 1]; k++)
       {
-        if ((i != j) && abs(generator_(i, j)) > NumConstants::TINY())
+        if (abs(generator_(i, generatorColumns_[k])) > NumConstants::TINY())
         {
           flag = false;
           break;
@@ -518,7 +521,7 @@ void AbstractWordSubstitutionModel::updateMatrices()
     // if rightEigenVectors_ is singular
     catch (ZeroDivisionException& e)
     {
-      ApplicationTools::displayMessage("Singularity during  diagonalization. Taylor series used instead.");
+      ApplicationTools::displayMessage("Singularity during  diagonalization. Pade approximant used instead.");
       isNonSingular_ = false;
       isDiagonalizable_ = false;
     }
@@ -561,12 +564,13 @@ void AbstractWordSubstitutionModel::updateMatrices()
       eigenValues_[i] /= -x;
       iEigenValues_[i] /= -x;
     }
-
-    if (!isNonSingular_)
-      MatrixTools::Taylor(generator_, 30, vPowGen_);
   }
   else  // compute freq_ is no eigenDecomposition
   {
+    // the exponential is computed from the sparse generator
+    isNonSingular_ = false;
+    isDiagonalizable_ = false;
+
     for (j = 0; j < size_; j++)
       freq_[j] = 1;
   
@@ -598,6 +602,37 @@ void AbstractWordSubstitutionModel::updateMatrices()
       exchangeability_(i, j) = generator_(i, j) / freq_[j];
 }
 
+/******************************************************************************/
+
+void AbstractWordSubstitutionModel::updateGeneratorStructure_()
+{
+  size_t nbmod = VSubMod_.size();
+  size_t salph = getNumberOfStates();
+
+  generatorRows_.resize(salph + 1);
+  generatorColumns_.clear();
+  for (size_t i = 0; i < salph; i++)
+  {
+    generatorRows_[i] = generatorColumns_.size();
+    // Change the letter at each position, from the last one:
+    size_t m = 1;
+    for (size_t k = nbmod; k > 0; k--)
+    {
+      size_t s = VSubMod_[k - 1]->getNumberOfStates();
+      size_t l = (i / m) % s;
+      for (size_t a = 0; a < s; a++)
+      {
+        if (a != l)
+          generatorColumns_.push_back(i + a * m - l * m);
+      }
+      m *= s;
+    }
+  }
+  generatorRows_[salph] = generatorColumns_.size();
+}
+
+/******************************************************************************/
+
 void AbstractWordSubstitutionModel::setFreq(std::map<int, double>& freqs)
 {
   map<int, double> tmpFreq;
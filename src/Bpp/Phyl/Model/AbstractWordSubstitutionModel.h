@@ -151,6 +151,12 @@ private:
    */
   bool new_alphabet_;
 
+  /**
+   * @brief Fill generatorRows_ and generatorColumns_ with the pairs of
+   * words which differ at a single position.
+   */
+  void updateGeneratorStructure_();
+
 protected:
   std::vector<SubstitutionModel*> VSubMod_;
   std::vector<std::string> VnestedPrefix_;
@@ -67,6 +67,7 @@ BinarySubstitutionModel::BinarySubstitutionModel(const BinaryAlphabet* alpha, do
 
 void BinarySubstitutionModel::updateMatrices()
 {
+  modelVersion_++;
   kappa_ = getParameterValue("kappa"); // alpha/beta
   lambda_ = (kappa_ + 1) * (kappa_ + 1) / (2 * kappa_);
 
@@ -172,14 +172,17 @@ void AbstractCodonSubstitutionModel::updateMatrices()
 
 void AbstractCodonSubstitutionModel::completeMatrices()
 {
-  size_t i, j;
+  size_t i, j, k;
   size_t salph = getNumberOfStates();
 
+  // Only single nucleotide changes may be non-null:
   for (i = 0; i < salph; i++)
   {
-    for (j = 0; j < salph; j++)
+    bool stop = gCode_->isStop(static_cast<int>(i));
+    for (k = generatorRows_[i]; k < generatorRows_[i + 1]; k++)
     {
-      if (gCode_->isStop(static_cast<int>(i)) || gCode_->isStop(static_cast<int>(j)))
+      j = generatorColumns_[k];
+      if (stop || gCode_->isStop(static_cast<int>(j)))
       {
         generator_(i, j) = 0;
       }
@@ -191,6 +191,7 @@ const DiscreteDistribution* MixtureOfASubstitutionModel::getDistribution(std::st
 
 void MixtureOfASubstitutionModel::updateMatrices()
 {
+  modelVersion_++;
   string s, t;
   size_t i, j, l;
   double d;
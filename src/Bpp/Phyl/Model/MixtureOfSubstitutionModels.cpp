@@ -205,6 +205,7 @@ const SubstitutionModel* MixtureOfSubstitutionModels::getSubModelWithName(const
 
 void MixtureOfSubstitutionModels::updateMatrices()
 {
+  modelVersion_++;
   size_t i, j, nbmod = modelsContainer_.size();
 
   double x, y;
@@ -77,6 +77,7 @@ F84::F84(
 
 void F84::updateMatrices()
 {
+  modelVersion_++;
   kappa_ = getParameterValue("kappa");
   theta_  = getParameterValue("theta");
   theta1_ = getParameterValue("theta1");
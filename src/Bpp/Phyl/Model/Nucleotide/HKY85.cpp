@@ -79,6 +79,7 @@ HKY85::HKY85(
 
 void HKY85::updateMatrices()
 {
+  modelVersion_++;
   kappa_  = getParameterValue("kappa");
   theta_  = getParameterValue("theta");
   theta1_ = getParameterValue("theta1");
@@ -60,6 +60,7 @@ JCnuc::JCnuc(const NucleicAlphabet* alpha) :
 
 void JCnuc::updateMatrices()
 {
+  modelVersion_++;
   // Frequencies:
   freq_[0] = freq_[1] = freq_[2] = freq_[3] = 1. / 4.;
 
@@ -63,6 +63,7 @@ AbstractParameterAliasable("K80."),
 
 void K80::updateMatrices()
 {
+  modelVersion_++;
   kappa_ = getParameterValue("kappa");
   k_ = (kappa_ + 1.) / 2.;
   r_ = 4. / (kappa_ + 2.);
@@ -120,6 +120,7 @@ RN95::RN95(
 /******************************************************************************/
 void RN95::updateMatrices()
 {
+  modelVersion_++;
   double alphaP  = getParameterValue("alphaP");
   double sigmaP  = getParameterValue("sigmaP");
   double thetaR  = getParameterValue("thetaR");
@@ -237,11 +238,10 @@ void RN95::updateMatrices()
     }
     catch (ZeroDivisionException& e)
     {
-      ApplicationTools::displayMessage("Singularity during diagonalization of RN95. Taylor series used instead.");
+      ApplicationTools::displayMessage("Singularity during diagonalization of RN95. Pade approximant used instead.");
       
       isNonSingular_ = false;
       isDiagonalizable_ = false;
-      MatrixTools::Taylor(generator_, 30, vPowGen_);
     }
     
     // and the exchangeability_
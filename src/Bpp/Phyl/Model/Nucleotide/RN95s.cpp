@@ -91,6 +91,7 @@ RN95s::RN95s(const NucleicAlphabet* alphabet,
 /******************************************************************************/
 void RN95s::updateMatrices()
 {
+  modelVersion_++;
   freq_[0]  = getParameterValue("thetaA");
   double alphaP  = getParameterValue("alphaP");
   gamma_  = getParameterValue("gamma");
@@ -193,11 +194,10 @@ void RN95s::updateMatrices()
     }
     catch (ZeroDivisionException& e)
     {
-      ApplicationTools::displayMessage("Singularity during  diagonalization. Taylor series used instead.");
+      ApplicationTools::displayMessage("Singularity during  diagonalization. Pade approximant used instead.");
       
       isNonSingular_ = false;
       isDiagonalizable_ = false;
-      MatrixTools::Taylor(generator_, 30, vPowGen_);
     }
     
     // and the exchangeability_
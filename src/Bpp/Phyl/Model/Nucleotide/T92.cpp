@@ -80,6 +80,7 @@ T92::T92(const NucleicAlphabet* alpha, double kappa, double theta) :
 
 void T92::updateMatrices()
 {
+  modelVersion_++;
   kappa_ = getParameterValue("kappa");
   theta_ = getParameterValue("theta");
   piA_ = (1 - theta_) / 2;
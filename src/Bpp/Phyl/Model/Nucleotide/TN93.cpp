@@ -84,6 +84,7 @@ TN93::TN93(
 
 void TN93::updateMatrices()
 {
+  modelVersion_++;
   kappa1_ = getParameterValue("kappa1");
   kappa2_ = getParameterValue("kappa2");
   theta_  = getParameterValue("theta" );
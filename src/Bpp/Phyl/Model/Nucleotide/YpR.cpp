@@ -90,6 +90,7 @@ void YpR::updateMatrices(double CgT, double cGA,
                          double CaT, double cAG,
                          double TaC, double tAC)
 {
+  modelVersion_++;
   //  check_model(pmodel_);
 
   // Generator:
@@ -280,7 +281,7 @@ void YpR::updateMatrices(double CgT, double cGA,
   }
   catch (ZeroDivisionException& e)
   {
-    ApplicationTools::displayMessage("Singularity during  diagonalization. Taylor series used instead.");
+    ApplicationTools::displayMessage("Singularity during  diagonalization. Pade approximant used instead.");
     isNonSingular_ = false;
     isDiagonalizable_ = false;
 
@@ -333,9 +334,6 @@ void YpR::updateMatrices(double CgT, double cGA,
 
   MatrixTools::scale(generator_, 1 / x);
 
-  if (!isNonSingular_)
-    MatrixTools::Taylor(generator_, 30, vPowGen_);
-
   for (i = 0; i < 36; i++)
   {
     eigenValues_[i] /= x;
@@ -91,6 +91,7 @@ void gBGC::fireParameterChanged(const ParameterList& parameters)
 
 void gBGC::updateMatrices()
 {
+  modelVersion_++;
   B_ = getParameterValue("B");
   unsigned int i, j;
   // Generator:
@@ -207,7 +208,7 @@ void gBGC::updateMatrices()
     }
     catch (ZeroDivisionException& e)
     {
-      ApplicationTools::displayMessage("Singularity during diagonalization of gBGC in gBGC. Taylor series used instead.");
+      ApplicationTools::displayMessage("Singularity during diagonalization of gBGC in gBGC. Pade approximant used instead.");
       isNonSingular_ = false;
       isDiagonalizable_ = false;
     }
@@ -252,9 +253,6 @@ void gBGC::updateMatrices()
       eigenValues_[i] /= -x;
       iEigenValues_[i] /= -x;
     }
-
-    if (!isNonSingular_)
-      MatrixTools::Taylor(generator_, 30, vPowGen_);
   }
 }
 
@@ -77,6 +77,7 @@ JCprot::JCprot(const ProteicAlphabet* alpha, ProteinFrequenciesSet* freqSet, boo
 	
 void JCprot::updateMatrices()
 {
+  modelVersion_++;
 	// Frequencies:
 	for (unsigned int i = 0; i < 20; i++) freq_[i] = 1. / 20.;
 
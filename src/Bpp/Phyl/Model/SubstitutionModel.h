@@ -343,6 +343,32 @@ public:
    */
   virtual const Matrix<double>& getd2Pij_dt2(double t) const = 0;
 
+  /**
+   * @brief Compute all probabilities of change for several times at once.
+   *
+   * Matrices are written one after the other in the output buffer, each
+   * one in row-major order. This default implementation calls getPij_t()
+   * for each time.
+   *
+   * @param times The times for which probabilities are computed.
+   * @param pijt A buffer of at least times.size() * n * n values, where n is the number of states.
+   */
+  virtual void computePij_t(const std::vector<double>& times, double* pijt) const
+  {
+    size_t n = getNumberOfStates();
+    for (size_t k = 0; k < times.size(); k++)
+    {
+      const Matrix<double>& p = getPij_t(times[k]);
+      for (size_t i = 0; i < n; i++)
+      {
+        for (size_t j = 0; j < n; j++)
+        {
+          *pijt++ = p(i, j);
+        }
+      }
+    }
+  }
+
   /**
    * @brief Set if eigenValues and Vectors must be computed
    */
@@ -45,6 +45,9 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "TreeTemplate.h"
 #include "TopologySearch.h"
 
+// From the STL:
+#include <vector>
+
 namespace bpp
 {
 
@@ -94,7 +97,7 @@ namespace bpp
  * 
  */
 class NNISearchable:
-  public TopologyListener,
+  public virtual TopologyListener,
   public virtual Clonable
 {
 	public:
@@ -119,6 +122,24 @@ class NNISearchable:
 		 */
 		virtual double testNNI(int nodeId) const throw (NodeException) = 0;
 
+		/**
+		 * @brief Send the scores of several NNI movements, without performing them.
+		 *
+		 * The default implementation calls testNNI() for each node, in the given order.
+		 * Implementations may evaluate the movements concurrently, in which case the
+		 * result must be identical to the one of the sequential calls.
+		 *
+		 * @param nodeIds The ids of the nodes defining the NNI movements.
+		 * @param diffs [out] The score variation of each NNI, in the same order as nodeIds.
+		 * @throw NodeException If one of the nodes does not define a valid NNI.
+		 */
+		virtual void testNNIs(const std::vector<int>& nodeIds, std::vector<double>& diffs) const throw (NodeException)
+		{
+			diffs.resize(nodeIds.size());
+			for (size_t i = 0; i < nodeIds.size(); i++)
+				diffs[i] = testNNI(nodeIds[i]);
+		}
+
 		/**
 		 * @brief Perform a NNI movement.
 		 *
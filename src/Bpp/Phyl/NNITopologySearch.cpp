@@ -99,29 +99,19 @@ void NNITopologySearch::searchFast() throw (Exception)
   bool test = true;
   do
   {
-    TreeTemplate<Node> tree(searchableTree_->getTopology());
-    vector<Node*> nodes = tree.getNodes();
-
-    vector<Node*> nodesSub = nodes;
-    for (size_t i = nodesSub.size(); i > 0; i--)
-    {
-      // !!! must not reach i==0 because of size_t
-      if (!(nodesSub[i - 1]->hasFather()))
-        nodesSub.erase(nodesSub.begin() + static_cast<ptrdiff_t>(i - 1));  // Remove root node.
-      else if (!(nodesSub[i - 1]->getFather()->hasFather()))
-        nodesSub.erase(nodesSub.begin() + static_cast<ptrdiff_t>(i - 1));  // Remove son of root node.
-    }
+    FlatTree tree(searchableTree_->getTopology());
+    vector<int> nodesSub = getNNINodesId_(tree);
 
     // Test all NNIs:
     test = false;
     for (size_t i = 0; !test && i < nodesSub.size(); i++)
     {
-      Node* node = nodesSub[i];
-      double diff = searchableTree_->testNNI(node->getId());
+      int nodeId = nodesSub[i];
+      double diff = searchableTree_->testNNI(nodeId);
       if (verbose_ >= 3)
       {
-        ApplicationTools::displayResult("   Testing node " + TextTools::toString(node->getId())
-                                        + " at " + TextTools::toString(node->getFather()->getId()),
+        ApplicationTools::displayResult("   Testing node " + TextTools::toString(nodeId)
+                                        + " at " + TextTools::toString(tree.getFatherId(nodeId)),
                                         TextTools::toString(diff));
       }
 
@@ -129,11 +119,11 @@ void NNITopologySearch::searchFast() throw (Exception)
       { // Good NNI found...
         if (verbose_ >= 2)
         {
-          ApplicationTools::displayResult("   Swapping node " + TextTools::toString(node->getId())
-                                          + " at " + TextTools::toString(node->getFather()->getId()),
+          ApplicationTools::displayResult("   Swapping node " + TextTools::toString(nodeId)
+                                          + " at " + TextTools::toString(tree.getFatherId(nodeId)),
                                           TextTools::toString(diff));
         }
-        searchableTree_->doNNI(node->getId());
+        searchableTree_->doNNI(nodeId);
         // Notify:
         notifyAllPerformed(TopologyChangeEvent());
         test = true;
@@ -151,40 +141,35 @@ void NNITopologySearch::searchBetter() throw (Exception)
   bool test = true;
   do
   {
-    TreeTemplate<Node> tree(searchableTree_->getTopology());
-    vector<Node*> nodes = tree.getNodes();
+    FlatTree tree(searchableTree_->getTopology());
 
     if (verbose_ >= 3)
       ApplicationTools::displayTask("Test all possible NNIs...");
 
-    vector<Node*> nodesSub = nodes;
-    for (size_t i = nodesSub.size(); i > 0; i--)
-    { // !!! must not reach i==0 because of size_t
-      if (!(nodesSub[i - 1]->hasFather()))
-        nodesSub.erase(nodesSub.begin() + static_cast<ptrdiff_t>(i - 1));  // Remove root node.
-      else if (!(nodesSub[i - 1]->getFather()->hasFather()))
-        nodesSub.erase(nodesSub.begin() + static_cast<ptrdiff_t>(i - 1));  // Remove son of root node.
-    }
+    vector<int> nodesSub = getNNINodesId_(tree);
 
     // Test all NNIs:
-    vector<Node*> improving;
+    vector<int> improving;
     vector<double> improvement;
     if (verbose_ >= 2 && ApplicationTools::message)
       ApplicationTools::message->endLine();
+    // All NNIs are scored at once, possibly concurrently:
+    vector<double> diffs;
+    searchableTree_->testNNIs(nodesSub, diffs);
     for (size_t i = 0; i < nodesSub.size(); i++)
     {
-      Node* node = nodesSub[i];
-      double diff = searchableTree_->testNNI(node->getId());
+      int nodeId = nodesSub[i];
+      double diff = diffs[i];
       if (verbose_ >= 3)
       {
-        ApplicationTools::displayResult("   Testing node " + TextTools::toString(node->getId())
-                                        + " at " + TextTools::toString(node->getFather()->getId()),
+        ApplicationTools::displayResult("   Testing node " + TextTools::toString(nodeId)
+                                        + " at " + TextTools::toString(tree.getFatherId(nodeId)),
                                         TextTools::toString(diff));
       }
 
       if (diff < 0.)
       {
-        improving.push_back(node);
+        improving.push_back(nodeId);
         improvement.push_back(diff);
       }
     }
@@ -194,12 +179,12 @@ void NNITopologySearch::searchBetter() throw (Exception)
     if (test)
     {
       size_t nodeMin = VectorTools::whichMin(improvement);
-      Node* node = improving[nodeMin];
+      int nodeId = improving[nodeMin];
       if (verbose_ >= 2)
-        ApplicationTools::displayResult("   Swapping node " + TextTools::toString(node->getId())
-                                        + " at " + TextTools::toString(node->getFather()->getId()),
+        ApplicationTools::displayResult("   Swapping node " + TextTools::toString(nodeId)
+                                        + " at " + TextTools::toString(tree.getFatherId(nodeId)),
                                         TextTools::toString(improvement[nodeMin]));
-      searchableTree_->doNNI(node->getId());
+      searchableTree_->doNNI(nodeId);
 
       // Notify:
       notifyAllPerformed(TopologyChangeEvent());
@@ -218,32 +203,27 @@ void NNITopologySearch::searchPhyML() throw (Exception)
   {
     if (verbose_ >= 3)
       ApplicationTools::displayTask("Test all possible NNIs...");
-    TreeTemplate<Node> tree(searchableTree_->getTopology());
-    vector<Node*> nodes = tree.getNodes();
-    vector<Node*> nodesSub = nodes;
-    for (size_t i = nodesSub.size(); i > 0; i--)
-    {
-      // !!! must not reach i==0 because of size_t
-      if (!(nodesSub[i - 1]->hasFather()))
-        nodesSub.erase(nodesSub.begin() + static_cast<ptrdiff_t>(i - 1));  // Remove root node.
-      else if (!(nodesSub[i - 1]->getFather()->hasFather()))
-        nodesSub.erase(nodesSub.begin() + static_cast<ptrdiff_t>(i - 1));  // Remove son of root node.
-    }
+    FlatTree tree(searchableTree_->getTopology());
+    vector<int> nodesSub = getNNINodesId_(tree);
 
     // Test all NNIs:
     vector<int> improving;
-    vector<Node*> improvingNodes;
     vector<double> improvement;
     if (verbose_ >= 2 && ApplicationTools::message)
       ApplicationTools::message->endLine();
+    // All NNIs are scored at once, possibly concurrently:
+    vector<double> diffs;
+    searchableTree_->testNNIs(nodesSub, diffs);
     for (size_t i = 0; i < nodesSub.size(); i++)
     {
-      Node* node = nodesSub[i];
-      double diff = searchableTree_->testNNI(node->getId());
+      int nodeId = nodesSub[i];
+      int fatherId = tree.getFatherId(nodeId);
+      int grandFatherId = tree.getFatherId(fatherId);
+      double diff = diffs[i];
       if (verbose_ >= 3)
       {
-        ApplicationTools::displayResult("   Testing node " + TextTools::toString(node->getId())
-                                        + " at " + TextTools::toString(node->getFather()->getId()),
+        ApplicationTools::displayResult("   Testing node " + TextTools::toString(nodeId)
+                                        + " at " + TextTools::toString(fatherId),
                                         TextTools::toString(diff));
       }
 
@@ -253,16 +233,18 @@ void NNITopologySearch::searchPhyML() throw (Exception)
         // Must test for incompatible NNIs...
         for (size_t j = improving.size(); j > 0; j--)
         {
-          if (improvingNodes[j - 1]->getFather()->getId() == node->getFather()->getId()
-              || improvingNodes[j - 1]->getFather()->getFather()->getId() == node->getFather()->getFather()->getId()
-              || improvingNodes[j - 1]->getId() == node->getFather()->getId()                           || improvingNodes[j - 1]->getFather()->getId() == node->getId()
-              || improvingNodes[j - 1]->getId() == node->getFather()->getFather()->getId()              || improvingNodes[j - 1]->getFather()->getFather()->getId() == node->getId()
-              || improvingNodes[j - 1]->getFather()->getId() == node->getFather()->getFather()->getId() || improvingNodes[j - 1]->getFather()->getFather()->getId() == node->getFather()->getId())
+          int improvingId = improving[j - 1];
+          int improvingFatherId = tree.getFatherId(improvingId);
+          int improvingGrandFatherId = tree.getFatherId(improvingFatherId);
+          if (improvingFatherId == fatherId
+              || improvingGrandFatherId == grandFatherId
+              || improvingId == fatherId                 || improvingFatherId == nodeId
+              || improvingId == grandFatherId            || improvingGrandFatherId == nodeId
+              || improvingFatherId == grandFatherId      || improvingGrandFatherId == fatherId)
           {
             // These are incompatible NNIs. We only keep the best:
             if (diff < improvement[j - 1])
             { // Erase previous node
-              improvingNodes.erase(improvingNodes.begin() + static_cast<ptrdiff_t>(j - 1));
               improving.erase(improving.begin() + static_cast<ptrdiff_t>(j - 1));
               improvement.erase(improvement.begin() + static_cast<ptrdiff_t>(j - 1));
             } // Otherwise forget about this NNI.
@@ -283,25 +265,11 @@ void NNITopologySearch::searchPhyML() throw (Exception)
               pos = j; break;
             }
           }
-          if (pos < improvement.size())
-          {
-            improvingNodes.insert(improvingNodes.begin() + static_cast<ptrdiff_t>(pos), node);
-            improving.insert(improving.begin() + static_cast<ptrdiff_t>(pos), node->getId());
-            improvement.insert(improvement.begin() + static_cast<ptrdiff_t>(pos), diff);
-          }
-          else
-          {
-            improvingNodes.insert(improvingNodes.end(), node);
-            improving.insert(improving.end(), node->getId());
-            improvement.insert(improvement.end(), diff);
-          }
+          improving.insert(improving.begin() + static_cast<ptrdiff_t>(pos), nodeId);
+          improvement.insert(improvement.begin() + static_cast<ptrdiff_t>(pos), diff);
         }
       }
     }
-    // This array is no more useful.
-    // Moreover, if a backward movement is performed,
-    // the underlying node will not exist anymore...
-    improvingNodes.clear();
     if (verbose_ >= 3)
       ApplicationTools::displayTaskDone();
     test = improving.size() > 0;
@@ -365,3 +333,19 @@ void NNITopologySearch::searchPhyML() throw (Exception)
   while (test);
 }
 
+vector<int> NNITopologySearch::getNNINodesId_(const FlatTree& tree)
+{
+  vector<size_t> order = tree.getPostOrder();
+  size_t root = tree.getRootIndex();
+  vector<int> ids;
+  ids.reserve(order.size());
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    // Remove root node and sons of root node:
+    size_t father = tree.getFatherIndex(order[i]);
+    if (father != FlatTree::NO_NODE && father != root)
+      ids.push_back(tree.getNodeId(order[i]));
+  }
+  return ids;
+}
+
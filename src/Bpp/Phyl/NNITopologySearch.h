@@ -42,6 +42,7 @@ knowledge of the CeCILL license and that you accept its terms.
 
 #include "TopologySearch.h"
 #include "NNISearchable.h"
+#include "FlatTree.h"
 
 namespace bpp
 {
@@ -57,6 +58,10 @@ namespace bpp
  *   Then re-loop over all nodes.
  * - PhyML algorithm (not fully tested, use with care): as the previous one, but perform all NNI improving the score at the same time.
  *   Leads to faster convergence.
+ *
+ * With the Better and PhyML algorithms, all NNIs of a round are scored with a single call to NNISearchable::testNNIs(),
+ * which may evaluate them concurrently (see for instance NNIHomogeneousTreeLikelihood::setNumberOfThreads()).
+ * The chosen NNIs are then performed sequentially, in the same order as with a sequential evaluation.
  */
 class NNITopologySearch :
   public virtual TopologySearch
@@ -163,6 +168,17 @@ class NNITopologySearch :
      * @brief Process a TopologyChangeEvent to all listeners.
      */
     void notifyAllSuccessful(const TopologyChangeEvent& event);
+
+  private:
+    /**
+     * @brief Get the nodes on which a NNI can be performed, that is all nodes but the root node and its sons.
+     *
+     * The topology is copied in a FlatTree at each round of the search, which is cheaper than a TreeTemplate copy.
+     *
+     * @param tree The current topology.
+     * @return The ids of the nodes, in post-order.
+     */
+    static std::vector<int> getNNINodesId_(const FlatTree& tree);
 		
 };
 
@@ -106,6 +106,11 @@ public:
     return rootWeights_[pos];
   }
 
+  const std::vector<unsigned int>& getWeights() const
+  {
+    return rootWeights_;
+  }
+
   const TreeTemplate<Node>* getTree() const { return tree_; }
 
 protected:
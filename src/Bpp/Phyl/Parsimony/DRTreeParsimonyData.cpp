@@ -104,7 +104,7 @@ void DRTreeParsimonyData::init(const SiteContainer& sites, const StateMap& state
   delete sequences;
 
   // Now initialize root arrays:
-  rootBitsets_.resize(nbDistinctSites_);
+  rootBitsets_.resize(nbDistinctSites_, nbStates_);
   rootScores_.resize(nbDistinctSites_);
 }
 
@@ -124,24 +124,23 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
       throw SequenceNotFoundException("DRTreeParsimonyData:init(node, sites). Leaf name in tree not found in site container: ", (node->getName()));
     }
     DRTreeParsimonyLeafData* leafData    = &leafData_[node->getId()];
-    vector<Bitset>* leafData_bitsets     = &leafData->getBitsetsArray();
+    ParsimonyBitsetArray* leafData_bitsets = &leafData->getBitsetsArray();
     leafData->setNode(node);
 
-    leafData_bitsets->resize(nbDistinctSites_);
+    leafData_bitsets->resize(nbDistinctSites_, nbStates_);
 
     for (unsigned int i = 0; i < nbDistinctSites_; i++)
     {
-      Bitset* leafData_bitsets_i = &(*leafData_bitsets)[i];
+      // Leaves bitset are set to 1 if the char correspond to the site in the sequence,
+      // otherwise value set to 0:
+      int state = seq->getValue(i);
+      vector<int> states = alphabet->getAlias(state);
       for (unsigned int s = 0; s < nbStates_; s++)
       {
-        // Leaves bitset are set to 1 if the char correspond to the site in the sequence,
-        // otherwise value set to 0:
-        int state = seq->getValue(i);
-        vector<int> states = alphabet->getAlias(state);
         for (size_t j = 0; j < states.size(); j++)
         {
           if (stateMap.getAlphabetStateAsInt(s) == states[j])
-            (*leafData_bitsets_i)[s].flip();
+            leafData_bitsets->set(i, s);
         }
       }
     }
@@ -157,10 +156,10 @@ void DRTreeParsimonyData::init(const Node* node, const SiteContainer& sites, con
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
+      ParsimonyBitsetArray* neighborData_bitsets = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
       vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
 
-      neighborData_bitsets->resize(nbDistinctSites_);
+      neighborData_bitsets->resize(nbDistinctSites_, nbStates_);
       neighborData_scores->resize(nbDistinctSites_);
     }
   }
@@ -198,10 +197,10 @@ void DRTreeParsimonyData::reInit(const Node* node) throw (Exception)
     for (int n = (node->hasFather() ? -1 : 0); n < nbSons; n++)
     {
       const Node* neighbor = (*node)[n];
-      vector<Bitset>* neighborData_bitsets       = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
+      ParsimonyBitsetArray* neighborData_bitsets = &nodeData->getBitsetsArrayForNeighbor(neighbor->getId());
       vector<unsigned int>* neighborData_scores  = &nodeData->getScoresArrayForNeighbor(neighbor->getId());
 
-      neighborData_bitsets->resize(nbDistinctSites_);
+      neighborData_bitsets->resize(nbDistinctSites_, nbStates_);
       neighborData_scores->resize(nbDistinctSites_);
     }
   }
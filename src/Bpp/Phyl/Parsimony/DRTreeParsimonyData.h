@@ -42,17 +42,14 @@
 #define _DRTREEPARSIMONYDATA_H_
 
 #include "AbstractTreeParsimonyData.h"
+#include "ParsimonyBitsetArray.h"
 #include "../Model/StateMap.h"
 
 // From SeqLib
 #include <Bpp/Seq/Container/SiteContainer.h>
 
-// From the STL:
-#include <bitset>
-
 namespace bpp
 {
-typedef std::bitset<21> Bitset; // 20AA + gaps, codon not lalowed so far :s
 
 /**
  * @brief Parsimony data structure for a node.
@@ -60,7 +57,7 @@ typedef std::bitset<21> Bitset; // 20AA + gaps, codon not lalowed so far :s
  * This class is for use with the DRTreeParsimonyData class.
  *
  * Store for each neighbor node
- * - a vector of bitsets,
+ * - a bit-sliced array of state sets (see ParsimonyBitsetArray),
  * - a vector of score for the corresponding subtree.
  *
  * @see DRTreeParsimonyData
@@ -69,7 +66,7 @@ class DRTreeParsimonyNodeData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::map<int, std::vector<Bitset> > nodeBitsets_;
+  mutable std::map<int, ParsimonyBitsetArray> nodeBitsets_;
   mutable std::map<int, std::vector<unsigned int> > nodeScores_;
   const Node* node_;
 
@@ -101,11 +98,11 @@ public:
 
   void setNode(const Node* node) { node_ = node; }
 
-  std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId)
+  ParsimonyBitsetArray& getBitsetsArrayForNeighbor(int neighborId)
   {
     return nodeBitsets_[neighborId];
   }
-  const std::vector<Bitset>& getBitsetsArrayForNeighbor(int neighborId) const
+  const ParsimonyBitsetArray& getBitsetsArrayForNeighbor(int neighborId) const
   {
     return nodeBitsets_[neighborId];
   }
@@ -135,7 +132,7 @@ public:
  *
  * This class is for use with the DRTreeParsimonyData class.
  *
- * Store the vector of bitsets associated to a leaf.
+ * Store the bit-sliced array of state sets associated to a leaf.
  *
  * @see DRTreeParsimonyData
  */
@@ -143,7 +140,7 @@ class DRTreeParsimonyLeafData :
   public TreeParsimonyNodeData
 {
 private:
-  mutable std::vector<Bitset> leafBitsets_;
+  mutable ParsimonyBitsetArray leafBitsets_;
   const Node* leaf_;
 
 public:
@@ -171,11 +168,11 @@ public:
   const Node* getNode() const { return leaf_; }
   void setNode(const Node* node) { leaf_ = node; }
 
-  std::vector<Bitset>& getBitsetsArray()
+  ParsimonyBitsetArray& getBitsetsArray()
   {
     return leafBitsets_;
   }
-  const std::vector<Bitset>& getBitsetsArray() const
+  const ParsimonyBitsetArray& getBitsetsArray() const
   {
     return leafBitsets_;
   }
@@ -185,6 +182,8 @@ public:
  * @brief Parsimony data structure for double-recursive (DR) algorithm.
  *
  * States are coded using bitsets for faster computing (@see AbstractTreeParsimonyData).
+ * Bitsets are stored by blocks of ParsimonyBitsetArray::SITES_PER_WORD sites, one word per state,
+ * so that any alphabet size can be used (codons included).
  * For each inner node in the tree, we store a DRTreeParsimonyNodeData object in nodeData_.
  * For each leaf node in the tree, we store a DRTreeParsimonyLeafData object in leafData_.
  *
@@ -198,7 +197,7 @@ class DRTreeParsimonyData :
 private:
   mutable std::map<int, DRTreeParsimonyNodeData> nodeData_;
   mutable std::map<int, DRTreeParsimonyLeafData> leafData_;
-  mutable std::vector<Bitset> rootBitsets_;
+  mutable ParsimonyBitsetArray rootBitsets_;
   mutable std::vector<unsigned int> rootScores_;
   SiteContainer* shrunkData_;
   size_t nbSites_;
@@ -269,11 +268,11 @@ public:
     return leafData_[nodeId];
   }
 
-  std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId)
+  ParsimonyBitsetArray& getBitsetsArray(int nodeId, int neighborId)
   {
     return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
   }
-  const std::vector<Bitset>& getBitsetsArray(int nodeId, int neighborId) const
+  const ParsimonyBitsetArray& getBitsetsArray(int nodeId, int neighborId) const
   {
     return nodeData_[nodeId].getBitsetsArrayForNeighbor(neighborId);
   }
@@ -292,9 +291,8 @@ public:
     return currentPosition;
   }
 
-  std::vector<Bitset>& getRootBitsets() { return rootBitsets_; }
-  const std::vector<Bitset>& getRootBitsets() const { return rootBitsets_; }
-  const Bitset& getRootBitset(size_t i) const { return rootBitsets_[i]; }
+  ParsimonyBitsetArray& getRootBitsets() { return rootBitsets_; }
+  const ParsimonyBitsetArray& getRootBitsets() const { return rootBitsets_; }
 
   std::vector<unsigned int>& getRootScores() { return rootScores_; }
   const std::vector<unsigned int>& getRootScores() const { return rootScores_; }
@@ -44,6 +44,9 @@
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Numeric/VectorTools.h>
 
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
@@ -136,17 +139,13 @@ void DRTreeParsimonyScore::computeScoresPostorder(const Node* node)
   {
     const Node* son = node->getSon(k);
     computeScoresPostorder(son);
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(son->getId());
+    ParsimonyBitsetArray* bitsets = &pData->getBitsetsArrayForNeighbor(son->getId());
     vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(son->getId());
     if (son->isLeaf())
     {
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(son->getId()).getBitsetsArray();
-      for (unsigned int i = 0; i < sonBitsets->size(); i++)
-      {
-        (*bitsets)[i] = (*sonBitsets)[i];
-        (*scores)[i]  = 0;
-      }
+      *bitsets = parsimonyData_->getLeafData(son->getId()).getBitsetsArray();
+      std::fill(scores->begin(), scores->end(), 0);
     }
     else
     {
@@ -158,14 +157,14 @@ void DRTreeParsimonyScore::computeScoresPostorder(const Node* node)
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, vector<Bitset>& rBitsets, vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPostorderForNode(const DRTreeParsimonyNodeData& pData, ParsimonyBitsetArray& rBitsets, vector<unsigned int>& rScores)
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   const Node* source = node->getFather();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
+  vector<const ParsimonyBitsetArray*> iBitsets;
   vector< const vector<unsigned int>*> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
@@ -187,17 +186,13 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
   if (node->hasFather())
   {
     const Node* father = node->getFather();
-    vector<Bitset>* bitsets      = &pData->getBitsetsArrayForNeighbor(father->getId());
+    ParsimonyBitsetArray* bitsets = &pData->getBitsetsArrayForNeighbor(father->getId());
     vector<unsigned int>* scores = &pData->getScoresArrayForNeighbor(father->getId());
     if (father->isLeaf())
     { // Means that the tree is rooted by a leaf... dunno if we must allow that! Let it be for now.
       // son has no NodeData associated, must use LeafData instead
-      vector<Bitset>* sonBitsets = &parsimonyData_->getLeafData(father->getId()).getBitsetsArray();
-      for (unsigned int i = 0; i < sonBitsets->size(); i++)
-      {
-        (*bitsets)[i] = (*sonBitsets)[i];
-        (*scores)[i]  = 0;
-      }
+      *bitsets = parsimonyData_->getLeafData(father->getId()).getBitsetsArray();
+      std::fill(scores->begin(), scores->end(), 0);
     }
     else
     {
@@ -215,13 +210,13 @@ void DRTreeParsimonyScore::computeScoresPreorder(const Node* node)
   }
 }
 
-void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNodeData& pData, const Node* source, ParsimonyBitsetArray& rBitsets, std::vector<unsigned int>& rScores)
 {
   // First initialize the vectors from input:
   const Node* node = pData.getNode();
   vector<const Node*> neighbors = node->getNeighbors();
   size_t nbNeighbors = node->degree();
-  vector< const vector<Bitset>*> iBitsets;
+  vector<const ParsimonyBitsetArray*> iBitsets;
   vector< const vector<unsigned int>*> iScores;
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
@@ -236,13 +231,13 @@ void DRTreeParsimonyScore::computeScoresPreorderForNode(const DRTreeParsimonyNod
   computeScoresFromArrays(iBitsets, iScores, rBitsets, rScores);
 }
 
-void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets, std::vector<unsigned int>& rScores)
+void DRTreeParsimonyScore::computeScoresForNode(const DRTreeParsimonyNodeData& pData, ParsimonyBitsetArray& rBitsets, std::vector<unsigned int>& rScores)
 {
   const Node* node = pData.getNode();
   size_t nbNeighbors = node->degree();
   vector<const Node*> neighbors = node->getNeighbors();
   // First initialize the vectors fro input:
-  vector< const vector<Bitset>*> iBitsets(nbNeighbors);
+  vector<const ParsimonyBitsetArray*> iBitsets(nbNeighbors);
   vector< const vector<unsigned int>*> iScores(nbNeighbors);
   for (unsigned int k = 0; k < nbNeighbors; k++)
   {
@@ -272,43 +267,101 @@ unsigned int DRTreeParsimonyScore::getScoreForSite(size_t site) const
 }
 
 /******************************************************************************/
+namespace
+{
+  /**
+   * @return The index of the lowest bit set in a non-null word.
+   */
+  inline size_t lowestBit(ParsimonyBitsetArray::Word w)
+  {
+    return ParsimonyBitsetArray::countBits((w & (~w + 1)) - 1);
+  }
+}
+
 void DRTreeParsimonyScore::computeScoresFromArrays(
-  const vector< const vector<Bitset>*>& iBitsets,
+  const vector<const ParsimonyBitsetArray*>& iBitsets,
   const vector< const vector<unsigned int>*>& iScores,
-  vector<Bitset>& oBitsets,
+  ParsimonyBitsetArray& oBitsets,
   vector<unsigned int>& oScores)
 {
-  size_t nbPos  = oBitsets.size();
   size_t nbNodes = iBitsets.size();
   if (iScores.size() != nbNodes)
     throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have the same length.");
   if (nbNodes < 1)
     throw Exception("DRTreeParsimonyScore::computeScores(); Error, input arrays must have a size >= 1.");
-  const vector<Bitset>* bitsets0 = iBitsets[0];
-  const vector<unsigned int>* scores0 = iScores[0];
-  for (size_t i = 0; i < nbPos; i++)
-  {
-    oBitsets[i] = (*bitsets0)[i];
-    oScores[i]  = (*scores0)[i];
-  }
+  oBitsets = *iBitsets[0];
+  oScores  = *iScores[0];
+  size_t nbPos    = oBitsets.getNumberOfSites();
+  size_t nbStates = oBitsets.getNumberOfStates();
+  size_t nbBlocks = oBitsets.getNumberOfBlocks();
   for (size_t k = 1; k < nbNodes; k++)
   {
-    const vector<Bitset>* bitsetsk = iBitsets[k];
+    const ParsimonyBitsetArray* bitsetsk = iBitsets[k];
     const vector<unsigned int>* scoresk = iScores[k];
-    for (unsigned int i = 0; i < nbPos; i++)
+    for (size_t i = 0; i < nbPos; i++)
     {
-      Bitset bs = oBitsets[i] & (*bitsetsk)[i];
       oScores[i] += (*scoresk)[i];
-      if (bs == 0)
+    }
+    // Sites are processed by blocks, and one is added to the score of each site where the intersection is empty:
+    for (size_t b = 0; b < nbBlocks; b++)
+    {
+      ParsimonyBitsetArray::Word empty =
+        ParsimonyBitsetArray::fitch(oBitsets.getBlock(b), bitsetsk->getBlock(b), nbStates) & oBitsets.getSitesMask(b);
+      size_t i0 = b * ParsimonyBitsetArray::SITES_PER_WORD;
+      for ( ; empty != 0; empty &= empty - 1)
       {
-        bs = oBitsets[i] | (*bitsetsk)[i];
-        oScores[i] += 1;
+        oScores[i0 + lowestBit(empty)] += 1;
       }
-      oBitsets[i] = bs;
     }
   }
 }
 
+/******************************************************************************/
+unsigned int DRTreeParsimonyScore::computeScoreFromArrays(
+  const vector<const ParsimonyBitsetArray*>& iBitsets,
+  const vector<const vector<unsigned int>*>& iScores,
+  const vector<unsigned int>& weights)
+{
+  size_t nbNodes = iBitsets.size();
+  if (iScores.size() != nbNodes)
+    throw Exception("DRTreeParsimonyScore::computeScoreFromArrays(); Error, input arrays must have the same length.");
+  if (nbNodes < 1)
+    throw Exception("DRTreeParsimonyScore::computeScoreFromArrays(); Error, input arrays must have a size >= 1.");
+  const ParsimonyBitsetArray* bitsets0 = iBitsets[0];
+  size_t nbPos    = bitsets0->getNumberOfSites();
+  size_t nbStates = bitsets0->getNumberOfStates();
+  size_t nbBlocks = bitsets0->getNumberOfBlocks();
+  unsigned int score = 0;
+  // Scores of the subtrees:
+  for (size_t k = 0; k < nbNodes; k++)
+  {
+    const vector<unsigned int>* scoresk = iScores[k];
+    for (size_t i = 0; i < nbPos; i++)
+    {
+      score += (*scoresk)[i] * weights[i];
+    }
+  }
+  // Unions at this node, computed one block at a time:
+  vector<ParsimonyBitsetArray::Word> block(nbStates);
+  for (size_t b = 0; b < nbBlocks; b++)
+  {
+    const ParsimonyBitsetArray::Word* block0 = bitsets0->getBlock(b);
+    std::copy(block0, block0 + nbStates, block.begin());
+    ParsimonyBitsetArray::Word mask = bitsets0->getSitesMask(b);
+    size_t i0 = b * ParsimonyBitsetArray::SITES_PER_WORD;
+    for (size_t k = 1; k < nbNodes; k++)
+    {
+      ParsimonyBitsetArray::Word empty =
+        ParsimonyBitsetArray::fitch(&block[0], iBitsets[k]->getBlock(b), nbStates) & mask;
+      for ( ; empty != 0; empty &= empty - 1)
+      {
+        score += weights[i0 + lowestBit(empty)];
+      }
+    }
+  }
+  return score;
+}
+
 /******************************************************************************/
 double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
 {
@@ -325,11 +378,11 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
 
   // Retrieving arrays of interest:
   const DRTreeParsimonyNodeData* parentData = &parsimonyData_->getNodeData(parent->getId());
-  const vector<Bitset>* sonBitsets = &parentData->getBitsetsArrayForNeighbor(son->getId());
+  const ParsimonyBitsetArray* sonBitsets = &parentData->getBitsetsArrayForNeighbor(son->getId());
   const vector<unsigned int>* sonScores  = &parentData->getScoresArrayForNeighbor(son->getId());
   vector<const Node*> parentNeighbors = TreeTemplateTools::getRemainingNeighbors(parent, grandFather, son);
   size_t nbParentNeighbors = parentNeighbors.size();
-  vector< const vector<Bitset>*> parentBitsets(nbParentNeighbors);
+  vector<const ParsimonyBitsetArray*> parentBitsets(nbParentNeighbors);
   vector< const vector<unsigned int>*> parentScores(nbParentNeighbors);
   for (unsigned int k = 0; k < nbParentNeighbors; k++)
   {
@@ -339,11 +392,11 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
   }
 
   const DRTreeParsimonyNodeData* grandFatherData = &parsimonyData_->getNodeData(grandFather->getId());
-  const vector<Bitset>* uncleBitsets = &grandFatherData->getBitsetsArrayForNeighbor(uncle->getId());
+  const ParsimonyBitsetArray* uncleBitsets = &grandFatherData->getBitsetsArrayForNeighbor(uncle->getId());
   const vector<unsigned int>* uncleScores  = &grandFatherData->getScoresArrayForNeighbor(uncle->getId());
   vector<const Node*> grandFatherNeighbors = TreeTemplateTools::getRemainingNeighbors(grandFather, parent, uncle);
   size_t nbGrandFatherNeighbors = grandFatherNeighbors.size();
-  vector< const vector<Bitset>*> grandFatherBitsets(nbGrandFatherNeighbors);
+  vector<const ParsimonyBitsetArray*> grandFatherBitsets(nbGrandFatherNeighbors);
   vector< const vector<unsigned int>*> grandFatherScores(nbGrandFatherNeighbors);
   for (unsigned int k = 0; k < nbGrandFatherNeighbors; k++)
   {
@@ -356,8 +409,8 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
   grandFatherBitsets.push_back(sonBitsets);
   grandFatherScores.push_back(sonScores);
   // Init arrays:
-  vector<Bitset> gfBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
-  vector<unsigned int> gfScores(sonScores->size());
+  ParsimonyBitsetArray gfBitsets;
+  vector<unsigned int> gfScores;
   // Fill arrays:
   computeScoresFromArrays(grandFatherBitsets, grandFatherScores, gfBitsets, gfScores);
 
@@ -366,18 +419,8 @@ double DRTreeParsimonyScore::testNNI(int nodeId) const throw (NodeException)
   parentScores.push_back(uncleScores);
   parentBitsets.push_back(&gfBitsets);
   parentScores.push_back(&gfScores);
-  // Init arrays:
-  vector<Bitset> pBitsets(sonBitsets->size()); // All arrays supposed to have the same size!
-  vector<unsigned int> pScores(sonScores->size());
-  // Fill arrays:
-  computeScoresFromArrays(parentBitsets, parentScores, pBitsets, pScores);
-
-  // Final computation:
-  unsigned int score = 0;
-  for (unsigned int i = 0; i < nbDistinctSites_; i++)
-  {
-    score += pScores[i] * parsimonyData_->getWeight(i);
-  }
+  // Final computation, without storing the arrays for the parent node:
+  unsigned int score = computeScoreFromArrays(parentBitsets, parentScores, parsimonyData_->getWeights());
   return (double)score - (double)getScore();
 }
 
@@ -115,7 +115,7 @@ public:
    */
   static void computeScoresPostorderForNode(
     const DRTreeParsimonyNodeData& pData,
-    std::vector<Bitset>& rBitsets,
+    ParsimonyBitsetArray& rBitsets,
     std::vector<unsigned int>& rScores);
 
   /**
@@ -129,7 +129,7 @@ public:
   static void computeScoresPreorderForNode(
     const DRTreeParsimonyNodeData& pData,
     const Node* source,
-    std::vector<Bitset>& rBitsets,
+    ParsimonyBitsetArray& rBitsets,
     std::vector<unsigned int>& rScores);
 
   /**
@@ -140,7 +140,7 @@ public:
    * @param rScores  The score array where to write the resulting scores.
    */
   static void computeScoresForNode(
-    const DRTreeParsimonyNodeData& pData, std::vector<Bitset>& rBitsets,
+    const DRTreeParsimonyNodeData& pData, ParsimonyBitsetArray& rBitsets,
     std::vector<unsigned int>& rScores);
 
   /**
@@ -156,11 +156,27 @@ public:
    * @param oScores  The score array where to write the resulting scores.
    */
   static void computeScoresFromArrays(
-    const std::vector<const std::vector<Bitset>*>& iBitsets,
+    const std::vector<const ParsimonyBitsetArray*>& iBitsets,
     const std::vector<const std::vector<unsigned int>*>& iScores,
-    std::vector<Bitset>& oBitsets,
+    ParsimonyBitsetArray& oBitsets,
     std::vector<unsigned int>& oScores);
 
+  /**
+   * @brief Compute the total weighted score from an array of arrays.
+   *
+   * This is equivalent to calling computeScoresFromArrays and summing the resulting
+   * scores weighted by the number of sites of each pattern, but no output array is built.
+   *
+   * @param iBitsets The vector of bitset arrays to use.
+   * @param iScores  The vector of score arrays to use.
+   * @param weights  The weight of each site pattern.
+   * @return The weighted parsimony score.
+   */
+  static unsigned int computeScoreFromArrays(
+    const std::vector<const ParsimonyBitsetArray*>& iBitsets,
+    const std::vector<const std::vector<unsigned int>*>& iScores,
+    const std::vector<unsigned int>& weights);
+
   /**
    * @name Thee NNISearchable interface.
    *
@@ -0,0 +1,189 @@
+//
+// File: ParsimonyBitsetArray.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _PARSIMONYBITSETARRAY_H_
+#define _PARSIMONYBITSETARRAY_H_
+
+// From the STL:
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace bpp
+{
+
+/**
+ * @brief Bit-sliced storage of the sets of possible states for a range of sites.
+ *
+ * Sites are packed by blocks of SITES_PER_WORD. Each block stores one machine word per
+ * state, where bit j is set if the state is possible for site j of the block ("vertical"
+ * layout). Fitch unions and intersections are hence computed for a whole block with a few
+ * word operations per state, whatever the size of the alphabet (codons included).
+ * Bits corresponding to sites beyond the last one are always 0.
+ *
+ * @see DRTreeParsimonyData, DRTreeParsimonyScore
+ */
+class ParsimonyBitsetArray
+{
+  public:
+    typedef uint64_t Word;
+
+    /**
+     * @brief Number of sites per block.
+     */
+    static const size_t SITES_PER_WORD = 64;
+
+  private:
+    std::vector<Word> words_;
+    size_t nbSites_;
+    size_t nbStates_;
+    size_t nbBlocks_;
+
+  public:
+    ParsimonyBitsetArray() : words_(), nbSites_(0), nbStates_(0), nbBlocks_(0) {}
+
+    ParsimonyBitsetArray(size_t nbSites, size_t nbStates) :
+      words_(), nbSites_(0), nbStates_(0), nbBlocks_(0)
+    {
+      resize(nbSites, nbStates);
+    }
+
+  public:
+    /**
+     * @brief Set the dimensions of the array. All states are unset.
+     *
+     * @param nbSites The number of sites.
+     * @param nbStates The number of states.
+     */
+    void resize(size_t nbSites, size_t nbStates)
+    {
+      nbSites_  = nbSites;
+      nbStates_ = nbStates;
+      nbBlocks_ = (nbSites + SITES_PER_WORD - 1) / SITES_PER_WORD;
+      words_.assign(nbBlocks_ * nbStates_, 0);
+    }
+
+    size_t getNumberOfSites() const { return nbSites_; }
+    size_t getNumberOfStates() const { return nbStates_; }
+    size_t getNumberOfBlocks() const { return nbBlocks_; }
+
+    /**
+     * @return A pointer toward the nbStates words of a block.
+     * @param block The index of the block.
+     */
+    Word* getBlock(size_t block) { return &words_[block * nbStates_]; }
+    const Word* getBlock(size_t block) const { return &words_[block * nbStates_]; }
+
+    /**
+     * @return True if a state is possible for a site.
+     * @param site The index of the site.
+     * @param state The index of the state.
+     */
+    bool test(size_t site, size_t state) const
+    {
+      return ((words_[(site / SITES_PER_WORD) * nbStates_ + state] >> (site % SITES_PER_WORD)) & 1) != 0;
+    }
+
+    /**
+     * @brief Tell if a state is possible for a site.
+     *
+     * @param site The index of the site.
+     * @param state The index of the state.
+     * @param value True if the state is possible.
+     */
+    void set(size_t site, size_t state, bool value = true)
+    {
+      Word* w = &words_[(site / SITES_PER_WORD) * nbStates_ + state];
+      Word mask = static_cast<Word>(1) << (site % SITES_PER_WORD);
+      if (value)
+        *w |= mask;
+      else
+        *w &= ~mask;
+    }
+
+    /**
+     * @return A word with the bits of all sites of a block set.
+     * @param block The index of the block.
+     */
+    Word getSitesMask(size_t block) const
+    {
+      size_t n = nbSites_ - block * SITES_PER_WORD;
+      return n >= SITES_PER_WORD ? ~static_cast<Word>(0) : (static_cast<Word>(1) << n) - 1;
+    }
+
+    /**
+     * @brief Fitch step for one block: intersection of the two sets of states if not empty, union otherwise.
+     *
+     * @param o The words of the block to update.
+     * @param in The words of the block to combine with.
+     * @param nbStates The number of states.
+     * @return A word where bits are set for sites where a union was performed.
+     */
+    static Word fitch(Word* o, const Word* in, size_t nbStates)
+    {
+      Word any = 0;
+      for (size_t s = 0; s < nbStates; s++)
+        any |= o[s] & in[s];
+      Word empty = ~any;
+      for (size_t s = 0; s < nbStates; s++)
+        o[s] = (o[s] & in[s]) | (empty & (o[s] | in[s]));
+      return empty;
+    }
+
+    /**
+     * @return The number of bits set in a word.
+     * @param w The word.
+     */
+    static unsigned int countBits(Word w)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return static_cast<unsigned int>(__builtin_popcountll(w));
+#else
+      w = w - ((w >> 1) & 0x5555555555555555ULL);
+      w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+      w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+      return static_cast<unsigned int>((w * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+};
+
+} //end of namespace bpp.
+
+#endif //_PARSIMONYBITSETARRAY_H_
+
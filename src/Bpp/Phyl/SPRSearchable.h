@@ -0,0 +1,135 @@
+//
+// File: SPRSearchable.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _SPRSEARCHABLE_H_
+#define _SPRSEARCHABLE_H_
+
+#include "Node.h"
+#include "TreeTemplate.h"
+#include "TopologySearch.h"
+
+// From the STL:
+#include <vector>
+
+namespace bpp
+{
+
+/**
+ * @brief Interface for Subtree Pruning and Regrafting (SPR) algorithms.
+ *
+ * A SPR movement is defined by three nodes:
+ * - the node defining the pruned subtree: the subtree is detached together with its father node,
+ *   and the two remaining neighbors of the father node are joined,
+ * - the regraft node: the father node of the pruned subtree is inserted on the branch above this node,
+ *   in the pruned tree,
+ * - the reroot node: if it is the same as the pruned node, the subtree is kept as is.
+ *   Otherwise the pruned subtree is rerooted on the branch above this node before being regrafted:
+ *   the two sons of the pruned node are joined, and the pruned node is inserted on the branch above the reroot node.
+ *   This corresponds to a Tree Bisection and Reconnection (TBR) movement.
+ * The father of the pruned node must not be the root of the tree, and must have exactly two sons.
+ * In addition, when rerooting, the pruned node must have exactly two sons.
+ *
+ * Regraft positions are characterized by their distance to the original position of the subtree,
+ * that is the number of branches between the pruned branch and the regraft branch in the pruned tree.
+ * Reroot positions are characterized in the same way, within the pruned subtree.
+ */
+class SPRSearchable:
+  public virtual TopologyListener,
+  public virtual Clonable
+{
+	public:
+		SPRSearchable() {}
+		virtual ~SPRSearchable() {}
+
+    virtual SPRSearchable* clone() const = 0;
+
+	public:
+
+		/**
+		 * @brief Send the scores of all SPR movements of a subtree within a given radius, without performing them.
+		 *
+		 * As for NNIs, score variations must be negative if the new point is better.
+		 *
+		 * @param nodeId The id of the node defining the pruned subtree.
+		 * @param regraftRadius The maximum distance of the regraft positions to the original position.
+		 * @param rerootRadius The maximum distance of the reroot positions to the original root of the subtree.
+		 * 0 means that the subtree is not rerooted (SPR only).
+		 * @param regraftIds [out] The regraft node of each movement.
+		 * @param rerootIds [out] The reroot node of each movement.
+		 * @param diffs [out] The score variation of each movement.
+		 * @throw NodeException If the node does not define a valid SPR.
+		 */
+		virtual void testSPRs(
+        int nodeId,
+        unsigned int regraftRadius,
+        unsigned int rerootRadius,
+        std::vector<int>& regraftIds,
+        std::vector<int>& rerootIds,
+        std::vector<double>& diffs) const throw (NodeException) = 0;
+
+		/**
+		 * @brief Perform a SPR movement.
+		 *
+		 * @param nodeId The id of the node defining the pruned subtree.
+		 * @param regraftId The id of the regraft node.
+		 * @param rerootId The id of the reroot node, or nodeId if the subtree is not to be rerooted.
+		 * @throw NodeException If the nodes do not define a valid SPR.
+		 */
+		virtual void doSPR(int nodeId, int regraftId, int rerootId) throw (NodeException) = 0;
+
+		/**
+		 * @brief Get the tree associated to this SPRSearchable object.
+		 *
+		 * @return The tree associated to this instance.
+		 */
+		virtual const Tree& getTopology() const = 0;
+
+    /**
+     * @brief Get the current score of this SPRSearchable object.
+     *
+     * @return The current score of this instance.
+     */
+    virtual double getTopologyValue() const throw (Exception) = 0;
+
+};
+
+} //end of namespace bpp.
+
+#endif //_SPRSEARCHABLE_H_
+
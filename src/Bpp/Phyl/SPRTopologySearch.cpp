@@ -0,0 +1,128 @@
+//
+// File: SPRTopologySearch.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "SPRTopologySearch.h"
+
+#include <Bpp/Text/TextTools.h>
+#include <Bpp/App/ApplicationTools.h>
+
+using namespace bpp;
+using namespace std;
+
+void SPRTopologySearch::notifyAllPerformed(const TopologyChangeEvent& event)
+{
+  searchableTree_->topologyChangePerformed(event);
+  for (size_t i = 0; i < topoListeners_.size(); i++)
+  {
+    topoListeners_[i]->topologyChangePerformed(event);
+  }
+}
+
+void SPRTopologySearch::notifyAllTested(const TopologyChangeEvent& event)
+{
+  searchableTree_->topologyChangeTested(event);
+  for (size_t i = 0; i < topoListeners_.size(); i++)
+  {
+    topoListeners_[i]->topologyChangeTested(event);
+  }
+}
+
+void SPRTopologySearch::notifyAllSuccessful(const TopologyChangeEvent& event)
+{
+  searchableTree_->topologyChangeSuccessful(event);
+  for (size_t i = 0; i < topoListeners_.size(); i++)
+  {
+    topoListeners_[i]->topologyChangeSuccessful(event);
+  }
+}
+
+void SPRTopologySearch::search() throw (Exception)
+{
+  bool test = true;
+  do
+  {
+    test = false;
+    // Node ids are not modified by SPR movements, but the topology is:
+    vector<int> nodeIds = searchableTree_->getTopology().getNodesId();
+    for (size_t i = 0; i < nodeIds.size(); i++)
+    {
+      const Tree& tree = searchableTree_->getTopology();
+      int nodeId = nodeIds[i];
+      // Only subtrees whose father node is not the root and is bifurcating can be pruned:
+      if (!tree.hasFather(nodeId)) continue;
+      int fatherId = tree.getFatherId(nodeId);
+      if (!tree.hasFather(fatherId) || tree.getSonsId(fatherId).size() != 2) continue;
+
+      vector<int> regraftIds, rerootIds;
+      vector<double> diffs;
+      searchableTree_->testSPRs(nodeId, regraftRadius_, rerootRadius_, regraftIds, rerootIds, diffs);
+      size_t best = diffs.size();
+      for (size_t j = 0; j < diffs.size(); j++)
+      {
+        if (diffs[j] < 0. && (best == diffs.size() || diffs[j] < diffs[best]))
+          best = j;
+      }
+      if (verbose_ >= 3)
+      {
+        ApplicationTools::displayResult("   Testing node " + TextTools::toString(nodeId),
+                                        TextTools::toString(diffs.size()) + " movements");
+      }
+
+      if (best < diffs.size())
+      { // Good movement found...
+        if (verbose_ >= 2)
+        {
+          ApplicationTools::displayResult("   Moving node " + TextTools::toString(nodeId)
+                                          + " to " + TextTools::toString(regraftIds[best])
+                                          + (rerootIds[best] != nodeId ? " rerooted at " + TextTools::toString(rerootIds[best]) : ""),
+                                          TextTools::toString(diffs[best]));
+        }
+        searchableTree_->doSPR(nodeId, regraftIds[best], rerootIds[best]);
+        // Notify:
+        notifyAllPerformed(TopologyChangeEvent());
+        test = true;
+
+        if (verbose_ >= 1)
+          ApplicationTools::displayResult("   Current value", TextTools::toString(searchableTree_->getTopologyValue(), 10));
+      }
+    }
+  }
+  while (test);
+}
+
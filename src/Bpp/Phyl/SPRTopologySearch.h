@@ -0,0 +1,179 @@
+//
+// File: SPRTopologySearch.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _SPRTOPOLOGYSEARCH_H_
+#define _SPRTOPOLOGYSEARCH_H_
+
+#include "TopologySearch.h"
+#include "SPRSearchable.h"
+
+namespace bpp
+{
+
+/**
+ * @brief SPR and TBR topology search method.
+ *
+ * The algorithm loops over all nodes which can be pruned, and test all their regraft positions
+ * within a given radius (the number of branches between the pruning and the regraft positions).
+ * If a reroot radius greater than 0 is set, the pruned subtrees are also rerooted on all branches
+ * within this radius, which corresponds to TBR movements.
+ * For each node, the best movement is performed if it improves the score, and the search
+ * continues with the next node. The search stops when a complete round does not improve the score.
+ *
+ * As SPR and TBR movements include NNIs, this method usually converges to better topologies than
+ * the NNITopologySearch one, at the expense of a higher computational cost.
+ */
+class SPRTopologySearch :
+  public virtual TopologySearch
+{
+  private:
+    SPRSearchable* searchableTree_;
+    unsigned int regraftRadius_;
+    unsigned int rerootRadius_;
+    unsigned int verbose_;
+    std::vector<TopologyListener*> topoListeners_;
+
+  public:
+    /**
+     * @param tree The object to optimize.
+     * @param regraftRadius The maximum number of branches between the pruning and regraft positions.
+     * @param rerootRadius The maximum number of branches between the original and new roots of the pruned subtrees (0 for SPR only).
+     * @param verbose The verbose level.
+     */
+    SPRTopologySearch(
+        SPRSearchable& tree,
+        unsigned int regraftRadius = 3,
+        unsigned int rerootRadius = 0,
+        unsigned int verbose = 2) :
+      searchableTree_(&tree), regraftRadius_(regraftRadius), rerootRadius_(rerootRadius), verbose_(verbose), topoListeners_()
+    {}
+
+    SPRTopologySearch(const SPRTopologySearch& ts) :
+      searchableTree_(ts.searchableTree_),
+      regraftRadius_(ts.regraftRadius_),
+      rerootRadius_(ts.rerootRadius_),
+      verbose_(ts.verbose_),
+      topoListeners_(ts.topoListeners_)
+    {
+      //Hard-copy all listeners:
+      for (size_t i = 0; i < topoListeners_.size(); i++)
+        topoListeners_[i] = dynamic_cast<TopologyListener*>(ts.topoListeners_[i]->clone());
+    }
+
+    SPRTopologySearch& operator=(const SPRTopologySearch& ts)
+    {
+      searchableTree_ = ts.searchableTree_;
+      regraftRadius_  = ts.regraftRadius_;
+      rerootRadius_   = ts.rerootRadius_;
+      verbose_        = ts.verbose_;
+      topoListeners_  = ts.topoListeners_;
+      //Hard-copy all listeners:
+      for (size_t i = 0; i < topoListeners_.size(); i++)
+        topoListeners_[i] = dynamic_cast<TopologyListener*>(ts.topoListeners_[i]->clone());
+      return *this;
+    }
+
+    virtual ~SPRTopologySearch()
+    {
+      for (std::vector<TopologyListener*>::iterator it = topoListeners_.begin();
+           it != topoListeners_.end();
+           it++)
+        delete *it;
+    }
+
+  public:
+    void search() throw (Exception);
+
+    /**
+     * @brief Add a listener to the list.
+     *
+     * All listeners will be notified in the order of the list.
+     * The first listener to be notified is the SPRSearchable object itself.
+     *
+     * The listener will be owned by this instance, and copied when needed.
+     */
+    void addTopologyListener(TopologyListener* listener)
+    {
+      if (listener)
+        topoListeners_.push_back(listener);
+    }
+
+  public:
+    /**
+     * @brief Retrieve the tree.
+     *
+     * @return The tree associated to this instance.
+     */
+    const Tree& getTopology() const { return searchableTree_->getTopology(); }
+
+    /**
+     * @return The SPRSearchable object associated to this instance.
+     */
+    SPRSearchable* getSearchableObject() { return searchableTree_; }
+    /**
+     * @return The SPRSearchable object associated to this instance.
+     */
+    const SPRSearchable* getSearchableObject() const { return searchableTree_; }
+
+    unsigned int getRegraftRadius() const { return regraftRadius_; }
+    void setRegraftRadius(unsigned int radius) { regraftRadius_ = radius; }
+
+    unsigned int getRerootRadius() const { return rerootRadius_; }
+    void setRerootRadius(unsigned int radius) { rerootRadius_ = radius; }
+
+  protected:
+    /**
+     * @brief Process a TopologyChangeEvent to all listeners.
+     */
+    void notifyAllPerformed(const TopologyChangeEvent& event);
+    /**
+     * @brief Process a TopologyChangeEvent to all listeners.
+     */
+    void notifyAllTested(const TopologyChangeEvent& event);
+    /**
+     * @brief Process a TopologyChangeEvent to all listeners.
+     */
+    void notifyAllSuccessful(const TopologyChangeEvent& event);
+
+};
+
+} //end of namespace bpp.
+
+#endif //_SPRTOPOLOGYSEARCH_H_
+
@@ -0,0 +1,327 @@
+//
+// File: ThreadPool.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include "ThreadPool.h"
+
+// From the STL:
+#include <atomic>
+#include <exception>
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+/**
+ * @brief The state of a parallelFor() call.
+ *
+ * Workers keep a reference on the job they are working on,
+ * so that a late worker never picks a task from a newer job.
+ */
+class ThreadPool::Job
+{
+  public:
+    const function<void (size_t)>* task;
+    size_t nbTasks;
+    atomic<size_t> next;
+    atomic<size_t> completed;
+    mutex exceptionMutex;
+    exception_ptr exception;
+
+  public:
+    Job(const function<void (size_t)>* t, size_t n) :
+      task(t), nbTasks(n), next(0), completed(0), exceptionMutex(), exception() {}
+
+  private:
+    Job(const Job&);
+    Job& operator=(const Job&);
+};
+
+namespace
+{
+  // The pool currently executing a task in this thread, if any:
+  thread_local const ThreadPool* currentPool = 0;
+}
+
+/******************************************************************************/
+
+ThreadPool::ThreadPool(size_t nbThreads) :
+  workers_(), mutex_(), runMutex_(), taskCondition_(), doneCondition_(),
+  job_(), generation_(0), stop_(false)
+{
+  if (nbThreads == 0)
+    nbThreads = getHardwareConcurrency();
+  for (size_t i = 1; i < nbThreads; i++)
+  {
+    workers_.push_back(thread(&ThreadPool::workerLoop_, this));
+  }
+}
+
+/******************************************************************************/
+
+ThreadPool::~ThreadPool()
+{
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  taskCondition_.notify_all();
+  for (size_t i = 0; i < workers_.size(); i++)
+  {
+    workers_[i].join();
+  }
+}
+
+/******************************************************************************/
+
+size_t ThreadPool::getHardwareConcurrency()
+{
+  unsigned int n = thread::hardware_concurrency();
+  return n == 0 ? 1 : static_cast<size_t>(n);
+}
+
+/******************************************************************************/
+
+void ThreadPool::parallelFor(size_t nbTasks, const function<void (size_t)>& task)
+{
+  if (workers_.size() == 0 || nbTasks <= 1 || currentPool == this)
+  {
+    for (size_t k = 0; k < nbTasks; k++)
+    {
+      task(k);
+    }
+    return;
+  }
+
+  lock_guard<mutex> runLock(runMutex_);
+  shared_ptr<Job> job(new Job(&task, nbTasks));
+  {
+    lock_guard<mutex> lock(mutex_);
+    job_ = job;
+    generation_++;
+  }
+  taskCondition_.notify_all();
+
+  // The calling thread works too:
+  runJob_(*job);
+
+  {
+    unique_lock<mutex> lock(mutex_);
+    doneCondition_.wait(lock, [&job]() { return job->completed == job->nbTasks; });
+    job_.reset();
+  }
+  if (job->exception)
+    rethrow_exception(job->exception);
+}
+
+/******************************************************************************/
+
+void ThreadPool::parallelForBlocks(size_t size, size_t blockSize, const function<void (size_t, size_t)>& f)
+{
+  if (blockSize == 0)
+    blockSize = 1;
+  size_t nbBlocks = (size + blockSize - 1) / blockSize;
+  parallelFor(nbBlocks, [size, blockSize, &f](size_t k) {
+      size_t begin = k * blockSize;
+      f(begin, min(begin + blockSize, size));
+    });
+}
+
+/******************************************************************************/
+
+void ThreadPool::parallelForGraph(const vector< vector<size_t> >& successors, const function<void (size_t)>& task)
+{
+  size_t nbTasks = successors.size();
+  vector<size_t> nbPredecessors(nbTasks, 0);
+  for (size_t k = 0; k < nbTasks; k++)
+  {
+    for (size_t l = 0; l < successors[k].size(); l++)
+    {
+      nbPredecessors[successors[k][l]]++;
+    }
+  }
+
+  // One queue per thread, initially filled in turn with the tasks without predecessor:
+  size_t nbQueues = (workers_.size() == 0 || currentPool == this) ? 1 : getNumberOfThreads();
+  vector< deque<size_t> > queues(nbQueues);
+  size_t q = 0;
+  for (size_t k = 0; k < nbTasks; k++)
+  {
+    if (nbPredecessors[k] == 0)
+    {
+      queues[q].push_back(k);
+      q = (q + 1) % nbQueues;
+    }
+  }
+
+  mutex graphMutex;
+  condition_variable graphCondition;
+  size_t nbDone = 0;
+  size_t nbRunning = 0;
+  bool cycle = false;
+  exception_ptr error;
+
+  function<void (size_t)> worker = [&](size_t thisQueue) {
+      unique_lock<mutex> lock(graphMutex);
+      while (true)
+      {
+        size_t k = nbTasks;
+        while (!error && !cycle && nbDone < nbTasks)
+        {
+          // Own tasks first, most recent first:
+          if (!queues[thisQueue].empty())
+          {
+            k = queues[thisQueue].back();
+            queues[thisQueue].pop_back();
+            break;
+          }
+          // Otherwise steal the oldest task of another thread:
+          for (size_t i = 1; i < nbQueues && k == nbTasks; i++)
+          {
+            deque<size_t>* other = &queues[(thisQueue + i) % nbQueues];
+            if (!other->empty())
+            {
+              k = other->front();
+              other->pop_front();
+            }
+          }
+          if (k < nbTasks)
+            break;
+          if (nbRunning == 0)
+          {
+            // Nothing is running or ready, but some tasks are not done:
+            cycle = true;
+            graphCondition.notify_all();
+            break;
+          }
+          graphCondition.wait(lock);
+        }
+        if (k == nbTasks)
+          return;
+
+        nbRunning++;
+        lock.unlock();
+        try
+        {
+          task(k);
+        }
+        catch (...)
+        {
+          lock.lock();
+          nbRunning--;
+          if (!error)
+            error = current_exception();
+          graphCondition.notify_all();
+          return;
+        }
+        lock.lock();
+        nbRunning--;
+        nbDone++;
+        for (size_t l = 0; l < successors[k].size(); l++)
+        {
+          size_t s = successors[k][l];
+          if (--nbPredecessors[s] == 0)
+            queues[thisQueue].push_back(s);
+        }
+        graphCondition.notify_all();
+      }
+    };
+
+  if (nbQueues == 1)
+    worker(0);
+  else
+    parallelFor(nbQueues, worker);
+
+  if (error)
+    rethrow_exception(error);
+  if (cycle)
+    throw Exception("ThreadPool::parallelForGraph. The dependency graph contains a cycle.");
+}
+
+/******************************************************************************/
+
+void ThreadPool::workerLoop_()
+{
+  size_t seenGeneration = 0;
+  while (true)
+  {
+    shared_ptr<Job> job;
+    {
+      unique_lock<mutex> lock(mutex_);
+      taskCondition_.wait(lock, [this, seenGeneration]() { return stop_ || generation_ != seenGeneration; });
+      if (stop_)
+        return;
+      seenGeneration = generation_;
+      job = job_;
+    }
+    if (job)
+      runJob_(*job);
+  }
+}
+
+/******************************************************************************/
+
+void ThreadPool::runJob_(Job& job)
+{
+  const ThreadPool* previousPool = currentPool;
+  currentPool = this;
+  size_t k;
+  while ((k = job.next++) < job.nbTasks)
+  {
+    try
+    {
+      (*job.task)(k);
+    }
+    catch (...)
+    {
+      lock_guard<mutex> lock(job.exceptionMutex);
+      if (!job.exception)
+        job.exception = current_exception();
+    }
+    if (++job.completed == job.nbTasks)
+    {
+      lock_guard<mutex> lock(mutex_);
+      doneCondition_.notify_all();
+    }
+  }
+  currentPool = previousPool;
+}
+
+/******************************************************************************/
+
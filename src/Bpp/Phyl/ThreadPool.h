@@ -0,0 +1,160 @@
+//
+// File: ThreadPool.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <Bpp/Exceptions.h>
+
+// From the STL:
+#include <vector>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+namespace bpp
+{
+
+/**
+ * @brief A fixed-size pool of threads executing loops in parallel.
+ *
+ * The pool is used to split independent computations, for instance over blocks of sites,
+ * between several threads. The calling thread takes part in the computation, so that a
+ * pool with n threads starts n - 1 worker threads.
+ *
+ * Tasks are distributed dynamically, but each task is identified by its index, so that
+ * results written at task-specific positions do not depend on the number of threads
+ * or on the scheduling. Reductions should hence be done by the caller, in task order.
+ *
+ * Calls to parallelFor() made from within a task of the same pool are executed sequentially.
+ * Concurrent calls from different threads are serialized.
+ */
+class ThreadPool
+{
+  private:
+    class Job;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::mutex runMutex_;
+    std::condition_variable taskCondition_;
+    std::condition_variable doneCondition_;
+    std::shared_ptr<Job> job_;
+    size_t generation_;
+    bool stop_;
+
+  public:
+    /**
+     * @brief Build a new pool.
+     *
+     * @param nbThreads The total number of threads, including the calling one.
+     * 0 means as many threads as hardware threads.
+     */
+    explicit ThreadPool(size_t nbThreads);
+
+  private:
+    ThreadPool(const ThreadPool& pool);
+    ThreadPool& operator=(const ThreadPool& pool);
+
+  public:
+    virtual ~ThreadPool();
+
+  public:
+    /**
+     * @return The total number of threads used, including the calling one.
+     */
+    size_t getNumberOfThreads() const { return workers_.size() + 1; }
+
+    /**
+     * @brief Execute task(k) for all k in [0, nbTasks), and wait for all of them to complete.
+     *
+     * If a task throws an exception, remaining tasks are still executed,
+     * and the first exception caught is rethrown in the calling thread.
+     *
+     * @param nbTasks The number of tasks.
+     * @param task The function to call for each task index.
+     */
+    void parallelFor(size_t nbTasks, const std::function<void (size_t)>& task);
+
+    /**
+     * @brief Execute f(begin, end) for consecutive blocks of a range [0, size).
+     *
+     * Blocks boundaries only depend on the size and block size,
+     * not on the number of threads.
+     *
+     * @param size The size of the range.
+     * @param blockSize The maximum size of each block.
+     * @param f The function to call for each block.
+     */
+    void parallelForBlocks(size_t size, size_t blockSize, const std::function<void (size_t, size_t)>& f);
+
+    /**
+     * @brief Execute tasks with dependencies, each one after all its predecessors are completed.
+     *
+     * Tasks which are ready are queued on the thread which made them ready, which will
+     * execute them first, most recent first. Idle threads steal the oldest tasks from the
+     * other queues. When tasks form a tree, a subtree is hence preferably computed by
+     * a single thread, while independent subtrees are processed concurrently.
+     *
+     * If a task throws an exception, no new task is started,
+     * and the first exception caught is rethrown in the calling thread.
+     *
+     * @param successors For each task, the indices of the tasks which depend on it.
+     * @param task The function to call for each task index.
+     * @throw Exception If the dependency graph contains a cycle.
+     */
+    void parallelForGraph(const std::vector< std::vector<size_t> >& successors, const std::function<void (size_t)>& task);
+
+    /**
+     * @return The number of hardware threads, or 1 if it is unknown.
+     */
+    static size_t getHardwareConcurrency();
+
+  private:
+    void workerLoop_();
+    void runJob_(Job& job);
+};
+
+} //end of namespace bpp.
+
+#endif //_THREADPOOL_H_
+
@@ -0,0 +1,79 @@
+//
+// File: TreeIterator.h
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 16, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for phylogenetic data analysis.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#ifndef _TREEITERATOR_H_
+#define _TREEITERATOR_H_
+
+#include "Tree.h"
+
+#include <Bpp/Exceptions.h>
+
+namespace bpp
+{
+
+/**
+ * @brief Generic pull-based iterator over a set of trees.
+ *
+ * Trees are retrieved one at a time, so that a set of trees can be processed
+ * without being entirely stored in memory, for instance when it is read from a file
+ * (see IMultiTree::getTreeIterator()).
+ */
+class TreeIterator
+{
+  public:
+    TreeIterator() {}
+    virtual ~TreeIterator() {}
+
+  public:
+    /**
+     * @return A new tree object, which is owned by the caller.
+     * @throw Exception If there is no more tree, or if the tree could not be retrieved.
+     */
+    virtual Tree* nextTree() throw (Exception) = 0;
+
+    /**
+     * @return True if nextTree() can be called again.
+     */
+    virtual bool hasMoreTrees() const = 0;
+};
+
+} //end of namespace bpp.
+
+#endif //_TREEITERATOR_H_
+
@@ -41,11 +41,10 @@
 
 #include "TreeTemplateTools.h"
 #include "TreeTemplate.h"
+#include "Io/NewickParser.h"
 
 #include <Bpp/Numeric/Number.h>
 #include <Bpp/BppString.h>
-#include <Bpp/Text/StringTokenizer.h>
-#include <Bpp/Text/NestedStringTokenizer.h>
 #include <Bpp/Text/TextTools.h>
 #include <Bpp/Numeric/Random/RandomTools.h>
 
@@ -253,93 +252,110 @@ TreeTemplateTools::Element TreeTemplateTools::getElement(const string& elt) thro
 
 Node* TreeTemplateTools::parenthesisToNode(const string& description, unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose)
 {
-  // cout << "NODE: " << description << endl;
-  Element elt = getElement(description);
+  NewickParser parser;
+  const char* begin = description.data();
+  parser.parse(begin, begin + description.size());
+  return parenthesisToNode(parser, nodeCounter, bootstrap, propertyName, withId, verbose);
+}
 
-  // New node:
-  Node* node = new Node();
-  if (!TextTools::isEmpty(elt.length))
-  {
-    node->setDistanceToFather(TextTools::toDouble(elt.length));
-    // cout << "NODE: LENGTH: " << * elt.length << endl;
-  }
-  if (!TextTools::isEmpty(elt.bootstrap))
+/******************************************************************************/
+
+Node* TreeTemplateTools::parenthesisToNode(const NewickParser& parser, unsigned int& nodeCounter, bool bootstrap, const string& propertyName, bool withId, bool verbose) throw (Exception)
+{
+  // Fathers always come before their sons in the parser, so that all nodes can be created in one pass:
+  size_t nbElements = parser.getNumberOfElements();
+  vector<Node*> nodes(nbElements);
+  try
   {
-    if (withId)
+    for (size_t i = 0; i < nbElements; ++i)
     {
-      node->setId(TextTools::toInt(elt.bootstrap));
-    }
-    else
-    {
-      if (bootstrap)
+      const NewickParser::Element& elt = parser.getElement(i);
+      Node* node = new Node();
+      if (elt.father != NewickParser::NO_FATHER)
+        nodes[elt.father]->addSon(node);
+      nodes[i] = node;
+
+      if (elt.hasLength())
+        node->setDistanceToFather(NewickParser::toDouble(elt.lengthBegin, elt.lengthEnd));
+      if (elt.isLeaf)
       {
-        node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(TextTools::toDouble(elt.bootstrap)));
-        // cout << "NODE: BOOTSTRAP: " << * elt.bootstrap << endl;
+        if (withId)
+        {
+          string name = elt.getLabel();
+          string::size_type underscore = name.rfind('_');
+          if (underscore == string::npos)
+          {
+            node->setName("");
+            node->setId(TextTools::toInt(name));
+          }
+          else
+          {
+            node->setName(name.substr(0, underscore));
+            node->setId(TextTools::toInt(name.substr(underscore + 1)));
+          }
+        }
+        else
+        {
+          node->setName(elt.getLabel());
+        }
       }
-      else
+      else if (elt.hasLabel())
       {
-        node->setBranchProperty(propertyName, BppString(elt.bootstrap));
-      }
-    }
-  }
-
-  NestedStringTokenizer nt(elt.content, "(", ")", ",");
-  vector<string> elements;
-  while (nt.hasMoreToken())
-  {
-    elements.push_back(nt.nextToken());
-  }
-
-  if (elt.isLeaf)
-  {
-    // This is a leaf:
-    string name = TextTools::removeSurroundingWhiteSpaces(elements[0]);
-    if (withId)
-    {
-      StringTokenizer st(name, "_", true, true);
-      ostringstream realName;
-      for (size_t i = 0; i < st.numberOfRemainingTokens() - 1; ++i)
-      {
-        if (i != 0)
+        if (withId)
         {
-          realName << "_";
+          node->setId(TextTools::toInt(elt.getLabel()));
+        }
+        else
+        {
+          if (bootstrap)
+          {
+            node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(NewickParser::toDouble(elt.labelBegin, elt.labelEnd)));
+          }
+          else
+          {
+            node->setBranchProperty(propertyName, BppString(elt.getLabel()));
+          }
         }
-        realName << st.getToken(i);
       }
-      node->setName(realName.str());
-      node->setId(TextTools::toInt(st.getToken(st.numberOfRemainingTokens() - 1)));
-    }
-    else
-    {
-      node->setName(name);
+      nodeCounter++;
+      if (verbose)
+        ApplicationTools::displayUnlimitedGauge(nodeCounter);
     }
   }
-  else
+  catch (Exception& e)
   {
-    // This is a node:
-    for (size_t i = 0; i < elements.size(); i++)
+    if (nbElements > 0 && nodes[0])
     {
-      // cout << "NODE: SUBNODE: " << i << ", " << elements[i] << endl;
-      Node* son = parenthesisToNode(elements[i], nodeCounter, bootstrap, propertyName, withId, verbose);
-      node->addSon(son);
+      deleteSubtree(nodes[0]);
+      delete nodes[0];
     }
+    throw;
   }
-  nodeCounter++;
-  if (verbose)
-    ApplicationTools::displayUnlimitedGauge(nodeCounter);
-  return node;
+  return nbElements > 0 ? nodes[0] : 0;
 }
 
 /******************************************************************************/
 
 TreeTemplate<Node>* TreeTemplateTools::parenthesisToTree(const string& description, bool bootstrap, const string& propertyName, bool withId, bool verbose) throw (Exception)
 {
-  string::size_type semi = description.rfind(';');
-  if (semi == string::npos)
-    throw Exception("TreeTemplateTools::parenthesisToTree(). Bad format: no semi-colon found.");
-  string content = description.substr(0, semi);
+  NewickParser parser;
+  try
+  {
+    parser.parse(description);
+  }
+  catch (IOException& e)
+  {
+    throw Exception(string("TreeTemplateTools::parenthesisToTree(). ") + e.what());
+  }
+  return parenthesisToTree(parser, bootstrap, propertyName, withId, verbose);
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* TreeTemplateTools::parenthesisToTree(const NewickParser& parser, bool bootstrap, const string& propertyName, bool withId, bool verbose) throw (Exception)
+{
   unsigned int nodeCounter = 0;
-  Node* node = parenthesisToNode(content, nodeCounter, bootstrap, propertyName, withId, verbose);
+  Node* node = parenthesisToNode(parser, nodeCounter, bootstrap, propertyName, withId, verbose);
   TreeTemplate<Node>* tree = new TreeTemplate<Node>();
   tree->setRootNode(node);
   if (!withId)
@@ -52,6 +52,7 @@
 namespace bpp
 {
 template<class N> class TreeTemplate;
+class NewickParser;
 
 
 /**
@@ -981,6 +982,35 @@ public:
    */
   static TreeTemplate<Node>* parenthesisToTree(const std::string& description, bool bootstrap = true, const std::string& propertyName = TreeTools::BOOTSTRAP, bool withId = false, bool verbose = true) throw (Exception);
 
+  /**
+   * @brief Build a subtree from a description parsed with a NewickParser.
+   *
+   * Nodes are created in a single pass over the parsed elements.
+   *
+   * @param parser A parser which has already parsed a description.
+   * @param nodeCounter [Output] Count all created nodes.
+   * @param bootstrap Tell is real bootstrap values are expected, see parenthesisToNode(const std::string&, unsigned int&, bool, const std::string&, bool, bool).
+   * @param propertyName The name of the property to store. Only used if bootstrap = false.
+   * @param withId Tells if node ids have been stored in the tree.
+   * @param verbose Tell if some information should be displayed, like progress bars for large trees.
+   * @return A pointer toward a dynamically created subtree.
+   * @throw Exception in case of bad format.
+   */
+  static Node* parenthesisToNode(const NewickParser& parser, unsigned int& nodeCounter, bool bootstrap = true, const std::string& propertyName = TreeTools::BOOTSTRAP, bool withId = false, bool verbose = true) throw (Exception);
+
+  /**
+   * @brief Build a tree from a description parsed with a NewickParser.
+   *
+   * @param parser A parser which has already parsed a description.
+   * @param bootstrap Tell is real bootstrap values are expected, see parenthesisToTree(const std::string&, bool, const std::string&, bool, bool).
+   * @param propertyName The name of the property to store. Only used if bootstrap = false.
+   * @param withId Tells if node ids have been stored in the tree.
+   * @param verbose Tell if some information should be displayed, like progress bars for large trees.
+   * @return A pointer toward a dynamically created tree.
+   * @throw Exception in case of bad format.
+   */
+  static TreeTemplate<Node>* parenthesisToTree(const NewickParser& parser, bool bootstrap = true, const std::string& propertyName = TreeTools::BOOTSTRAP, bool withId = false, bool verbose = true) throw (Exception);
+
   /**
    * @brief Get the parenthesis description of a subtree.
    *
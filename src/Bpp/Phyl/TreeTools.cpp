@@ -40,6 +40,7 @@
 #include "TreeTools.h"
 #include "Tree.h"
 #include "BipartitionTools.h"
+#include "BipartitionHashTable.h"
 #include "Model/Nucleotide/JCnuc.h"
 #include "Distance/DistanceEstimation.h"
 #include "Distance/BioNJ.h"
@@ -64,6 +65,7 @@ using namespace bpp;
 // From the STL:
 #include <iostream>
 #include <sstream>
+#include <memory>
 
 using namespace std;
 
@@ -955,76 +957,126 @@ int TreeTools::robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool che
 
 /******************************************************************************/
 
+vector<int> TreeTools::robinsonFouldsDistances(const Tree& tree, TreeIterator& trees, bool checkNames) throw (Exception)
+{
+  vector<string> leaves = tree.getLeavesNames();
+  BipartitionHashTable bipTable(leaves);
+  bipTable.addTree(tree);
+  size_t nbBip = bipTable.getNumberOfBipartitions();
+
+  vector<int> distances;
+  vector<uint64_t> bitsets;
+  vector<int> nodeIds;
+  size_t nbWords = bipTable.getNumberOfWords();
+  while (trees.hasMoreTrees())
+  {
+    unique_ptr<Tree> tr(trees.nextTree());
+    if (checkNames && !VectorTools::haveSameElements(tr->getLeavesNames(), leaves))
+      throw Exception("Distinct leaf sets between trees ");
+    bipTable.computeBipartitions(*tr, bitsets, nodeIds);
+    size_t shared = 0;
+    for (size_t i = 0; i < nodeIds.size(); i++)
+    {
+      if (bipTable.getCount(&bitsets[i * nbWords]) > 0)
+        shared++;
+    }
+    distances.push_back(static_cast<int>(nbBip - shared + nodeIds.size() - shared));
+  }
+  return distances;
+}
+
+/******************************************************************************/
+
 BipartitionList* TreeTools::bipartitionOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore)
 {
-  vector<BipartitionList*> vecBipL;
-  BipartitionList* mergedBipL;
-  vector<size_t> bipSize;
-  size_t nbBip;
+  if (vecTr.size() == 0)
+    throw Exception("TreeTools::bipartitionOccurrences. Empty vector passed");
 
-  /*  build and merge bipartitions */
-  for (size_t i = 0; i < vecTr.size(); i++)
-  {
-    vecBipL.push_back(new BipartitionList(*vecTr[i]));
-  }
-  mergedBipL = BipartitionTools::mergeBipartitionLists(vecBipL);
+  /* count bipartitions */
+  BipartitionHashTable bipTable(vecTr[0]->getLeavesNames());
   for (size_t i = 0; i < vecTr.size(); i++)
   {
-    delete vecBipL[i];
+    bipTable.addTree(*vecTr[i]);
   }
+  return bipartitionOccurrences_(bipTable, bipScore);
+}
+
+/******************************************************************************/
+
+BipartitionList* TreeTools::bipartitionOccurrences(TreeIterator& trees, vector<size_t>& bipScore)
+{
+  unique_ptr<BipartitionHashTable> bipTable(countBipartitions_(trees, false));
+  return bipartitionOccurrences_(*bipTable, bipScore);
+}
+
+/******************************************************************************/
+
+BipartitionList* TreeTools::bipartitionOccurrences_(const BipartitionHashTable& bipTable, vector<size_t>& bipScore)
+{
+  vector<size_t> indices = getBipartitionOrder_(bipTable);
 
-  mergedBipL->removeTrivialBipartitions();
-  nbBip = mergedBipL->getNumberOfBipartitions();
   bipScore.clear();
-  for (size_t i = 0; i < nbBip; i++)
+  for (size_t i = 0; i < indices.size(); i++)
   {
-    bipSize.push_back(mergedBipL->getPartitionSize(i));
-    bipScore.push_back(1);
+    bipScore.push_back(bipTable.getCount(indices[i]));
   }
 
-  /* compare bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
+  /* add terminal branches */
+  for (size_t i = 0; i < bipTable.getNumberOfElements(); i++)
   {
-    if (bipScore[i - 1] == 0)
-      continue;
-    for (size_t j = i - 1; j > 0; j--)
-    {
-      if (bipScore[j - 1] && bipSize[i - 1] == bipSize[j - 1] && mergedBipL->areIdentical(i - 1, j - 1))
-      {
-        bipScore[i - 1]++;
-        bipScore[j - 1] = 0;
-      }
-    }
+    bipScore.push_back(bipTable.getNumberOfTrees());
   }
 
-  /* keep only distinct bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
+  return bipTable.toBipartitionList(indices, true);
+}
+
+/******************************************************************************/
+
+BipartitionHashTable* TreeTools::countBipartitions_(TreeIterator& trees, bool checkNames) throw (Exception)
+{
+  if (!trees.hasMoreTrees())
+    throw Exception("TreeTools::countBipartitions_. Empty tree set passed");
+
+  // Trees are read and processed one at a time:
+  unique_ptr<Tree> tree(trees.nextTree());
+  vector<string> tr0leaves = tree->getLeavesNames();
+  unique_ptr<BipartitionHashTable> bipTable(new BipartitionHashTable(tr0leaves));
+  bipTable->addTree(*tree);
+  while (trees.hasMoreTrees())
+  {
+    tree.reset(trees.nextTree());
+    if (checkNames && !VectorTools::haveSameElements(tree->getLeavesNames(), tr0leaves))
+      throw Exception("TreeTools::countBipartitions_. Distinct leaf sets between trees");
+    bipTable->addTree(*tree);
+  }
+  return bipTable.release();
+}
+
+/******************************************************************************/
+
+vector<size_t> TreeTools::getBipartitionOrder_(const BipartitionHashTable& bipTable)
+{
+  // Distinct bipartitions are listed in the order of their last occurrence in the trees,
+  // which is the order the consensus methods rely on.
+  vector< pair<size_t, size_t> > occurrences(bipTable.getNumberOfBipartitions());
+  for (size_t i = 0; i < occurrences.size(); i++)
   {
-    if (bipScore[i - 1] == 0)
-    {
-      bipScore.erase(bipScore.begin() + static_cast<ptrdiff_t>(i - 1));
-      mergedBipL->deleteBipartition(i - 1);
-    }
+    occurrences[i] = make_pair(bipTable.getLastOccurrence(i), i);
   }
-
-  /* add terminal branches */
-  mergedBipL->addTrivialBipartitions(false);
-  for (size_t i = 0; i < mergedBipL->getNumberOfElements(); i++)
+  std::sort(occurrences.begin(), occurrences.end());
+  vector<size_t> indices(occurrences.size());
+  for (size_t i = 0; i < occurrences.size(); i++)
   {
-    bipScore.push_back(vecTr.size());
+    indices[i] = occurrences[i].second;
   }
-
-  return mergedBipL;
+  return indices;
 }
 
 /******************************************************************************/
 
 TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, double threshold, bool checkNames) throw (Exception)
 {
-  vector<size_t> bipScore;
   vector<string> tr0leaves;
-  BipartitionList* bipL;
-  double score;
 
   if (vecTr.size() == 0)
     throw Exception("TreeTools::thresholdConsensus. Empty vector passed");
@@ -1040,30 +1092,58 @@ TreeTemplate<Node>* TreeTools::thresholdConsensus(const vector<Tree*>& vecTr, do
     }
   }
 
-  bipL = bipartitionOccurrences(vecTr, bipScore);
+  BipartitionHashTable bipTable(vecTr[0]->getLeavesNames());
+  for (size_t i = 0; i < vecTr.size(); i++)
+  {
+    bipTable.addTree(*vecTr[i]);
+  }
+  return thresholdConsensus_(bipTable, threshold);
+}
+
+/******************************************************************************/
 
-  for (size_t i = bipL->getNumberOfBipartitions(); i > 0; i--)
+TreeTemplate<Node>* TreeTools::thresholdConsensus(TreeIterator& trees, double threshold, bool checkNames) throw (Exception)
+{
+  unique_ptr<BipartitionHashTable> bipTable(countBipartitions_(trees, checkNames));
+  return thresholdConsensus_(*bipTable, threshold);
+}
+
+/******************************************************************************/
+
+TreeTemplate<Node>* TreeTools::thresholdConsensus_(const BipartitionHashTable& bipTable, double threshold) throw (Exception)
+{
+  vector<size_t> indices = getBipartitionOrder_(bipTable);
+  double score;
+
+  /* select bipartitions, terminal branches are always kept */
+  vector<bool> kept(indices.size(), true);
+  for (size_t i = indices.size(); i > 0; i--)
   {
-    if (bipL->getPartitionSize(i - 1) == 1)
-      continue;
-    score = static_cast<int>(bipScore[i - 1]) / static_cast<double>(vecTr.size());
+    score = static_cast<double>(bipTable.getCount(indices[i - 1])) / static_cast<double>(bipTable.getNumberOfTrees());
     if (score <= threshold && score != 1.)
     {
-      bipL->deleteBipartition(i - 1);
+      kept[i - 1] = false;
       continue;
     }
     if (score > 0.5)
       continue;
-    for (size_t j = bipL->getNumberOfBipartitions(); j > i; j--)
+    for (size_t j = indices.size(); j > i; j--)
     {
-      if (!bipL->areCompatible(i - 1, j - 1))
+      if (kept[j - 1] && !bipTable.areCompatible(indices[i - 1], indices[j - 1]))
       {
-        bipL->deleteBipartition(i - 1);
+        kept[i - 1] = false;
         break;
       }
     }
   }
+  vector<size_t> selected;
+  for (size_t i = 0; i < indices.size(); i++)
+  {
+    if (kept[i])
+      selected.push_back(indices[i]);
+  }
 
+  BipartitionList* bipL = bipTable.toBipartitionList(selected, true);
   TreeTemplate<Node>* tr = bipL->toTree();
   delete bipL;
   return tr;
@@ -1078,6 +1158,13 @@ TreeTemplate<Node>* TreeTools::fullyResolvedConsensus(const vector<Tree*>& vecTr
 
 /******************************************************************************/
 
+TreeTemplate<Node>* TreeTools::fullyResolvedConsensus(TreeIterator& trees, bool checkNames)
+{
+  return thresholdConsensus(trees, 0., checkNames);
+}
+
+/******************************************************************************/
+
 TreeTemplate<Node>* TreeTools::majorityConsensus(const vector<Tree*>& vecTr, bool checkNames)
 {
   return thresholdConsensus(vecTr, 0.5, checkNames);
@@ -1085,6 +1172,13 @@ TreeTemplate<Node>* TreeTools::majorityConsensus(const vector<Tree*>& vecTr, boo
 
 /******************************************************************************/
 
+TreeTemplate<Node>* TreeTools::majorityConsensus(TreeIterator& trees, bool checkNames)
+{
+  return thresholdConsensus(trees, 0.5, checkNames);
+}
+
+/******************************************************************************/
+
 TreeTemplate<Node>* TreeTools::strictConsensus(const vector<Tree*>& vecTr, bool checkNames)
 {
   return thresholdConsensus(vecTr, 1., checkNames);
@@ -1092,6 +1186,13 @@ TreeTemplate<Node>* TreeTools::strictConsensus(const vector<Tree*>& vecTr, bool
 
 /******************************************************************************/
 
+TreeTemplate<Node>* TreeTools::strictConsensus(TreeIterator& trees, bool checkNames)
+{
+  return thresholdConsensus(trees, 1., checkNames);
+}
+
+/******************************************************************************/
+
 Tree* TreeTools::MRP(const vector<Tree*>& vecTr)
 {
   // matrix representation
@@ -1123,34 +1224,49 @@ Tree* TreeTools::MRP(const vector<Tree*>& vecTr)
 
 void TreeTools::computeBootstrapValues(Tree& tree, const vector<Tree*>& vecTr, bool verbose, int format)
 {
-  vector<int> index;
-  BipartitionList bpTree(tree, true, &index);
-  vector<size_t> occurences;
-  BipartitionList* bpList = bipartitionOccurrences(vecTr, occurences);
+  BipartitionHashTable bipTable(tree.getLeavesNames());
+  for (size_t i = 0; i < vecTr.size(); i++)
+  {
+    bipTable.addTree(*vecTr[i]);
+  }
+  computeBootstrapValues_(tree, bipTable, verbose, format);
+}
 
-  vector< Number<double> > bootstrapValues(bpTree.getNumberOfBipartitions());
+/******************************************************************************/
 
-  for (size_t i = 0; i < bpTree.getNumberOfBipartitions(); i++)
+void TreeTools::computeBootstrapValues(Tree& tree, TreeIterator& trees, bool verbose, int format)
+{
+  BipartitionHashTable bipTable(tree.getLeavesNames());
+  while (trees.hasMoreTrees())
   {
-    if (verbose)
-      ApplicationTools::displayGauge(i, bpTree.getNumberOfBipartitions() - 1, '=');
-    for (size_t j = 0; j < bpList->getNumberOfBipartitions(); j++)
-    {
-      if (BipartitionTools::areIdentical(bpTree, i, *bpList, j))
-      {
-        bootstrapValues[i] = format >= 0 ? round(static_cast<double>(occurences[j]) * pow(10., 2 + format) / static_cast<double>(vecTr.size())) / pow(10., format) : static_cast<double>(occurences[j]);
-        break;
-      }
-    }
+    unique_ptr<Tree> tr(trees.nextTree());
+    bipTable.addTree(*tr);
   }
+  computeBootstrapValues_(tree, bipTable, verbose, format);
+}
+
+/******************************************************************************/
+
+void TreeTools::computeBootstrapValues_(Tree& tree, const BipartitionHashTable& bipTable, bool verbose, int format)
+{
+  vector<uint64_t> bitsets;
+  vector<int> index;
+  bipTable.computeBipartitions(tree, bitsets, index, true);
+  size_t nbWords = bipTable.getNumberOfWords();
+  size_t nbTrees = bipTable.getNumberOfTrees();
 
   for (size_t i = 0; i < index.size(); i++)
   {
-    if (!tree.isLeaf(index[i]))
-      tree.setBranchProperty(index[i], BOOTSTRAP, bootstrapValues[i]);
+    if (verbose)
+      ApplicationTools::displayGauge(i, index.size() - 1, '=');
+    if (tree.isLeaf(index[i]))
+      continue;
+    const uint64_t* bitset = &bitsets[i * nbWords];
+    // Terminal branches are present in all trees:
+    size_t occurrences = bipTable.getPartitionSize(bitset) < 2 ? nbTrees : bipTable.getCount(bitset);
+    Number<double> bootstrapValue(format >= 0 ? round(static_cast<double>(occurrences) * pow(10., 2 + format) / static_cast<double>(nbTrees)) / pow(10., format) : static_cast<double>(occurrences));
+    tree.setBranchProperty(index[i], BOOTSTRAP, bootstrapValue);
   }
-
-  delete bpList;
 }
 
 /******************************************************************************/
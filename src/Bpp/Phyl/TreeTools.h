@@ -44,6 +44,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include "Node.h"
 #include "Tree.h"
 #include "BipartitionList.h"
+#include "TreeIterator.h"
 
 #include <Bpp/Exceptions.h>
 #include <Bpp/Numeric/VectorTools.h>
@@ -55,6 +56,8 @@ knowledge of the CeCILL license and that you accept its terms.
 namespace bpp
 {
 
+class BipartitionHashTable;
+
 /**
  * @brief Generic utilitary methods dealing with trees.
  *
@@ -599,11 +602,26 @@ class TreeTools
      */
     static int robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool checkNames = true, int* missing_in_tr2 = NULL, int* missing_in_tr1 = NULL) throw (Exception);
 
+    /**
+     * @brief Calculates the Robinson-Foulds topological distance between a tree and each tree of a set.
+     *
+     * Trees are read one at a time from the iterator, so that the set does not need to fit in memory.
+     * The bipartitions of the reference tree are stored in a BipartitionHashTable and looked up for each tree.
+     *
+     * @param tree The reference tree.
+     * @param trees An iterator over the trees to compare to the reference tree.
+     * @param checkNames Tell whether we should check the trees first.
+     * @return The Robinson-Foulds distances between the reference tree and each tree, in the order of the iterator.
+     * @throw Exception If checkNames is set to true and trees do not share the same leaves names.
+     */
+    static std::vector<int> robinsonFouldsDistances(const Tree& tree, TreeIterator& trees, bool checkNames = true) throw (Exception);
+
     /**
      * @brief Counts the total number of occurrences of every bipartition from the input trees
      *
      * Returns the list of distinct bipartitions found at least once in the set of input trees,
      * and writes the number of occurrence of each of these bipartitions in vector bipScore.
+     * Bipartitions are counted with a BipartitionHashTable, in a time linear in the number of trees.
      *
      * @author Nicolas Galtier
      * @param vecTr Vector of input trees (must share a common set of leaves - not checked in this function)
@@ -612,6 +630,18 @@ class TreeTools
      */
     static BipartitionList* bipartitionOccurrences(const std::vector<Tree*>& vecTr, std::vector<size_t>& bipScore);
 
+    /**
+     * @brief Counts the total number of occurrences of every bipartition from a stream of trees
+     *
+     * Same as bipartitionOccurrences(const std::vector<Tree*>&, std::vector<size_t>&), but trees are read
+     * one at a time from the iterator and discarded once counted.
+     *
+     * @param trees An iterator over the input trees (must share a common set of leaves - not checked in this function)
+     * @param bipScore Output as the numbers of occurrences of the returned distinct bipartitions
+     * @return A BipartitionList object including only distinct bipartitions
+     */
+    static BipartitionList* bipartitionOccurrences(TreeIterator& trees, std::vector<size_t>& bipScore);
+
     /**
      * @brief General greedy consensus tree method
      *
@@ -627,6 +657,18 @@ class TreeTools
      */
     static TreeTemplate<Node>* thresholdConsensus(const std::vector<Tree*>& vecTr, double threshold, bool checkNames = true) throw (Exception);
 
+    /**
+     * @brief General greedy consensus tree method, on a stream of trees
+     *
+     * Same as thresholdConsensus(const std::vector<Tree*>&, double, bool), but trees are read one at a time
+     * from the iterator, so that only the bipartition counts are kept in memory.
+     *
+     * @param trees An iterator over the input trees (must share a common set of leaves - checked if checkNames is true)
+     * @param threshold Minimal acceptable score =number of occurrence of a bipartition/number of trees (0.<=threshold<=1.)
+     * @param checkNames Tell whether we should check the trees first.
+     */
+    static TreeTemplate<Node>* thresholdConsensus(TreeIterator& trees, double threshold, bool checkNames = true) throw (Exception);
+
     /**
      * @brief Fully-resolved greedy consensus tree method
      *
@@ -638,6 +680,7 @@ class TreeTools
      * @param checkNames Tell whether we should check the trees first.
      */
     static TreeTemplate<Node>* fullyResolvedConsensus(const std::vector<Tree*>& vecTr, bool checkNames = true);
+    static TreeTemplate<Node>* fullyResolvedConsensus(TreeIterator& trees, bool checkNames = true);
 
     /**
      * @brief Majority consensus tree method
@@ -649,6 +692,7 @@ class TreeTools
      * @param checkNames Tell whether we should check the trees first.
      */
     static TreeTemplate<Node>* majorityConsensus(const std::vector<Tree*>& vecTr, bool checkNames = true);
+    static TreeTemplate<Node>* majorityConsensus(TreeIterator& trees, bool checkNames = true);
 
     /**
      * @brief Strict consensus tree method
@@ -660,6 +704,7 @@ class TreeTools
      * @param checkNames Tell whether we should check the trees first.
      */
     static TreeTemplate<Node>* strictConsensus(const std::vector<Tree*>& vecTr, bool checkNames = true);
+    static TreeTemplate<Node>* strictConsensus(TreeIterator& trees, bool checkNames = true);
 
     /** @} */
 
@@ -680,12 +725,28 @@ class TreeTools
      * @brief Compute bootstrap values.
      *
      * @param tree    Input tree. the BOOTSTRAP banch property of the tree will be modified if it already exists.
-     * @param vecTr   A list of trees to compare to 'tree'.
+     * Bipartitions of the input trees are counted once with a BipartitionHashTable,
+     * and each branch of 'tree' is then looked up in this table.
+     *
+     * @param vecTr   A list of trees to compare to 'tree', with the same leaf names.
      * @param verbose Tell if a progress bar should be displayed.
      * @param format  If null or positive, bootstrap values are reported as percentage, with the given number of decimal digits.
      *                If negative, bootstrap calues are the raw number of tree occurrences.
      */
     static void computeBootstrapValues(Tree& tree, const std::vector<Tree*>& vecTr, bool verbose = true, int format = 0);
+
+    /**
+     * @brief Compute bootstrap values from a stream of trees.
+     *
+     * Same as computeBootstrapValues(Tree&, const std::vector<Tree*>&, bool, int), but the bootstrap
+     * trees are read one at a time from the iterator.
+     *
+     * @param tree    Input tree.
+     * @param trees   An iterator over the trees to compare to 'tree', with the same leaf names.
+     * @param verbose Tell if a progress bar should be displayed.
+     * @param format  Output format, see computeBootstrapValues(Tree&, const std::vector<Tree*>&, bool, int).
+     */
+    static void computeBootstrapValues(Tree& tree, TreeIterator& trees, bool verbose = true, int format = 0);
 	
     /**
      * @brief Determine the mid-point position of the root along the branch that already contains the root. Consequently, the topology of the rooted tree remains identical.
@@ -732,6 +793,21 @@ class TreeTools
 	  static Moments_ statFromNode_(Tree& tree, int rootId);
 	  static double bestRootPosition_(Tree& tree, int nodeId1, int nodeId2, double length);
 
+    /**
+     * @return The indices of the bipartitions of a table, by order of last occurrence.
+     */
+    static std::vector<size_t> getBipartitionOrder_(const BipartitionHashTable& bipTable);
+
+    /**
+     * @return A table with the bipartitions of all trees of an iterator.
+     * @throw Exception If the iterator is empty, or if checkNames is true and trees do not share the same leaves names.
+     */
+    static BipartitionHashTable* countBipartitions_(TreeIterator& trees, bool checkNames) throw (Exception);
+
+    static BipartitionList* bipartitionOccurrences_(const BipartitionHashTable& bipTable, std::vector<size_t>& bipScore);
+    static TreeTemplate<Node>* thresholdConsensus_(const BipartitionHashTable& bipTable, double threshold) throw (Exception);
+    static void computeBootstrapValues_(Tree& tree, const BipartitionHashTable& bipTable, bool verbose, int format);
+
 
     /** @} */
 
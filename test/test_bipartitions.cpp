@@ -0,0 +1,305 @@
+//
+// File: test_bipartitions.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/BipartitionHashTable.h>
+#include <Bpp/Phyl/BipartitionTools.h>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+// Reference implementations, based on BipartitionList, as used before BipartitionHashTable:
+
+BipartitionList* referenceOccurrences(const vector<Tree*>& vecTr, vector<size_t>& bipScore)
+{
+  vector<BipartitionList*> vecBipL;
+  for (size_t i = 0; i < vecTr.size(); i++)
+    vecBipL.push_back(new BipartitionList(*vecTr[i]));
+  BipartitionList* mergedBipL = BipartitionTools::mergeBipartitionLists(vecBipL);
+  for (size_t i = 0; i < vecTr.size(); i++)
+    delete vecBipL[i];
+
+  mergedBipL->removeTrivialBipartitions();
+  size_t nbBip = mergedBipL->getNumberOfBipartitions();
+  vector<size_t> bipSize;
+  bipScore.clear();
+  for (size_t i = 0; i < nbBip; i++) {
+    bipSize.push_back(mergedBipL->getPartitionSize(i));
+    bipScore.push_back(1);
+  }
+  for (size_t i = nbBip; i > 0; i--) {
+    if (bipScore[i - 1] == 0)
+      continue;
+    for (size_t j = i - 1; j > 0; j--) {
+      if (bipScore[j - 1] && bipSize[i - 1] == bipSize[j - 1] && mergedBipL->areIdentical(i - 1, j - 1)) {
+        bipScore[i - 1]++;
+        bipScore[j - 1] = 0;
+      }
+    }
+  }
+  for (size_t i = nbBip; i > 0; i--) {
+    if (bipScore[i - 1] == 0) {
+      bipScore.erase(bipScore.begin() + static_cast<ptrdiff_t>(i - 1));
+      mergedBipL->deleteBipartition(i - 1);
+    }
+  }
+  mergedBipL->addTrivialBipartitions(false);
+  for (size_t i = 0; i < mergedBipL->getNumberOfElements(); i++)
+    bipScore.push_back(vecTr.size());
+  return mergedBipL;
+}
+
+TreeTemplate<Node>* referenceConsensus(const vector<Tree*>& vecTr, double threshold)
+{
+  vector<size_t> bipScore;
+  unique_ptr<BipartitionList> bipL(referenceOccurrences(vecTr, bipScore));
+  for (size_t i = bipL->getNumberOfBipartitions(); i > 0; i--) {
+    if (bipL->getPartitionSize(i - 1) == 1)
+      continue;
+    double score = static_cast<int>(bipScore[i - 1]) / static_cast<double>(vecTr.size());
+    if (score <= threshold && score != 1.) {
+      bipL->deleteBipartition(i - 1);
+      continue;
+    }
+    if (score > 0.5)
+      continue;
+    for (size_t j = bipL->getNumberOfBipartitions(); j > i; j--) {
+      if (!bipL->areCompatible(i - 1, j - 1)) {
+        bipL->deleteBipartition(i - 1);
+        break;
+      }
+    }
+  }
+  return bipL->toTree();
+}
+
+void referenceBootstrapValues(Tree& tree, const vector<Tree*>& vecTr)
+{
+  vector<int> index;
+  BipartitionList bpTree(tree, true, &index);
+  vector<size_t> occurences;
+  unique_ptr<BipartitionList> bpList(referenceOccurrences(vecTr, occurences));
+  for (size_t i = 0; i < bpTree.getNumberOfBipartitions(); i++) {
+    if (tree.isLeaf(index[i]))
+      continue;
+    for (size_t j = 0; j < bpList->getNumberOfBipartitions(); j++) {
+      if (BipartitionTools::areIdentical(bpTree, i, *bpList, j)) {
+        Number<double> value(round(static_cast<double>(occurences[j]) * 100. / static_cast<double>(vecTr.size())));
+        tree.setBranchProperty(index[i], TreeTools::BOOTSTRAP, value);
+        break;
+      }
+    }
+  }
+}
+
+// Compare the bootstrap values of two copies of the same tree:
+bool compareBootstrapValues(const TreeTemplate<Node>& tree, const TreeTemplate<Node>& ref)
+{
+  vector<int> ids = ref.getInnerNodesId();
+  for (size_t i = 0; i < ids.size(); ++i) {
+    bool has = tree.hasBranchProperty(ids[i], TreeTools::BOOTSTRAP);
+    if (has != ref.hasBranchProperty(ids[i], TreeTools::BOOTSTRAP)) {
+      cerr << "Bootstrap value missing for node " << ids[i] << endl;
+      return false;
+    }
+    if (!has)
+      continue;
+    double value = dynamic_cast<const Number<double>*>(tree.getBranchProperty(ids[i], TreeTools::BOOTSTRAP))->getValue();
+    double refValue = dynamic_cast<const Number<double>*>(ref.getBranchProperty(ids[i], TreeTools::BOOTSTRAP))->getValue();
+    if (value != refValue) {
+      cerr << "Wrong bootstrap value for node " << ids[i] << ": " << value << " instead of " << refValue << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compare the consensus trees and their support with the reference implementation:
+bool testConsensus(const vector<Tree*>& trees)
+{
+  vector<size_t> scores, refScores;
+  unique_ptr<BipartitionList> bipL(TreeTools::bipartitionOccurrences(trees, scores));
+  unique_ptr<BipartitionList> refBipL(referenceOccurrences(trees, refScores));
+  if (bipL->getNumberOfBipartitions() != refBipL->getNumberOfBipartitions()) {
+    cerr << "Wrong number of distinct bipartitions: " << bipL->getNumberOfBipartitions() << " instead of " << refBipL->getNumberOfBipartitions() << endl;
+    return false;
+  }
+  for (size_t i = 0; i < refBipL->getNumberOfBipartitions(); ++i) {
+    size_t j = 0;
+    while (j < bipL->getNumberOfBipartitions() && !BipartitionTools::areIdentical(*refBipL, i, *bipL, j))
+      j++;
+    if (j == bipL->getNumberOfBipartitions() || scores[j] != refScores[i]) {
+      cerr << "Wrong occurrences for bipartition " << i << endl;
+      return false;
+    }
+  }
+
+  double thresholds[] = { 0., 0.5, 1. };
+  for (size_t k = 0; k < 3; ++k) {
+    unique_ptr<TreeTemplate<Node> > consensus(TreeTools::thresholdConsensus(trees, thresholds[k]));
+    unique_ptr<TreeTemplate<Node> > refConsensus(referenceConsensus(trees, thresholds[k]));
+    if (TreeTools::robinsonFouldsDistance(*consensus, *refConsensus) != 0) {
+      cerr << "Consensus with threshold " << thresholds[k] << " differs from the reference one." << endl;
+      return false;
+    }
+    // Support values, on the same consensus tree:
+    TreeTemplate<Node> refSupport(*consensus);
+    TreeTools::computeBootstrapValues(*consensus, trees, false);
+    referenceBootstrapValues(refSupport, trees);
+    if (!compareBootstrapValues(*consensus, refSupport))
+      return false;
+  }
+  return true;
+}
+
+int main() {
+  vector<string> leaves(70);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf" + TextTools::toString(i);
+
+  // A few random trees, and several copies of the first one (rooted and unrooted):
+  vector<Tree*> trees;
+  for (size_t i = 0; i < 10; ++i)
+    trees.push_back(TreeTemplateTools::getRandomTree(leaves, i % 2 == 0));
+  for (size_t i = 0; i < 5; ++i)
+    trees.push_back(new TreeTemplate<Node>(*dynamic_cast<TreeTemplate<Node>*>(trees[0])));
+  dynamic_cast<TreeTemplate<Node>*>(trees.back())->unroot();
+
+  BipartitionHashTable table(leaves);
+  size_t total = 0;
+  for (size_t i = 0; i < trees.size(); ++i) {
+    table.addTree(*trees[i]);
+    BipartitionList bipL(*trees[i]);
+    bipL.removeTrivialBipartitions();
+    bipL.removeRedundantBipartitions();
+    total += bipL.getNumberOfBipartitions();
+  }
+
+  // Compare the counts with the ones obtained by pairwise comparisons of bipartitions:
+  size_t sum = 0;
+  for (size_t i = 0; i < table.getNumberOfBipartitions(); ++i) {
+    unique_ptr<BipartitionList> bip(table.toBipartitionList(vector<size_t>(1, i)));
+    size_t count = 0;
+    for (size_t j = 0; j < trees.size(); ++j) {
+      BipartitionList bipL(*trees[j]);
+      for (size_t k = 0; k < bipL.getNumberOfBipartitions(); ++k) {
+        if (BipartitionTools::areIdentical(*bip, 0, bipL, k)) {
+          count++;
+          break;
+        }
+      }
+    }
+    if (count != table.getCount(i)) {
+      cerr << "Wrong count for bipartition " << i << ": " << table.getCount(i) << " instead of " << count << endl;
+      return 1;
+    }
+    sum += count;
+  }
+  cout << table.getNumberOfBipartitions() << " distinct bipartitions, " << sum << " occurrences." << endl;
+  if (sum != total) {
+    cerr << "Wrong total number of occurrences: " << sum << " instead of " << total << endl;
+    return 1;
+  }
+
+  // Strict consensus of identical trees:
+  vector<Tree*> copies(trees.begin() + 10, trees.end());
+  unique_ptr<TreeTemplate<Node> > consensus(TreeTools::strictConsensus(copies));
+  if (TreeTools::robinsonFouldsDistance(*consensus, *trees[0]) != 0) {
+    cerr << "Strict consensus of identical trees differs from the input tree." << endl;
+    return 1;
+  }
+
+  // Bootstrap values of a tree against its copies:
+  TreeTemplate<Node> tree(*dynamic_cast<TreeTemplate<Node>*>(trees[0]));
+  TreeTools::computeBootstrapValues(tree, copies, false);
+  vector<Node*> nodes = tree.getInnerNodes();
+  size_t nbValues = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (!nodes[i]->hasBranchProperty(TreeTools::BOOTSTRAP))
+      continue;
+    double value = dynamic_cast<Number<double>*>(nodes[i]->getBranchProperty(TreeTools::BOOTSTRAP))->getValue();
+    if (value != 100.) {
+      cerr << "Wrong bootstrap value: " << value << endl;
+      return 1;
+    }
+    nbValues++;
+  }
+  if (nbValues == 0)
+    return 1;
+
+  // Perturbed copies of a tree, with a few pairs of leaves swapped, so that bipartitions have various supports:
+  mt19937 generator(17);
+  uniform_int_distribution<size_t> leafIndex(0, leaves.size() - 1);
+  vector<Tree*> perturbed;
+  for (size_t i = 0; i < 40; ++i) {
+    TreeTemplate<Node>* copy = new TreeTemplate<Node>(*dynamic_cast<TreeTemplate<Node>*>(trees[0]));
+    copy->unroot();
+    vector<Node*> copyLeaves = copy->getLeaves();
+    size_t nbSwaps = i % 5;
+    for (size_t k = 0; k < nbSwaps; ++k) {
+      Node* leaf1 = copyLeaves[leafIndex(generator)];
+      Node* leaf2 = copyLeaves[leafIndex(generator)];
+      string name = leaf1->getName();
+      leaf1->setName(leaf2->getName());
+      leaf2->setName(name);
+    }
+    perturbed.push_back(copy);
+  }
+  if (!testConsensus(perturbed))
+    return 1;
+  // Also add independent (unrooted) random trees, which only share few bipartitions:
+  vector<Tree*> mixed(perturbed);
+  for (size_t i = 1; i < 10; i += 2)
+    mixed.push_back(trees[i]);
+  if (!testConsensus(mixed))
+    return 1;
+
+  for (size_t i = 0; i < perturbed.size(); ++i)
+    delete perturbed[i];
+  for (size_t i = 0; i < trees.size(); ++i)
+    delete trees[i];
+  return 0;
+}
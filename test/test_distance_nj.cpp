@@ -0,0 +1,97 @@
+//
+// File: test_distance_nj.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/DistanceMatrix.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/Distance/NeighborJoining.h>
+#include <Bpp/Phyl/Distance/BioNJ.h>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+//Build a tree with the fast and exhaustive searches, and check that both trees are identical.
+bool testMethod(NeighborJoining& method, const DistanceMatrix& matrix) {
+  method.setDistanceMatrix(matrix);
+  method.setFastSearch(false);
+  method.computeTree();
+  unique_ptr<TreeTemplate<Node> > refTree(dynamic_cast<TreeTemplate<Node>*>(method.getTree()));
+  string ref = TreeTemplateTools::treeToParenthesis(*refTree);
+  method.setDistanceMatrix(matrix);
+  method.setFastSearch(true);
+  method.computeTree();
+  unique_ptr<TreeTemplate<Node> > tree(dynamic_cast<TreeTemplate<Node>*>(method.getTree()));
+  string fast = TreeTemplateTools::treeToParenthesis(*tree);
+  cout << method.getName() << ": " << fast << endl;
+  if (fast != ref) {
+    cerr << "Fast search differs from the exhaustive one:" << endl << ref << endl;
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  for (unsigned int rep = 0; rep < 10; ++rep) {
+    vector<string> leavesNames;
+    size_t n = 4 + rep * 10;
+    for (size_t i = 0; i < n; ++i)
+      leavesNames.push_back("L" + TextTools::toString(i));
+    unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leavesNames, false));
+    tree->setBranchLengths(0.1);
+    unique_ptr<DistanceMatrix> matrix(TreeTools::getDistanceMatrix(*tree));
+    //Add some noise, so that the matrix is not additive:
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < i; ++j)
+        (*matrix)(i, j) = (*matrix)(j, i) = (*matrix)(i, j) * RandomTools::giveRandomNumberBetweenZeroAndEntry(2.);
+
+    for (unsigned int rooted = 0; rooted < 2; ++rooted) {
+      NeighborJoining nj(rooted == 1, false, false);
+      if (!testMethod(nj, *matrix))
+        return 1;
+      BioNJ bionj(rooted == 1, false, false);
+      if (!testMethod(bionj, *matrix))
+        return 1;
+    }
+  }
+  return 0;
+}
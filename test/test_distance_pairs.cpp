@@ -0,0 +1,119 @@
+//
+// File: test_distance_pairs.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Distance/DistanceEstimation.h>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool isClose(double x, double ref, double tolerance) {
+  return abs(x - ref) <= tolerance * max(1., abs(ref));
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  //Sequences with gaps, unknown characters and ambiguous states, including a gap-only column:
+  VectorSiteContainer sites(alphabet);
+  sites.addSequence(BasicSequence("A", "ACGT-NACGTRYACGGT-ACGTTAGCANAAGT", alphabet));
+  sites.addSequence(BasicSequence("B", "ACGA-NGCGTAYACTGTCACRTTAGCGGAAGT", alphabet));
+  sites.addSequence(BasicSequence("C", "TCGTCNACGCRCAC--T-ACGTTAKCANAAGT", alphabet));
+  sites.addSequence(BasicSequence("D", "ACCT-AAC-TGYACGGTTACGSTAGNANCAGT", alphabet));
+  vector<string> names = sites.getSequencesNames();
+
+  K80 model(alphabet, 2.);
+  GammaDiscreteRateDistribution rdist(4, 0.5);
+  double brLens[] = { 0.01, 0.1, 1. };
+
+  try {
+    //A single instance is reused for all pairs:
+    TwoTreeLikelihood reused(names[0], names[1], sites, &model, &rdist, false);
+    for (size_t i = 0; i < names.size(); ++i) {
+      for (size_t j = i + 1; j < names.size(); ++j) {
+        reused.setSequences(names[i], names[j], sites);
+        reused.initialize();
+        reused.enableDerivatives(true);
+        TwoTreeLikelihood fresh(names[i], names[j], sites, &model, &rdist, false);
+        fresh.initialize();
+        fresh.enableDerivatives(true);
+        //The pair of sequences is available from the reused instance:
+        const SiteContainer* pair = reused.getData();
+        if (pair->getNumberOfSequences() != 2
+            || pair->getSequence(0).toString() != sites.getSequence(names[i]).toString()
+            || pair->getSequence(1).toString() != sites.getSequence(names[j]).toString()) {
+          cerr << "Wrong pair of sequences." << endl;
+          return 1;
+        }
+        for (size_t k = 0; k < 3; ++k) {
+          reused.setParameterValue("BrLen", brLens[k]);
+          fresh.setParameterValue("BrLen", brLens[k]);
+          //Reference: a rooted two-leaf tree, with the same total branch length:
+          unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree(
+                "(" + names[i] + ":" + TextTools::toString(brLens[k] / 2.) + "," + names[j] + ":" + TextTools::toString(brLens[k] / 2.) + ");"));
+          DRHomogeneousTreeLikelihood tl(*tree, sites, &model, &rdist, false, false);
+          tl.initialize();
+          cout << names[i] << "-" << names[j] << "\t" << brLens[k] << "\t" << setprecision(20) << reused.getLogLikelihood() << "\t" << tl.getLogLikelihood() << endl;
+          if (!isClose(reused.getLogLikelihood(), fresh.getLogLikelihood(), 1e-12)
+              || !isClose(reused.getFirstOrderDerivative("BrLen"), fresh.getFirstOrderDerivative("BrLen"), 1e-12)
+              || !isClose(reused.getSecondOrderDerivative("BrLen"), fresh.getSecondOrderDerivative("BrLen"), 1e-12)) {
+            cerr << "Reused pair likelihood differs from a new one." << endl;
+            return 1;
+          }
+          if (!isClose(reused.getLogLikelihood(), tl.getLogLikelihood(), 1e-10)) {
+            cerr << "Pair likelihood differs from the tree likelihood." << endl;
+            return 1;
+          }
+        }
+      }
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,98 @@
+//
+// File: test_distance_parallel.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Seq/DistanceMatrix.h>
+#include <Bpp/Numeric/Prob/ConstantDistribution.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Distance/DistanceEstimation.h>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  vector<string> leavesNames;
+  for (size_t i = 0; i < 30; ++i)
+    leavesNames.push_back("L" + TextTools::toString(i));
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leavesNames, false));
+  tree->setBranchLengths(0.05);
+
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  K80 model(alphabet, 3.);
+  ConstantDistribution rdist(1.);
+  HomogeneousSequenceSimulator simulator(&model, &rdist, tree.get());
+  unique_ptr<SiteContainer> sites(simulator.simulate(500));
+
+  try {
+    DistanceEstimation distEst(model.clone(), rdist.clone(), sites.get(), 0, false);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    distEst.computeMatrix();
+    cout << "Sequential:\t" << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+    unique_ptr<DistanceMatrix> ref(distEst.getMatrix());
+
+    size_t nbThreads[] = { 2, 4 };
+    for (size_t k = 0; k < 2; ++k) {
+      distEst.setNumberOfThreads(nbThreads[k]);
+      start = chrono::steady_clock::now();
+      distEst.computeMatrix();
+      cout << nbThreads[k] << " threads:\t" << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+      unique_ptr<DistanceMatrix> dist(distEst.getMatrix());
+      for (size_t i = 0; i < leavesNames.size(); ++i) {
+        for (size_t j = 0; j < leavesNames.size(); ++j) {
+          if (abs((*dist)(i, j) - (*ref)(i, j)) > 1e-6) {
+            cerr << "Parallel distance differs from the sequential one for pair " << i << ", " << j << ": "
+                 << (*dist)(i, j) << " vs " << (*ref)(i, j) << endl;
+            return 1;
+          }
+        }
+      }
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,126 @@
+//
+// File: test_flat_tree.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#include <Bpp/BppString.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/FlatTree.h>
+#include <iostream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+bool sameTree(const TreeTemplate<Node>& tree1, const FlatTree& tree2) {
+  TreeTemplate<Node> tree3(tree2);
+  string d1 = TreeTemplateTools::treeToParenthesis(tree1, true);
+  string d2 = TreeTemplateTools::treeToParenthesis(tree3, true);
+  if (d1 != d2) {
+    cerr << d1 << endl << d2 << endl;
+    return false;
+  }
+  return tree1.getNodesId() == tree2.getNodesId() && tree1.getLeavesId() == tree2.getLeavesId()
+      && tree1.getInnerNodesId() == tree2.getInnerNodesId() && tree1.getBranchesId() == tree2.getBranchesId()
+      && tree1.getLeavesNames() == tree2.getLeavesNames();
+}
+
+int main() {
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::parenthesisToTree("((A:0.1,B:0.2)90:0.3,((C:0.1,D:0.4)80:0.1,E:0.3)70:0.2,F:0.6);", true, TreeTools::BOOTSTRAP, false, false));
+  tree->setNodeProperty(tree->getLeafId("A"), "species", BppString("human"));
+  FlatTree flat(*tree);
+  if (!sameTree(*tree, flat)) {
+    cerr << "Conversion failed." << endl;
+    return 1;
+  }
+
+  // Copies share their storage until they are modified:
+  FlatTree copy(flat);
+  copy.setDistanceToFather(copy.getLeafId("A"), 1.);
+  dynamic_cast<BppString*>(copy.getNodeProperty(copy.getLeafId("A"), "species"))->operator=(BppString("mouse"));
+  if (flat.getDistanceToFather(flat.getLeafId("A")) != 0.1
+      || dynamic_cast<const BppString*>(const_cast<const FlatTree&>(flat).getNodeProperty(flat.getLeafId("A"), "species"))->toSTL() != "human") {
+    cerr << "Original tree was modified through its copy." << endl;
+    return 1;
+  }
+
+  // Rerooting:
+  vector<int> ids = tree->getNodesId();
+  for (size_t i = 0; i < ids.size(); ++i) {
+    TreeTemplate<Node> tree2(*tree);
+    FlatTree flat2(flat);
+    tree2.newOutGroup(ids[i]);
+    flat2.newOutGroup(ids[i]);
+    if (!sameTree(tree2, flat2)) {
+      cerr << "newOutGroup failed for node " << ids[i] << "." << endl;
+      return 1;
+    }
+    if (tree2.isRooted()) {
+      tree2.unroot();
+      flat2.unroot();
+    }
+    tree2.rootAt(ids[i]);
+    flat2.rootAt(ids[i]);
+    tree2.resetNodesId();
+    flat2.resetNodesId();
+    if (!sameTree(tree2, flat2)) {
+      cerr << "rootAt failed for node " << ids[i] << "." << endl;
+      return 1;
+    }
+  }
+
+  // Subtrees:
+  int id = tree->getFatherId(tree->getLeafId("C"));
+  unique_ptr<TreeTemplate<Node> > sub1(tree->cloneSubtree(id));
+  unique_ptr<FlatTree> sub2(flat.cloneSubtree(id));
+  if (!sameTree(*sub1, *sub2)) {
+    cerr << "cloneSubtree failed." << endl;
+    return 1;
+  }
+
+  // Branch lengths:
+  flat.scaleTree(2.);
+  tree->scaleTree(2.);
+  if (abs(flat.getTotalLength() - tree->getTotalLength()) > 1e-12 || flat.getBranchLengths() != tree->getBranchLengths()) {
+    cerr << "Wrong branch lengths." << endl;
+    return 1;
+  }
+  cout << TreeTemplateTools::treeToParenthesis(TreeTemplate<Node>(flat)) << endl;
+  return 0;
+}
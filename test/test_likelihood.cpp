@@ -70,8 +70,12 @@ void fitModelHSR(SubstitutionModel* model, DiscreteDistribution* rdist, const Tr
 }
 
 void fitModelHDR(SubstitutionModel* model, DiscreteDistribution* rdist, const Tree& tree, const SiteContainer& sites,
-    double initialValue, double finalValue) {
+    double initialValue, double finalValue, bool flat = false, size_t nbThreads = 1) {
   DRHomogeneousTreeLikelihood tl(tree, sites, model, rdist);
+  tl.setFlatLikelihoodArrays(flat);
+  tl.setNumberOfThreads(nbThreads);
+  if (nbThreads > 1)
+    tl.setSiteBlockSize(3); //Force several blocks on this small data set.
   tl.initialize();
   ApplicationTools::displayResult("Test model", model->getName());
   cout << setprecision(20) << tl.getValue() << endl;
@@ -121,17 +125,67 @@ int main() {
     return 1;
   }  
 
+  model.reset(new T92(alphabet, 3.));
+  rdist.reset(new GammaDiscreteRateDistribution(4, 1.0));
+  try {
+    cout << "Testing Double Tree Traversal likelihood class with flat arrays..." << endl;
+    fitModelHDR(model.get(), rdist.get(), *tree, sites, 85.030942031997312824, 65.72293577214308868406, true);
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }  
+
+  model.reset(new T92(alphabet, 3.));
+  rdist.reset(new GammaDiscreteRateDistribution(4, 1.0));
+  try {
+    cout << "Testing Double Tree Traversal likelihood class with 4 threads..." << endl;
+    fitModelHDR(model.get(), rdist.get(), *tree, sites, 85.030942031997312824, 65.72293577214308868406, false, 4);
+    model.reset(new T92(alphabet, 3.));
+    rdist.reset(new GammaDiscreteRateDistribution(4, 1.0));
+    cout << "Testing Double Tree Traversal likelihood class with flat arrays and 4 threads..." << endl;
+    fitModelHDR(model.get(), rdist.get(), *tree, sites, 85.030942031997312824, 65.72293577214308868406, true, 4);
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }  
+
   //Let's compare the derivatives:
   RHomogeneousTreeLikelihood tlsr(*tree, sites, model.get(), rdist.get());
   tlsr.initialize();
   DRHomogeneousTreeLikelihood tldr(*tree, sites, model.get(), rdist.get());
   tldr.initialize();
+  DRHomogeneousTreeLikelihood tldrf(*tree, sites, model.get(), rdist.get());
+  tldrf.setFlatLikelihoodArrays(true);
+  tldrf.initialize();
   vector<string> params = tlsr.getBranchLengthsParameters().getParameterNames();
+  //The model keeps the transition probabilities of all branches and rate classes:
+  if (dynamic_cast<AbstractSubstitutionModel*>(model.get())->getTransitionProbabilitiesCacheSize() < params.size() * rdist->getNumberOfCategories()) return 1;
   for (vector<string>::iterator it = params.begin(); it != params.end(); ++it) {
     double d1sr = tlsr.getFirstOrderDerivative(*it);
     double d1dr = tldr.getFirstOrderDerivative(*it);
-    cout << *it << "\t" << d1sr << "\t" << d1dr << endl;
+    double d1drf = tldrf.getFirstOrderDerivative(*it);
+    cout << *it << "\t" << d1sr << "\t" << d1dr << "\t" << d1drf << endl;
     if (abs(d1sr - d1dr) > 0.000001) return 1;
+    if (abs(d1dr - d1drf) > 0.000001) return 1;
+  }
+
+  //The VVVdouble accessors return copies of the arrays with the flat layout:
+  const DRASDRTreeLikelihoodData* data = tldr.getLikelihoodData();
+  const DRASDRTreeLikelihoodData* dataf = tldrf.getLikelihoodData();
+  vector<const Node*> nodes = dynamic_cast<const TreeTemplate<Node>&>(tldr.getTree()).getNodes();
+  for (size_t k = 0; k < nodes.size(); ++k) {
+    int id = nodes[k]->getId();
+    const map<int, VVVdouble>& arrays = data->getLikelihoodArrays(id);
+    const map<int, VVVdouble>& arraysf = dataf->getLikelihoodArrays(id);
+    if (arrays.size() != arraysf.size()) return 1;
+    for (map<int, VVVdouble>::const_iterator it = arrays.begin(); it != arrays.end(); ++it) {
+      if (arraysf.find(it->first) == arraysf.end()) return 1;
+      const VVVdouble& arrayf = dataf->getLikelihoodArray(id, it->first);
+      for (size_t i = 0; i < it->second.size(); ++i)
+        for (size_t c = 0; c < it->second[i].size(); ++c)
+          for (size_t x = 0; x < it->second[i][c].size(); ++x)
+            if (abs(it->second[i][c][x] - arrayf[i][c][x]) > 0.000001) return 1;
+    }
   }
 
   return 0;
@@ -0,0 +1,147 @@
+//
+// File: test_likelihood_kernels.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Phyl/Likelihood/LikelihoodKernels.h>
+#include <Bpp/Phyl/Likelihood/StateLikelihoodKernels.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+//Compare all available instruction sets to a naive implementation.
+bool testKernels(size_t nbStates, bool transpose) {
+  size_t nbClasses = 3;
+  size_t nbSites = 7;
+  size_t stateStride = nbStates + 1; //Unpadded and unaligned vectors.
+  VVVdouble pxy(nbClasses, VVdouble(nbStates, Vdouble(nbStates)));
+  for (size_t c = 0; c < nbClasses; ++c)
+    for (size_t x = 0; x < nbStates; ++x)
+      for (size_t y = 0; y < nbStates; ++y)
+        pxy[c][x][y] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+  vector<double> in(nbSites * nbClasses * stateStride), out(in.size());
+  for (size_t k = 0; k < in.size(); ++k) {
+    in[k]  = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+    out[k] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+  }
+  vector<double> ref = out;
+  for (size_t i = 0; i < nbSites; ++i)
+    for (size_t c = 0; c < nbClasses; ++c)
+      for (size_t x = 0; x < nbStates; ++x) {
+        size_t pos = (i * nbClasses + c) * stateStride;
+        double l = 0;
+        for (size_t y = 0; y < nbStates; ++y)
+          l += (transpose ? pxy[c][x][y] : pxy[c][y][x]) * in[pos + y];
+        ref[pos + x] *= l;
+      }
+
+  //The buffer is shared with the previous tests, which used other numbers of states:
+  vector<double>& packed = LikelihoodKernels::getPackingBuffer();
+  LikelihoodKernels::packTransitionMatrices(pxy, transpose, packed, nbClasses, nbStates);
+  size_t stride = LikelihoodKernels::getPackedStride(nbStates);
+  for (int is = 0; is <= static_cast<int>(LikelihoodKernels::getBestInstructionSet()); ++is) {
+    LikelihoodKernels::setInstructionSet(static_cast<LikelihoodKernels::InstructionSet>(is));
+    vector<double> out1 = out, out2 = out;
+    LikelihoodKernels::multiplyArray(&packed[0], stride, &in[0], &out1[0], nbSites, nbClasses, nbStates, stateStride);
+    for (size_t i = 0; i < nbSites; ++i)
+      for (size_t c = 0; c < nbClasses; ++c) {
+        size_t pos = (i * nbClasses + c) * stateStride;
+        LikelihoodKernels::multiply(&packed[c * nbStates * stride], stride, &in[pos], &out2[pos], nbStates);
+      }
+    for (size_t k = 0; k < ref.size(); ++k) {
+      if (abs(out1[k] - ref[k]) > 1e-10 || abs(out2[k] - ref[k]) > 1e-10) {
+        cerr << "Error with " << LikelihoodKernels::getInstructionSetName(LikelihoodKernels::getInstructionSet()) << " kernel for " << nbStates << " states." << endl;
+        return false;
+      }
+    }
+  }
+  LikelihoodKernels::setInstructionSet(LikelihoodKernels::getBestInstructionSet());
+  return true;
+}
+
+//Compare the state-specialized loops to the generic ones.
+bool testStateKernels(size_t nbStates) {
+  size_t nbClasses = 3;
+  size_t nbSites = 7;
+  VVVdouble pxy(nbClasses, VVdouble(nbStates, Vdouble(nbStates)));
+  for (size_t c = 0; c < nbClasses; ++c)
+    for (size_t x = 0; x < nbStates; ++x)
+      for (size_t y = 0; y < nbStates; ++y)
+        pxy[c][x][y] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+  VVVdouble in(nbSites + 1, VVdouble(nbClasses, Vdouble(nbStates))), out(nbSites, VVdouble(nbClasses, Vdouble(nbStates)));
+  for (size_t i = 0; i <= nbSites; ++i)
+    for (size_t c = 0; c < nbClasses; ++c)
+      for (size_t x = 0; x < nbStates; ++x) {
+        in[i][c][x] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+        if (i < nbSites) out[i][c][x] = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.);
+      }
+  vector<size_t> positions(nbSites);
+  for (size_t i = 0; i < nbSites; ++i)
+    positions[i] = nbSites - i;
+  Vdouble probs(nbClasses, 1. / static_cast<double>(nbClasses)), rootLik(nbSites, 0.5);
+
+  VVVdouble out1 = out, out2 = out;
+  StateLikelihoodKernels::multiply(pxy, in, &positions, out1, 0, nbSites, nbClasses, nbStates);
+  FixedStateLikelihoodKernels<0>::multiply(pxy, in, &positions, out2, 0, nbSites, nbClasses, nbStates);
+  Vdouble d1(nbSites), d2(nbSites);
+  StateLikelihoodKernels::derivative(pxy, in, out, probs, rootLik, d1, 0, nbSites, nbClasses, nbStates);
+  FixedStateLikelihoodKernels<0>::derivative(pxy, in, out, probs, rootLik, d2, 0, nbSites, nbClasses, nbStates);
+  for (size_t i = 0; i < nbSites; ++i) {
+    bool ok = abs(d1[i] - d2[i]) <= 1e-10 * abs(d2[i]);
+    for (size_t c = 0; c < nbClasses; ++c)
+      for (size_t x = 0; x < nbStates; ++x)
+        ok = ok && abs(out1[i][c][x] - out2[i][c][x]) <= 1e-10 * abs(out2[i][c][x]);
+    if (!ok) {
+      cerr << "Error with state-specialized loops for " << nbStates << " states." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  cout << "Best instruction set: " << LikelihoodKernels::getInstructionSetName(LikelihoodKernels::getBestInstructionSet()) << endl;
+  size_t nbStates[] = { 2, 3, 4, 5, 9, 20, 33, 61, 64, 70 };
+  for (size_t k = 0; k < 10; ++k) {
+    if (!testKernels(nbStates[k], true) || !testKernels(nbStates[k], false) || !testStateKernels(nbStates[k]))
+      return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,123 @@
+//
+// File: test_likelihood_parallel.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+//Compute the likelihood with a given parallel mode, compare it to the sequential value and report timing.
+template<class TreeLikelihoodType>
+bool testParallelMode(TreeLikelihoodType& tl, const string& modeName, short mode, size_t nbThreads, double refLogL) {
+  tl.setNumberOfThreads(nbThreads);
+  tl.setParallelMode(mode);
+  unsigned int nbRep = 20;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (unsigned int r = 0; r < nbRep; ++r)
+    tl.computeTreeLikelihood();
+  double time = chrono::duration<double>(chrono::steady_clock::now() - start).count() / nbRep;
+  double logL = tl.getLogLikelihood();
+  cout << modeName << "\t" << nbThreads << " thread(s)\t" << time * 1000. << " ms\t" << setprecision(20) << logL << endl;
+  if (abs(logL - refLogL) > 1e-9) {
+    cerr << "Parallel computation differs from the sequential one." << endl;
+    return false;
+  }
+  return true;
+}
+
+template<class TreeLikelihoodType>
+bool testParallelModes(TreeLikelihoodType& tl, const string& name) {
+  tl.initialize();
+  double refLogL = tl.getLogLikelihood();
+  cout << "Testing " << name << "..." << endl;
+  cout << "Sequential:\t\t\t\t" << setprecision(20) << refLogL << endl;
+  size_t nbThreads[] = { 1, 2, 4 };
+  for (size_t k = 0; k < 3; ++k) {
+    if (!testParallelMode(tl, "Site blocks", AbstractDiscreteRatesAcrossSitesTreeLikelihood::PARALLEL_SITES, nbThreads[k], refLogL))
+      return false;
+    if (!testParallelMode(tl, "Subtrees", AbstractDiscreteRatesAcrossSitesTreeLikelihood::PARALLEL_SUBTREES, nbThreads[k], refLogL))
+      return false;
+  }
+  return true;
+}
+
+int main() {
+  //A large tree with few sites, where subtree parallelism should be the most efficient:
+  vector<string> leavesNames;
+  for (size_t i = 0; i < 512; ++i)
+    leavesNames.push_back("L" + TextTools::toString(i));
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leavesNames, false));
+  tree->setBranchLengths(0.05);
+
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  T92 model(alphabet, 3.);
+  GammaDiscreteRateDistribution rdist(4, 1.0);
+  HomogeneousSequenceSimulator simulator(&model, &rdist, tree.get());
+  unique_ptr<SiteContainer> sites(simulator.simulate(50));
+
+  try {
+    RHomogeneousTreeLikelihood tlsr(*tree, *sites, &model, &rdist, true, false);
+    if (!testParallelModes(tlsr, "Single Tree Traversal likelihood class"))
+      return 1;
+    DRHomogeneousTreeLikelihood tldr(*tree, *sites, &model, &rdist, true, false);
+    if (!testParallelModes(tldr, "Double Tree Traversal likelihood class"))
+      return 1;
+    DRHomogeneousTreeLikelihood tldrf(*tree, *sites, &model, &rdist, true, false);
+    tldrf.setFlatLikelihoodArrays(true);
+    if (!testParallelModes(tldrf, "Double Tree Traversal likelihood class with flat arrays"))
+      return 1;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
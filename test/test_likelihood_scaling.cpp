@@ -0,0 +1,212 @@
+//
+// File: test_likelihood_scaling.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Likelihood/RHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/DRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+bool isClose(double x, double ref, double tolerance) {
+  return abs(x - ref) <= tolerance * max(1., abs(ref));
+}
+
+//Values computed by a likelihood object, to be compared between scaled and unscaled computations.
+struct LikelihoodValues {
+  double logL;
+  vector<double> d1;
+  vector<double> d2;
+};
+
+template<class TreeLikelihoodType>
+LikelihoodValues computeValues(TreeLikelihoodType& tl, const vector<string>& brLenNames) {
+  LikelihoodValues values;
+  values.logL = tl.getLogLikelihood();
+  for (size_t i = 0; i < brLenNames.size(); ++i) {
+    values.d1.push_back(tl.getFirstOrderDerivative(brLenNames[i]));
+    values.d2.push_back(tl.getSecondOrderDerivative(brLenNames[i]));
+  }
+  return values;
+}
+
+bool compareValues(const LikelihoodValues& values, const LikelihoodValues& ref, const string& name) {
+  cout << name << ":\t" << setprecision(20) << values.logL << "\t" << ref.logL << endl;
+  if (!isClose(values.logL, ref.logL, 1e-10)) {
+    cerr << "Scaled log-likelihood differs from the unscaled one." << endl;
+    return false;
+  }
+  for (size_t i = 0; i < ref.d1.size(); ++i) {
+    if (!isClose(values.d1[i], ref.d1[i], 1e-8) || !isClose(values.d2[i], ref.d2[i], 1e-8)) {
+      cerr << "Scaled derivatives differ from the unscaled ones for branch " << i << "." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//Check that scaling prevents underflow on a tree where unscaled likelihoods vanish.
+template<class TreeLikelihoodType>
+bool testScalingUnderflow(TreeLikelihoodType& tl, const string& name) {
+  tl.setLikelihoodScaling(true);
+  tl.initialize();
+  double logL = tl.getLogLikelihood();
+  cout << name << ":\t" << setprecision(20) << logL << endl;
+  if (std::isinf(logL) || std::isnan(logL)) {
+    cerr << "Scaled likelihood underflowed." << endl;
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  T92 model(alphabet, 3.);
+  GammaDiscreteRateDistribution rdist(4, 1.0);
+
+  //A tree with long branches, where conditional likelihoods fall below the scaling threshold (2^-256)
+  //while site likelihoods remain above the smallest double, so that scaled and unscaled values can be compared:
+  vector<string> leavesNames;
+  for (size_t i = 0; i < 400; ++i)
+    leavesNames.push_back("L" + TextTools::toString(i));
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leavesNames, false));
+  tree->setBranchLengths(1.);
+  HomogeneousSequenceSimulator simulator(&model, &rdist, tree.get());
+  unique_ptr<SiteContainer> sites(simulator.simulate(50));
+
+  //A large tree with long branches, where site likelihoods are below the smallest double:
+  vector<string> bigLeavesNames;
+  for (size_t i = 0; i < 2000; ++i)
+    bigLeavesNames.push_back("L" + TextTools::toString(i));
+  unique_ptr<TreeTemplate<Node> > bigTree(TreeTemplateTools::getRandomTree(bigLeavesNames, false));
+  bigTree->setBranchLengths(1.);
+  HomogeneousSequenceSimulator bigSimulator(&model, &rdist, bigTree.get());
+  unique_ptr<SiteContainer> bigSites(bigSimulator.simulate(20));
+
+  try {
+    //Reference values, without scaling:
+    DRHomogeneousTreeLikelihood tldr(*tree, *sites, &model, &rdist, true, false);
+    tldr.initialize();
+    vector<string> brLenNames;
+    for (size_t i = 0; i < 10; ++i)
+      brLenNames.push_back("BrLen" + TextTools::toString(i));
+    LikelihoodValues ref = computeValues(tldr, brLenNames);
+    if (std::isinf(ref.logL)) {
+      cerr << "Unscaled likelihood underflowed, the test tree is too large." << endl;
+      return 1;
+    }
+
+    DRHomogeneousTreeLikelihood tldrs(*tree, *sites, &model, &rdist, true, false);
+    tldrs.setLikelihoodScaling(true);
+    tldrs.initialize();
+    //Make sure that arrays were actually rescaled:
+    const vector<int>& rootCounts = tldrs.getLikelihoodData()->getRootScalingCounts();
+    bool scaled = false;
+    for (size_t i = 0; i < rootCounts.size() && !scaled; ++i)
+      scaled = (rootCounts[i] > 0);
+    if (!scaled) {
+      cerr << "No site was rescaled, the test tree is too small." << endl;
+      return 1;
+    }
+    if (!compareValues(computeValues(tldrs, brLenNames), ref, "Double Tree Traversal likelihood class, scaled"))
+      return 1;
+
+    DRHomogeneousTreeLikelihood tldrfs(*tree, *sites, &model, &rdist, true, false);
+    tldrfs.setFlatLikelihoodArrays(true);
+    tldrfs.setLikelihoodScaling(true);
+    tldrfs.initialize();
+    if (!compareValues(computeValues(tldrfs, brLenNames), ref, "Double Tree Traversal likelihood class with flat arrays, scaled"))
+      return 1;
+
+    RHomogeneousTreeLikelihood tlsrs(*tree, *sites, &model, &rdist, true, false);
+    tlsrs.setLikelihoodScaling(true);
+    tlsrs.initialize();
+    if (!compareValues(computeValues(tlsrs, brLenNames), ref, "Single Tree Traversal likelihood class, scaled"))
+      return 1;
+
+    //NNI tests combine scaled arrays, and must match the unscaled ones:
+    NNIHomogeneousTreeLikelihood tlnni(*tree, *sites, &model, &rdist, true, false);
+    tlnni.initialize();
+    NNIHomogeneousTreeLikelihood tlnnis(*tree, *sites, &model, &rdist, true, false);
+    tlnnis.setLikelihoodScaling(true);
+    tlnnis.initialize();
+    NNIHomogeneousTreeLikelihood tlnnifs(*tree, *sites, &model, &rdist, true, false);
+    tlnnifs.setFlatLikelihoodArrays(true);
+    tlnnifs.setLikelihoodScaling(true);
+    tlnnifs.initialize();
+    vector<Node*> nodes = tree->getNodes();
+    size_t nbTests = 0;
+    for (size_t i = 0; i < nodes.size() && nbTests < 10; ++i) {
+      const Node* node = nodes[i];
+      if (!node->hasFather() || !node->getFather()->hasFather())
+        continue;
+      double diff = tlnni.testNNI(node->getId());
+      double diffs = tlnnis.testNNI(node->getId());
+      double difffs = tlnnifs.testNNI(node->getId());
+      cout << "NNI on node " << node->getId() << ":\t" << setprecision(20) << diffs << "\t" << difffs << "\t" << diff << endl;
+      if (!isClose(diffs, diff, 1e-6) || !isClose(difffs, diff, 1e-6)) {
+        cerr << "Scaled NNI test differs from the unscaled one." << endl;
+        return 1;
+      }
+      nbTests++;
+    }
+
+    RHomogeneousTreeLikelihood bigtlsr(*bigTree, *bigSites, &model, &rdist, true, false);
+    if (!testScalingUnderflow(bigtlsr, "Single Tree Traversal likelihood class, large tree"))
+      return 1;
+    DRHomogeneousTreeLikelihood bigtldr(*bigTree, *bigSites, &model, &rdist, true, false);
+    if (!testScalingUnderflow(bigtldr, "Double Tree Traversal likelihood class, large tree"))
+      return 1;
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -56,6 +56,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Phyl/Mapping/ProbabilisticSubstitutionMapping.h>
 #include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
 #include <iostream>
+#include <sstream>
 
 using namespace bpp;
 using namespace std;
@@ -175,6 +176,79 @@ int main() {
   ProbabilisticSubstitutionMapping* probMapUniDet = 
     SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniDet);
 
+  //Branches processed concurrently must give the same mapping:
+  unique_ptr<ProbabilisticSubstitutionMapping> probMapUniDetPar(
+    SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniDet, false, 3));
+  for (size_t j = 0; j < ids.size(); ++j) {
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t t = 0; t < probMapUniDet->getNumberOfSubstitutionTypes(); ++t) {
+        if ((*probMapUniDetPar)(j, i, t) != (*probMapUniDet)(j, i, t)) {
+          cerr << "Error, parallel mapping differs from the sequential one." << endl;
+          return 1;
+        }
+      }
+    }
+  }
+
+  //Binary round trip, into a mapping with the other layout:
+  for (unsigned int k = 0; k < 2; ++k) {
+    bool singlePrecision = (k == 1);
+    stringstream binary;
+    SubstitutionMappingTools::writeToBinaryStream(*probMapUniDet, binary, singlePrecision);
+    ProbabilisticSubstitutionMapping probMapRead(*tree, sCountUniDet, 0, ProbabilisticSubstitutionMapping::BRANCH_MAJOR);
+    SubstitutionMappingTools::readFromBinaryStream(binary, probMapRead);
+    if (probMapRead.getNumberOfSites() != n) {
+      cerr << "Error, wrong number of sites after binary round trip." << endl;
+      return 1;
+    }
+    for (size_t j = 0; j < probMapUniDet->getNumberOfBranches(); ++j) {
+      for (size_t i = 0; i < n; ++i) {
+        for (size_t t = 0; t < probMapUniDet->getNumberOfSubstitutionTypes(); ++t) {
+          double x = (*probMapUniDet)(j, i, t);
+          size_t jr = probMapRead.getNodeIndex(probMapUniDet->getNode(j)->getId());
+          double y = probMapRead(jr, i, t);
+          if (singlePrecision ? abs(x - y) > 1e-6 * abs(x) : x != y) {
+            cerr << "Error, binary round trip differs from the original mapping." << endl;
+            return 1;
+          }
+          //Deprecated per-site access:
+          if (probMapRead[i][jr][t] != y || (*probMapUniDet)[i][j][t] != x) {
+            cerr << "Error, per-site access differs from the strided one." << endl;
+            return 1;
+          }
+        }
+      }
+    }
+  }
+
+  //Mapping stored per site pattern must give the same numbers:
+  unique_ptr<ProbabilisticSubstitutionMapping> probMapUniDetComp(
+    SubstitutionMappingTools::computeSubstitutionVectors(drhtl, ids, *sCountUniDet, false, 1, true));
+  if (!probMapUniDetComp->isCompressed() || probMapUniDetComp->getNumberOfSites() != n) {
+    cerr << "Error, mapping is not compressed." << endl;
+    return 1;
+  }
+  cout << "Number of patterns: " << probMapUniDetComp->getNumberOfPatterns() << endl;
+  ProbabilisticSubstitutionMapping probMapUniDetExp(*probMapUniDetComp);
+  probMapUniDetExp.expand();
+  for (size_t j = 0; j < probMapUniDet->getNumberOfBranches(); ++j) {
+    vector<double> sum1 = SubstitutionMappingTools::computeSumForBranch(*probMapUniDet, j);
+    vector<double> sum2 = SubstitutionMappingTools::computeSumForBranch(*probMapUniDetComp, j);
+    for (size_t t = 0; t < probMapUniDet->getNumberOfSubstitutionTypes(); ++t) {
+      if (abs(sum1[t] - sum2[t]) > 1e-9 * abs(sum1[t])) {
+        cerr << "Error, compressed mapping gives different sums." << endl;
+        return 1;
+      }
+      for (size_t i = 0; i < n; ++i) {
+        if ((*probMapUniDetComp)(j, i, t) != (*probMapUniDet)(j, i, t) || probMapUniDetExp(j, i, t) != (*probMapUniDet)(j, i, t)
+            || (*probMapUniDetComp)[i][j][t] != (*probMapUniDet)(j, i, t)) {
+          cerr << "Error, compressed mapping differs from the expanded one." << endl;
+          return 1;
+        }
+      }
+    }
+  }
+
   //Check saturation:
   cout << "checking saturation..." << endl;
   m = sCountUniDet->getAllNumbersOfSubstitutions(0.001,1);
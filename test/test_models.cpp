@@ -38,6 +38,8 @@ knowledge of the CeCILL license and that you accept its terms.
 */
 
 #include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Nucleotide/gBGC.h>
+#include <Bpp/Phyl/Model/Protein/LG08.h>
 #include <Bpp/Phyl/Model/Codon/YN98.h>
 #include <Bpp/Phyl/Model/FrequenciesSet/CodonFrequenciesSet.h>
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
@@ -49,6 +51,7 @@ knowledge of the CeCILL license and that you accept its terms.
 #include <Bpp/Numeric/AbstractParametrizable.h>
 #include <Bpp/Numeric/Random/RandomTools.h>
 #include <iostream>
+#include <memory>
 
 using namespace bpp;
 using namespace std;
@@ -77,10 +80,126 @@ class DummyFunction:
 
 };
 
+//Compare the cached transition probabilities with the ones computed without cache:
+bool testTransitionProbabilities(const SubstitutionModel& model, const AbstractSubstitutionModel& refModel) {
+  double times[] = { 0., 0.1, 0.5, 0.1 };
+  size_t n = model.getNumberOfStates();
+  vector<double> batch(4 * n * n);
+  model.computePij_t(vector<double>(times, times + 4), &batch[0]);
+  for (size_t k = 0; k < 4; ++k) {
+    const Matrix<double>& refPijt = refModel.getPij_t(times[k]);
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        if (abs(batch[(k * n + i) * n + j] - refPijt(i, j)) > 1e-12) {
+          cerr << "ERROR: batched transition probabilities differ for t = " << times[k] << endl;
+          return false;
+        }
+      }
+    }
+  }
+  for (size_t k = 0; k < 4; ++k) {
+    const Matrix<double>& pijt = model.getPij_t(times[k]);
+    const Matrix<double>& refPijt = refModel.getPij_t(times[k]);
+    const Matrix<double>& dpijt = model.getdPij_dt(times[k]);
+    const Matrix<double>& refdPijt = refModel.getdPij_dt(times[k]);
+    for (size_t i = 0; i < model.getNumberOfStates(); ++i) {
+      for (size_t j = 0; j < model.getNumberOfStates(); ++j) {
+        if (abs(pijt(i, j) - refPijt(i, j)) > 1e-12 || abs(dpijt(i, j) - refdPijt(i, j)) > 1e-12) {
+          cerr << "ERROR: cached transition probabilities differ for t = " << times[k] << endl;
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+//Check that the eigen decomposition reconstructs the generator:
+bool testEigenDecomposition(const SubstitutionModel& model) {
+  if (!model.isDiagonalizable()) return true;
+  const Matrix<double>& q = model.getGenerator();
+  const Matrix<double>& left = model.getRowLeftEigenVectors();
+  const Matrix<double>& right = model.getColumnRightEigenVectors();
+  const Vdouble& lambda = model.getEigenValues();
+  size_t n = model.getNumberOfStates();
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      double qij = 0, id = 0;
+      for (size_t k = 0; k < n; ++k) {
+        qij += right(i, k) * lambda[k] * left(k, j);
+        id += left(i, k) * right(k, j);
+      }
+      if (abs(qij - q(i, j)) > 1e-10 || abs(id - (i == j ? 1. : 0.)) > 1e-10) {
+        cerr << "ERROR: eigen decomposition does not match the generator." << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//Check that transition probabilities are stochastic matrices, with P(t1 + t2) = P(t1) * P(t2):
+bool testExponential(const SubstitutionModel& model) {
+  size_t n = model.getNumberOfStates();
+  RowMatrix<double> p1 = model.getPij_t(0.2);
+  RowMatrix<double> p2 = model.getPij_t(1.3);
+  RowMatrix<double> p12 = model.getPij_t(1.5);
+  for (size_t i = 0; i < n; ++i) {
+    double sum = 0;
+    for (size_t j = 0; j < n; ++j) {
+      double pij = 0;
+      for (size_t k = 0; k < n; ++k)
+        pij += p1(i, k) * p2(k, j);
+      if (p12(i, j) < -1e-12 || abs(pij - p12(i, j)) > 1e-10) {
+        cerr << "ERROR: transition probabilities do not match for " << i << " -> " << j << endl;
+        return false;
+      }
+      sum += p12(i, j);
+    }
+    if (abs(sum - 1.) > 1e-10) {
+      cerr << "ERROR: transition probabilities from " << i << " do not sum to 1." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//Compare transition probabilities and their derivatives with the ones of a reference model:
+bool testAgainstReference(const SubstitutionModel& model, const SubstitutionModel& refModel) {
+  double times[] = { 0.001, 0.1, 0.7, 3., 20. };
+  size_t n = model.getNumberOfStates();
+  for (size_t k = 0; k < 5; ++k) {
+    RowMatrix<double> pijt = model.getPij_t(times[k]);
+    RowMatrix<double> dpijt = model.getdPij_dt(times[k]);
+    RowMatrix<double> d2pijt = model.getd2Pij_dt2(times[k]);
+    const Matrix<double>& refPijt = refModel.getPij_t(times[k]);
+    const Matrix<double>& refdPijt = refModel.getdPij_dt(times[k]);
+    const Matrix<double>& refd2Pijt = refModel.getd2Pij_dt2(times[k]);
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        if (abs(pijt(i, j) - refPijt(i, j)) > 1e-10
+            || abs(dpijt(i, j) - refdPijt(i, j)) > 1e-8
+            || abs(d2pijt(i, j) - refd2Pijt(i, j)) > 1e-8) {
+          cerr << "ERROR: transition probabilities differ from the reference for t = " << times[k] << endl;
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 bool testModel(SubstitutionModel& model) {
   ParameterList pl = model.getParameters();
   DummyFunction df(model);
   ReparametrizationFunctionWrapper redf(&df, pl, false);
+  //A copy of the model without cache, and a cache for the model itself, if it can have one:
+  unique_ptr<AbstractSubstitutionModel> refModel;
+  if (dynamic_cast<AbstractSubstitutionModel*>(&model)) {
+    refModel.reset(dynamic_cast<AbstractSubstitutionModel*>(model.clone()));
+    refModel->setTransitionProbabilitiesCacheSize(0);
+    dynamic_cast<AbstractSubstitutionModel&>(model).setTransitionProbabilitiesCacheSize(32);
+  }
 
   //Try to modify randomly each parameter and check that the new parameter apply correctly:
   for (unsigned int i = 0; i < 10; ++i) {
@@ -97,6 +216,13 @@ bool testModel(SubstitutionModel& model) {
     //pl2.printParameters(cout);
     //Now apply the new parameters and retrieve them again:
     model.matchParametersValues(pl2);
+    if (!testEigenDecomposition(model))
+      return false;
+    if (refModel.get()) {
+      refModel->matchParametersValues(pl2);
+      if (!testTransitionProbabilities(model, *refModel))
+        return false;
+    }
     ParameterList pl3 = model.getParameters();
     //Compare the two lists:
     for (size_t j = 0; j < pl.size(); ++j) {
@@ -110,10 +236,52 @@ bool testModel(SubstitutionModel& model) {
   return true;
 }
 
+//Check that the transition probabilities cache is invalidated when the frequencies change:
+bool testCacheInvalidation(AbstractSubstitutionModel& model) {
+  unique_ptr<AbstractSubstitutionModel> refModel(model.clone());
+  refModel->setTransitionProbabilitiesCacheSize(0);
+  model.setTransitionProbabilitiesCacheSize(32);
+  model.getPij_t(0.1);
+  map<int, double> freqs;
+  size_t n = model.getNumberOfStates();
+  for (size_t i = 0; i < n; ++i)
+    freqs[static_cast<int>(i)] = static_cast<double>(i + 1) * 2. / static_cast<double>(n * (n + 1));
+  model.setFreq(freqs);
+  refModel->setFreq(freqs);
+  return testTransitionProbabilities(model, *refModel);
+}
+
 int main() {
   //Nucleotide models:
   GTR gtr(&AlphabetTools::DNA_ALPHABET);
   if (!testModel(gtr)) return 1;
+  gBGC gbgc(&AlphabetTools::DNA_ALPHABET, new GTR(&AlphabetTools::DNA_ALPHABET), 0.5);
+  if (!testCacheInvalidation(gbgc)) return 1;
+
+  //Pade approximant, compared to the eigen decomposition:
+  gtr.setParameterValue("a", 2.);
+  gtr.setParameterValue("theta", 0.3);
+  unique_ptr<GTR> gtrPade(gtr.clone());
+  gtrPade->enableEigenDecomposition(false);
+  gtrPade->setParameterValue("b", 0.4);
+  gtr.setParameterValue("b", 0.4);
+  if (gtrPade->isDiagonalizable()) return 1;
+  if (!testAgainstReference(*gtrPade, gtr)) return 1;
+  if (!testExponential(*gtrPade)) return 1;
+
+  //Protein models:
+  LG08 lg08(&AlphabetTools::PROTEIN_ALPHABET);
+  if (!testEigenDecomposition(lg08)) return 1;
+  unique_ptr<LG08> lg08Pade(lg08.clone());
+  lg08Pade->enableEigenDecomposition(false);
+  map<int, double> freqs;
+  for (size_t i = 0; i < 20; ++i)
+    freqs[static_cast<int>(i)] = static_cast<double>(i + 1) / 210.;
+  lg08Pade->setFreq(freqs);
+  lg08.setFreq(freqs);
+  if (lg08Pade->isDiagonalizable()) return 1;
+  if (!testAgainstReference(*lg08Pade, lg08)) return 1;
+  if (!testExponential(*lg08Pade)) return 1;
 
   //Codon models:
   StandardGeneticCode gc(&AlphabetTools::DNA_ALPHABET);
@@ -122,6 +290,12 @@ int main() {
   YN98 yn98(&gc, fset);
   if (!testModel(yn98)) return 1;
 
+  //Codon model without eigen decomposition:
+  unique_ptr<YN98> yn98Sparse(yn98.clone());
+  yn98Sparse->enableEigenDecomposition(false);
+  yn98Sparse->setParameterValue("omega", 0.5);
+  if (!testExponential(*yn98Sparse)) return 1;
+
   delete codonAlphabet;
 
   return 0;
@@ -0,0 +1,118 @@
+//
+// File: test_newick.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Io/NewickParser.h>
+#include <iostream>
+#include <sstream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  vector<string> leaves(100);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf" + TextTools::toString(i);
+
+  // Write a random tree with branch lengths and bootstrap values, and read it again:
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leaves, true));
+  vector<Node*> nodes = tree->getNodes();
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (nodes[i]->hasFather())
+      nodes[i]->setDistanceToFather(static_cast<double>(i % 7) / 8.);
+    if (nodes[i]->hasFather() && !nodes[i]->isLeaf())
+      nodes[i]->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(static_cast<double>(i % 100)));
+  }
+  string description = TreeTemplateTools::treeToParenthesis(*tree);
+  unique_ptr<TreeTemplate<Node> > tree2(TreeTemplateTools::parenthesisToTree(description, true, TreeTools::BOOTSTRAP, false, false));
+  if (TreeTemplateTools::treeToParenthesis(*tree2) != description) {
+    cerr << "Tree was not read properly:" << endl << description << endl << TreeTemplateTools::treeToParenthesis(*tree2) << endl;
+    return 1;
+  }
+
+  // Node ids:
+  description = TreeTemplateTools::treeToParenthesis(*tree, true);
+  tree2.reset(TreeTemplateTools::parenthesisToTree(description, true, TreeTools::BOOTSTRAP, true, false));
+  if (TreeTemplateTools::treeToParenthesis(*tree2, true) != description) {
+    cerr << "Node ids were not read properly." << endl;
+    return 1;
+  }
+
+  // Comments and line breaks:
+  Newick newick(true);
+  newick.enableExtendedBootstrapProperty("label");
+  stringstream text("[A comment] ((A:0.1[x],\n B : 0.2)\n 95 : 0.3 [y], C)[z];");
+  tree2.reset(newick.read(text));
+  if (tree2->getNumberOfLeaves() != 3 || tree2->getNode("B")->getDistanceToFather() != 0.2) {
+    cerr << "Comments were not handled properly." << endl;
+    return 1;
+  }
+
+  // A deep tree, which cannot be parsed with recursive calls:
+  size_t depth = 100000;
+  string caterpillar(depth, '(');
+  caterpillar += "A";
+  for (size_t i = 0; i < depth; ++i)
+    caterpillar += ",B" + TextTools::toString(i) + ":1)";
+  caterpillar += ";";
+  NewickParser parser;
+  parser.parse(caterpillar);
+  if (parser.getNumberOfElements() != 2 * depth + 1) {
+    cerr << "Wrong number of nodes in caterpillar tree: " << parser.getNumberOfElements() << endl;
+    return 1;
+  }
+
+  // Bad formats:
+  const char* bad[3] = { "((A,B);", "(A,B));", "(A,B)" };
+  for (size_t i = 0; i < 3; ++i) {
+    try {
+      unique_ptr<TreeTemplate<Node> > tree3(TreeTemplateTools::parenthesisToTree(bad[i], true, TreeTools::BOOTSTRAP, false, false));
+      cerr << "Bad description was parsed: " << bad[i] << endl;
+      return 1;
+    } catch (Exception& e) {
+      cout << e.what() << endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,147 @@
+//
+// File: test_nni_parallel.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Likelihood/NNIHomogeneousTreeLikelihood.h>
+#include <iostream>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  vector<string> leavesNames;
+  for (size_t i = 0; i < 20; ++i)
+    leavesNames.push_back("L" + TextTools::toString(i));
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leavesNames, false));
+  tree->setBranchLengths(0.05);
+
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  K80 model(alphabet, 3.);
+  GammaDiscreteDistribution rdist(4, 0.5);
+  HomogeneousSequenceSimulator simulator(&model, &rdist, tree.get());
+  unique_ptr<SiteContainer> sites(simulator.simulate(500));
+
+  try {
+    // Score NNIs on a different random topology, so that some of them improve the likelihood:
+    unique_ptr<TreeTemplate<Node> > start(TreeTemplateTools::getRandomTree(leavesNames, false));
+    start->setBranchLengths(0.05);
+    NNIHomogeneousTreeLikelihood tl(*start, *sites, model.clone(), rdist.clone(), true, false);
+    tl.initialize();
+
+    vector<int> nodeIds;
+    vector<const Node*> nodes = dynamic_cast<const TreeTemplate<Node>&>(tl.getTopology()).getNodes();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (nodes[i]->hasFather() && nodes[i]->getFather()->hasFather())
+        nodeIds.push_back(nodes[i]->getId());
+    }
+
+    vector<double> ref(nodeIds.size());
+    for (size_t i = 0; i < nodeIds.size(); ++i)
+      ref[i] = tl.testNNI(nodeIds[i]);
+
+    size_t nbThreads[] = { 2, 4 };
+    for (size_t k = 0; k < 2; ++k) {
+      tl.setNumberOfThreads(nbThreads[k]);
+      vector<double> diffs;
+      tl.testNNIs(nodeIds, diffs);
+      for (size_t i = 0; i < nodeIds.size(); ++i) {
+        cout << nodeIds[i] << "\t" << ref[i] << "\t" << diffs[i] << endl;
+        if (abs(diffs[i] - ref[i]) > 1e-6) {
+          cerr << "Parallel NNI score differs from the sequential one for node " << nodeIds[i] << endl;
+          return 1;
+        }
+      }
+    }
+
+    // Blocks are kept between calls, their model must follow parameter changes:
+    tl.setParameterValue("K80.kappa", 1.5);
+    tl.setNumberOfThreads(1);
+    vector<double> ref2(nodeIds.size());
+    for (size_t i = 0; i < nodeIds.size(); ++i)
+      ref2[i] = tl.testNNI(nodeIds[i]);
+    tl.setNumberOfThreads(4);
+    vector<double> diffs2;
+    tl.testNNIs(nodeIds, diffs2);
+    for (size_t i = 0; i < nodeIds.size(); ++i) {
+      if (abs(diffs2[i] - ref2[i]) > 1e-6) {
+        cerr << "Parallel NNI score differs from the sequential one after a parameter change for node " << nodeIds[i] << endl;
+        return 1;
+      }
+    }
+
+    // ...and changes of the model which are not parameter changes:
+    dynamic_cast<AbstractSubstitutionModel*>(tl.getSubstitutionModel())->setScale(2.);
+    tl.setNumberOfThreads(1);
+    vector<double> ref3(nodeIds.size());
+    for (size_t i = 0; i < nodeIds.size(); ++i)
+      ref3[i] = tl.testNNI(nodeIds[i]);
+    tl.setNumberOfThreads(4);
+    vector<double> diffs3;
+    tl.testNNIs(nodeIds, diffs3);
+    for (size_t i = 0; i < nodeIds.size(); ++i) {
+      if (abs(diffs3[i] - ref3[i]) > 1e-6) {
+        cerr << "Parallel NNI score differs from the sequential one after a change of scale for node " << nodeIds[i] << endl;
+        return 1;
+      }
+    }
+
+    // Scores must not depend on the storage layout either:
+    NNIHomogeneousTreeLikelihood tlf(*start, *sites, model.clone(), rdist.clone(), true, false);
+    tlf.setFlatLikelihoodArrays(true);
+    tlf.initialize();
+    for (size_t i = 0; i < nodeIds.size(); ++i) {
+      double diff = tlf.testNNI(nodeIds[i]);
+      if (abs(diff - ref[i]) > 1e-6) {
+        cerr << "NNI score with flat arrays differs from the default one for node " << nodeIds[i] << ": " << diff << " vs " << ref[i] << endl;
+        return 1;
+      }
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -37,16 +37,170 @@ The fact that you are presently reading this means that you have had
 knowledge of the CeCILL license and that you accept its terms.
 */
 
+#include <Bpp/Text/TextTools.h>
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
 #include <Bpp/Seq/Io/Phylip.h>
 #include <Bpp/Phyl/Tree.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
 #include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/StateMap.h>
 #include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
 #include <iostream>
+#include <memory>
+#include <random>
 
 using namespace bpp;
 using namespace std;
 
+// Reference Fitch implementation, with one set of states per node and site, as used before ParsimonyBitsetArray:
+
+vector<bool> referenceFitch(const Node* node, const SiteContainer& sites, size_t site, const StateMap& stateMap, unsigned int& score)
+{
+  size_t nbStates = stateMap.getNumberOfModelStates();
+  vector<bool> states(nbStates, false);
+  if (node->isLeaf())
+  {
+    vector<int> alias = sites.getAlphabet()->getAlias(sites.getSequence(node->getName()).getValue(site));
+    for (size_t s = 0; s < nbStates; s++)
+      for (size_t j = 0; j < alias.size(); j++)
+        if (stateMap.getAlphabetStateAsInt(s) == alias[j])
+          states[s] = true;
+    return states;
+  }
+  states = referenceFitch(node->getSon(0), sites, site, stateMap, score);
+  for (size_t k = 1; k < node->getNumberOfSons(); k++)
+  {
+    vector<bool> sonStates = referenceFitch(node->getSon(k), sites, site, stateMap, score);
+    vector<bool> inter(nbStates, false);
+    bool empty = true;
+    for (size_t s = 0; s < nbStates; s++)
+    {
+      inter[s] = states[s] && sonStates[s];
+      if (inter[s]) empty = false;
+    }
+    if (empty)
+    {
+      for (size_t s = 0; s < nbStates; s++)
+        states[s] = states[s] || sonStates[s];
+      score++;
+    }
+    else
+      states = inter;
+  }
+  return states;
+}
+
+unsigned int referenceScoreForSite(const Tree& tree, const SiteContainer& sites, size_t site, const StateMap& stateMap)
+{
+  TreeTemplate<Node> ttree(tree);
+  unsigned int score = 0;
+  referenceFitch(ttree.getRootNode(), sites, site, stateMap, score);
+  return score;
+}
+
+// Model states restricted to sense codons:
+class SenseCodonStateMap:
+  public AbstractStateMap
+{
+public:
+  SenseCodonStateMap(const GeneticCode& gc):
+    AbstractStateMap(gc.getSourceAlphabet())
+  {
+    for (int i = 0; i < static_cast<int>(alphabet_->getSize()); ++i) {
+      if (!gc.isStop(i))
+        states_.push_back(i);
+    }
+  }
+
+  SenseCodonStateMap* clone() const { return new SenseCodonStateMap(*this); }
+
+  std::string getStateDescription(size_t index) const { return getAlphabetStateAsChar(index); }
+};
+
+// Random alignment where each site is mostly drawn among two states, with some duplicated sites:
+VectorSiteContainer* getRandomSites(const vector<string>& names, size_t nbSites, const vector<string>& states, const Alphabet* alphabet, mt19937& rng)
+{
+  uniform_int_distribution<size_t> stateDist(0, states.size() - 1);
+  vector< vector<string> > columns(nbSites, vector<string>(names.size()));
+  for (size_t i = 0; i < nbSites; i++)
+  {
+    if (i % 5 == 4)
+    {
+      columns[i] = columns[i - 3];
+      continue;
+    }
+    string s1 = states[stateDist(rng)];
+    string s2 = states[stateDist(rng)];
+    for (size_t j = 0; j < names.size(); j++)
+    {
+      size_t draw = rng() % 10;
+      columns[i][j] = draw < 6 ? s1 : (draw < 9 ? s2 : states[stateDist(rng)]);
+    }
+  }
+  VectorSiteContainer* sites = new VectorSiteContainer(alphabet);
+  for (size_t j = 0; j < names.size(); j++)
+  {
+    string seq;
+    for (size_t i = 0; i < nbSites; i++)
+      seq += columns[i][j];
+    sites->addSequence(BasicSequence(names[j], seq, alphabet));
+  }
+  return sites;
+}
+
+// Compare the total and site scores, and the score changes of all NNIs, to the reference implementation:
+bool testAgainstReference(const DRTreeParsimonyScore& pars, const SiteContainer& sites)
+{
+  const StateMap& stateMap = pars.getStateMap();
+  unsigned int refScore = 0;
+  for (size_t i = 0; i < sites.getNumberOfSites(); i++)
+  {
+    unsigned int refSite = referenceScoreForSite(pars.getTree(), sites, i, stateMap);
+    if (pars.getScoreForSite(i) != refSite)
+    {
+      cerr << "Wrong score for site " << i << ": " << pars.getScoreForSite(i) << " instead of " << refSite << endl;
+      return false;
+    }
+    refScore += refSite;
+  }
+  cout << "Parsimony score: " << pars.getScore() << " (reference: " << refScore << ")" << endl;
+  if (pars.getScore() != refScore) return false;
+
+  TreeTemplate<Node> tree(pars.getTree());
+  vector<Node*> nodes = tree.getNodes();
+  for (size_t k = 0; k < nodes.size(); k++)
+  {
+    Node* son = nodes[k];
+    if (!son->hasFather() || !son->getFather()->hasFather()) continue;
+    // Same swap as DRTreeParsimonyScore::doNNI:
+    TreeTemplate<Node> nniTree(tree);
+    Node* nniSon = nniTree.getNode(son->getId());
+    Node* parent = nniSon->getFather();
+    Node* grandFather = parent->getFather();
+    size_t parentPosition = grandFather->getSonPosition(parent);
+    Node* uncle = grandFather->getSon(parentPosition > 1 ? parentPosition - 1 : 1 - parentPosition);
+    parent->removeSon(nniSon);
+    grandFather->removeSon(uncle);
+    parent->addSon(uncle);
+    grandFather->addSon(nniSon);
+
+    unsigned int nniScore = 0;
+    for (size_t i = 0; i < sites.getNumberOfSites(); i++)
+      nniScore += referenceScoreForSite(nniTree, sites, i, stateMap);
+    double diff = pars.testNNI(son->getId());
+    if (diff != static_cast<double>(nniScore) - static_cast<double>(refScore))
+    {
+      cerr << "Wrong score change for NNI on node " << son->getId() << ": " << diff << " instead of " << (static_cast<double>(nniScore) - static_cast<double>(refScore)) << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
 int main() {
   try {
     Newick treeReader;
@@ -55,15 +209,61 @@ int main() {
     unique_ptr<SiteContainer> sites(alnReader.readAlignment("example1.ph", &AlphabetTools::DNA_ALPHABET));
 
     DRTreeParsimonyScore pars(*tree, *sites, true, true);
-  
+
     cout << "Parsimony score: " << pars.getScore() << endl;
 
     if (pars.getScore() != 9) return 1;
-    
+    if (!testAgainstReference(pars, *sites)) return 1;
+
+    mt19937 rng(11);
+
+    // Nucleotides, with gaps and ambiguities, over several blocks of sites:
+    vector<string> dnaNames;
+    for (size_t i = 0; i < 20; i++)
+      dnaNames.push_back("S" + TextTools::toString(i));
+    vector<string> dnaStates;
+    dnaStates.push_back("A");
+    dnaStates.push_back("C");
+    dnaStates.push_back("G");
+    dnaStates.push_back("T");
+    dnaStates.push_back("N");
+    dnaStates.push_back("R");
+    dnaStates.push_back("Y");
+    dnaStates.push_back("-");
+    unique_ptr<VectorSiteContainer> dnaSites(getRandomSites(dnaNames, 150, dnaStates, &AlphabetTools::DNA_ALPHABET, rng));
+    for (unsigned int r = 0; r < 3; r++)
+    {
+      unique_ptr<Tree> dnaTree(TreeTemplateTools::getRandomTree(dnaNames, false));
+      DRTreeParsimonyScore dnaPars(*dnaTree, *dnaSites, false, r % 2 == 1);
+      if (!testAgainstReference(dnaPars, *dnaSites)) return 1;
+    }
+
+    // Codons, with 61 model states:
+    StandardGeneticCode gc(&AlphabetTools::DNA_ALPHABET);
+    const CodonAlphabet* codonAlphabet = gc.getSourceAlphabet();
+    SenseCodonStateMap codonStateMap(gc);
+    if (codonStateMap.getNumberOfModelStates() != 61) return 1;
+    vector<string> codonNames;
+    for (size_t i = 0; i < 12; i++)
+      codonNames.push_back("C" + TextTools::toString(i));
+    vector<string> codonStates;
+    for (int i = 0; i < static_cast<int>(codonAlphabet->getSize()); i++)
+      if (!gc.isStop(i))
+        codonStates.push_back(codonAlphabet->intToChar(i));
+    codonStates.push_back("NNN");
+    codonStates.push_back("---");
+    unique_ptr<VectorSiteContainer> codonSites(getRandomSites(codonNames, 100, codonStates, codonAlphabet, rng));
+    for (unsigned int r = 0; r < 2; r++)
+    {
+      unique_ptr<Tree> codonTree(TreeTemplateTools::getRandomTree(codonNames, false));
+      DRTreeParsimonyScore codonPars(*codonTree, *codonSites, &codonStateMap, false);
+      if (!testAgainstReference(codonPars, *codonSites)) return 1;
+    }
+
   } catch (Exception& ex) {
     cerr << ex.what() << endl;
     return 1;
-  }  
+  }
 
   return 0;
 }
@@ -0,0 +1,118 @@
+//
+// File: test_spr.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Numeric/Prob/GammaDiscreteDistribution.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Simulation/HomogeneousSequenceSimulator.h>
+#include <Bpp/Phyl/Likelihood/SPRHomogeneousTreeLikelihood.h>
+#include <Bpp/Phyl/SPRTopologySearch.h>
+#include <iostream>
+#include <memory>
+#include <cmath>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  vector<string> leavesNames;
+  for (size_t i = 0; i < 15; ++i)
+    leavesNames.push_back("L" + TextTools::toString(i));
+  unique_ptr<TreeTemplate<Node> > tree(TreeTemplateTools::getRandomTree(leavesNames, false));
+  tree->setBranchLengths(0.05);
+
+  const NucleicAlphabet* alphabet = &AlphabetTools::DNA_ALPHABET;
+  K80 model(alphabet, 3.);
+  GammaDiscreteDistribution rdist(4, 0.5);
+  HomogeneousSequenceSimulator simulator(&model, &rdist, tree.get());
+  unique_ptr<SiteContainer> sites(simulator.simulate(300));
+
+  try {
+    // Start from a different random topology, so that some movements improve the likelihood:
+    unique_ptr<TreeTemplate<Node> > start(TreeTemplateTools::getRandomTree(leavesNames, false));
+    start->setBranchLengths(0.05);
+    SPRHomogeneousTreeLikelihood tl(*start, *sites, model.clone(), rdist.clone(), true, false);
+    tl.initialize();
+
+    // The score of a movement must be the likelihood variation after the movement is performed:
+    vector<const Node*> nodes = dynamic_cast<const TreeTemplate<Node>&>(tl.getTopology()).getNodes();
+    size_t nbChecked = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const Node* node = nodes[i];
+      if (!node->hasFather() || !node->getFather()->hasFather() || node->getFather()->getNumberOfSons() != 2)
+        continue;
+      vector<int> regraftIds, rerootIds;
+      vector<double> diffs;
+      tl.testSPRs(node->getId(), 3, 2, regraftIds, rerootIds, diffs);
+      for (size_t j = 0; j < diffs.size(); j += 7) {
+        unique_ptr<SPRHomogeneousTreeLikelihood> tl2(tl.clone());
+        tl2->doSPR(node->getId(), regraftIds[j], rerootIds[j]);
+        tl2->topologyChangePerformed(TopologyChangeEvent());
+        double diff = tl2->getValue() - tl.getValue();
+        cout << node->getId() << "\t" << regraftIds[j] << "\t" << rerootIds[j] << "\t" << diffs[j] << "\t" << diff << endl;
+        if (abs(diff - diffs[j]) > 1e-4) {
+          cerr << "Incorrect score for movement of node " << node->getId() << endl;
+          return 1;
+        }
+        nbChecked++;
+      }
+    }
+    if (nbChecked == 0) {
+      cerr << "No movement was tested." << endl;
+      return 1;
+    }
+
+    // A search must not decrease the likelihood:
+    double initialValue = tl.getValue();
+    SPRTopologySearch search(tl, 3, 1, 0);
+    search.search();
+    cout << "Initial value: " << initialValue << ", final value: " << tl.getValue() << endl;
+    if (tl.getValue() > initialValue + 1e-6) {
+      cerr << "SPR search decreased the likelihood." << endl;
+      return 1;
+    }
+  } catch (Exception& ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,142 @@
+//
+// File: test_tree_iterator.cpp
+// Created by: Bio++ Development Team
+// Created on: Sat Oct 17 2026
+//
+
+/*
+Copyright or © or Copr. Bio++ Development Team, (November 17, 2004)
+
+This software is a computer program whose purpose is to provide classes
+for numerical calculus. This file is part of the Bio++ project.
+
+This software is governed by the CeCILL  license under French law and
+abiding by the rules of distribution of free software.  You can  use, 
+modify and/ or redistribute the software under the terms of the CeCILL
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info". 
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability. 
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or 
+data to be ensured and,  more generally, to use and operate it in the 
+same conditions as regards security. 
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL license and that you accept its terms.
+*/
+
+
+#include <Bpp/Numeric/Number.h>
+#include <Bpp/Phyl/TreeTemplate.h>
+#include <Bpp/Phyl/TreeTemplateTools.h>
+#include <Bpp/Phyl/TreeTools.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <iostream>
+#include <sstream>
+#include <memory>
+
+using namespace bpp;
+using namespace std;
+
+int main() {
+  vector<string> leaves(20);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    leaves[i] = "leaf" + TextTools::toString(i);
+
+  vector<Tree*> trees;
+  for (size_t i = 0; i < 30; ++i)
+    trees.push_back(TreeTemplateTools::getRandomTree(leaves, i % 2 == 0));
+  for (size_t i = 0; i < 20; ++i)
+    trees.push_back(new TreeTemplate<Node>(*dynamic_cast<TreeTemplate<Node>*>(trees[i % 3])));
+
+  Newick newick;
+  stringstream text;
+  newick.write(trees, text);
+  string content = text.str();
+
+  // Read back all trees one by one:
+  stringstream in1(content);
+  unique_ptr<TreeIterator> it(newick.getTreeIterator(in1));
+  size_t nbTrees = 0;
+  while (it->hasMoreTrees()) {
+    unique_ptr<Tree> tree(it->nextTree());
+    if (TreeTools::robinsonFouldsDistance(*tree, *trees[nbTrees]) != 0) {
+      cerr << "Tree " << nbTrees << " differs from the one written." << endl;
+      return 1;
+    }
+    nbTrees++;
+  }
+  cout << nbTrees << " trees read." << endl;
+  if (nbTrees != trees.size())
+    return 1;
+
+  // Consensus trees:
+  double thresholds[3] = { 0., 0.5, 1. };
+  for (size_t i = 0; i < 3; ++i) {
+    stringstream in(content);
+    it.reset(newick.getTreeIterator(in));
+    unique_ptr<TreeTemplate<Node> > cons1(TreeTools::thresholdConsensus(trees, thresholds[i]));
+    unique_ptr<TreeTemplate<Node> > cons2(TreeTools::thresholdConsensus(*it, thresholds[i]));
+    if (TreeTools::robinsonFouldsDistance(*cons1, *cons2) != 0) {
+      cerr << "Consensus trees differ for threshold " << thresholds[i] << "." << endl;
+      return 1;
+    }
+  }
+
+  // Bipartition scores:
+  stringstream in2(content);
+  it.reset(newick.getTreeIterator(in2));
+  vector<size_t> scores1, scores2;
+  unique_ptr<BipartitionList> bipL1(TreeTools::bipartitionOccurrences(trees, scores1));
+  unique_ptr<BipartitionList> bipL2(TreeTools::bipartitionOccurrences(*it, scores2));
+  if (scores1 != scores2 || bipL1->getNumberOfBipartitions() != bipL2->getNumberOfBipartitions()) {
+    cerr << "Bipartition scores differ." << endl;
+    return 1;
+  }
+
+  // Bootstrap values:
+  stringstream in3(content);
+  it.reset(newick.getTreeIterator(in3));
+  TreeTemplate<Node> tree1(*dynamic_cast<TreeTemplate<Node>*>(trees[0]));
+  TreeTemplate<Node> tree2(tree1);
+  TreeTools::computeBootstrapValues(tree1, trees, false);
+  TreeTools::computeBootstrapValues(tree2, *it, false);
+  vector<int> ids = tree1.getInnerNodesId();
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (!tree1.hasBranchProperty(ids[i], TreeTools::BOOTSTRAP))
+      continue;
+    double b1 = dynamic_cast<const Number<double>*>(tree1.getBranchProperty(ids[i], TreeTools::BOOTSTRAP))->getValue();
+    double b2 = dynamic_cast<const Number<double>*>(tree2.getBranchProperty(ids[i], TreeTools::BOOTSTRAP))->getValue();
+    if (b1 != b2) {
+      cerr << "Bootstrap values differ: " << b1 << " and " << b2 << "." << endl;
+      return 1;
+    }
+  }
+
+  // Robinson-Foulds distances:
+  stringstream in4(content);
+  it.reset(newick.getTreeIterator(in4));
+  vector<int> distances = TreeTools::robinsonFouldsDistances(*trees[0], *it);
+  for (size_t i = 0; i < trees.size(); ++i) {
+    if (distances[i] != TreeTools::robinsonFouldsDistance(*trees[0], *trees[i])) {
+      cerr << "Wrong Robinson-Foulds distance for tree " << i << ": " << distances[i] << endl;
+      return 1;
+    }
+  }
+
+  for (size_t i = 0; i < trees.size(); ++i)
+    delete trees[i];
+  return 0;
+}